@@ -0,0 +1,136 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey and Eclipse engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file alloccount.cpp
+ *  Counting the allocations of one thread, for xoreos-modelbench.
+ */
+
+/* We count the allocations of one thread, by replacing the global
+ * allocation functions. Other threads, like the ones decoding textures,
+ * aren't counted, but they allocate at the same time, so the counting
+ * state is guarded by a mutex. That's a plain SDL mutex, because a
+ * Common::Mutex might not be constructed yet when the first allocations
+ * happen.
+ *
+ * The replacement functions live in their own file, so that the compiler
+ * doesn't inline their malloc() and free() into code that it sees calling
+ * operator new and delete. */
+
+#include <cstdlib>
+#include <new>
+
+#include <SDL_thread.h>
+
+#include "alloccount.h"
+
+static SDL_mutex *allocMutex    = 0;     ///< Guards the counting state.
+static bool       allocCounting = false; ///< Are we counting allocations?
+static uint32     allocThread   = 0;     ///< The thread whose allocations we count.
+static uint32     allocCount    = 0;     ///< Number of allocations counted.
+static uint64     allocSize     = 0;     ///< Bytes allocated.
+
+void initAllocationCounting() {
+	allocMutex = SDL_CreateMutex();
+}
+
+void deinitAllocationCounting() {
+	SDL_mutex *mutex = allocMutex;
+	allocMutex = 0;
+
+	SDL_DestroyMutex(mutex);
+}
+
+void startAllocationCounting() {
+	SDL_LockMutex(allocMutex);
+
+	allocCount = 0;
+	allocSize  = 0;
+
+	allocThread   = SDL_ThreadID();
+	allocCounting = true;
+
+	SDL_UnlockMutex(allocMutex);
+}
+
+void stopAllocationCounting(uint32 &count, uint64 &size) {
+	SDL_LockMutex(allocMutex);
+
+	allocCounting = false;
+
+	count = allocCount;
+	size  = allocSize;
+
+	SDL_UnlockMutex(allocMutex);
+}
+
+static void countAllocation(std::size_t size) {
+	if (!allocMutex)
+		return;
+
+	SDL_LockMutex(allocMutex);
+
+	if (allocCounting && (SDL_ThreadID() == allocThread)) {
+		allocCount++;
+		allocSize += size;
+	}
+
+	SDL_UnlockMutex(allocMutex);
+}
+
+static void *allocate(std::size_t size) {
+	countAllocation(size);
+
+	void *ptr = std::malloc((size > 0) ? size : 1);
+	if (!ptr)
+		throw std::bad_alloc();
+
+	return ptr;
+}
+
+void *operator new(std::size_t size) throw(std::bad_alloc) {
+	return allocate(size);
+}
+
+void *operator new[](std::size_t size) throw(std::bad_alloc) {
+	return allocate(size);
+}
+
+void operator delete(void *ptr) throw() {
+	std::free(ptr);
+}
+
+void operator delete[](void *ptr) throw() {
+	std::free(ptr);
+}
+
+// The sized forms, used instead of the ones above when compiling for C++14 and newer
+
+void operator delete(void *ptr, std::size_t) throw() {
+	std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) throw() {
+	std::free(ptr);
+}
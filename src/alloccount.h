@@ -0,0 +1,45 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey and Eclipse engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file alloccount.h
+ *  Counting the allocations of one thread, for xoreos-modelbench.
+ */
+
+#ifndef ALLOCCOUNT_H
+#define ALLOCCOUNT_H
+
+#include "common/types.h"
+
+/** Create the mutex guarding the counting state. Call before any other thread exists. */
+void initAllocationCounting();
+/** Destroy the mutex guarding the counting state. Call after all other threads are gone. */
+void deinitAllocationCounting();
+
+/** Start counting the allocations of the calling thread. */
+void startAllocationCounting();
+/** Stop counting allocations, and return what has been counted. */
+void stopAllocationCounting(uint32 &count, uint64 &size);
+
+#endif // ALLOCCOUNT_H
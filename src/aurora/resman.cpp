@@ -59,7 +59,7 @@ static const char *kArchiveGlob[Aurora::kArchiveMAX] = {
 namespace Aurora {
 
 ResourceManager::Resource::Resource() : type(kFileTypeNone), priority(0),
-		source(kSourceNone), archive(0), archiveIndex(0xFFFFFFFF) {
+		source(kSourceNone), archive(0), archiveIndex(0xFFFFFFFF), serial(0) {
 }
 
 bool ResourceManager::Resource::operator<(const Resource &right) const {
@@ -82,7 +82,7 @@ ResourceManager::ChangeID::ChangeID(ChangeSetList::iterator c) : _empty(false),
 }
 
 
-ResourceManager::ResourceManager() : _rimsAreERFs(false) {
+ResourceManager::ResourceManager() : _rimsAreERFs(false), _lastSerial(0) {
 	_resourceTypeTypes[kResourceImage].push_back(kFileTypeDDS);
 	_resourceTypeTypes[kResourceImage].push_back(kFileTypeTPC);
 	_resourceTypeTypes[kResourceImage].push_back(kFileTypeTXB);
@@ -122,6 +122,8 @@ ResourceManager::~ResourceManager() {
 }
 
 void ResourceManager::clear() {
+	Common::StackLock lock(_mutex);
+
 	_rimsAreERFs = false;
 
 	_cursorRemap.clear();
@@ -136,6 +138,7 @@ void ResourceManager::clear() {
 	for (ArchiveList::iterator archive = _archives.begin(); archive != _archives.end(); ++archive)
 		delete *archive;
 	_archives.clear();
+	_archivePaths.clear();
 
 	_resources.clear();
 
@@ -217,13 +220,15 @@ bool ResourceManager::hasArchive(ArchiveType archive, const Common::UString &fil
 ResourceManager::ChangeID ResourceManager::addArchive(ArchiveType archive,
 		const Common::UString &file, uint32 priority) {
 
+	Common::StackLock lock(_mutex);
+
 	// NDS aren't found in resource directories, they are used /instead/ of directories
 	if (archive == kArchiveNDS) {
 		NDSFile *nds = new NDSFile(file);
 
 		ChangeID change = newChangeSet();
 
-		return indexArchive(nds, priority, change);
+		return indexArchive(nds, file, priority, change);
 	}
 
 	// HERF files are only found inside NDS files
@@ -232,7 +237,7 @@ ResourceManager::ChangeID ResourceManager::addArchive(ArchiveType archive,
 
 		ChangeID change = newChangeSet();
 
-		return indexArchive(herf, priority, change);
+		return indexArchive(herf, "", priority, change);
 	}
 
 	assert((archive >= 0) && (archive < kArchiveMAX));
@@ -252,7 +257,7 @@ ResourceManager::ChangeID ResourceManager::addArchive(ArchiveType archive,
 
 		ChangeID change = newChangeSet();
 
-		return indexArchive(erf, priority, change);
+		return indexArchive(erf, realName, priority, change);
 	}
 
 	if (archive == kArchiveRIM) {
@@ -260,7 +265,7 @@ ResourceManager::ChangeID ResourceManager::addArchive(ArchiveType archive,
 
 		ChangeID change = newChangeSet();
 
-		return indexArchive(rim, priority, change);
+		return indexArchive(rim, realName, priority, change);
 	}
 
 	if (archive == kArchiveZIP) {
@@ -268,7 +273,7 @@ ResourceManager::ChangeID ResourceManager::addArchive(ArchiveType archive,
 
 		ChangeID change = newChangeSet();
 
-		return indexArchive(zip, priority, change);
+		return indexArchive(zip, realName, priority, change);
 	}
 
 	if (archive == kArchiveEXE) {
@@ -276,7 +281,7 @@ ResourceManager::ChangeID ResourceManager::addArchive(ArchiveType archive,
 
 		ChangeID change = newChangeSet();
 
-		return indexArchive(pe, priority, change);
+		return indexArchive(pe, realName, priority, change);
 	}
 
 	return ChangeID();
@@ -338,15 +343,21 @@ ResourceManager::ChangeID ResourceManager::indexKEY(const Common::UString &file,
 
 	ChangeID change = newChangeSet();
 
-	for (std::vector<BIFFile *>::iterator bifFile = bifFiles.begin(); bifFile != bifFiles.end(); ++bifFile)
-		indexArchive(*bifFile, priority, change);
+	for (uint32 i = 0; i < bifFiles.size(); i++)
+		indexArchive(bifFiles[i], bifs[i], priority, change);
 
 	return change;
 }
 
-ResourceManager::ChangeID ResourceManager::indexArchive(Archive *archive, uint32 priority, ChangeID &change) {
+ResourceManager::ChangeID ResourceManager::indexArchive(Archive *archive, const Common::UString &file,
+		uint32 priority, ChangeID &change) {
+
 	_archives.push_back(archive);
 
+	// Archives found within other archives don't have a file of their own
+	if (!file.empty())
+		_archivePaths[archive] = file;
+
 	// Add the information of the new archive to the change set
 	change._change->archives.push_back(--_archives.end());
 
@@ -372,6 +383,8 @@ ResourceManager::ChangeID ResourceManager::indexArchive(Archive *archive, uint32
 ResourceManager::ChangeID ResourceManager::addResourceDir(const Common::UString &dir,
 		const char *glob, int depth, uint32 priority) {
 
+	Common::StackLock lock(_mutex);
+
 	// Find the directory
 	Common::UString directory = Common::FilePath::findSubDirectory(_baseDir, dir, true);
 	if (directory.empty())
@@ -399,6 +412,8 @@ ResourceManager::ChangeID ResourceManager::addResourceDir(const Common::UString
 }
 
 void ResourceManager::undo(ChangeID &change) {
+	Common::StackLock lock(_mutex);
+
 	if (change.empty() || (change._change == _changes.end()))
 		// Nothing to do
 		return;
@@ -423,6 +438,8 @@ void ResourceManager::undo(ChangeID &change) {
 	for (std::list<ArchiveList::iterator>::iterator archiveChange = change._change->archives.begin();
 	     archiveChange != change._change->archives.end(); ++archiveChange) {
 
+		_archivePaths.erase(**archiveChange);
+
 		delete **archiveChange;
 		_archives.erase(*archiveChange);
 	}
@@ -436,6 +453,8 @@ void ResourceManager::undo(ChangeID &change) {
 }
 
 void ResourceManager::addTypeAlias(FileType alias, FileType realType) {
+	Common::StackLock lock(_mutex);
+
 	_typeAliases[alias] = realType;
 }
 
@@ -448,6 +467,8 @@ bool ResourceManager::hasResource(const Common::UString &name, FileType type) co
 }
 
 bool ResourceManager::hasResource(const Common::UString &name, const std::vector<FileType> &types) const {
+	Common::StackLock lock(_mutex);
+
 	if (getRes(name, types))
 		return true;
 
@@ -486,6 +507,8 @@ Common::SeekableReadStream *ResourceManager::getResource(const Common::UString &
 Common::SeekableReadStream *ResourceManager::getResource(const Common::UString &name,
 		const std::vector<FileType> &types, FileType *foundType) const {
 
+	Common::StackLock lock(_mutex);
+
 	const Resource *res = getRes(name, types);
 	if (!res)
 		return 0;
@@ -528,9 +551,84 @@ Common::SeekableReadStream *ResourceManager::getResource(ResourceType resType,
 	return 0;
 }
 
+uint32 ResourceManager::getResourceSerial(ResourceType resType, const Common::UString &name) const {
+	assert((resType >= 0) && (resType < kResourceMAX));
+
+	Common::StackLock lock(_mutex);
+
+	const Resource *res = getRes(name, _resourceTypeTypes[resType]);
+	if (!res)
+		return 0;
+
+	return res->serial;
+}
+
+uint32 ResourceManager::getResourceSerial(const Common::UString &name, FileType type) const {
+	Common::StackLock lock(_mutex);
+
+	std::vector<FileType> types;
+
+	types.push_back(type);
+
+	const Resource *res = getRes(name, types);
+	if (!res)
+		return 0;
+
+	return res->serial;
+}
+
+bool ResourceManager::getResourceOrigin(ResourceType resType, const Common::UString &name,
+		ResourceOrigin &origin) const {
+
+	assert((resType >= 0) && (resType < kResourceMAX));
+
+	Common::StackLock lock(_mutex);
+
+	return getResourceOrigin(getRes(name, _resourceTypeTypes[resType]), origin);
+}
+
+bool ResourceManager::getResourceOrigin(const Common::UString &name, FileType type,
+		ResourceOrigin &origin) const {
+
+	std::vector<FileType> types;
+
+	types.push_back(type);
+
+	Common::StackLock lock(_mutex);
+
+	return getResourceOrigin(getRes(name, types), origin);
+}
+
+bool ResourceManager::getResourceOrigin(const Resource *res, ResourceOrigin &origin) const {
+	if (!res)
+		return false;
+
+	if (res->source == kSourceArchive) {
+		std::map<const Archive *, Common::UString>::const_iterator file = _archivePaths.find(res->archive);
+		if (file == _archivePaths.end())
+			return false;
+
+		origin.file  = file->second;
+		origin.index = res->archiveIndex;
+
+	} else if (res->source == kSourceFile) {
+		origin.file  = res->path;
+		origin.index = 0;
+
+	} else
+		return false;
+
+	origin.size = getResourceSize(*res);
+	origin.type = res->type;
+
+	return true;
+}
+
 void ResourceManager::getAvailableResources(FileType type,
 		std::list<ResourceID> &list) const {
 
+	Common::StackLock lock(_mutex);
+
 	for (ResourceMap::const_iterator r = _resources.begin(); r != _resources.end(); ++r)
 		for (ResourceTypeMap::const_iterator rt = r->second.begin(); rt != r->second.end(); ++rt)
 			if (rt->first == type) {
@@ -545,6 +643,8 @@ void ResourceManager::getAvailableResources(FileType type,
 void ResourceManager::getAvailableResources(const std::vector<FileType> &types,
 		std::list<ResourceID> &list) const {
 
+	Common::StackLock lock(_mutex);
+
 	for (ResourceMap::const_iterator r = _resources.begin(); r != _resources.end(); ++r)
 		for (ResourceTypeMap::const_iterator rt = r->second.begin(); rt != r->second.end(); ++rt)
 			for (std::vector<FileType>::const_iterator wt = types.begin(); wt != types.end(); ++wt)
@@ -606,6 +706,7 @@ void ResourceManager::addResource(Resource &resource, Common::UString name, Chan
 
 	// Add the resource to the list
 	resList->second.push_back(resource);
+	resList->second.back().serial = ++_lastSerial;
 
 	// And sort the list by priority
 	resList->second.sort();
@@ -650,6 +751,8 @@ const ResourceManager::Resource *ResourceManager::getRes(Common::UString name,
 }
 
 void ResourceManager::dumpResourcesList(const Common::UString &fileName) const {
+	Common::StackLock lock(_mutex);
+
 	Common::DumpFile file;
 
 	if (!file.open(fileName))
@@ -38,6 +38,7 @@
 #include "common/types.h"
 #include "common/ustring.h"
 #include "common/singleton.h"
+#include "common/mutex.h"
 #include "common/filelist.h"
 
 #include "aurora/types.h"
@@ -54,6 +55,11 @@ class BIFFile;
 
 /** A resource manager holding information about and handling all request for all
  *  resources useable by the game.
+ *
+ *  Looking up and reading resources is safe from any thread. All lookups and
+ *  all changes to the indexed resources are serialized by one lock, so
+ *  background threads can read resources while the main thread (un)indexes
+ *  archives.
  */
 class ResourceManager : public Common::Singleton<ResourceManager> {
 // Type definitions
@@ -86,6 +92,8 @@ private:
 		// For kSourceFile
 		Common::UString path; ///< The file's path.
 
+		uint32 serial; ///< A number unique to this resource, never given out twice.
+
 		Resource();
 
 		bool operator<(const Resource &right) const;
@@ -119,6 +127,14 @@ public:
 		FileType type;
 	};
 
+	/** The place a resource's data is read from. */
+	struct ResourceOrigin {
+		Common::UString file; ///< The archive or resource file holding the data.
+		uint32 index;         ///< The resource's index within the archive.
+		uint32 size;          ///< The resource's size in bytes.
+		FileType type;        ///< The resource's type.
+	};
+
 	/** ID of a set of changes produced by a manager operation. */
 	class ChangeID {
 	public:
@@ -254,6 +270,36 @@ public:
 	Common::SeekableReadStream *getResource(ResourceType resType,
 			const Common::UString &name, FileType *foundType = 0) const;
 
+	/** Return a number identifying the resource a name currently resolves to.
+	 *
+	 *  Resources are numbered when they're indexed, and no number is ever given
+	 *  out twice. So if the number is still the same, the name still refers to
+	 *  the same data, while even re-indexing the same archive gives new numbers.
+	 *
+	 *  @param  resType The type of the resource.
+	 *  @param  name The name (ResRef) of the resource.
+	 *  @return The resource's number, or 0 if the resource doesn't exist.
+	 */
+	uint32 getResourceSerial(ResourceType resType, const Common::UString &name) const;
+	/** Return a number identifying the resource a name currently resolves to.
+	 *  See getResourceSerial(ResourceType, const Common::UString &). */
+	uint32 getResourceSerial(const Common::UString &name, FileType type) const;
+
+	/** Find the file the data of a resource is read from.
+	 *
+	 *  This allows caching data derived from the resource, as long as the
+	 *  file stays unchanged.
+	 *
+	 *  @param  resType The type of the resource.
+	 *  @param  name The name (ResRef) of the resource.
+	 *  @param  origin The place the resource's data is read from.
+	 *  @return false if the resource doesn't exist, or isn't read from a file
+	 *          directly, like resources inside archives within archives.
+	 */
+	bool getResourceOrigin(ResourceType resType, const Common::UString &name, ResourceOrigin &origin) const;
+	/** Find the file the data of a resource of this type is read from. */
+	bool getResourceOrigin(const Common::UString &name, FileType type, ResourceOrigin &origin) const;
+
 	/** Return a list of all available resources of the specified type. */
 	void getAvailableResources(FileType type, std::list<ResourceID> &list) const;
 	/** Return a list of all available resources of the specified type. */
@@ -267,6 +313,8 @@ public:
 private:
 	bool _rimsAreERFs; ///< Are .rim files actually ERF files?
 
+	uint32 _lastSerial; ///< The last number given to a resource.
+
 	std::vector<Common::UString> _cursorRemap; ///< Cursor ID -> cursor name
 
 	Common::UString _baseDir;     ///< The data base directory.
@@ -276,6 +324,8 @@ private:
 
 	ArchiveList _archives; ///< List of currently used archives.
 
+	std::map<const Archive *, Common::UString> _archivePaths; ///< The files the archives were opened from.
+
 	std::map<FileType, FileType> _typeAliases;
 
 	ResourceMap _resources;
@@ -284,11 +334,13 @@ private:
 
 	FileTypeList _resourceTypeTypes[kResourceMAX]; ///< All valid resource type file types.
 
+	mutable Common::Mutex _mutex; ///< Protects the indexed resources and archives.
+
 	Common::UString findArchive(const Common::UString &file,
 			const DirectoryList &dirs, const Common::FileList &files);
 
 	ChangeID indexKEY(const Common::UString &file, uint32 priority);
-	ChangeID indexArchive(Archive *archive, uint32 priority, ChangeID &change);
+	ChangeID indexArchive(Archive *archive, const Common::UString &file, uint32 priority, ChangeID &change);
 
 	// KEY/BIF loading helpers
 	void findBIFs   (const KEYFile &key, std::vector<Common::UString> &bifs);
@@ -299,6 +351,8 @@ private:
 
 	const Resource *getRes(Common::UString name, const std::vector<FileType> &types) const;
 
+	bool getResourceOrigin(const Resource *res, ResourceOrigin &origin) const;
+
 	Common::SeekableReadStream *getArchiveResource(const Resource &res) const;
 
 	uint32 getResourceSize(const Resource &res) const;
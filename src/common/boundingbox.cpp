@@ -78,15 +78,15 @@ void BoundingBox::getMin(float &x, float &y, float &z) const {
 		return;
 	}
 
-	TransformationMatrix min = _origin;
-	min.translate(_min[0], _min[1], _min[2]);
+	float minX = _min[0], minY = _min[1], minZ = _min[2];
+	_origin.transformPoint(minX, minY, minZ);
 
-	TransformationMatrix max = _origin;
-	max.translate(_max[0], _max[1], _max[2]);
+	float maxX = _max[0], maxY = _max[1], maxZ = _max[2];
+	_origin.transformPoint(maxX, maxY, maxZ);
 
-	x = MIN(min.getX(), max.getX());
-	y = MIN(min.getY(), max.getY());
-	z = MIN(min.getZ(), max.getZ());
+	x = MIN(minX, maxX);
+	y = MIN(minY, maxY);
+	z = MIN(minZ, maxZ);
 }
 
 void BoundingBox::getMax(float &x, float &y, float &z) const {
@@ -97,15 +97,15 @@ void BoundingBox::getMax(float &x, float &y, float &z) const {
 		return;
 	}
 
-	TransformationMatrix min = _origin;
-	min.translate(_min[0], _min[1], _min[2]);
+	float minX = _min[0], minY = _min[1], minZ = _min[2];
+	_origin.transformPoint(minX, minY, minZ);
 
-	TransformationMatrix max = _origin;
-	max.translate(_max[0], _max[1], _max[2]);
+	float maxX = _max[0], maxY = _max[1], maxZ = _max[2];
+	_origin.transformPoint(maxX, maxY, maxZ);
 
-	x = MAX(min.getX(), max.getX());
-	y = MAX(min.getY(), max.getY());
-	z = MAX(min.getZ(), max.getZ());
+	x = MAX(minX, maxX);
+	y = MAX(minY, maxY);
+	z = MAX(minZ, maxZ);
 }
 
 float BoundingBox::getWidth() const {
@@ -276,7 +276,7 @@ void BoundingBox::rotate(float angle, float x, float y, float z) {
 	_absolute = false;
 }
 
-void BoundingBox::transform(const Matrix &m) {
+void BoundingBox::transform(const Matrix4x4 &m) {
 	_origin *= m;
 	_absolute = false;
 }
@@ -310,11 +310,11 @@ void BoundingBox::absolutize() {
 
 	float coords[8][3];
 	for (int i = 0; i < 8; i++) {
-		TransformationMatrix c = _origin;
+		coords[i][0] = _coords[i][0];
+		coords[i][1] = _coords[i][1];
+		coords[i][2] = _coords[i][2];
 
-		c.translate(_coords[i][0], _coords[i][1], _coords[i][2]);
-
-		c.getPosition(coords[i][0], coords[i][1], coords[i][2]);
+		_origin.transformPoint(coords[i][0], coords[i][1], coords[i][2]);
 	}
 
 	clear();
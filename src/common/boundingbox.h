@@ -66,7 +66,7 @@ public:
 
 	void rotate(float angle, float x, float y, float z);
 
-	void transform(const Matrix &m);
+	void transform(const Matrix4x4 &m);
 
 	/** Apply the origin transformations directly to the coordinates. */
 	void absolutize();
@@ -28,6 +28,7 @@
  */
 
 #include <list>
+#include <ctime>
 
 #include "boost/algorithm/string.hpp"
 #include "boost/system/config.hpp"
@@ -42,6 +43,8 @@ using boost::filesystem::exists;
 using boost::filesystem::is_regular_file;
 using boost::filesystem::is_directory;
 using boost::filesystem::file_size;
+using boost::filesystem::last_write_time;
+using boost::filesystem::create_directories;
 using boost::filesystem::directory_iterator;
 
 // boost-string_algo
@@ -73,6 +76,24 @@ uint32 FilePath::getFileSize(const UString &p) {
 	return size;
 }
 
+uint32 FilePath::getModificationTime(const UString &p) {
+	boost::system::error_code error;
+
+	std::time_t time = last_write_time(p.c_str(), error);
+	if (error || (time == ((std::time_t) -1)))
+		return kFileInvalid;
+
+	return time;
+}
+
+bool FilePath::createDirectories(const UString &p) {
+	boost::system::error_code error;
+
+	create_directories(p.c_str(), error);
+
+	return isDirectory(p);
+}
+
 UString FilePath::getStem(const UString &p) {
 	path file(p.c_str());
 
@@ -63,6 +63,20 @@ public:
 	 */
 	static uint32 getFileSize(const UString &p);
 
+	/** Return the time a file was last modified.
+	 *
+	 *  @param  p The file to look up.
+	 *  @return The modification time in seconds since the epoch, or kFileInvalid if not a valid file.
+	 */
+	static uint32 getModificationTime(const UString &p);
+
+	/** Create a directory, including all missing parent directories.
+	 *
+	 *  @param  p The directory to create.
+	 *  @return true if the directory exists now, false otherwise.
+	 */
+	static bool createDirectories(const UString &p);
+
 	/** Return a file name's stem.
 	 *
 	 *  Example: "/path/to/file.ext" -> "file"
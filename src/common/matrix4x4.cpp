@@ -0,0 +1,254 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey and Eclipse engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file common/matrix4x4.cpp
+ *  A fixed-size 4x4 matrix.
+ */
+
+#include <cstring>
+
+#include "common/error.h"
+#include "common/matrix4x4.h"
+
+#ifdef XOREOS_SSE2
+	#include <emmintrin.h>
+#endif
+
+static const float kIdentity[] = {
+	1.0, 0.0, 0.0, 0.0,
+	0.0, 1.0, 0.0, 0.0,
+	0.0, 0.0, 1.0, 0.0,
+	0.0, 0.0, 0.0, 1.0
+};
+
+namespace Common {
+
+Matrix4x4::Matrix4x4() {
+	loadIdentity();
+}
+
+Matrix4x4::Matrix4x4(const float *m) {
+	set(m);
+}
+
+const float *Matrix4x4::get() const {
+	return _elements;
+}
+
+void Matrix4x4::set(const float *m) {
+	memcpy(_elements, m, 16 * sizeof(float));
+}
+
+void Matrix4x4::loadIdentity() {
+	set(kIdentity);
+}
+
+float &Matrix4x4::operator()(int row, int column) {
+	return _elements[(column * 4) + row];
+}
+
+float Matrix4x4::operator()(int row, int column) const {
+	return _elements[(column * 4) + row];
+}
+
+Matrix4x4 Matrix4x4::operator*(const Matrix4x4 &right) const {
+	Matrix4x4 tmp(*this);
+
+	multiply(tmp._elements, _elements, right._elements);
+
+	return tmp;
+}
+
+Matrix4x4 &Matrix4x4::operator*=(const Matrix4x4 &right) {
+	multiply(_elements, _elements, right._elements);
+
+	return *this;
+}
+
+void Matrix4x4::transformPoint(float &x, float &y, float &z) const {
+	float v[4] = { x, y, z, 1.0 };
+
+	multiply(v, v);
+
+	x = v[0];
+	y = v[1];
+	z = v[2];
+}
+
+Matrix4x4 Matrix4x4::getTranspose() const {
+	Matrix4x4 tmp;
+
+	for (int i = 0; i < 4; i++)
+		for (int j = 0; j < 4; j++)
+			tmp(i, j) = (*this)(j, i);
+
+	return tmp;
+}
+
+void Matrix4x4::transpose() {
+	*this = getTranspose();
+}
+
+/** Calculate the first row of the adjugate of m. */
+static void getAdjugateRow0(const float *m, float *inv) {
+	inv[ 0] =  m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] +
+	           m[9] * m[ 7] * m[14] + m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+	inv[ 4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] -
+	           m[8] * m[ 7] * m[14] - m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+	inv[ 8] =  m[4] * m[ 9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] +
+	           m[8] * m[ 7] * m[13] + m[12] * m[5] * m[11] - m[12] * m[7] * m[ 9];
+	inv[12] = -m[4] * m[ 9] * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] -
+	           m[8] * m[ 6] * m[13] - m[12] * m[5] * m[10] + m[12] * m[6] * m[ 9];
+}
+
+float Matrix4x4::getDeterminant() const {
+	const float *m = _elements;
+
+	float inv[16];
+	getAdjugateRow0(m, inv);
+
+	return m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+}
+
+Matrix4x4 Matrix4x4::getInverse() const {
+	const float *m = _elements;
+
+	float inv[16];
+	getAdjugateRow0(m, inv);
+
+	const float det = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+	if (det == 0)
+		throw Exception("Matrix4x4::getInverse(): Determinant == 0");
+
+	inv[ 1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] -
+	           m[9] * m[ 3] * m[14] - m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+	inv[ 5] =  m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] +
+	           m[8] * m[ 3] * m[14] + m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+	inv[ 9] = -m[0] * m[ 9] * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] -
+	           m[8] * m[ 3] * m[13] - m[12] * m[1] * m[11] + m[12] * m[3] * m[ 9];
+	inv[13] =  m[0] * m[ 9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] +
+	           m[8] * m[ 2] * m[13] + m[12] * m[1] * m[10] - m[12] * m[2] * m[ 9];
+	inv[ 2] =  m[1] * m[ 6] * m[15] - m[1] * m[ 7] * m[14] - m[5] * m[2] * m[15] +
+	           m[5] * m[ 3] * m[14] + m[13] * m[2] * m[ 7] - m[13] * m[3] * m[ 6];
+	inv[ 6] = -m[0] * m[ 6] * m[15] + m[0] * m[ 7] * m[14] + m[4] * m[2] * m[15] -
+	           m[4] * m[ 3] * m[14] - m[12] * m[2] * m[ 7] + m[12] * m[3] * m[ 6];
+	inv[10] =  m[0] * m[ 5] * m[15] - m[0] * m[ 7] * m[13] - m[4] * m[1] * m[15] +
+	           m[4] * m[ 3] * m[13] + m[12] * m[1] * m[ 7] - m[12] * m[3] * m[ 5];
+	inv[14] = -m[0] * m[ 5] * m[14] + m[0] * m[ 6] * m[13] + m[4] * m[1] * m[14] -
+	           m[4] * m[ 2] * m[13] - m[12] * m[1] * m[ 6] + m[12] * m[2] * m[ 5];
+	inv[ 3] = -m[1] * m[ 6] * m[11] + m[1] * m[ 7] * m[10] + m[5] * m[2] * m[11] -
+	           m[5] * m[ 3] * m[10] - m[ 9] * m[2] * m[ 7] + m[ 9] * m[3] * m[ 6];
+	inv[ 7] =  m[0] * m[ 6] * m[11] - m[0] * m[ 7] * m[10] - m[4] * m[2] * m[11] +
+	           m[4] * m[ 3] * m[10] + m[ 8] * m[2] * m[ 7] - m[ 8] * m[3] * m[ 6];
+	inv[11] = -m[0] * m[ 5] * m[11] + m[0] * m[ 7] * m[ 9] + m[4] * m[1] * m[11] -
+	           m[4] * m[ 3] * m[ 9] - m[ 8] * m[1] * m[ 7] + m[ 8] * m[3] * m[ 5];
+	inv[15] =  m[0] * m[ 5] * m[10] - m[0] * m[ 6] * m[ 9] - m[4] * m[1] * m[10] +
+	           m[4] * m[ 2] * m[ 9] + m[ 8] * m[1] * m[ 6] - m[ 8] * m[2] * m[ 5];
+
+	const float invDet = 1.0f / det;
+	for (int i = 0; i < 16; i++)
+		inv[i] *= invDet;
+
+	return Matrix4x4(inv);
+}
+
+void Matrix4x4::invert() {
+	*this = getInverse();
+}
+
+bool Matrix4x4::isInvertible() const {
+	return getDeterminant() != 0;
+}
+
+#ifdef XOREOS_SSE2
+
+void Matrix4x4::multiply(const float *in, float *out) const {
+	const float x = in[0], y = in[1], z = in[2], w = in[3];
+
+	__m128 r =            _mm_mul_ps(_mm_loadu_ps(_elements +  0), _mm_set1_ps(x));
+	r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(_elements +  4), _mm_set1_ps(y)));
+	r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(_elements +  8), _mm_set1_ps(z)));
+	r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(_elements + 12), _mm_set1_ps(w)));
+
+	_mm_storeu_ps(out, r);
+}
+
+void Matrix4x4::multiply(float *out, const float *a, const float *b) {
+	// Load all of a first, so that out may alias a. Each column of out only
+	// depends on the same column of b, so out may alias b as well.
+
+	const __m128 a0 = _mm_loadu_ps(a +  0);
+	const __m128 a1 = _mm_loadu_ps(a +  4);
+	const __m128 a2 = _mm_loadu_ps(a +  8);
+	const __m128 a3 = _mm_loadu_ps(a + 12);
+
+	for (int i = 0; i < 16; i += 4) {
+		__m128 r =            _mm_mul_ps(a0, _mm_set1_ps(b[i + 0]));
+		r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_set1_ps(b[i + 1])));
+		r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_set1_ps(b[i + 2])));
+		r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_set1_ps(b[i + 3])));
+
+		_mm_storeu_ps(out + i, r);
+	}
+}
+
+#else
+
+void Matrix4x4::multiply(const float *in, float *out) const {
+	const float *e = _elements;
+	const float x = in[0], y = in[1], z = in[2], w = in[3];
+
+	out[0] = (e[0] * x) + (e[4] * y) + (e[ 8] * z) + (e[12] * w);
+	out[1] = (e[1] * x) + (e[5] * y) + (e[ 9] * z) + (e[13] * w);
+	out[2] = (e[2] * x) + (e[6] * y) + (e[10] * z) + (e[14] * w);
+	out[3] = (e[3] * x) + (e[7] * y) + (e[11] * z) + (e[15] * w);
+}
+
+void Matrix4x4::multiply(float *out, const float *a, const float *b) {
+	float t[16];
+
+	t[ 0] = (a[ 0] * b[ 0]) + (a[ 4] * b[ 1]) + (a[ 8] * b[ 2]) + (a[12] * b[ 3]);
+	t[ 1] = (a[ 1] * b[ 0]) + (a[ 5] * b[ 1]) + (a[ 9] * b[ 2]) + (a[13] * b[ 3]);
+	t[ 2] = (a[ 2] * b[ 0]) + (a[ 6] * b[ 1]) + (a[10] * b[ 2]) + (a[14] * b[ 3]);
+	t[ 3] = (a[ 3] * b[ 0]) + (a[ 7] * b[ 1]) + (a[11] * b[ 2]) + (a[15] * b[ 3]);
+	t[ 4] = (a[ 0] * b[ 4]) + (a[ 4] * b[ 5]) + (a[ 8] * b[ 6]) + (a[12] * b[ 7]);
+	t[ 5] = (a[ 1] * b[ 4]) + (a[ 5] * b[ 5]) + (a[ 9] * b[ 6]) + (a[13] * b[ 7]);
+	t[ 6] = (a[ 2] * b[ 4]) + (a[ 6] * b[ 5]) + (a[10] * b[ 6]) + (a[14] * b[ 7]);
+	t[ 7] = (a[ 3] * b[ 4]) + (a[ 7] * b[ 5]) + (a[11] * b[ 6]) + (a[15] * b[ 7]);
+	t[ 8] = (a[ 0] * b[ 8]) + (a[ 4] * b[ 9]) + (a[ 8] * b[10]) + (a[12] * b[11]);
+	t[ 9] = (a[ 1] * b[ 8]) + (a[ 5] * b[ 9]) + (a[ 9] * b[10]) + (a[13] * b[11]);
+	t[10] = (a[ 2] * b[ 8]) + (a[ 6] * b[ 9]) + (a[10] * b[10]) + (a[14] * b[11]);
+	t[11] = (a[ 3] * b[ 8]) + (a[ 7] * b[ 9]) + (a[11] * b[10]) + (a[15] * b[11]);
+	t[12] = (a[ 0] * b[12]) + (a[ 4] * b[13]) + (a[ 8] * b[14]) + (a[12] * b[15]);
+	t[13] = (a[ 1] * b[12]) + (a[ 5] * b[13]) + (a[ 9] * b[14]) + (a[13] * b[15]);
+	t[14] = (a[ 2] * b[12]) + (a[ 6] * b[13]) + (a[10] * b[14]) + (a[14] * b[15]);
+	t[15] = (a[ 3] * b[12]) + (a[ 7] * b[13]) + (a[11] * b[14]) + (a[15] * b[15]);
+
+	memcpy(out, t, 16 * sizeof(float));
+}
+
+#endif
+
+} // End of namespace Common
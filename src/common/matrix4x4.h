@@ -0,0 +1,95 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey and Eclipse engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file common/matrix4x4.h
+ *  A fixed-size 4x4 matrix.
+ */
+
+#ifndef COMMON_MATRIX4X4_H
+#define COMMON_MATRIX4X4_H
+
+#include "common/system.h"
+
+namespace Common {
+
+/** A 4x4 float matrix, storing its elements in column-major order.
+ *
+ *  Unlike Matrix, the elements live directly inside the object, so
+ *  that copies and temporaries never touch the heap. Multiplications
+ *  use SSE2 where available.
+ */
+class Matrix4x4 {
+public:
+	/** Create an identity matrix. */
+	Matrix4x4();
+	/** Create a matrix from a flat array, column-major order. */
+	Matrix4x4(const float *m);
+
+	/** Get the matrix elements in a flat array, column-major order. */
+	const float *get() const;
+	/** Set the matrix elements from flat array, column-major order. */
+	void set(const float *m);
+
+	/** Reset to the identity matrix. */
+	void loadIdentity();
+
+	float &operator()(int row, int column);
+	float  operator()(int row, int column) const;
+
+
+	Matrix4x4 operator*(const Matrix4x4 &right) const;
+	Matrix4x4 &operator*=(const Matrix4x4 &right);
+
+
+	/** Multiply the column vector in with this matrix, writing the result into out.
+	 *
+	 *  Both in and out are 4 floats long, and may point to the same array.
+	 */
+	void multiply(const float *in, float *out) const;
+
+	/** Transform the point (x, y, z, 1) by this matrix. */
+	void transformPoint(float &x, float &y, float &z) const;
+
+
+	float getDeterminant() const;
+
+	Matrix4x4 getTranspose() const;
+	Matrix4x4 getInverse() const;
+
+	void transpose();
+	void invert();
+
+	bool isInvertible() const;
+
+protected:
+	ALIGNED_PRE(16) float _elements[16];
+
+	/** Multiply two 4x4 matrices. out may be the same as a or b. */
+	static void multiply(float *out, const float *a, const float *b);
+};
+
+} // End of namespace Common
+
+#endif // COMMON_MATRIX4X4_H
@@ -50,6 +50,15 @@ void WriteStream::writeString(const UString &str) {
 	write(str.c_str(), strlen(str.c_str()));
 }
 
+void WriteStream::writeIEEEFloatLE(const float *values, uint32 count) {
+#ifdef XOREOS_LITTLE_ENDIAN
+	write(values, count * sizeof(float));
+#else
+	for (uint32 i = 0; i < count; i++)
+		writeIEEEFloatLE(values[i]);
+#endif
+}
+
 
 MemoryReadStream *ReadStream::readStream(uint32 dataSize) {
 	byte *buf = new byte[dataSize];
@@ -60,6 +69,43 @@ MemoryReadStream *ReadStream::readStream(uint32 dataSize) {
 	return new MemoryReadStream(buf, dataSize, true);
 }
 
+uint32 ReadStream::readUint16LE(uint16 *values, uint32 count) {
+	count = read(values, count * sizeof(uint16)) / sizeof(uint16);
+
+#ifndef XOREOS_LITTLE_ENDIAN
+	for (uint32 i = 0; i < count; i++)
+		values[i] = FROM_LE_16(values[i]);
+#endif
+
+	return count;
+}
+
+uint32 ReadStream::readUint32LE(uint32 *values, uint32 count) {
+	count = read(values, count * sizeof(uint32)) / sizeof(uint32);
+
+#ifndef XOREOS_LITTLE_ENDIAN
+	for (uint32 i = 0; i < count; i++)
+		values[i] = FROM_LE_32(values[i]);
+#endif
+
+	return count;
+}
+
+uint32 ReadStream::readIEEEFloatLE(float *values, uint32 count) {
+	count = read(values, count * sizeof(float)) / sizeof(float);
+
+#ifndef XOREOS_LITTLE_ENDIAN
+	for (uint32 i = 0; i < count; i++) {
+		uint32 data;
+
+		std::memcpy(&data, &values[i], sizeof(data));
+		values[i] = convertIEEEFloat(FROM_LE_32(data));
+	}
+#endif
+
+	return count;
+}
+
 
 uint32 MemoryReadStream::read(void *dataPtr, uint32 dataSize) {
 	// Read at most as many bytes as are still available...
@@ -82,6 +128,18 @@ uint32 MemoryReadStream::read(void *dataPtr, uint32 dataSize) {
 	return dataSize;
 }
 
+const byte *MemoryReadStream::readInPlace(uint32 dataSize) {
+	if (_encbyte || (dataSize > _size - _pos))
+		return 0;
+
+	const byte *data = _ptr;
+
+	_ptr += dataSize;
+	_pos += dataSize;
+
+	return data;
+}
+
 bool MemoryReadStream::seek(int32 offs, int whence) {
 	// Pre-Condition
 	assert(_pos <= _size);
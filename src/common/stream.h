@@ -191,6 +191,13 @@ public:
 	/** Copy the complete contents of the given stream. */
 	void writeStream(ReadStream &stream);
 
+	/**
+	 * Write an array of 32-bit IEEE floats in little endian
+	 * (LSB first) order to the stream.
+	 * On little endian hosts, this is a single write() call.
+	 */
+	void writeIEEEFloatLE(const float *values, uint32 count);
+
 	/**
 	 *  Write the given string to the stream.
 	 *  No terminating zero byte is written.
@@ -435,6 +442,39 @@ public:
 		return convertIEEEDouble(readUint64BE());
 	}
 
+	/**
+	 * Read an array of unsigned 16-bit words stored in little endian
+	 * (LSB first) order from the stream.
+	 * On little endian hosts, this is a single read() call.
+	 *
+	 * @param  values array into which the values are read.
+	 * @param  count number of values to read.
+	 * @return the number of values which were actually read.
+	 */
+	uint32 readUint16LE(uint16 *values, uint32 count);
+
+	/**
+	 * Read an array of unsigned 32-bit words stored in little endian
+	 * (LSB first) order from the stream.
+	 * On little endian hosts, this is a single read() call.
+	 *
+	 * @param  values array into which the values are read.
+	 * @param  count number of values to read.
+	 * @return the number of values which were actually read.
+	 */
+	uint32 readUint32LE(uint32 *values, uint32 count);
+
+	/**
+	 * Read an array of 32-bit IEEE floats stored in little endian
+	 * (LSB first) order from the stream.
+	 * On little endian hosts, this is a single read() call.
+	 *
+	 * @param  values array into which the values are read.
+	 * @param  count number of values to read.
+	 * @return the number of values which were actually read.
+	 */
+	uint32 readIEEEFloatLE(float *values, uint32 count);
+
 	/**
 	 * Read the specified amount of data into a new[]'ed buffer
 	 * which then is wrapped into a MemoryReadStream.
@@ -686,6 +726,14 @@ public:
 
 	uint32 read(void *dataPtr, uint32 dataSize);
 
+	/**
+	 * Skip over the next dataSize bytes and return a pointer to them,
+	 * instead of copying them. Returns 0, without skipping anything, if
+	 * fewer bytes are left or the data would need decrypting.
+	 * The pointer is valid as long as the stream.
+	 */
+	const byte *readInPlace(uint32 dataSize);
+
 	bool eos() const { return _eos; }
 	void clearErr() { _eos = false; }
 
@@ -783,7 +831,8 @@ private:
 
 		byte *old_data = _data;
 
-		_capacity = new_len + 32;
+		// Grow at least by half, so that many small writes don't copy the data over and over
+		_capacity = MAX(new_len + 32, _capacity + _capacity / 2);
 		_data = new byte[_capacity];
 		_ptr = _data + _pos;
 
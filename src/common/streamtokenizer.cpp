@@ -27,73 +27,139 @@
  *  Parse tokens out of a stream.
  */
 
+#include <cassert>
+#include <cstring>
+
 #include "common/streamtokenizer.h"
 #include "common/stream.h"
 #include "common/error.h"
+#include "common/util.h"
+
+/** Number of bytes we copy at first out of streams we can't look into directly. */
+static const uint32 kWindowSize = 256;
 
 namespace Common {
 
+StreamTokenizer::Token::Token() : data(0), length(0) {
+}
+
+bool StreamTokenizer::Token::empty() const {
+	return length == 0;
+}
+
+
 StreamTokenizer::StreamTokenizer(ConsecutiveSeparatorRule conSepRule) : _conSepRule(conSepRule) {
+	std::memset(_classes, 0, sizeof(_classes));
 }
 
-bool StreamTokenizer::isIn(uint32 c, const std::list<uint32> &list) {
-	for (std::list<uint32>::const_iterator it = list.begin(); it != list.end(); ++it)
-		if (*it == c)
-			return true;
+void StreamTokenizer::addClass(uint32 c, CharacterClass charClass) {
+	// We only look at single bytes
+	if (c > 0xFF)
+		return;
 
-	return false;
+	_classes[c] |= charClass;
 }
 
 void StreamTokenizer::addSeparator(uint32 c) {
-	_separators.push_back(c);
+	addClass(c, kClassSeparator);
 }
 
 void StreamTokenizer::addQuote(uint32 c) {
-	_quotes.push_back(c);
+	addClass(c, kClassQuote);
 }
 
 void StreamTokenizer::addChunkEnd(uint32 c) {
-	_chunkEnds.push_back(c);
+	addClass(c, kClassChunkEnd);
 }
 
 void StreamTokenizer::addIgnore(uint32 c) {
-	_ignores.push_back(c);
+	addClass(c, kClassIgnore);
 }
 
-UString StreamTokenizer::getToken(SeekableReadStream &stream) {
+const byte *StreamTokenizer::peek(SeekableReadStream &stream, uint32 &size) {
+	const int32  start = stream.pos();
+	const uint32 left  = MAX<int32>(stream.size() - start, 0);
+
+	// If the stream is held in memory anyway, we can look at all of it directly
+	MemoryReadStream *memStream = dynamic_cast<MemoryReadStream *>(&stream);
+	if (memStream) {
+		const byte *data = memStream->readInPlace(left);
+		if (data) {
+			memStream->seek(start);
+
+			size = left;
+			return data;
+		}
+	}
+
+	// Otherwise, we need to copy the bytes out
+
+	size = MIN(size, left);
+	if (size == 0)
+		return 0;
+
+	_buffer.resize(size);
+
+	size = stream.read(&_buffer[0], size);
+	stream.seek(start);
+
+	return &_buffer[0];
+}
+
+void StreamTokenizer::consume(SeekableReadStream &stream, uint32 start, uint32 size, bool ranOut) {
+	stream.seek(start + size);
+
+	if (ranOut)
+		// We looked past the end of the stream, read one more byte to properly set the EOS state
+		stream.readByte();
+}
+
+uint32 StreamTokenizer::scanToken(const byte *data, uint32 size, Token &token, bool &ranOut) {
 	// Init
 	bool   chunkEnd     = false;
 	bool   inQuote      = false;
 	bool   hasSeparator = false;
-	uint32 separator    = 0;
+	byte   separator    = 0;
+
+	/* As long as the token's characters are contiguous in the data, we just point to them.
+	 * Only when quotes or ignored characters interrupt them do we need to collect them. */
+	const byte *tokenStart  = 0;
+	uint32      tokenLength = 0;
+	bool        collected   = false;
 
-	UString token;
+	_token.clear();
 
-	// Run through the stream, character by character
-	while (!stream.eos()) {
-		char c = (char) stream.readByte();
+	ranOut = true;
 
-		if (isIn(c, _chunkEnds)) {
-			// This is a end character, seek back and break
-			stream.seek(-1, SEEK_CUR);
+	// Run through the data, character by character
+	uint32 pos = 0;
+	while (pos < size) {
+		const byte c         = data[pos++];
+		const byte charClass = _classes[c];
+
+		if (charClass & kClassChunkEnd) {
+			// This is a end character, step back and break
+			pos--;
 			chunkEnd = true;
+			ranOut   = false;
 			break;
 		}
 
-		if (isIn(c, _quotes)) {
+		if (charClass & kClassQuote) {
 			// This is a quote character, set state
 			inQuote = !inQuote;
 			continue;
 		}
 
-		if (!inQuote && isIn(c, _separators)) {
+		if (!inQuote && (charClass & kClassSeparator)) {
 			// We're not in a quote and this is a separator
 
-			if (!token.empty()) {
+			if (tokenLength > 0) {
 				// We have a token
 
 				hasSeparator = true;
 				separator = c;
+				ranOut = false;
 				break;
 			}
 
@@ -104,13 +170,15 @@ UString StreamTokenizer::getToken(SeekableReadStream &stream) {
 
 				hasSeparator = true;
 				separator = c;
+				ranOut = false;
 				break;
 			}
 
-			if ((_conSepRule == kRuleIgnoreSame) && hasSeparator && (separator != ((byte) c))) {
+			if ((_conSepRule == kRuleIgnoreSame) && hasSeparator && (separator != c)) {
 				// We ignore only consecutive separators that are the same
 				hasSeparator = true;
 				separator = c;
+				ranOut = false;
 				break;
 			}
 
@@ -120,37 +188,87 @@ UString StreamTokenizer::getToken(SeekableReadStream &stream) {
 			continue;
 		}
 
-		if (isIn(c, _ignores))
+		if (charClass & kClassIgnore)
 			// This is a character to be ignored, do so
 			continue;
 
 		// A normal character, add it to our token
-		token += c;
+
+		if (collected) {
+			_token.push_back((char) c);
+		} else if (tokenLength == 0) {
+			tokenStart  = data + pos - 1;
+			tokenLength = 1;
+		} else if ((tokenStart + tokenLength) == (data + pos - 1)) {
+			tokenLength++;
+		} else {
+			_token.assign(tokenStart, tokenStart + tokenLength);
+			_token.push_back((char) c);
+
+			collected = true;
+		}
+
+		if (collected)
+			tokenLength = _token.size();
 	}
 
+	token.data   = collected ? &_token[0] : (const char *) tokenStart;
+	token.length = tokenLength;
+
 	// Is the string actually empty?
-	if (!token.empty() && (*token.begin() == '\0'))
-		token.clear();
+	if ((token.length > 0) && (token.data[0] == '\0'))
+		token.length = 0;
 
 	if (!chunkEnd && (_conSepRule != kRuleHeed)) {
 		// We have to look for consecutive separators
 
-		while (!stream.eos()) {
-			uint32 c = stream.readByte();
+		ranOut = true;
+		while (pos < size) {
+			const byte c = data[pos];
 
 			// Use the rule to determine when we should abort skipping consecutive separators
 			if (((_conSepRule == kRuleIgnoreSame) && (c != separator)) ||
-			    ((_conSepRule == kRuleIgnoreAll ) && !isIn(c, _separators))) {
+			    ((_conSepRule == kRuleIgnoreAll ) && !(_classes[c] & kClassSeparator))) {
 
-				stream.seek(-1, SEEK_CUR);
+				ranOut = false;
 				break;
 			}
+
+			pos++;
 		}
 
 	}
 
-	// And return the token
-	return token;
+	return pos;
+}
+
+void StreamTokenizer::getToken(SeekableReadStream &stream, Token &token) {
+	const int32  start = stream.pos();
+	const uint32 left  = MAX<int32>(stream.size() - start, 0);
+
+	for (uint32 window = kWindowSize; ; window *= 2) {
+		uint32 size = window;
+		const byte *data = peek(stream, size);
+
+		bool ranOut;
+		const uint32 consumed = scanToken(data, size, token, ranOut);
+
+		// If the token goes on past what we've looked at, we need to look further
+		if (!ranOut || (size >= left)) {
+			consume(stream, start, consumed, ranOut);
+			break;
+		}
+	}
+}
+
+UString StreamTokenizer::getToken(SeekableReadStream &stream) {
+	Token token;
+	getToken(stream, token);
+
+	if (token.empty())
+		return UString();
+
+	return UString(token.data, token.length);
 }
 
 int StreamTokenizer::getTokens(SeekableReadStream &stream, std::vector<UString> &list,
@@ -161,14 +279,52 @@ int StreamTokenizer::getTokens(SeekableReadStream &stream, std::vector<UString>
 	list.clear();
 	list.reserve(min);
 
+	const int32  start = stream.pos();
+	const uint32 left  = MAX<int32>(stream.size() - start, 0);
+
+	const bool eos = stream.eos();
+
+	uint32 size = kWindowSize;
+	const byte *data = eos ? 0 : peek(stream, size);
+
+	if (eos || (size < left)) {
+		// We can't look at the whole rest of the stream, go token by token
+
+		int realTokenCount;
+		for (realTokenCount = 0; !isChunkEnd(stream) && ((max < 0) || (realTokenCount < max)); realTokenCount++) {
+			UString token = getToken(stream);
+
+			if (!token.empty() || (_conSepRule != kRuleIgnoreAll))
+				list.push_back(token);
+		}
+
+		while (list.size() < ((uint32) min))
+			list.push_back(def);
+
+		return realTokenCount;
+	}
+
+	// Run through the data in one go
+
+	uint32 pos    = 0;
+	bool   ranOut = false;
+
 	int realTokenCount;
-	for (realTokenCount = 0; !isChunkEnd(stream) && ((max < 0) || (realTokenCount < max)); realTokenCount++) {
-		UString token = getToken(stream);
+	for (realTokenCount = 0; !ranOut && ((max < 0) || (realTokenCount < max)); realTokenCount++) {
+		if ((pos >= size) || (_classes[data[pos]] & kClassChunkEnd))
+			break;
 
-		if (!token.empty() || (_conSepRule != kRuleIgnoreAll))
-			list.push_back(token);
+		Token token;
+		pos += scanToken(data + pos, size - pos, token, ranOut);
+
+		if (!token.empty())
+			list.push_back(UString(token.data, token.length));
+		else if (_conSepRule != kRuleIgnoreAll)
+			list.push_back(UString());
 	}
 
+	consume(stream, start, pos, ranOut);
+
 	while (list.size() < ((uint32) min))
 		list.push_back(def);
 
@@ -176,18 +332,34 @@ int StreamTokenizer::getTokens(SeekableReadStream &stream, std::vector<UString>
 }
 
 void StreamTokenizer::skipToken(SeekableReadStream &stream, uint32 n) {
+	Token token;
+
 	while (n-- > 0)
-		UString token = getToken(stream);
+		getToken(stream, token);
 }
 
 void StreamTokenizer::skipChunk(SeekableReadStream &stream) {
-	assert(!_chunkEnds.empty());
+	int32  start = stream.pos();
+	uint32 left  = MAX<int32>(stream.size() - start, 0);
+
+	while (true) {
+		uint32 size = kWindowSize;
+		const byte *data = peek(stream, size);
 
-	while (!stream.eos() && !stream.err()) {
-		if (isIn(stream.readByte(), _chunkEnds)) {
-			stream.seek(-1, SEEK_CUR);
+		uint32 pos = 0;
+		while ((pos < size) && !(_classes[data[pos]] & kClassChunkEnd))
+			pos++;
+
+		if ((pos < size) || (size >= left) || stream.err()) {
+			consume(stream, start, pos, pos == size);
 			break;
 		}
+
+		// No end of the chunk in sight yet, look at the next bytes
+		start += size;
+		left  -= size;
+
+		stream.seek(start);
 	}
 
 	if (stream.err())
@@ -202,7 +374,7 @@ void StreamTokenizer::nextChunk(SeekableReadStream &stream) {
 	if (stream.eos() || stream.err())
 		return;
 
-	if (!isIn(c, _chunkEnds))
+	if (!(_classes[c] & kClassChunkEnd))
 		stream.seek(-1, SEEK_CUR);
 	else
 		if (stream.pos() == stream.size())
@@ -214,11 +386,11 @@ bool StreamTokenizer::isChunkEnd(SeekableReadStream &stream) {
 	if (stream.eos())
 		return true;
 
-	bool chunkEnd = isIn(stream.readByte(), _chunkEnds);
-
-	stream.seek(-1, SEEK_CUR);
+	uint32 size = 1;
+	const byte *data = peek(stream, size);
 
-	return chunkEnd;
+	// Nothing left in the stream ends the chunk as well
+	return (size == 0) || (_classes[data[0]] & kClassChunkEnd);
 }
 
 } // End of namespace Common
@@ -30,7 +30,6 @@
 #ifndef COMMON_STREAMTOKENIZER_H
 #define COMMON_STREAMTOKENIZER_H
 
-#include <list>
 #include <vector>
 
 #include "common/types.h"
@@ -53,6 +52,21 @@ public:
 		kRuleHeed        ///< Heed each separator.
 	};
 
+	/** A token's characters.
+	 *
+	 *  The characters point either directly into the stream's data or into
+	 *  the tokenizer's own buffer. They stay valid until the tokenizer is
+	 *  used again, or the stream is destroyed.
+	 */
+	struct Token {
+		const char *data;
+		uint32 length;
+
+		Token();
+
+		bool empty() const;
+	};
+
 	StreamTokenizer(ConsecutiveSeparatorRule conSepRule = kRuleHeed);
 
 	/** Add a character on where to split. */
@@ -66,6 +80,8 @@ public:
 
 	/** Parse a token out of the stream. */
 	UString getToken(SeekableReadStream &stream);
+	/** Parse a token out of the stream, without copying it if possible. */
+	void getToken(SeekableReadStream &stream, Token &token);
 
 	/** Parse tokens out of the stream.
 	 *
@@ -89,14 +105,38 @@ public:
 	void nextChunk(SeekableReadStream &stream);
 
 private:
+	/** The classes a character can belong to. */
+	enum CharacterClass {
+		kClassSeparator = 1 << 0,
+		kClassQuote     = 1 << 1,
+		kClassChunkEnd  = 1 << 2,
+		kClassIgnore    = 1 << 3
+	};
+
 	ConsecutiveSeparatorRule _conSepRule;
 
-	std::list<uint32> _separators;
-	std::list<uint32> _quotes;
-	std::list<uint32> _chunkEnds;
-	std::list<uint32> _ignores;
+	byte _classes[256]; ///< The classes of each character.
+
+	std::vector<byte> _buffer; ///< A copy of the stream data, if we can't access it directly.
+	std::vector<char> _token;  ///< The characters of a token that isn't contiguous in the data.
+
+	void addClass(uint32 c, CharacterClass charClass);
+
+	/** Make the stream's next bytes available, without moving the stream.
+	 *
+	 *  @param  stream The stream to look into.
+	 *  @param  size The number of bytes wanted. Returns the number of bytes available,
+	 *               which is all that's left for streams held in memory.
+	 *  @return The stream's data from its current position onwards.
+	 */
+	const byte *peek(SeekableReadStream &stream, uint32 &size);
+
+	/** Parse a token out of this data, returning the number of bytes consumed.
+	 *  If the data ended before the token did, ranOut is set to true. */
+	uint32 scanToken(const byte *data, uint32 size, Token &token, bool &ranOut);
 
-	static bool isIn(uint32 c, const std::list<uint32> &list);
+	/** Move the stream past the bytes we consumed. */
+	static void consume(SeekableReadStream &stream, uint32 start, uint32 size, bool ranOut);
 
 	bool isChunkEnd(SeekableReadStream &stream);
 };
@@ -44,6 +44,7 @@
 
 	#define FORCEINLINE __forceinline
 	#define NORETURN_PRE __declspec(noreturn)
+	#define ALIGNED_PRE(x) __declspec(align(x))
 	#define PLUGIN_EXPORT __declspec(dllexport)
 
 	#ifndef WIN32
@@ -81,6 +82,7 @@
 	#define NORETURN_POST __attribute__((__noreturn__))
 	#define PACKED_STRUCT __attribute__((__packed__))
 	#define GCC_PRINTF(x,y) __attribute__((__format__(printf, x, y)))
+	#define ALIGNED_PRE(x) __attribute__((__aligned__(x)))
 
 	#if !defined(FORCEINLINE) && (__GNUC__ > 3 || (__GNUC__ == 3 && __GNUC_MINOR__ >= 1))
 		#define FORCEINLINE inline __attribute__((__always_inline__))
@@ -90,6 +92,13 @@
 	#define GCC_PRINTF(x,y)
 #endif
 
+//
+// SIMD instruction set availability
+//
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+	#define XOREOS_SSE2
+#endif
+
 //
 // Fallbacks / default values for various special macros
 //
@@ -105,6 +114,10 @@
 	#define NORETURN_POST
 #endif
 
+#ifndef ALIGNED_PRE
+	#define ALIGNED_PRE(x)
+#endif
+
 #ifndef STRINGBUFLEN
 	#define STRINGBUFLEN 1024
 #endif
@@ -30,17 +30,12 @@
 #include "common/transmatrix.h"
 #include "common/maths.h"
 
-static const float kIdentity[] = {
-	1.0, 0.0, 0.0, 0.0,
-	0.0, 1.0, 0.0, 0.0,
-	0.0, 0.0, 1.0, 0.0,
-	0.0, 0.0, 0.0, 1.0
-};
-
 namespace Common {
 
-TransformationMatrix::TransformationMatrix() : Matrix(4, 4) {
-	loadIdentity();
+TransformationMatrix::TransformationMatrix() {
+}
+
+TransformationMatrix::TransformationMatrix(const Matrix4x4 &m) : Matrix4x4(m) {
 }
 
 float TransformationMatrix::getX() const {
@@ -61,32 +56,20 @@ void TransformationMatrix::getPosition(float &x, float &y, float &z) const {
 	z = getZ();
 }
 
-void TransformationMatrix::loadIdentity() {
-	set(kIdentity);
-}
-
 void TransformationMatrix::translate(float x, float y, float z) {
-	Matrix tMatrix(4, 4);
-
-	tMatrix.set(kIdentity);
-
-	tMatrix(0, 3) = x;
-	tMatrix(1, 3) = y;
-	tMatrix(2, 3) = z;
+	// Multiplying with a translation matrix only changes the last column
+	float t[4] = { x, y, z, 1.0 };
 
-	(*this) *= tMatrix;
+	multiply(t, _elements + 12);
 }
 
 void TransformationMatrix::scale(float x, float y, float z) {
-	Matrix sMatrix(4, 4);
-
-	sMatrix.set(kIdentity);
-
-	sMatrix(0, 0) = x;
-	sMatrix(1, 1) = y;
-	sMatrix(2, 2) = z;
-
-	(*this) *= sMatrix;
+	// Multiplying with a scaling matrix only scales the first three columns
+	for (int i = 0; i < 4; i++) {
+		_elements[0 + i] *= x;
+		_elements[4 + i] *= y;
+		_elements[8 + i] *= z;
+	}
 }
 
 void TransformationMatrix::rotate(float angle, float x, float y, float z) {
@@ -123,14 +106,10 @@ void TransformationMatrix::rotate(float angle, float x, float y, float z) {
 	e[14] = 0.0;
 	e[15] = 1.0;
 
-	Matrix rMatrix(4, 4);
-
-	rMatrix.set(e);
-
-	(*this) *= rMatrix;
+	Matrix4x4::multiply(_elements, _elements, e);
 }
 
-void TransformationMatrix::transform(const Matrix &m) {
+void TransformationMatrix::transform(const Matrix4x4 &m) {
 	(*this) *= m;
 }
 
@@ -49,6 +49,7 @@
 #include "graphics/aurora/cursorman.h"
 #include "graphics/aurora/text.h"
 #include "graphics/aurora/guiquad.h"
+#include "graphics/aurora/model.h"
 
 #include "engines/aurora/console.h"
 #include "engines/aurora/util.h"
@@ -686,6 +687,16 @@ Console::Console(const Common::UString &font, int fontHeight) : _neverShown(true
 			"Usage: playsound <sound>\nPlay the specified sound");
 	registerCommand("silence"    , boost::bind(&Console::cmdSilence    , this, _1),
 			"Usage: silence\nStop all playing sounds and music");
+	registerCommand("texmem"     , boost::bind(&Console::cmdTexMem     , this, _1),
+			"Usage: texmem\nShow the image data held in memory by textures");
+	registerCommand("texatlas"   , boost::bind(&Console::cmdTexAtlas   , this, _1),
+			"Usage: texatlas\nShow the texture atlas usage and the texture binds per frame");
+	registerCommand("texcache"   , boost::bind(&Console::cmdTexCache   , this, _1),
+			"Usage: texcache\nShow how many textures were reused instead of loaded again,\n"
+			"and how many were read out of the texture cache directory");
+	registerCommand("modelmem"   , boost::bind(&Console::cmdModelMem   , this, _1),
+			"Usage: modelmem [<file>]\nShow the geometry held in memory by the models currently shown.\n"
+			"If a file was given, dump the full list of models into it");
 
 	_console->setPrompt(kPrompt);
 
@@ -1152,6 +1163,84 @@ void Console::cmdSilence(const CommandLine &cl) {
 	SoundMan.stopAll();
 }
 
+void Console::cmdTexMem(const CommandLine &cl) {
+	std::list<Graphics::Aurora::TextureMemory> textures;
+	uint32 total = TextureMan.getMemoryUsage(textures);
+
+	printf("%u textures hold %.2f MB of image data", (uint) textures.size(), total / (1024.0 * 1024.0));
+
+	uint n = 0;
+	for (std::list<Graphics::Aurora::TextureMemory>::const_iterator t = textures.begin();
+	     (t != textures.end()) && (n < 10); ++t, ++n)
+		printf("%8.1f KB  %s", t->size / 1024.0, t->name.c_str());
+}
+
+void Console::cmdTexAtlas(const CommandLine &cl) {
+	uint32 pages, textures;
+	TextureMan.getAtlasStats(pages, textures);
+
+	printf("%u textures in %u atlas pages", textures, pages);
+	printf("%u texture binds in the last frame", TextureMan.getBindCount());
+}
+
+void Console::cmdTexCache(const CommandLine &cl) {
+	uint32 hits, misses, count, size;
+	TextureMan.getCacheStats(hits, misses);
+	TextureMan.getCacheUsage(count, size);
+
+	const uint32 total = hits + misses;
+
+	printf("%u textures reused, %u loaded (%.1f%% hit rate)", hits, misses,
+	       (total > 0) ? ((100.0 * hits) / total) : 0.0);
+	printf("%u unused textures kept, holding %.2f MB", count, size / (1024.0 * 1024.0));
+
+	if (!TextureMan.getFileCache().isEnabled()) {
+		printf("The texture cache directory is disabled");
+		return;
+	}
+
+	uint32 fileHits, fileMisses;
+	TextureMan.getFileCache().getStats(fileHits, fileMisses);
+
+	printf("%u textures read out of the texture cache directory, %u not found there", fileHits, fileMisses);
+}
+
+void Console::cmdModelMem(const CommandLine &cl) {
+	Graphics::Aurora::ModelMemoryUsage usage("Shown models");
+	usage.addVisible();
+
+	printModelMemoryUsage(std::list<Graphics::Aurora::ModelMemoryUsage>(1, usage), cl.args);
+}
+
+void Console::printModelMemory(const Graphics::Aurora::ModelMemory &memory) {
+	printf("%8.1f KB  %s: %u models, %u nodes, %u faces, %.1f KB in lists", memory.getSize() / 1024.0,
+	       memory.name.c_str(), memory.models, memory.nodes, memory.faces, memory.listSize / 1024.0);
+}
+
+void Console::printModelMemoryUsage(const std::list<Graphics::Aurora::ModelMemoryUsage> &groups,
+                                    const Common::UString &file) {
+
+	for (std::list<Graphics::Aurora::ModelMemoryUsage>::const_iterator g = groups.begin(); g != groups.end(); ++g) {
+		printModelMemory(g->getTotal());
+
+		std::list<Graphics::Aurora::ModelMemory> models;
+		g->getModels(models);
+
+		uint n = 0;
+		for (std::list<Graphics::Aurora::ModelMemory>::const_iterator m = models.begin();
+		     (m != models.end()) && (n < 10); ++m, ++n)
+			printModelMemory(*m);
+	}
+
+	if (file.empty())
+		return;
+
+	if (dumpModelMemory(groups, file))
+		printf("Dumped list of models to file \"%s\"", file.c_str());
+	else
+		printf("Failed dumping list of models to file \"%s\"", file.c_str());
+}
+
 void Console::printCommandHelp(const Common::UString &cmd) {
 	CommandMap::const_iterator c = _commands.find(cmd);
 	if (c == _commands.end()) {
@@ -50,6 +50,12 @@ namespace Common {
 	class ReadLine;
 }
 
+namespace Graphics {
+	namespace Aurora {
+		struct ModelMemory;
+	}
+}
+
 namespace Engines {
 
 class ConsoleWindow : public Graphics::GUIFrontElement, public Events::Notifyable {
@@ -218,6 +224,13 @@ protected:
 	void printCommandHelp(const Common::UString &cmd);
 	void printList(const std::list<Common::UString> &list, uint32 maxSize = 0);
 
+	/** Print the geometry a model, or group of models, holds in memory. */
+	void printModelMemory(const Graphics::Aurora::ModelMemory &memory);
+	/** Print the total and the 10 biggest models of each group of model memory usage,
+	 *  and dump the full list of models into a file, if a file name was given. */
+	void printModelMemoryUsage(const std::list<Graphics::Aurora::ModelMemoryUsage> &groups,
+	                           const Common::UString &file);
+
 	void setArguments(const Common::UString &cmd, const std::list<Common::UString> &args);
 	void setArguments(const Common::UString &cmd);
 
@@ -278,6 +291,10 @@ private:
 	void cmdListSounds (const CommandLine &cl);
 	void cmdPlaySound  (const CommandLine &cl);
 	void cmdSilence    (const CommandLine &cl);
+	void cmdTexMem     (const CommandLine &cl);
+	void cmdTexAtlas   (const CommandLine &cl);
+	void cmdTexCache   (const CommandLine &cl);
+	void cmdModelMem   (const CommandLine &cl);
 
 	void updateHelpArguments();
 
@@ -27,24 +27,30 @@
  *  Generic Aurora engines model functions.
  */
 
-#ifndef ENGINES_AURORA_MODEL_H
-#define ENGINES_AURORA_MODEL_H
-
+#include "common/util.h"
 #include "common/ustring.h"
 #include "common/error.h"
+#include "common/configman.h"
 
 #include "engines/aurora/model.h"
 #include "engines/aurora/modelloader.h"
+#include "engines/aurora/modelpreloader.h"
 
 namespace Engines {
 
+static const int kModelPreloadThreads = 2;
+
 static ModelLoader *kModelLoader = 0;
 
+static ModelPreloader *kModelPreloader = 0;
+
 void registerModelLoader(ModelLoader *loader) {
 	kModelLoader = loader;
 }
 
 void unregisterModelLoader() {
+	endModelPreload();
+
 	delete kModelLoader;
 
 	kModelLoader = 0;
@@ -58,7 +64,8 @@ Graphics::Aurora::Model *loadModelObject(const Common::UString &resref,
 
 	try {
 
-		model = kModelLoader->load(resref, Graphics::Aurora::kModelTypeObject, texture);
+		if (!kModelPreloader || !kModelPreloader->take(resref, texture, model))
+			model = kModelLoader->load(resref, Graphics::Aurora::kModelTypeObject, texture);
 
 	} catch (Common::Exception &e) {
 
@@ -95,6 +102,23 @@ void freeModel(Graphics::Aurora::Model *&model) {
 	kModelLoader->free(model);
 }
 
-} // End of namespace Engines
+void beginModelPreload() {
+	assert(kModelLoader);
+
+	endModelPreload();
 
-#endif // ENGINES_AURORA_MODEL_H
+	kModelPreloader = new ModelPreloader(*kModelLoader);
+	kModelPreloader->start(MAX(ConfigMan.getInt("modelthreads", kModelPreloadThreads), 0));
+}
+
+void preloadModelObject(const Common::UString &resref, const Common::UString &texture) {
+	if (kModelPreloader)
+		kModelPreloader->add(resref, texture);
+}
+
+void endModelPreload() {
+	delete kModelPreloader;
+	kModelPreloader = 0;
+}
+
+} // End of namespace Engines
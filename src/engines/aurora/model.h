@@ -49,6 +49,18 @@ Graphics::Aurora::Model *loadModelGUI   (const Common::UString &resref);
 
 void freeModel(Graphics::Aurora::Model *&model);
 
+/** Start parsing object models in the background.
+ *
+ *  Models queued with preloadModelObject() are parsed on a pool of threads.
+ *  Until endModelPreload(), loadModelObject() takes these parsed models,
+ *  in the order they were queued.
+ */
+void beginModelPreload();
+/** Queue an object model for parsing in the background. */
+void preloadModelObject(const Common::UString &resref, const Common::UString &texture = "");
+/** Stop parsing object models in the background, freeing all models nobody took. */
+void endModelPreload();
+
 } // End of namespace Engines
 
 #endif // ENGINES_AURORA_MODEL_H
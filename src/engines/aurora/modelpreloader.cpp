@@ -0,0 +1,216 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey and Eclipse engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file engines/aurora/modelpreloader.cpp
+ *  Parsing object models in the background.
+ */
+
+#include "common/util.h"
+
+#include "graphics/aurora/model.h"
+#include "graphics/aurora/textureman.h"
+
+#include "engines/aurora/modelpreloader.h"
+#include "engines/aurora/modelloader.h"
+
+namespace Engines {
+
+ModelPreloader::Job::Job(const Common::UString &r, const Common::UString &t) :
+	resref(r), texture(t), state(kJobQueued), model(0), failed(false) {
+
+}
+
+
+ModelPreloader::Worker::Worker(ModelPreloader &preloader) : _preloader(&preloader) {
+}
+
+ModelPreloader::Worker::~Worker() {
+	destroyThread();
+}
+
+void ModelPreloader::Worker::threadMethod() {
+	while (!_killThread) {
+		Job *job = _preloader->takeJob();
+		if (!job) {
+			_preloader->wait();
+			continue;
+		}
+
+		_preloader->parse(*job);
+
+		// Nobody is ever going to collect the PLTs this thread created
+		TextureMan.clearNewPLTs();
+	}
+}
+
+
+ModelPreloader::ModelPreloader(ModelLoader &loader) : _loader(&loader) {
+}
+
+ModelPreloader::~ModelPreloader() {
+	stop();
+
+	for (JobMap::iterator j = _jobs.begin(); j != _jobs.end(); ++j) {
+		for (std::list<Job *>::iterator job = j->second.begin(); job != j->second.end(); ++job) {
+			_loader->free((*job)->model);
+
+			delete *job;
+		}
+	}
+}
+
+void ModelPreloader::start(uint threadCount) {
+	stop();
+
+	for (uint i = 0; i < threadCount; i++) {
+		Worker *worker = new Worker(*this);
+
+		if (!worker->createThread()) {
+			warning("Failed to create a model parsing thread");
+			delete worker;
+			break;
+		}
+
+		_workers.push_back(worker);
+	}
+}
+
+void ModelPreloader::stop() {
+	// Jobs still left in the queue are parsed on demand, in take()
+	for (std::vector<Worker *>::iterator w = _workers.begin(); w != _workers.end(); ++w)
+		delete *w;
+
+	_workers.clear();
+}
+
+void ModelPreloader::add(const Common::UString &resref, const Common::UString &texture) {
+	Job *job = new Job(resref, texture);
+
+	_mutex.lock();
+	_jobs[JobKey(resref, texture)].push_back(job);
+	_queue.push_back(job);
+	_mutex.unlock();
+
+	_newJob.signal();
+}
+
+bool ModelPreloader::take(const Common::UString &resref, const Common::UString &texture,
+                          Graphics::Aurora::Model *&model) {
+
+	_mutex.lock();
+
+	JobMap::iterator j = _jobs.find(JobKey(resref, texture));
+	if ((j == _jobs.end()) || j->second.empty()) {
+		_mutex.unlock();
+		return false;
+	}
+
+	Job *job = j->second.front();
+	j->second.pop_front();
+
+	if (job->state == kJobQueued) {
+		// Nobody started on this one yet, so we do it ourselves
+		_queue.remove(job);
+		job->state = kJobParsing;
+
+		_mutex.unlock();
+
+		parse(*job);
+
+		_mutex.lock();
+	}
+
+	// If a thread is currently parsing the model, wait until it's done
+	while (job->state != kJobDone) {
+		_mutex.unlock();
+		_parsed.wait(1);
+		_mutex.lock();
+	}
+
+	_mutex.unlock();
+
+	model = job->model;
+
+	bool failed = job->failed;
+	Common::Exception error = job->error;
+
+	delete job;
+
+	if (failed)
+		throw error;
+
+	return true;
+}
+
+ModelPreloader::Job *ModelPreloader::takeJob() {
+	Common::StackLock lock(_mutex);
+
+	if (_queue.empty())
+		return 0;
+
+	Job *job = _queue.front();
+
+	_queue.pop_front();
+	job->state = kJobParsing;
+
+	return job;
+}
+
+void ModelPreloader::parse(Job &job) {
+	Graphics::Aurora::Model *model = 0;
+
+	bool failed = false;
+	Common::Exception error;
+
+	try {
+		model = _loader->load(job.resref, Graphics::Aurora::kModelTypeObject, job.texture);
+	} catch (Common::Exception &e) {
+		failed = true;
+		error  = e;
+	} catch (std::exception &e) {
+		failed = true;
+		error  = Common::Exception("%s", e.what());
+	} catch (...) {
+		failed = true;
+		error  = Common::Exception("Unknown exception");
+	}
+
+	_mutex.lock();
+
+	job.model  = model;
+	job.failed = failed;
+	job.error  = error;
+	job.state  = kJobDone;
+
+	_mutex.unlock();
+
+	_parsed.signal();
+}
+
+void ModelPreloader::wait() {
+	_newJob.wait(10);
+}
+
+} // End of namespace Engines
@@ -0,0 +1,148 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey and Eclipse engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file engines/aurora/modelpreloader.h
+ *  Parsing object models in the background.
+ */
+
+#ifndef ENGINES_AURORA_MODELPRELOADER_H
+#define ENGINES_AURORA_MODELPRELOADER_H
+
+#include <vector>
+#include <list>
+#include <map>
+
+#include "common/types.h"
+#include "common/ustring.h"
+#include "common/error.h"
+#include "common/mutex.h"
+#include "common/thread.h"
+
+#include "graphics/aurora/types.h"
+
+namespace Engines {
+
+class ModelLoader;
+
+/** A pool of threads parsing object models in the background.
+ *
+ *  Models are queued up front, in the order they're going to be needed,
+ *  and are then taken out again in that same order. Placing the models
+ *  and showing them is still left to the taking thread, so the result
+ *  doesn't depend on which thread finishes a model first.
+ *
+ *  A thread taking a model still sitting in the queue parses it on the
+ *  spot, so nobody ever waits for a model nobody is working on.
+ *
+ *  Parsing a model reads resources through ResMan, and gets textures out
+ *  of TextureMan and compiled models out of ModelCacheMan. All three guard
+ *  their state with locks of their own. TextureMan may look up resources
+ *  while holding its lock, but ResMan never calls back out, so the locks
+ *  are always taken in the same order.
+ */
+class ModelPreloader {
+public:
+	ModelPreloader(ModelLoader &loader);
+	/** Stop all threads and free all models nobody took. */
+	~ModelPreloader();
+
+	/** Start that many parsing threads. */
+	void start(uint threadCount);
+	/** Stop all parsing threads. */
+	void stop();
+
+	/** Queue this object model for parsing. */
+	void add(const Common::UString &resref, const Common::UString &texture);
+
+	/** Take the next queued model with this resref and texture.
+	 *
+	 *  Waits for the model if it's currently being parsed. If parsing the
+	 *  model failed, the exception is rethrown here.
+	 *
+	 *  @return false if no such model was queued.
+	 */
+	bool take(const Common::UString &resref, const Common::UString &texture,
+	          Graphics::Aurora::Model *&model);
+
+private:
+	enum JobState {
+		kJobQueued,  ///< Waiting to be parsed.
+		kJobParsing, ///< Currently being parsed.
+		kJobDone     ///< Finished, successfully or not.
+	};
+
+	/** A model to parse. */
+	struct Job {
+		Common::UString resref;
+		Common::UString texture;
+
+		JobState state;
+
+		Graphics::Aurora::Model *model;
+
+		bool failed;
+		Common::Exception error;
+
+		Job(const Common::UString &r, const Common::UString &t);
+	};
+
+	/** A thread parsing models. */
+	class Worker : public Common::Thread {
+	public:
+		Worker(ModelPreloader &preloader);
+		~Worker();
+
+	private:
+		ModelPreloader *_preloader;
+
+		void threadMethod();
+	};
+
+	typedef std::pair<Common::UString, Common::UString> JobKey;
+	typedef std::map<JobKey, std::list<Job *> > JobMap;
+
+	ModelLoader *_loader;
+
+	std::vector<Worker *> _workers;
+
+	JobMap _jobs;              ///< All jobs not yet taken, by resref and texture.
+	std::list<Job *> _queue;   ///< Jobs waiting to be parsed.
+
+	Common::Mutex _mutex; ///< Protects the jobs.
+
+	Common::Condition _newJob; ///< Signals a newly queued job.
+	Common::Condition _parsed; ///< Signals a finished job.
+
+	/** Take the next job out of the queue. */
+	Job *takeJob();
+	/** Parse the model of this job. */
+	void parse(Job &job);
+	/** Wait for new jobs to be queued. */
+	void wait();
+};
+
+} // End of namespace Engines
+
+#endif // ENGINES_AURORA_MODELPRELOADER_H
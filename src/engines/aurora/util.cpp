@@ -38,6 +38,7 @@
 #include "../../aurora/2dafile.h"
 
 #include "graphics/aurora/texture.h"
+#include "graphics/aurora/model.h"
 
 #include "sound/sound.h"
 
@@ -224,4 +225,43 @@ bool dump2DA(const Common::UString &name) {
 	return success;
 }
 
+static void writeModelMemory(Common::WriteStream &file, const Graphics::Aurora::ModelMemory &memory,
+                             const Common::UString &indent) {
+
+	const Common::UString name = indent + memory.name;
+
+	file.writeString(Common::UString::sprintf("%-40s | %6u | %6u | %8u | %8u | %9u | %11u | %10u\n",
+	                 name.c_str(), memory.models, memory.nodes, memory.faces, memory.vertices,
+	                 memory.texCoords, memory.geometrySize, memory.listSize));
+}
+
+bool dumpModelMemory(const std::list<Graphics::Aurora::ModelMemoryUsage> &groups, const Common::UString &name) {
+	Common::DumpFile file;
+	if (!file.open(name))
+		return false;
+
+	file.writeString("                  Name                   | Models |  Nodes |   Faces  | Vertices | TexCoords "
+	                 "|  Geometry   |    Lists  \n");
+	file.writeString("-----------------------------------------|--------|--------|----------|----------|-----------"
+	                 "|-------------|-----------\n");
+
+	for (std::list<Graphics::Aurora::ModelMemoryUsage>::const_iterator g = groups.begin(); g != groups.end(); ++g) {
+		writeModelMemory(file, g->getTotal(), "");
+
+		std::list<Graphics::Aurora::ModelMemory> models;
+		g->getModels(models);
+
+		for (std::list<Graphics::Aurora::ModelMemory>::const_iterator m = models.begin(); m != models.end(); ++m)
+			writeModelMemory(file, *m, "  ");
+	}
+
+	file.flush();
+
+	bool error = file.err();
+
+	file.close();
+
+	return !error;
+}
+
 } // End of namespace Engines
@@ -30,6 +30,8 @@
 #ifndef ENGINES_AURORA_UTIL_H
 #define ENGINES_AURORA_UTIL_H
 
+#include <list>
+
 #include "common/ustring.h"
 
 #include "aurora/types.h"
@@ -44,6 +46,12 @@ namespace Aurora {
 	class GFFFile;
 }
 
+namespace Graphics {
+	namespace Aurora {
+		class ModelMemoryUsage;
+	}
+}
+
 namespace Engines {
 
 /** Play this video resource. */
@@ -77,6 +85,9 @@ bool dumpTGA(const Common::UString &name);
 /** Debug method to quickly dump a 2DA to disk. */
 bool dump2DA(const Common::UString &name);
 
+/** Debug method to dump the geometry these groups of models hold to disk, by group and model name. */
+bool dumpModelMemory(const std::list<Graphics::Aurora::ModelMemoryUsage> &groups, const Common::UString &name);
+
 } // End of namespace Engines
 
 #endif // ENGINES_AURORA_UTIL_H
@@ -27,6 +27,9 @@
  *  Generic engine interface.
  */
 
+#include "common/error.h"
+#include "common/ustring.h"
+
 #include "engines/engine.h"
 
 
@@ -38,4 +41,8 @@ Engine::Engine() {
 Engine::~Engine() {
 }
 
+void Engine::indexResources(const Common::UString &target) {
+	throw Common::Exception("This engine can't index its resources without running the game");
+}
+
 } // End of namespace Engine
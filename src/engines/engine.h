@@ -44,6 +44,13 @@ public:
 
 	/** Run the game. */
 	virtual void run(const Common::UString &target) = 0;
+
+	/** Index the game's resources and register its model loader, without running the game.
+	 *
+	 *  This sets up the resource manager the same way running the game does,
+	 *  for tools that only want to load the game's resources.
+	 */
+	virtual void indexResources(const Common::UString &target);
 };
 
 } // End of namespace Engines
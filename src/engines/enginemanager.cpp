@@ -216,6 +216,12 @@ void EngineManager::run(GameInstance &game) const {
 
 }
 
+void EngineManager::indexResources(GameInstance &game) const {
+	createEngine(game);
+
+	game._engine->indexResources(game._target);
+}
+
 void EngineManager::cleanup(GameInstance &game) const {
 	try {
 		delete game._engine;
@@ -76,6 +76,9 @@ public:
 	/** Run the specified game. */
 	void run(GameInstance &game) const;
 
+	/** Index the specified game's resources and register its model loader, without running it. */
+	void indexResources(GameInstance &game) const;
+
 	/** Return the full game name to that game. */
 	Common::UString getGameName(GameInstance &game, bool platform = false) const;
 
@@ -27,6 +27,8 @@
  *  An area.
  */
 
+#include <set>
+
 #include "common/util.h"
 #include "common/error.h"
 #include "common/stream.h"
@@ -38,6 +40,7 @@
 #include "aurora/2dareg.h"
 
 #include "graphics/graphics.h"
+#include "graphics/camera.h"
 
 #include "graphics/aurora/cursorman.h"
 
@@ -131,16 +134,18 @@ void Area::show() {
 	playAmbientSound();
 	playAmbientMusic();
 
-	GfxMan.lockFrame();
+	Common::StackLock lock(_mutex);
 
-	// Show rooms
-	for (std::vector<Room *>::iterator r = _rooms.begin(); r != _rooms.end(); ++r)
-		(*r)->model->show();
+	GfxMan.lockFrame();
 
-	// Show objects
-	for (ObjectList::iterator o = _objects.begin(); o != _objects.end(); ++o)
+	// Show objects outside of rooms
+	for (ObjectList::iterator o = _roomlessObjects.begin(); o != _roomlessObjects.end(); ++o)
 		(*o)->show();
 
+	// Show the rooms visible from the camera, and their objects
+	_cameraRooms.clear();
+	updateRooms();
+
 	GfxMan.unlockFrame();
 
 	_visible = true;
@@ -156,6 +161,8 @@ void Area::hide() {
 
 	stopSound();
 
+	Common::StackLock lock(_mutex);
+
 	GfxMan.lockFrame();
 
 	// Hide objects
@@ -163,14 +170,25 @@ void Area::hide() {
 		(*o)->hide();
 
 	// Hide rooms
-	for (std::vector<Room *>::iterator room = _rooms.begin(); room != _rooms.end(); ++room)
+	for (std::vector<Room *>::iterator room = _rooms.begin(); room != _rooms.end(); ++room) {
 		(*room)->model->hide();
+		(*room)->visible = false;
+	}
 
 	GfxMan.unlockFrame();
 
 	_visible = false;
 }
 
+void Area::getModelMemory(Graphics::Aurora::ModelMemoryUsage &usage) const {
+	for (std::vector<Room *>::const_iterator room = _rooms.begin(); room != _rooms.end(); ++room)
+		if ((*room)->model)
+			usage.add(*(*room)->model);
+
+	for (ObjectList::const_iterator o = _objects.begin(); o != _objects.end(); ++o)
+		(*o)->getModelMemory(usage);
+}
+
 void Area::load(const Common::UString &resRef) {
 	_resRef = resRef;
 
@@ -186,6 +204,8 @@ void Area::load(const Common::UString &resRef) {
 	Aurora::GFFFile git(_resRef, Aurora::kFileTypeGIT, MKID_BE('GIT '));
 	loadGIT(git.getTopLevel());
 
+	assignRooms(); // Objects within rooms
+
 	_loaded = true;
 }
 
@@ -350,6 +370,14 @@ void Area::loadCreatures(const Aurora::GFFList &list) {
 
 void Area::loadModels() {
 	const Aurora::LYTFile::RoomArray &rooms = _lyt.getRooms();
+
+	// Parse the room models in the background, then place them in the same order
+	beginModelPreload();
+
+	for (size_t i = 0; i < rooms.size(); i++)
+		if (rooms[i].model != "****")
+			preloadModelObject(rooms[i].model);
+
 	_rooms.reserve(rooms.size());
 	for (size_t i = 0; i < rooms.size(); i++) {
 		const Aurora::LYTFile::Room &lytRoom = rooms[i];
@@ -363,6 +391,7 @@ void Area::loadModels() {
 		room->model = loadModelObject(lytRoom.model);
 		if (!room->model) {
 			delete room;
+			endModelPreload();
 			throw Common::Exception("Can't load model \"%s\" for area \"%s\"",
 			                        lytRoom.model.c_str(), _resRef.c_str());
 		}
@@ -372,6 +401,7 @@ void Area::loadModels() {
 		_rooms.push_back(room);
 	}
 
+	endModelPreload();
 }
 
 void Area::loadVisibles() {
@@ -386,11 +416,16 @@ void Area::loadVisibles() {
 			for (std::vector<Room *>::iterator iRoom = _rooms.begin(); iRoom != _rooms.end(); ++iRoom)
 				(*room)->visibles.push_back(*iRoom);
 
-			return;
+			continue;
 		}
 
+		// A room can always see itself
+		(*room)->visibles.push_back(*room);
+
 		// Otherwise, go through all rooms again, look for a match with the visibilities
 		for (std::vector<Room *>::iterator iRoom = _rooms.begin(); iRoom != _rooms.end(); ++iRoom) {
+			if (*iRoom == *room)
+				continue;
 
 			for (std::vector<Common::UString>::const_iterator vRoom = rooms.begin(); vRoom != rooms.end(); ++vRoom) {
 				if (vRoom->equalsIgnoreCase((*iRoom)->lytRoom->model)) {
@@ -406,6 +441,92 @@ void Area::loadVisibles() {
 
 }
 
+void Area::assignRooms() {
+	for (ObjectList::iterator o = _objects.begin(); o != _objects.end(); ++o) {
+		float x, y, z;
+		(*o)->getPosition(x, y, z);
+
+		/* Find the room the object stands in. The room models' bounding boxes
+		 * are in world space, where the Aurora z axis is pointing up. Objects
+		 * stand on the floor, so we look just a bit above their position. */
+
+		Room *room = 0;
+		for (std::vector<Room *>::iterator r = _rooms.begin(); r != _rooms.end(); ++r) {
+			if ((*r)->model->isIn(x, z + 0.1, -y)) {
+				room = *r;
+				break;
+			}
+		}
+
+		if (room)
+			room->objects.push_back(*o);
+		else
+			_roomlessObjects.push_back(*o);
+	}
+}
+
+void Area::updateRooms() {
+	float cPos[3];
+
+	CameraMan.lock();
+	memcpy(cPos, CameraMan.getPosition(), 3 * sizeof(float));
+	CameraMan.unlock();
+
+	// Find the rooms the camera is in
+	std::vector<Room *> cameraRooms;
+	for (std::vector<Room *>::iterator r = _rooms.begin(); r != _rooms.end(); ++r)
+		if ((*r)->model->isIn(cPos[0], cPos[1], -cPos[2]))
+			cameraRooms.push_back(*r);
+
+	if (cameraRooms.empty()) {
+		// Outside of all rooms, keep what we see. If we don't see anything yet, show everything
+		for (std::vector<Room *>::iterator r = _rooms.begin(); r != _rooms.end(); ++r)
+			if ((*r)->visible)
+				return;
+
+		cameraRooms = _rooms;
+	}
+
+	if (cameraRooms == _cameraRooms)
+		return;
+
+	_cameraRooms.swap(cameraRooms);
+
+	// Collect all rooms visible from the rooms the camera is in
+	std::set<Room *> visibles;
+	for (std::vector<Room *>::iterator r = _cameraRooms.begin(); r != _cameraRooms.end(); ++r) {
+		visibles.insert(*r);
+		visibles.insert((*r)->visibles.begin(), (*r)->visibles.end());
+	}
+
+	GfxMan.lockFrame();
+
+	for (std::vector<Room *>::iterator r = _rooms.begin(); r != _rooms.end(); ++r)
+		setRoomVisible(**r, visibles.find(*r) != visibles.end());
+
+	GfxMan.unlockFrame();
+}
+
+void Area::setRoomVisible(Room &room, bool visible) {
+	if (room.visible == visible)
+		return;
+
+	room.visible = visible;
+
+	if (visible) {
+		room.model->show();
+
+		for (ObjectList::iterator o = room.objects.begin(); o != room.objects.end(); ++o)
+			(*o)->show();
+
+	} else {
+		for (ObjectList::iterator o = room.objects.begin(); o != room.objects.end(); ++o)
+			(*o)->hide();
+
+		room.model->hide();
+	}
+}
+
 void Area::addEvent(const Events::Event &event) {
 	_eventQueue.push_back(event);
 }
@@ -488,6 +609,12 @@ void Area::removeFocus() {
 }
 
 void Area::notifyCameraMoved() {
+	if (_visible) {
+		Common::StackLock lock(_mutex);
+
+		updateRooms();
+	}
+
 	checkActive();
 }
 
@@ -69,6 +69,9 @@ public:
 	void show();
 	void hide();
 
+	/** Add the geometry the models of the area's rooms and objects hold to the counts. */
+	void getModelMemory(Graphics::Aurora::ModelMemoryUsage &usage) const;
+
 	void addEvent(const Events::Event &event);
 	void processEventQueue();
 
@@ -80,6 +83,8 @@ protected:
 
 
 private:
+	typedef std::list<Object *> ObjectList;
+
 	/** A room within the area. */
 	struct Room {
 		const Aurora::LYTFile::Room *lytRoom;
@@ -89,12 +94,12 @@ private:
 		bool visible;
 		std::vector<Room *> visibles;
 
+		ObjectList objects; ///< The objects standing within the room.
+
 		Room(const Aurora::LYTFile::Room &lRoom);
 		~Room();
 	};
 
-	typedef std::list<Object *> ObjectList;
-
 	typedef std::map<uint32, Object *> ObjectMap;
 
 
@@ -124,8 +129,10 @@ private:
 	Aurora::VISFile _vis;
 
 	std::vector<Room *> _rooms;
+	std::vector<Room *> _cameraRooms; ///< The rooms the camera is currently in.
 
 	ObjectList _objects;
+	ObjectList _roomlessObjects; ///< Objects not standing within any room.
 
 	ObjectMap _objectMap;
 
@@ -153,6 +160,12 @@ private:
 	void loadDoors     (const Aurora::GFFList &list);
 	void loadCreatures (const Aurora::GFFList &list);
 
+	void assignRooms();
+
+	/** Show the rooms visible from the camera's position, and hide all others. */
+	void updateRooms();
+	void setRoomVisible(Room &room, bool visible);
+
 	void stopSound();
 	void stopAmbientMusic();
 	void stopAmbientSound();
@@ -33,9 +33,11 @@
 #include "common/util.h"
 
 #include "graphics/aurora/fontman.h"
+#include "graphics/aurora/model.h"
 
 #include "engines/kotor/console.h"
 #include "engines/kotor/module.h"
+#include "engines/kotor/area.h"
 
 namespace Engines {
 
@@ -44,8 +46,11 @@ namespace KotOR {
 Console::Console() : ::Engines::Console(Graphics::Aurora::kSystemFontMono, 13),
 	_module(0) {
 
-	registerCommand("loadmodule", boost::bind(&Console::cmdLoadModule, this, _1),
+	registerCommand("loadmodule"  , boost::bind(&Console::cmdLoadModule  , this, _1),
 			"Usage: loadmodule <module>\nLoad and enter the specified module");
+	registerCommand("areamodelmem", boost::bind(&Console::cmdAreaModelMem, this, _1),
+			"Usage: areamodelmem [<file>]\nShow the geometry held in memory by the models "
+			"of the current area.\nIf a file was given, dump the full list of models into it");
 }
 
 Console::~Console() {
@@ -67,6 +72,16 @@ void Console::cmdLoadModule(const CommandLine &cl) {
 	_module->replaceModule(cl.args);
 }
 
+void Console::cmdAreaModelMem(const CommandLine &cl) {
+	if (!_module || !_module->_area)
+		return;
+
+	Graphics::Aurora::ModelMemoryUsage usage(_module->_area->getName());
+	_module->_area->getModelMemory(usage);
+
+	printModelMemoryUsage(std::list<Graphics::Aurora::ModelMemoryUsage>(1, usage), cl.args);
+}
+
 } // End of namespace KOTOR
 
 } // End of namespace Engines
@@ -48,7 +48,8 @@ public:
 private:
 	Module *_module;
 
-	void cmdLoadModule(const CommandLine &cl);
+	void cmdLoadModule  (const CommandLine &cl);
+	void cmdAreaModelMem(const CommandLine &cl);
 };
 
 } // End of namespace KOTOR
@@ -66,6 +66,11 @@ void Creature::hide() {
 		_model->hide();
 }
 
+void Creature::getModelMemory(Graphics::Aurora::ModelMemoryUsage &usage) const {
+	if (_model)
+		usage.add(*_model);
+}
+
 void Creature::setPosition(float x, float y, float z) {
 	Object::setPosition(x, y, z);
 	Object::getPosition(x, y, z);
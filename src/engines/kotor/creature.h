@@ -56,6 +56,8 @@ public:
 	void show();
 	void hide();
 
+	void getModelMemory(Graphics::Aurora::ModelMemoryUsage &usage) const;
+
 	void setPosition(float x, float y, float z);
 	void setOrientation(float x, float y, float z);
 
@@ -157,6 +157,12 @@ void KotOREngine::run(const Common::UString &target) {
 	deinit();
 }
 
+void KotOREngine::indexResources(const Common::UString &target) {
+	_baseDirectory = target;
+
+	initResources();
+}
+
 void KotOREngine::init() {
 	initConfig();
 	checkConfig();
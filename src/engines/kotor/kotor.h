@@ -104,6 +104,7 @@ public:
 	~KotOREngine();
 
 	void run(const Common::UString &target);
+	void indexResources(const Common::UString &target);
 
 private:
 	Common::UString _baseDirectory;
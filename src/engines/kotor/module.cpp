@@ -30,6 +30,7 @@
 #include "common/util.h"
 #include "common/error.h"
 #include "common/ustring.h"
+#include "common/debug.h"
 
 #include "graphics/camera.h"
 
@@ -44,6 +45,8 @@
 #include "engines/kotor/module.h"
 #include "engines/kotor/area.h"
 
+using Common::kDebugGraphics;
+
 namespace Engines {
 
 namespace KotOR {
@@ -173,9 +176,23 @@ void Module::loadIFO() {
 }
 
 void Module::loadArea() {
+	TextureMan.resetCacheStats();
+	TextureMan.getFileCache().resetStats();
+
+	const uint32 startTime = EventMan.getTimestamp();
+
 	_area = createArea();
 
 	_area->load(_ifo.getEntryArea());
+
+	const uint32 loadTime = EventMan.getTimestamp() - startTime;
+
+	uint32 hits, misses, fileHits, fileMisses;
+	TextureMan.getCacheStats(hits, misses);
+	TextureMan.getFileCache().getStats(fileHits, fileMisses);
+
+	debugC(2, kDebugGraphics, "Area textures: %u reused, %u loaded, %u of them out of the texture cache (%u ms)",
+	       hits, misses, fileHits, loadTime);
 }
 
 static const char *texturePacks[3] = {
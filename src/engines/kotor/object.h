@@ -35,6 +35,8 @@
 #include "common/types.h"
 #include "common/ustring.h"
 
+#include "graphics/aurora/types.h"
+
 namespace Engines {
 
 namespace KotOR {
@@ -48,6 +50,9 @@ public:
 	virtual void show() = 0;
 	virtual void hide() = 0;
 
+	/** Add the geometry the object's model(s) hold to the counts. */
+	virtual void getModelMemory(Graphics::Aurora::ModelMemoryUsage &usage) const = 0;
+
 	const Common::UString &getTag() const;
 	const Common::UString &getName() const;
 	const Common::UString &getDescription() const;
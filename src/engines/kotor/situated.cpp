@@ -68,6 +68,11 @@ void Situated::hide() {
 		_model->hide();
 }
 
+void Situated::getModelMemory(Graphics::Aurora::ModelMemoryUsage &usage) const {
+	if (_model)
+		usage.add(*_model);
+}
+
 void Situated::setPosition(float x, float y, float z) {
 	Object::setPosition(x, y, z);
 	Object::getPosition(x, y, z);
@@ -143,6 +143,12 @@ void KotOR2Engine::run(const Common::UString &target) {
 	deinit();
 }
 
+void KotOR2Engine::indexResources(const Common::UString &target) {
+	_baseDirectory = target;
+
+	initResources();
+}
+
 void KotOR2Engine::init() {
 	initConfig();
 	checkConfig();
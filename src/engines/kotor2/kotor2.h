@@ -93,6 +93,7 @@ public:
 	~KotOR2Engine();
 
 	void run(const Common::UString &target);
+	void indexResources(const Common::UString &target);
 
 private:
 	Common::UString _baseDirectory;
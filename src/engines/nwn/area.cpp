@@ -255,6 +255,15 @@ void Area::hide() {
 	_visible = false;
 }
 
+void Area::getModelMemory(Graphics::Aurora::ModelMemoryUsage &usage) const {
+	for (std::vector<Tile>::const_iterator t = _tiles.begin(); t != _tiles.end(); ++t)
+		if (t->model)
+			usage.add(*t->model);
+
+	for (ObjectList::const_iterator o = _objects.begin(); o != _objects.end(); ++o)
+		(*o)->getModelMemory(usage);
+}
+
 void Area::loadARE(const Aurora::GFFStruct &are) {
 	// Tag
 
@@ -378,20 +387,38 @@ void Area::loadTile(const Aurora::GFFStruct &t, Tile &tile) {
 }
 
 void Area::loadModels() {
-	loadTileModels();
+	loadTileset();
+
+	// Parse the models in the background, then place them in the same order
+	beginModelPreload();
 
-	for (ObjectList::iterator o = _objects.begin(); o != _objects.end(); ++o) {
-		Engines::NWN::Object &object = **o;
+	try {
+		preloadTiles();
 
-		object.loadModel();
+		for (ObjectList::iterator o = _objects.begin(); o != _objects.end(); ++o)
+			(*o)->preloadModel();
 
-		if (!object.isStatic()) {
-			const std::list<uint32> &ids = object.getIDs();
+		loadTiles();
 
-			for (std::list<uint32>::const_iterator id = ids.begin(); id != ids.end(); ++id)
-				_objectMap.insert(std::make_pair(*id, &object));
+		for (ObjectList::iterator o = _objects.begin(); o != _objects.end(); ++o) {
+			Engines::NWN::Object &object = **o;
+
+			object.loadModel();
+
+			if (!object.isStatic()) {
+				const std::list<uint32> &ids = object.getIDs();
+
+				for (std::list<uint32>::const_iterator id = ids.begin(); id != ids.end(); ++id)
+					_objectMap.insert(std::make_pair(*id, &object));
+			}
 		}
+
+	} catch (...) {
+		endModelPreload();
+		throw;
 	}
+
+	endModelPreload();
 }
 
 void Area::unloadModels() {
@@ -400,15 +427,6 @@ void Area::unloadModels() {
 	for (ObjectList::iterator o = _objects.begin(); o != _objects.end(); ++o)
 		(*o)->unloadModel();
 
-	unloadTileModels();
-}
-
-void Area::loadTileModels() {
-	loadTileset();
-	loadTiles();
-}
-
-void Area::unloadTileModels() {
 	unloadTiles();
 	unloadTileset();
 }
@@ -432,6 +450,11 @@ void Area::unloadTileset() {
 	_tileset = 0;
 }
 
+void Area::preloadTiles() {
+	for (std::vector<Tile>::const_iterator t = _tiles.begin(); t != _tiles.end(); ++t)
+		preloadModelObject(_tileset->getTile(t->tileID).model);
+}
+
 void Area::loadTiles() {
 	for (uint32 y = 0; y < _height; y++) {
 		for (uint32 x = 0; x < _width; x++) {
@@ -81,6 +81,9 @@ public:
 	void show(); ///< Show the area.
 	void hide(); ///< Hide the area.
 
+	/** Add the geometry the models of the area's tiles and objects hold to the counts. */
+	void getModelMemory(Graphics::Aurora::ModelMemoryUsage &usage) const;
+
 	// Music/Sound
 
 	uint32 getMusicDayTrack   () const; ///< Return the music track ID playing by day.
@@ -223,12 +226,10 @@ private:
 	void loadModels();
 	void unloadModels();
 
-	void loadTileModels();
-	void unloadTileModels();
-
 	void loadTileset();
 	void unloadTileset();
 
+	void preloadTiles();
 	void loadTiles();
 	void unloadTiles();
 
@@ -36,6 +36,7 @@
 #include "aurora/talkman.h"
 
 #include "graphics/aurora/fontman.h"
+#include "graphics/aurora/model.h"
 
 #include "engines/aurora/util.h"
 
@@ -79,6 +80,9 @@ Console::Console() : ::Engines::Console(Graphics::Aurora::kSystemFontMono, 13),
 			"Usage: listareas\nList all areas in the current module");
 	registerCommand("gotoarea"     , boost::bind(&Console::cmdGotoArea     , this, _1),
 			"Usage: gotoarea <area>\nMove to a specific area");
+	registerCommand("areamodelmem" , boost::bind(&Console::cmdAreaModelMem , this, _1),
+			"Usage: areamodelmem [<file>]\nShow the geometry held in memory by the models "
+			"of each loaded area.\nIf a file was given, dump the full list of models into it");
 	registerCommand("listmusic"    , boost::bind(&Console::cmdListMusic    , this, _1),
 			"Usage: listmusic\nList all available music resources");
 	registerCommand("stopmusic"    , boost::bind(&Console::cmdStopMusic    , this, _1),
@@ -271,6 +275,31 @@ void Console::cmdGotoArea(const CommandLine &cl) {
 	printf("Area \"%s\" does not exist", cl.args.c_str());
 }
 
+void Console::cmdAreaModelMem(const CommandLine &cl) {
+	if (!_module)
+		return;
+
+	// Only the areas that have their models loaded hold any geometry
+	std::list<Graphics::Aurora::ModelMemoryUsage> areas;
+	for (Module::AreaMap::const_iterator a = _module->_areas.begin(); a != _module->_areas.end(); ++a) {
+		if (!a->second)
+			continue;
+
+		Graphics::Aurora::ModelMemoryUsage usage(a->first);
+		a->second->getModelMemory(usage);
+
+		if (usage.getTotal().models > 0)
+			areas.push_back(usage);
+	}
+
+	if (areas.empty()) {
+		printf("No area has any models loaded");
+		return;
+	}
+
+	printModelMemoryUsage(areas, cl.args);
+}
+
 void Console::cmdListMusic(const CommandLine &cl) {
 	updateMusic();
 	printList(_music, _maxSizeMusic);
@@ -85,6 +85,7 @@ private:
 	void cmdLoadModule   (const CommandLine &cl);
 	void cmdListAreas    (const CommandLine &cl);
 	void cmdGotoArea     (const CommandLine &cl);
+	void cmdAreaModelMem (const CommandLine &cl);
 	void cmdListMusic    (const CommandLine &cl);
 	void cmdStopMusic    (const CommandLine &cl);
 	void cmdPlayMusic    (const CommandLine &cl);
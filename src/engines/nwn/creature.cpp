@@ -149,6 +149,11 @@ void Creature::hide() {
 		_model->hide();
 }
 
+void Creature::getModelMemory(Graphics::Aurora::ModelMemoryUsage &usage) const {
+	if (_model)
+		usage.add(*_model);
+}
+
 void Creature::setPosition(float x, float y, float z) {
 	Object::setPosition(x, y, z);
 	Object::getPosition(x, y, z);
@@ -342,6 +347,19 @@ void Creature::finishPLTs(std::list<Graphics::Aurora::PLTHandle> &plts) {
 	}
 }
 
+void Creature::preloadModel() {
+	if (_model || (_appearanceID == Aurora::kFieldIDInvalid))
+		return;
+
+	const Aurora::TwoDARow &appearance = TwoDAReg.get("appearance").getRow(_appearanceID);
+
+	// Part-based creatures collect their PLTs while loading, so they're loaded in place
+	if (appearance.getString("MODELTYPE") == "P")
+		return;
+
+	preloadModelObject(appearance.getString("RACE"));
+}
+
 void Creature::loadModel() {
 	if (_model)
 		return;
@@ -397,6 +415,9 @@ void Creature::loadModel() {
 		_model->setClickable(isClickable());
 
 		_ids.push_back(_model->getID());
+
+		// Idle about, if the model comes with the animation
+		_model->playAnimation("pause1");
 	}
 }
 
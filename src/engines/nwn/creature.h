@@ -61,12 +61,16 @@ public:
 
 	// Basic visuals
 
-	void loadModel();   ///< Load the creature's model.
-	void unloadModel(); ///< Unload the creature's model.
+	void preloadModel(); ///< Queue the creature's model for parsing in the background.
+	void loadModel();    ///< Load the creature's model.
+	void unloadModel();  ///< Unload the creature's model.
 
 	void show(); ///< Show the creature's model.
 	void hide(); ///< Hide the creature's model.
 
+	/** Add the geometry the creature's model holds to the counts. */
+	void getModelMemory(Graphics::Aurora::ModelMemoryUsage &usage) const;
+
 	// Basic properties
 
 	/** Return the creature's first name. */
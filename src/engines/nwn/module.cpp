@@ -30,6 +30,7 @@
 #include "common/util.h"
 #include "common/error.h"
 #include "common/configman.h"
+#include "common/debug.h"
 
 #include "events/events.h"
 
@@ -55,6 +56,8 @@
 
 #include "engines/nwn/gui/ingame/ingame.h"
 
+using Common::kDebugGraphics;
+
 struct GenderToken {
 	const char *token;
 	uint32 male;
@@ -357,8 +360,19 @@ void Module::enterArea() {
 
 	_currentArea = area->second;
 
+	TextureMan.resetCacheStats();
+	TextureMan.getFileCache().resetStats();
+
+	const uint32 startTime = EventMan.getTimestamp();
+
 	_currentArea->show();
 
+	const uint32 showTime = EventMan.getTimestamp() - startTime;
+
+	uint32 hits, misses, fileHits, fileMisses;
+	TextureMan.getCacheStats(hits, misses);
+	TextureMan.getFileCache().getStats(fileHits, fileMisses);
+
 	EventMan.flushEvents();
 
 	_ingameGUI->setArea(_currentArea->getName());
@@ -368,6 +382,8 @@ void Module::enterArea() {
 	_currentArea->runScript(kScriptEnter, _currentArea, _pc);
 
 	_console->printf("Entering area \"%s\"", _currentArea->getResRef().c_str());
+	debugC(2, kDebugGraphics, "Area textures: %u reused, %u loaded, %u of them out of the texture cache (%u ms)",
+	       hits, misses, fileHits, showTime);
 }
 
 void Module::run() {
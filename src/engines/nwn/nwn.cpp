@@ -149,6 +149,12 @@ void NWNEngine::run(const Common::UString &target) {
 	deinit();
 }
 
+void NWNEngine::indexResources(const Common::UString &target) {
+	_baseDirectory = target;
+
+	initResources();
+}
+
 void NWNEngine::init() {
 	initConfig();
 	checkConfig();
@@ -85,6 +85,7 @@ public:
 	~NWNEngine();
 
 	void run(const Common::UString &target);
+	void indexResources(const Common::UString &target);
 
 	/** Return a list of all modules. */
 	static void getModules(std::vector<Common::UString> &modules);
@@ -72,6 +72,9 @@ ObjectType Object::getType() const {
 	return _type;
 }
 
+void Object::preloadModel() {
+}
+
 void Object::loadModel() {
 }
 
@@ -84,6 +87,9 @@ void Object::show() {
 void Object::hide() {
 }
 
+void Object::getModelMemory(Graphics::Aurora::ModelMemoryUsage &usage) const {
+}
+
 const Common::UString &Object::getName() const {
 	return _name;
 }
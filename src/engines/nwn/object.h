@@ -37,6 +37,8 @@
 
 #include "aurora/nwscript/object.h"
 
+#include "graphics/aurora/types.h"
+
 #include "sound/types.h"
 
 #include "engines/nwn/location.h"
@@ -67,12 +69,16 @@ public:
 
 	// Basic visuals
 
-	virtual void loadModel();   ///< Load the object's model(s).
-	virtual void unloadModel(); ///< Unload the object's model(s).
+	virtual void preloadModel(); ///< Queue the object's model(s) for parsing in the background.
+	virtual void loadModel();    ///< Load the object's model(s).
+	virtual void unloadModel();  ///< Unload the object's model(s).
 
 	virtual void show(); ///< Show the object's model(s).
 	virtual void hide(); ///< Hide the object's model(s).
 
+	/** Add the geometry the object's model(s) hold to the counts. */
+	virtual void getModelMemory(Graphics::Aurora::ModelMemoryUsage &usage) const;
+
 	/** Return the object's model IDs. */
 	const std::list<uint32> &getIDs() const;
 
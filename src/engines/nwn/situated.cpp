@@ -56,6 +56,13 @@ Situated::~Situated() {
 	delete _model;
 }
 
+void Situated::preloadModel() {
+	if (_model || _modelName.empty())
+		return;
+
+	preloadModelObject(_modelName);
+}
+
 void Situated::loadModel() {
 	if (_model)
 		return;
@@ -105,6 +112,11 @@ void Situated::hide() {
 		_model->hide();
 }
 
+void Situated::getModelMemory(Graphics::Aurora::ModelMemoryUsage &usage) const {
+	if (_model)
+		usage.add(*_model);
+}
+
 void Situated::setPosition(float x, float y, float z) {
 	Object::setPosition(x, y, z);
 	Object::getPosition(x, y, z);
@@ -45,12 +45,16 @@ class Situated : public Object {
 public:
 	~Situated();
 
-	void loadModel();   ///< Load the situated object's model.
-	void unloadModel(); ///< Unload the situated object's model.
+	void preloadModel(); ///< Queue the situated object's model for parsing in the background.
+	void loadModel();    ///< Load the situated object's model.
+	void unloadModel();  ///< Unload the situated object's model.
 
 	void show(); ///< Show the situated object's model.
 	void hide(); ///< Hide the situated object's model.
 
+	/** Add the geometry the situated object's model holds to the counts. */
+	void getModelMemory(Graphics::Aurora::ModelMemoryUsage &usage) const;
+
 	/** Set the situated object's position. */
 	void setPosition(float x, float y, float z);
 	/** Set the situated object's orientation. */
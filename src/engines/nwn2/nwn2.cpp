@@ -203,6 +203,12 @@ void NWN2Engine::run(const Common::UString &target) {
 	delete fps;
 }
 
+void NWN2Engine::indexResources(const Common::UString &target) {
+	_baseDirectory = target;
+
+	init();
+}
+
 void NWN2Engine::init() {
 	status("Setting base directory");
 	ResMan.registerDataBaseDir(_baseDirectory);
@@ -73,6 +73,7 @@ public:
 	~NWN2Engine();
 
 	void run(const Common::UString &target);
+	void indexResources(const Common::UString &target);
 
 private:
 	Common::UString _baseDirectory;
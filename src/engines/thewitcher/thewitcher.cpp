@@ -199,6 +199,12 @@ void TheWitcherEngine::run(const Common::UString &target) {
 	delete fps;
 }
 
+void TheWitcherEngine::indexResources(const Common::UString &target) {
+	_baseDirectory = target;
+
+	init();
+}
+
 void TheWitcherEngine::init() {
 	status("Setting base directory");
 	ResMan.registerDataBaseDir(_baseDirectory);
@@ -73,6 +73,7 @@ public:
 	~TheWitcherEngine();
 
 	void run(const Common::UString &target);
+	void indexResources(const Common::UString &target);
 
 private:
 	Common::UString _baseDirectory;
@@ -0,0 +1,224 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey and Eclipse engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/aurora/animation.cpp
+ *  A skeletal model animation.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "graphics/aurora/animation.h"
+#include "graphics/aurora/nodeindex.h"
+
+namespace Graphics {
+
+namespace Aurora {
+
+Animation::Track::Track(const Common::UString &n) : node(n), nodeID(NodeNames.intern(n)),
+	positionStart(0), positionCount(0), orientationStart(0), orientationCount(0) {
+
+}
+
+
+Animation::Animation(const Common::UString &name, float length, float transitionTime) :
+	_name(name), _length(length), _transitionTime(transitionTime) {
+
+}
+
+Animation::~Animation() {
+}
+
+const Common::UString &Animation::getName() const {
+	return _name;
+}
+
+float Animation::getLength() const {
+	return _length;
+}
+
+float Animation::getTransitionTime() const {
+	return _transitionTime;
+}
+
+uint32 Animation::getTrackCount() const {
+	return _tracks.size();
+}
+
+const Common::UString &Animation::getTrackNode(uint32 track) const {
+	assert(track < _tracks.size());
+
+	return _tracks[track].node;
+}
+
+uint32 Animation::getTrackNodeID(uint32 track) const {
+	assert(track < _tracks.size());
+
+	return _tracks[track].nodeID;
+}
+
+Animation::Track &Animation::getTrack(const Common::UString &node) {
+	TrackMap::const_iterator t = _trackMap.find(node);
+	if (t != _trackMap.end())
+		return _tracks[t->second];
+
+	_trackMap.insert(std::make_pair(node, _tracks.size()));
+	_tracks.push_back(Track(node));
+
+	return _tracks.back();
+}
+
+void Animation::addPositionKeys(const Common::UString &node, uint32 count,
+                                const float *times, const float *positions, uint32 stride) {
+
+	if (count == 0)
+		return;
+
+	Track &track = getTrack(node);
+
+	track.positionStart = _positionTime.size();
+	track.positionCount = count;
+
+	_positionTime.insert(_positionTime.end(), times, times + count);
+
+	for (uint32 i = 0; i < count; i++, positions += stride) {
+		_positionX.push_back(positions[0]);
+		_positionY.push_back(positions[1]);
+		_positionZ.push_back(positions[2]);
+	}
+}
+
+void Animation::addOrientationKeys(const Common::UString &node, uint32 count,
+                                   const float *times, const float *orientations, uint32 stride) {
+
+	if (count == 0)
+		return;
+
+	Track &track = getTrack(node);
+
+	track.orientationStart = _orientationTime.size();
+	track.orientationCount = count;
+
+	_orientationTime.insert(_orientationTime.end(), times, times + count);
+
+	for (uint32 i = 0; i < count; i++, orientations += stride) {
+		_orientationX.push_back(orientations[0]);
+		_orientationY.push_back(orientations[1]);
+		_orientationZ.push_back(orientations[2]);
+		_orientationW.push_back(orientations[3]);
+	}
+}
+
+uint32 Animation::findKey(const float *times, uint32 count, float time, float &fraction) {
+	fraction = 0.0;
+
+	if ((count == 1) || (time <= times[0]))
+		return 0;
+
+	if (time >= times[count - 1])
+		return count - 1;
+
+	// The first key after the time, which is never the first key here
+	const uint32 next = std::upper_bound(times, times + count, time) - times;
+
+	const float span = times[next] - times[next - 1];
+	if (span > 0.0)
+		fraction = (time - times[next - 1]) / span;
+
+	return next - 1;
+}
+
+void Animation::sample(float time, Pose *poses) const {
+	for (std::vector<Track>::const_iterator t = _tracks.begin(); t != _tracks.end(); ++t, ++poses) {
+		poses->hasPosition    = t->positionCount    > 0;
+		poses->hasOrientation = t->orientationCount > 0;
+
+		float f;
+
+		if (poses->hasPosition) {
+			const uint32 s = t->positionStart;
+			const uint32 k = s + findKey(&_positionTime[s], t->positionCount, time, f);
+			const uint32 n = (f > 0.0) ? (k + 1) : k;
+
+			poses->position[0] = _positionX[k] + (_positionX[n] - _positionX[k]) * f;
+			poses->position[1] = _positionY[k] + (_positionY[n] - _positionY[k]) * f;
+			poses->position[2] = _positionZ[k] + (_positionZ[n] - _positionZ[k]) * f;
+		}
+
+		if (poses->hasOrientation) {
+			const uint32 s = t->orientationStart;
+			const uint32 k = s + findKey(&_orientationTime[s], t->orientationCount, time, f);
+			const uint32 n = (f > 0.0) ? (k + 1) : k;
+
+			const float a[4] = { _orientationX[k], _orientationY[k], _orientationZ[k], _orientationW[k] };
+			const float b[4] = { _orientationX[n], _orientationY[n], _orientationZ[n], _orientationW[n] };
+
+			interpolateQuaternion(a, b, f, poses->orientation);
+		}
+	}
+}
+
+void Animation::interpolate(const Pose &from, const Pose &to, float fraction, Pose &pose) {
+	for (int i = 0; i < 3; i++)
+		pose.position[i] = from.position[i] + (to.position[i] - from.position[i]) * fraction;
+
+	interpolateQuaternion(from.orientation, to.orientation, fraction, pose.orientation);
+
+	pose.hasPosition    = true;
+	pose.hasOrientation = true;
+}
+
+void Animation::interpolateQuaternion(const float *a, const float *b, float fraction, float *q) {
+	/* Normalized linear interpolation, along the shorter arc. With the keys
+	 * as close together as they are, this is indistinguishable from a proper
+	 * slerp, and a lot cheaper. */
+
+	const float dot = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+
+	const float fA = 1.0 - fraction;
+	const float fB = (dot < 0.0) ? -fraction : fraction;
+
+	q[0] = a[0] * fA + b[0] * fB;
+	q[1] = a[1] * fA + b[1] * fB;
+	q[2] = a[2] * fA + b[2] * fB;
+	q[3] = a[3] * fA + b[3] * fB;
+
+	const float length = sqrtf(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+	if (length <= 0.0) {
+		q[0] = q[1] = q[2] = 0.0;
+		q[3] = 1.0;
+		return;
+	}
+
+	q[0] /= length;
+	q[1] /= length;
+	q[2] /= length;
+	q[3] /= length;
+}
+
+} // End of namespace Aurora
+
+} // End of namespace Graphics
@@ -0,0 +1,160 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey and Eclipse engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/aurora/animation.h
+ *  A skeletal model animation.
+ */
+
+#ifndef GRAPHICS_AURORA_ANIMATION_H
+#define GRAPHICS_AURORA_ANIMATION_H
+
+#include <vector>
+#include <map>
+
+#include "common/types.h"
+#include "common/ustring.h"
+
+namespace Graphics {
+
+namespace Aurora {
+
+/** A skeletal model animation.
+ *
+ *  An animation consists of tracks, each moving and turning one node of
+ *  a model over time. The keys of all tracks are stored in one pool per
+ *  component (times, X, Y, Z, ...), so that sampling a track walks over
+ *  contiguous floats instead of chasing pointers.
+ */
+class Animation {
+public:
+	/** A node's transformation, sampled from a track. */
+	struct Pose {
+		float position[3];    ///< Position of the node.
+		float orientation[4]; ///< Orientation of the node, as a quaternion (x, y, z, w).
+
+		bool hasPosition;    ///< Does the track move the node?
+		bool hasOrientation; ///< Does the track turn the node?
+	};
+
+	Animation(const Common::UString &name, float length, float transitionTime);
+	~Animation();
+
+	/** Return the animation's name. */
+	const Common::UString &getName() const;
+
+	/** Return the length of the animation, in seconds. */
+	float getLength() const;
+	/** Return the time, in seconds, over which to blend into this animation. */
+	float getTransitionTime() const;
+
+	/** Return the number of tracks. */
+	uint32 getTrackCount() const;
+	/** Return the name of the node a track animates. */
+	const Common::UString &getTrackNode(uint32 track) const;
+	/** Return the interned name ID of the node a track animates. */
+	uint32 getTrackNodeID(uint32 track) const;
+
+	/** Add position keys for this node.
+	 *
+	 *  @param node The name of the node to move.
+	 *  @param count The number of keys.
+	 *  @param times The time of each key, in seconds.
+	 *  @param positions The positions of the keys, stride floats apart.
+	 *  @param stride The distance between two positions, in floats.
+	 */
+	void addPositionKeys(const Common::UString &node, uint32 count,
+	                     const float *times, const float *positions, uint32 stride = 3);
+
+	/** Add orientation keys for this node.
+	 *
+	 *  @param node The name of the node to turn.
+	 *  @param count The number of keys.
+	 *  @param times The time of each key, in seconds.
+	 *  @param orientations The quaternions (x, y, z, w) of the keys, stride floats apart.
+	 *  @param stride The distance between two quaternions, in floats.
+	 */
+	void addOrientationKeys(const Common::UString &node, uint32 count,
+	                        const float *times, const float *orientations, uint32 stride = 4);
+
+	/** Sample all tracks at this time, writing getTrackCount() poses. */
+	void sample(float time, Pose *poses) const;
+
+	/** Interpolate between two complete poses. */
+	static void interpolate(const Pose &from, const Pose &to, float fraction, Pose &pose);
+
+private:
+	/** The keys moving and turning one node. */
+	struct Track {
+		Common::UString node;   ///< The name of the node.
+		uint32          nodeID; ///< The interned name ID of the node.
+
+		uint32 positionStart; ///< Index of the first position key.
+		uint32 positionCount; ///< Number of position keys.
+
+		uint32 orientationStart; ///< Index of the first orientation key.
+		uint32 orientationCount; ///< Number of orientation keys.
+
+		Track(const Common::UString &n);
+	};
+
+	typedef std::map<Common::UString, uint32, Common::UString::iless> TrackMap;
+
+
+	Common::UString _name;
+
+	float _length;
+	float _transitionTime;
+
+	std::vector<Track> _tracks;
+	TrackMap _trackMap;
+
+	// Position keys
+	std::vector<float> _positionTime;
+	std::vector<float> _positionX;
+	std::vector<float> _positionY;
+	std::vector<float> _positionZ;
+
+	// Orientation keys
+	std::vector<float> _orientationTime;
+	std::vector<float> _orientationX;
+	std::vector<float> _orientationY;
+	std::vector<float> _orientationZ;
+	std::vector<float> _orientationW;
+
+
+	Track &getTrack(const Common::UString &node);
+
+	/** Find the key at or before this time, and how far we are towards the next one. */
+	static uint32 findKey(const float *times, uint32 count, float time, float &fraction);
+
+	/** Interpolate between two quaternions, along the shorter arc. */
+	static void interpolateQuaternion(const float *a, const float *b, float fraction, float *q);
+};
+
+} // End of namespace Aurora
+
+} // End of namespace Graphics
+
+#endif // GRAPHICS_AURORA_ANIMATION_H
@@ -0,0 +1,130 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey and Eclipse engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/aurora/cachefile.cpp
+ *  Files caching data derived from resources, kept across runs.
+ */
+
+#include <cstdio>
+#include <cstring>
+
+#include <SDL_thread.h>
+
+#include "common/util.h"
+#include "common/error.h"
+#include "common/stream.h"
+#include "common/file.h"
+#include "common/filepath.h"
+
+#include "graphics/aurora/cachefile.h"
+
+namespace Graphics {
+
+namespace Aurora {
+
+/** FNV-1a hash of a string. */
+static uint32 hashString(const Common::UString &str) {
+	uint32 hash = 2166136261U;
+
+	for (const char *s = str.c_str(); *s; s++)
+		hash = (hash ^ ((byte) *s)) * 16777619U;
+
+	return hash;
+}
+
+bool getCacheFile(const Common::UString &directory, const Common::UString &id, const char *extension,
+                  const ::Aurora::ResourceManager::ResourceOrigin &origin,
+                  Common::UString &file, Common::UString &key) {
+
+	const uint32 time = Common::FilePath::getModificationTime(origin.file);
+	if (time == Common::kFileInvalid)
+		return false;
+
+	file = Common::UString::sprintf("%s/%s-%08X.%s", directory.c_str(), id.c_str(),
+	                                hashString(origin.file), extension);
+	key  = Common::UString::sprintf("%s|%u|%u|%u|%u", origin.file.c_str(),
+	                                origin.index, origin.size, (uint32) origin.type, time);
+
+	return true;
+}
+
+Common::MemoryReadStream *readCacheFile(const Common::UString &file, const Common::UString &key) {
+	Common::File cacheFile;
+	if (!cacheFile.open(file) || (cacheFile.size() <= 4))
+		return 0;
+
+	Common::MemoryReadStream *stream = cacheFile.readStream(cacheFile.size());
+
+	// The cache file starts with the key it was written for
+	const uint32 keySize = strlen(key.c_str());
+	if (!stream || (stream->readUint32LE() != keySize) ||
+	    ((uint32) (stream->size() - stream->pos()) < keySize) ||
+	    std::memcmp(stream->readInPlace(keySize), key.c_str(), keySize)) {
+
+		delete stream;
+		return 0;
+	}
+
+	return stream;
+}
+
+void writeCacheFile(const Common::UString &file, const Common::UString &key,
+                    const byte *data, uint32 size) {
+
+	// Each thread writes into a temporary file of its own
+	const Common::UString tmpFile =
+		Common::UString::sprintf("%s.%u.tmp", file.c_str(), (uint32) SDL_ThreadID());
+
+	try {
+		Common::DumpFile cacheFile;
+		if (!cacheFile.open(tmpFile))
+			throw Common::Exception(Common::kOpenError);
+
+		cacheFile.writeUint32LE(strlen(key.c_str()));
+		cacheFile.writeString(key);
+
+		if (cacheFile.write(data, size) != size)
+			throw Common::Exception(Common::kWriteError);
+
+		if (!cacheFile.flush() || cacheFile.err())
+			throw Common::Exception(Common::kWriteError);
+
+		cacheFile.close();
+
+		std::remove(file.c_str());
+		if (std::rename(tmpFile.c_str(), file.c_str()) != 0)
+			throw Common::Exception("Failed renaming \"%s\"", tmpFile.c_str());
+
+	} catch (Common::Exception &e) {
+		std::remove(tmpFile.c_str());
+
+		e.add("Failed writing cache file \"%s\"", file.c_str());
+		Common::printException(e, "WARNING: ");
+	}
+}
+
+} // End of namespace Aurora
+
+} // End of namespace Graphics
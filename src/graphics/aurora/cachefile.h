@@ -0,0 +1,88 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey and Eclipse engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/aurora/cachefile.h
+ *  Files caching data derived from resources, kept across runs.
+ */
+
+#ifndef GRAPHICS_AURORA_CACHEFILE_H
+#define GRAPHICS_AURORA_CACHEFILE_H
+
+#include "common/types.h"
+#include "common/ustring.h"
+
+#include "aurora/resman.h"
+
+namespace Common {
+	class MemoryReadStream;
+}
+
+namespace Graphics {
+
+namespace Aurora {
+
+/** Find the cache file for data derived from a resource.
+ *
+ *  The file is named after the ID the caller gives the data, and a hash of
+ *  the path of the file the resource is read from, to tell apart same-named
+ *  resources from different files.
+ *
+ *  The key identifies the resource data the cache file is created from: the
+ *  file the resource is read from, the resource's place and size within that
+ *  file, its type and the file's modification time. If any of these changes,
+ *  the cache file is outdated.
+ *
+ *  @param  directory The directory holding the cache files.
+ *  @param  id The name of the cached data, unique within the directory.
+ *  @param  extension The extension of the cache file, without the dot.
+ *  @param  origin The place the resource's data is read from.
+ *  @param  file The path of the cache file.
+ *  @param  key The key identifying the resource data.
+ *  @return false if the resource's file doesn't exist.
+ */
+bool getCacheFile(const Common::UString &directory, const Common::UString &id, const char *extension,
+                  const ::Aurora::ResourceManager::ResourceOrigin &origin,
+                  Common::UString &file, Common::UString &key);
+
+/** Read a cache file with one single read, if it was written for that key.
+ *
+ *  The returned stream is positioned right after the key, at the cached data.
+ */
+Common::MemoryReadStream *readCacheFile(const Common::UString &file, const Common::UString &key);
+
+/** Write a cache file starting with its key.
+ *
+ *  The data is written into a temporary file first, which then replaces the
+ *  cache file, so that nobody ever reads a half-written cache file. Failures
+ *  only print a warning.
+ */
+void writeCacheFile(const Common::UString &file, const Common::UString &key,
+                    const byte *data, uint32 size);
+
+} // End of namespace Aurora
+
+} // End of namespace Graphics
+
+#endif // GRAPHICS_AURORA_CACHEFILE_H
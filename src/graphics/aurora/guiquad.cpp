@@ -165,7 +165,21 @@ void GUIQuad::render(RenderPass pass) {
 			((pass == kRenderPassTransparent) && !isTransparent))
 		return;
 
-	TextureMan.set(_texture);
+	float tX1 = _tX1, tY1 = _tY1, tX2 = _tX2, tY2 = _tY2;
+
+	// Textures repeated over the quad can't come out of the atlas
+	const bool repeated = (MIN(MIN(tX1, tX2), MIN(tY1, tY2)) < 0.0) ||
+	                      (MAX(MAX(tX1, tX2), MAX(tY1, tY2)) > 1.0);
+
+	if (repeated) {
+		TextureMan.set(_texture);
+	} else {
+		const AtlasRegion *region = TextureMan.setAtlased(_texture);
+		if (region) {
+			region->map(tX1, tY1);
+			region->map(tX2, tY2);
+		}
+	}
 
 	glColor4f(_r, _g, _b, _a);
 
@@ -175,13 +189,13 @@ void GUIQuad::render(RenderPass pass) {
 	}
 
 	glBegin(GL_QUADS);
-		glTexCoord2f(_tX1, _tY1);
+		glTexCoord2f(tX1, tY1);
 		glVertex2f(_x1, _y1);
-		glTexCoord2f(_tX2, _tY1);
+		glTexCoord2f(tX2, tY1);
 		glVertex2f(_x2, _y1);
-		glTexCoord2f(_tX2, _tY2);
+		glTexCoord2f(tX2, tY2);
 		glVertex2f(_x2, _y2);
-		glTexCoord2f(_tX1, _tY2);
+		glTexCoord2f(tX1, tY2);
 		glVertex2f(_x1, _y2);
 	glEnd();
 
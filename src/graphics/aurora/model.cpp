@@ -27,23 +27,74 @@
  *  A 3D model of an object.
  */
 
+#include <algorithm>
+#include <set>
+#include <cmath>
+
+#include "common/util.h"
 #include "common/stream.h"
 
 #include "graphics/graphics.h"
 #include "graphics/camera.h"
+#include "graphics/queueman.h"
 
 #include "graphics/aurora/model.h"
 #include "graphics/aurora/modelnode.h"
+#include "graphics/aurora/texture.h"
+#include "graphics/aurora/skinning.h"
 
 namespace Graphics {
 
 namespace Aurora {
 
+/** Number of vertex cluster cells along the model's longest side, for each detail level. */
+static const float kLODResolution[] = { 0.0, 32.0, 8.0 };
+
+/** A detail level is used when its cluster cells are at most this many pixels large. */
+static const float kLODMaxError = 2.0;
+
+ModelMemory::ModelMemory(const Common::UString &n) : name(n), models(0), nodes(0),
+	faces(0), vertices(0), texCoords(0), geometrySize(0), listSize(0) {
+}
+
+uint32 ModelMemory::getSize() const {
+	return geometrySize + listSize;
+}
+
+void ModelMemory::add(const ModelMemory &memory) {
+	models       += memory.models;
+	nodes        += memory.nodes;
+	faces        += memory.faces;
+	vertices     += memory.vertices;
+	texCoords    += memory.texCoords;
+	geometrySize += memory.geometrySize;
+	listSize     += memory.listSize;
+}
+
+bool ModelMemory::operator<(const ModelMemory &right) const {
+	return getSize() > right.getSize();
+}
+
+
+Model::AnimationChannel::AnimationChannel() : animation(0), time(0.0), loop(false) {
+}
+
+void Model::AnimationChannel::swap(AnimationChannel &channel) {
+	std::swap(animation, channel.animation);
+	std::swap(time     , channel.time);
+	std::swap(loop     , channel.loop);
+
+	nodes.swap(channel.nodes);
+	rest.swap(channel.rest);
+	poses.swap(channel.poses);
+}
+
+
 Model::Model(ModelType type) : Renderable((RenderableType) type),
-	_type(type), _currentState(0), _drawBound(false), _lists(0) {
+	_type(type), _currentState(0), _drawBound(false), _lists(0), _lodCount(1), _lod(0),
+	_blendTime(0.0), _blendLength(0.0), _animationStep(0) {
 
-	for (int i = 0; i < kRenderPassAll; i++)
-		_needBuild[i] = true;
+	needRebuild();
 
 	_position[0] = 0.0; _position[1] = 0.0; _position[2] = 0.0;
 	_rotation[0] = 0.0; _rotation[1] = 0.0; _rotation[2] = 0.0;
@@ -54,15 +105,20 @@ Model::Model(ModelType type) : Renderable((RenderableType) type),
 Model::~Model() {
 	hide();
 
+	stopAnimation();
+
 	if (_lists != 0)
-		GfxMan.abandon(_lists, kRenderPassAll);
+		GfxMan.abandon(_lists, kLODCount * kRenderPassAll);
 
 	for (StateList::iterator s = _stateList.begin(); s != _stateList.end(); ++s) {
-		for (NodeList::iterator n = (*s)->nodeList.begin(); n != (*s)->nodeList.end(); ++n)
+		for (NodeArray::iterator n = (*s)->nodes.begin(); n != (*s)->nodes.end(); ++n)
 			delete *n;
 
 		delete *s;
 	}
+
+	for (AnimationList::iterator a = _animationList.begin(); a != _animationList.end(); ++a)
+		delete *a;
 }
 
 ModelType Model::getType() const {
@@ -189,11 +245,11 @@ void Model::rotate(float x, float y, float z) {
 }
 
 void Model::getTooltipAnchor(float &x, float &y, float &z) const {
-	Common::TransformationMatrix pos = _absolutePosition;
-
-	pos.translate(0.0, 0.0, _absoluteBoundBox.getHeight() + 0.5);
+	x = 0.0;
+	y = 0.0;
+	z = _absoluteBoundBox.getHeight() + 0.5;
 
-	pos.getPosition(x, y, z);
+	_absolutePosition.transformPoint(x, y, z);
 }
 
 void Model::createAbsolutePosition() {
@@ -245,8 +301,23 @@ void Model::setState(const Common::UString &name) {
 	if (visible)
 		hide();
 
+	// The playing animations need to move the nodes of the new state
+	Renderable::lockQueue(kQueueAnimatedObject);
+
+	unbindAnimation(_animation);
+	unbindAnimation(_lastAnimation);
+
+	resetSkins();
+
 	_currentState = state;
 
+	bindSkins();
+
+	bindAnimation(_animation);
+	bindAnimation(_lastAnimation);
+
+	Renderable::unlockQueue(kQueueAnimatedObject);
+
 	// TODO: Do we need to recreate the bounding box on a state change?
 	// createBound();
 
@@ -266,37 +337,424 @@ const Common::UString &Model::getState() const {
 	return _currentState->name;
 }
 
-bool Model::hasNode(const Common::UString &node) const {
-	if (!_currentState)
+const std::list<Common::UString> &Model::getAnimations() const {
+	return _animationNames;
+}
+
+void Model::addAnimation(Animation *animation) {
+	assert(animation);
+
+	AnimationMap::iterator a = _animationMap.find(animation->getName());
+	if (a != _animationMap.end()) {
+		warning("Model::addAnimation(): Duplicate animation \"%s\" in model \"%s\"",
+		        animation->getName().c_str(), _name.c_str());
+
+		delete animation;
+		return;
+	}
+
+	_animationList.push_back(animation);
+	_animationMap.insert(std::make_pair(animation->getName(), animation));
+
+	_animationNames.push_back(animation->getName());
+}
+
+bool Model::isAnimating() const {
+	return _animation.animation != 0;
+}
+
+bool Model::playAnimation(const Common::UString &name, bool loop) {
+	AnimationMap::iterator a = _animationMap.find(name);
+	if (a == _animationMap.end())
 		return false;
 
-	NodeMap::iterator n = _currentState->nodeMap.find(node);
-	if (n == _currentState->nodeMap.end())
+	GfxMan.lockFrame();
+	Renderable::lockQueue(kQueueAnimatedObject);
+
+	// Blend over from the current animation, dropping the one we were already blending from
+	unbindAnimation(_lastAnimation);
+	_lastAnimation.swap(_animation);
+
+	_animation.animation = a->second;
+	_animation.time      = 0.0;
+	_animation.loop      = loop;
+
+	bindAnimation(_animation);
+
+	_blendTime   = 0.0;
+	_blendLength = _lastAnimation.animation ? a->second->getTransitionTime() : 0.0;
+
+	applyAnimations();
+
+	if (!Renderable::isInQueue(kQueueAnimatedObject))
+		Renderable::addToQueue(kQueueAnimatedObject);
+
+	Renderable::unlockQueue(kQueueAnimatedObject);
+	GfxMan.unlockFrame();
+
+	return true;
+}
+
+void Model::stopAnimation() {
+	GfxMan.lockFrame();
+	Renderable::lockQueue(kQueueAnimatedObject);
+
+	unbindAnimation(_animation);
+	unbindAnimation(_lastAnimation);
+
+	_animation.animation     = 0;
+	_lastAnimation.animation = 0;
+
+	resetSkins();
+
+	if (Renderable::isInQueue(kQueueAnimatedObject))
+		Renderable::removeFromQueue(kQueueAnimatedObject);
+
+	Renderable::unlockQueue(kQueueAnimatedObject);
+	GfxMan.unlockFrame();
+}
+
+void Model::bindAnimation(AnimationChannel &channel) {
+	if (!channel.animation)
+		return;
+
+	const uint32 trackCount = channel.animation->getTrackCount();
+
+	channel.nodes.resize(trackCount);
+	channel.rest.resize(trackCount);
+	channel.poses.resize(trackCount);
+
+	for (uint32 i = 0; i < trackCount; i++) {
+		ModelNode *node = getNode(channel.animation->getTrackNodeID(i));
+
+		channel.nodes[i] = node;
+		if (!node)
+			continue;
+
+		Animation::Pose &rest = channel.rest[i];
+
+		rest.position[0] = node->_position[0];
+		rest.position[1] = node->_position[1];
+		rest.position[2] = node->_position[2];
+
+		node->getOrientationQuaternion(rest.orientation);
+
+		rest.hasPosition    = true;
+		rest.hasOrientation = true;
+	}
+}
+
+void Model::unbindAnimation(AnimationChannel &channel) {
+	if (!channel.animation)
+		return;
+
+	for (std::vector<ModelNode *>::iterator n = channel.nodes.begin(); n != channel.nodes.end(); ++n) {
+		if (*n) {
+			(*n)->_animated       = false;
+			(*n)->_transformDirty = true;
+		}
+	}
+}
+
+/** Advance the channel's time, returning false if a non-looping animation has ended. */
+static bool advanceTime(float &time, float length, bool loop, float elapsed) {
+	time += elapsed;
+	if (time < length)
+		return true;
+
+	if (!loop || (length <= 0.0)) {
+		time = length;
 		return false;
+	}
 
+	time = fmodf(time, length);
 	return true;
 }
 
+void Model::advanceAnimation(float elapsed) {
+	if (!_animation.animation)
+		return;
+
+	Renderable::lockQueue(kQueueAnimatedObject);
+
+	if (_lastAnimation.animation) {
+		advanceTime(_lastAnimation.time, _lastAnimation.animation->getLength(), _lastAnimation.loop, elapsed);
+
+		_blendTime += elapsed;
+		if (_blendTime >= _blendLength) {
+			// Done blending over
+			unbindAnimation(_lastAnimation);
+			_lastAnimation.animation = 0;
+		}
+	}
+
+	if (!advanceTime(_animation.time, _animation.animation->getLength(), _animation.loop, elapsed)) {
+		stopAnimation();
+		Renderable::unlockQueue(kQueueAnimatedObject);
+		return;
+	}
+
+	// No need to move nodes nobody can see
+	if (isVisible()) {
+		applyAnimations();
+		deformSkins();
+	}
+
+	Renderable::unlockQueue(kQueueAnimatedObject);
+}
+
+/** The pose of a node, with what the track doesn't move taken from its resting pose. */
+static void completePose(const Animation::Pose &pose, const Animation::Pose &rest, Animation::Pose &result) {
+	const float *position    = pose.hasPosition    ? pose.position    : rest.position;
+	const float *orientation = pose.hasOrientation ? pose.orientation : rest.orientation;
+
+	result.position[0] = position[0];
+	result.position[1] = position[1];
+	result.position[2] = position[2];
+
+	result.orientation[0] = orientation[0];
+	result.orientation[1] = orientation[1];
+	result.orientation[2] = orientation[2];
+	result.orientation[3] = orientation[3];
+
+	result.hasPosition    = true;
+	result.hasOrientation = true;
+}
+
+static void getNodePose(const float *position, const float *orientation, Animation::Pose &pose) {
+	pose.position[0] = position[0];
+	pose.position[1] = position[1];
+	pose.position[2] = position[2];
+
+	pose.orientation[0] = orientation[0];
+	pose.orientation[1] = orientation[1];
+	pose.orientation[2] = orientation[2];
+	pose.orientation[3] = orientation[3];
+
+	pose.hasPosition    = true;
+	pose.hasOrientation = true;
+}
+
+static void setNodePose(float *position, float *orientation, const Animation::Pose &pose) {
+	position[0] = pose.position[0];
+	position[1] = pose.position[1];
+	position[2] = pose.position[2];
+
+	orientation[0] = pose.orientation[0];
+	orientation[1] = pose.orientation[1];
+	orientation[2] = pose.orientation[2];
+	orientation[3] = pose.orientation[3];
+}
+
+void Model::applyAnimations() {
+	/* We first put all nodes into the pose of the animation we're blending from,
+	 * then blend the nodes of the current animation from there (or from their
+	 * resting places) into their new pose. Nodes only the old animation moves
+	 * blend back into their resting places. The step counter tells us which
+	 * animation touched a node last, so that we don't need any extra storage. */
+
+	if (!_animation.animation)
+		return;
+
+	float weight = 1.0;
+
+	Animation::Pose pose, from, to;
+
+	const uint32 lastStep = ++_animationStep;
+	if (_lastAnimation.animation) {
+		weight = (_blendLength > 0.0) ? CLIP(_blendTime / _blendLength, 0.0f, 1.0f) : 1.0f;
+
+		AnimationChannel &c = _lastAnimation;
+		if (!c.poses.empty())
+			c.animation->sample(c.time, &c.poses[0]);
+
+		for (uint32 i = 0; i < c.nodes.size(); i++) {
+			ModelNode *node = c.nodes[i];
+			if (!node)
+				continue;
+
+			completePose(c.poses[i], c.rest[i], pose);
+			setNodePose(node->_animPosition, node->_animOrientation, pose);
+
+			node->_animStamp      = lastStep;
+			node->_animated       = true;
+			node->_transformDirty = true;
+		}
+	}
+
+	const uint32 currentStep = ++_animationStep;
+	if (!_animation.poses.empty()) {
+		AnimationChannel &c = _animation;
+		c.animation->sample(c.time, &c.poses[0]);
+
+		for (uint32 i = 0; i < c.nodes.size(); i++) {
+			ModelNode *node = c.nodes[i];
+			if (!node)
+				continue;
+
+			completePose(c.poses[i], c.rest[i], to);
+
+			if (weight < 1.0) {
+				if (node->_animStamp == lastStep)
+					getNodePose(node->_animPosition, node->_animOrientation, from);
+				else
+					from = c.rest[i];
+
+				Animation::interpolate(from, to, weight, pose);
+				setNodePose(node->_animPosition, node->_animOrientation, pose);
+			} else
+				setNodePose(node->_animPosition, node->_animOrientation, to);
+
+			node->_animStamp      = currentStep;
+			node->_animated       = true;
+			node->_transformDirty = true;
+		}
+	}
+
+	if (_lastAnimation.animation) {
+		AnimationChannel &c = _lastAnimation;
+
+		for (uint32 i = 0; i < c.nodes.size(); i++) {
+			ModelNode *node = c.nodes[i];
+			if (!node || (node->_animStamp != lastStep))
+				continue;
+
+			getNodePose(node->_animPosition, node->_animOrientation, from);
+
+			Animation::interpolate(from, c.rest[i], weight, pose);
+			setNodePose(node->_animPosition, node->_animOrientation, pose);
+		}
+	}
+}
+
+void Model::bindSkins() {
+	_skinNodes.clear();
+
+	if (!_currentState)
+		return;
+
+	std::map<uint32, ModelNode *> numbers;
+	for (NodeArray::iterator n = _currentState->nodes.begin(); n != _currentState->nodes.end(); ++n) {
+		numbers.insert(std::make_pair((*n)->_nodeNumber, *n));
+
+		if ((*n)->_skin)
+			_skinNodes.push_back(*n);
+	}
+
+	for (std::vector<ModelNode *>::iterator n = _skinNodes.begin(); n != _skinNodes.end(); ++n) {
+		Skin &skin = *(*n)->_skin;
+
+		Common::TransformationMatrix skinRest;
+		(*n)->getModelTransform(skinRest, false);
+
+		for (uint32 b = 0; b < skin.boneNumbers.size(); b++) {
+			std::map<uint32, ModelNode *>::const_iterator bone = numbers.find(skin.boneNumbers[b]);
+
+			skin.boneNodes[b] = (bone != numbers.end()) ? bone->second : 0;
+			if (!skin.boneNodes[b])
+				continue;
+
+			// Takes a vertex from the skin node at rest into the bone node at rest
+			Common::TransformationMatrix boneRest;
+			skin.boneNodes[b]->getModelTransform(boneRest, false);
+
+			skin.bindPose[b] = boneRest.getInverse() * skinRest;
+		}
+	}
+}
+
+void Model::deformSkins() {
+	if (_skinNodes.empty())
+		return;
+
+	updateTransforms();
+
+	for (std::vector<ModelNode *>::iterator n = _skinNodes.begin(); n != _skinNodes.end(); ++n) {
+		Skin &skin = *(*n)->_skin;
+
+		// The matrices might still be in use by the last frame's batch
+		SkinMan.wait(skin);
+
+		const Common::Matrix4x4 toSkin = (*n)->_modelTransform.getInverse();
+
+		for (uint32 b = 0; b < skin.boneNodes.size(); b++) {
+			if (!skin.boneNodes[b]) {
+				skin.matrices[b].loadIdentity();
+				continue;
+			}
+
+			skin.matrices[b] = toSkin * skin.boneNodes[b]->_modelTransform * skin.bindPose[b];
+		}
+
+		skin.deformed = true;
+
+		SkinMan.add(skin);
+	}
+}
+
+void Model::resetSkins() {
+	for (std::vector<ModelNode *>::iterator n = _skinNodes.begin(); n != _skinNodes.end(); ++n) {
+		SkinMan.wait(*(*n)->_skin);
+
+		(*n)->_skin->deformed = false;
+	}
+}
+
+void Model::waitForSkins() {
+	for (std::vector<ModelNode *>::iterator n = _skinNodes.begin(); n != _skinNodes.end(); ++n)
+		SkinMan.wait(*(*n)->_skin);
+}
+
+bool Model::hasNode(const Common::UString &node) const {
+	return getNode(node) != 0;
+}
+
 ModelNode *Model::getNode(const Common::UString &node) {
+	return getNode(NodeNames.find(node));
+}
+
+ModelNode *Model::getNode(uint32 nameID) {
 	if (!_currentState)
 		return 0;
 
-	NodeMap::iterator n = _currentState->nodeMap.find(node);
-	if (n == _currentState->nodeMap.end())
+	const uint32 n = _currentState->nodeIndex.find(nameID);
+	if (n == NodeIndex::kNoNode)
 		return 0;
 
-	return n->second;
+	return _currentState->nodes[n];
+}
+
+void Model::getMemoryUsage(ModelMemory &memory) const {
+	memory.models++;
+
+	for (StateList::const_iterator s = _stateList.begin(); s != _stateList.end(); ++s)
+		for (NodeArray::const_iterator n = (*s)->nodes.begin(); n != (*s)->nodes.end(); ++n)
+			(*n)->getMemoryUsage(memory);
+
+	if (!_currentState || (_lists == 0))
+		return;
+
+	// Each display list built holds the vertex data of the current state, as rendered then
+	for (uint lod = 0; lod < kLODCount; lod++) {
+		for (int pass = 0; pass < kRenderPassAll; pass++) {
+			if (_needBuild[lod][pass])
+				continue;
+
+			for (NodeArray::const_iterator n = _currentState->nodes.begin(); n != _currentState->nodes.end(); ++n)
+				memory.listSize += (*n)->getRenderSize((RenderPass) pass, lod);
+		}
+	}
 }
 
 const ModelNode *Model::getNode(const Common::UString &node) const {
 	if (!_currentState)
 		return 0;
 
-	NodeMap::const_iterator n = _currentState->nodeMap.find(node);
-	if (n == _currentState->nodeMap.end())
+	const uint32 n = _currentState->nodeIndex.find(NodeNames.find(node));
+	if (n == NodeIndex::kNoNode)
 		return 0;
 
-	return n->second;
+	return _currentState->nodes[n];
 }
 
 void Model::calculateDistance() {
@@ -306,68 +764,85 @@ void Model::calculateDistance() {
 	}
 
 
-	Common::TransformationMatrix center = _absolutePosition;
+	float centerX = _center[0], centerY = _center[1], centerZ = _center[2];
 
-	center.translate(_center[0], _center[1], _center[2]);
+	_absolutePosition.transformPoint(centerX, centerY, centerZ);
 
 
 	const float cameraX =  CameraMan.getPosition()[0];
 	const float cameraY =  CameraMan.getPosition()[1];
 	const float cameraZ = -CameraMan.getPosition()[2];
 
-	const float x = ABS(center.getX() - cameraX);
-	const float y = ABS(center.getY() - cameraY);
-	const float z = ABS(center.getZ() - cameraZ);
+	const float x = ABS(centerX - cameraX);
+	const float y = ABS(centerY - cameraY);
+	const float z = ABS(centerZ - cameraZ);
 
 
 	_distance = x + y + z;
-}
 
-bool Model::buildList(RenderPass pass) {
-	if (!_needBuild[pass])
-		return false;
+	const float distance = sqrt(x * x + y * y + z * z);
 
-	if (_lists == 0)
-		_lists = glGenLists(kRenderPassAll);
+	_lod = selectLOD(distance);
 
-	glNewList(_lists + pass, GL_COMPILE);
+	requestTextureDetail(distance);
+}
 
+float Model::getScreenSize(float distance) const {
+	const float size = MAX(MAX(_absoluteBoundBox.getWidth(), _absoluteBoundBox.getHeight()),
+	                       _absoluteBoundBox.getDepth());
 
-	// Apply our global model transformation
+	return GfxMan.getProjectedSize(size, distance);
+}
 
-	glScalef(_modelScale[0], _modelScale[1], _modelScale[2]);
+uint Model::selectLOD(float distance) const {
+	const float bias = GfxMan.getLODBias();
+	if ((_lodCount <= 1) || (bias <= 0.0))
+		return 0;
 
-	if (_type == kModelTypeObject)
-		// Aurora world objects have a rotated axis
-		glRotatef(90.0, -1.0, 0.0, 0.0);
+	const float pixels = getScreenSize(distance);
 
-	glTranslatef(_position[0], _position[1], _position[2]);
+	// Use the simplest level whose cluster cells don't get too large on screen
+	for (uint lod = _lodCount - 1; lod > 0; lod--)
+		if ((pixels / kLODResolution[lod]) <= (kLODMaxError * bias))
+			return lod;
 
-	glRotatef( _rotation[0], 1.0, 0.0, 0.0);
-	glRotatef( _rotation[1], 0.0, 1.0, 0.0);
-	glRotatef(-_rotation[2], 0.0, 0.0, 1.0);
+	return 0;
+}
 
+bool Model::buildList(RenderPass pass) {
+	const uint lod = _lod;
 
-	// Draw the bounding box, if requested
-	doDrawBound();
+	if (!_needBuild[lod][pass])
+		return false;
 
-	// Draw the nodes
-	for (NodeList::iterator n = _currentState->rootNodes.begin();
-	     n != _currentState->rootNodes.end(); n++) {
+	if (_lists == 0)
+		_lists = glGenLists(kLODCount * kRenderPassAll);
 
-		glPushMatrix();
-		(*n)->render(pass);
-		glPopMatrix();
-	}
+	glNewList(_lists + lod * kRenderPassAll + pass, GL_COMPILE);
 
+	renderImmediate(pass, lod);
 
 	glEndList();
 
 
-	_needBuild[pass] = false;
+	_needBuild[lod][pass] = false;
 	return true;
 }
 
+void Model::renderImmediate(RenderPass pass, uint lod) {
+	// Apply our global model transformation, as kept up to date by createAbsolutePosition()
+	glMultMatrixf(_absolutePosition.get());
+
+	// Draw the bounding box, if requested
+	doDrawBound();
+
+	// Draw the nodes, each by its own transformation
+	updateTransforms();
+
+	for (NodeArray::iterator n = _currentState->nodes.begin(); n != _currentState->nodes.end(); ++n)
+		(*n)->render(pass, lod);
+}
+
 void Model::render(RenderPass pass) {
 	if (!_currentState || (pass > kRenderPassAll))
 		return;
@@ -379,8 +854,16 @@ void Model::render(RenderPass pass) {
 	}
 
 	// Render
-	buildList(pass);
-	glCallList(_lists + pass);
+	const uint lod = _lod;
+
+	if (isAnimating()) {
+		// The nodes move every frame, so there's no point in compiling them into a list
+		waitForSkins();
+		renderImmediate(pass, lod);
+	} else {
+		buildList(pass);
+		glCallList(_lists + lod * kRenderPassAll + pass);
+	}
 
 	// Reset the first texture units
 	TextureMan.reset();
@@ -450,29 +933,252 @@ void Model::doDestroy() {
 	if (_lists == 0)
 		return;
 
-	glDeleteLists(_lists, kRenderPassAll);
+	glDeleteLists(_lists, kLODCount * kRenderPassAll);
 	_lists = 0;
 }
 
+void Model::indexState(State &state) {
+	/* Walk the hierarchy depth first, each node followed by its children
+	 * in order. That's the order the nodes are rendered in, too. */
+
+	NodeArray nodes;
+	std::vector<uint32> parents;
+
+	nodes.reserve(state.nodes.size());
+	parents.reserve(state.nodes.size());
+
+	// The nodes still to visit, with the index of their parent
+	std::vector< std::pair<ModelNode *, uint32> > stack;
+
+	for (NodeList::reverse_iterator r = state.rootNodes.rbegin(); r != state.rootNodes.rend(); ++r)
+		stack.push_back(std::make_pair(*r, (uint32) NodeIndex::kNoNode));
+
+	while (!stack.empty()) {
+		ModelNode *node   = stack.back().first;
+		const uint32 parent = stack.back().second;
+		stack.pop_back();
+
+		const uint32 index = nodes.size();
+
+		nodes.push_back(node);
+		parents.push_back(parent);
+
+		for (NodeList::reverse_iterator c = node->_children.rbegin(); c != node->_children.rend(); ++c)
+			stack.push_back(std::make_pair(*c, index));
+	}
+
+	if (nodes.size() != state.nodes.size()) {
+		// Some nodes are not reachable from the roots. Keep them, so that they still get deleted
+		std::set<ModelNode *> reachable(nodes.begin(), nodes.end());
+
+		for (NodeArray::iterator n = state.nodes.begin(); n != state.nodes.end(); ++n) {
+			if (reachable.find(*n) == reachable.end()) {
+				nodes.push_back(*n);
+				parents.push_back(NodeIndex::kNoNode);
+			}
+		}
+	}
+
+	state.nodes.swap(nodes);
+	state.parents.swap(parents);
+
+	std::vector<uint32> nameIDs(state.nodes.size());
+	for (uint32 i = 0; i < state.nodes.size(); i++) {
+		ModelNode &node = *state.nodes[i];
+
+		if (node._nameID == NodeNameManager::kInvalidID)
+			node._nameID = NodeNames.intern(node._name);
+
+		nameIDs[i] = node._nameID;
+
+		// The parent might have changed
+		node._transformDirty = true;
+	}
+
+	state.nodeIndex.build(nameIDs);
+}
+
+void Model::indexStates() {
+	for (StateList::iterator s = _stateList.begin(); s != _stateList.end(); ++s)
+		indexState(**s);
+}
+
+uint32 Model::getSubtreeEnd(const State &state, uint32 index) {
+	// All nodes below this one follow it directly, and have parents at or after it
+	uint32 end = index + 1;
+	while ((end < state.parents.size()) &&
+	       (state.parents[end] != NodeIndex::kNoNode) && (state.parents[end] >= index))
+		end++;
+
+	return end;
+}
+
+void Model::reorderChildren(const ModelNode &parent) {
+	for (StateList::iterator s = _stateList.begin(); s != _stateList.end(); ++s) {
+		State &state = **s;
+
+		NodeArray::const_iterator p = std::find(state.nodes.begin(), state.nodes.end(), &parent);
+		if (p == state.nodes.end())
+			continue;
+
+		/* The parent is followed by its children, each in one block together
+		 * with the nodes below it. Gather these blocks in the new order. */
+
+		const uint32 parentIndex = p - state.nodes.begin();
+		const uint32 start       = parentIndex + 1;
+		const uint32 end         = getSubtreeEnd(state, parentIndex);
+
+		NodeArray nodes;
+		std::vector<uint32> parents;
+
+		nodes.reserve(end - start);
+		parents.reserve(end - start);
+
+		const NodeArray::const_iterator blocksStart = state.nodes.begin() + start;
+		const NodeArray::const_iterator blocksEnd   = state.nodes.begin() + end;
+
+		for (NodeList::const_iterator c = parent._children.begin(); c != parent._children.end(); ++c) {
+			NodeArray::const_iterator child = std::find(blocksStart, blocksEnd, *c);
+			if (child == blocksEnd)
+				continue;
+
+			const uint32 blockStart = child - state.nodes.begin();
+			const uint32 blockEnd   = getSubtreeEnd(state, blockStart);
+			const uint32 newStart   = start + nodes.size();
+
+			for (uint32 i = blockStart; i < blockEnd; i++) {
+				nodes.push_back(state.nodes[i]);
+				parents.push_back((i == blockStart) ? parentIndex : (state.parents[i] - blockStart + newStart));
+			}
+		}
+
+		// Should never happen, but rather keep the old order than lose nodes
+		if (nodes.size() != (end - start))
+			return;
+
+		std::copy(nodes.begin(), nodes.end(), state.nodes.begin() + start);
+		std::copy(parents.begin(), parents.end(), state.parents.begin() + start);
+
+		/* Names indexed into the blocks now point to the first node with that
+		 * name in the new order. Names indexed elsewhere stay as they are. */
+		std::set<uint32> moved;
+		for (uint32 i = start; i < end; i++) {
+			const uint32 id    = state.nodes[i]->_nameID;
+			const uint32 index = state.nodeIndex.find(id);
+
+			if ((index < start) || (index >= end) || !moved.insert(id).second)
+				continue;
+
+			state.nodeIndex.set(id, i);
+		}
+
+		return;
+	}
+}
+
+void Model::updateTransforms() {
+	if (!_currentState)
+		return;
+
+	/* Parents come before their children, so one pass is enough. A node
+	 * needs a new model transformation if it or any of its parents moved. */
+
+	const NodeArray &nodes = _currentState->nodes;
+	const std::vector<uint32> &parents = _currentState->parents;
+
+	for (uint32 i = 0; i < nodes.size(); i++) {
+		ModelNode &node = *nodes[i];
+
+		const ModelNode *parent = (parents[i] != NodeIndex::kNoNode) ? nodes[parents[i]] : 0;
+
+		node._transformMoved = node._transformDirty || (parent && parent->_transformMoved);
+		if (!node._transformMoved)
+			continue;
+
+		if (node._transformDirty) {
+			node._localTransform.loadIdentity();
+			node.applyTransform(node._localTransform, true);
+
+			node._transformDirty = false;
+		}
+
+		if (parent)
+			node._modelTransform = parent->_modelTransform * node._localTransform;
+		else
+			node._modelTransform = node._localTransform;
+	}
+}
+
 void Model::finalize() {
+	// The loader might have changed the model scale
+	createAbsolutePosition();
+
 	_currentState = 0;
 
 	createStateNamesList();
 	setState();
 
+	// By now, most textures should have been decoded in the background
+	for (StateList::iterator s = _stateList.begin(); s != _stateList.end(); ++s)
+		for (NodeArray::iterator n = (*s)->nodes.begin(); n != (*s)->nodes.end(); ++n)
+			(*n)->checkTransparency();
+
 	createBound();
+	createLODs();
+
+	collectStreamingTextures();
 
-	// Order all node children lists
+	// Order all node children lists, and the nodes with them
 	for (StateList::iterator s = _stateList.begin(); s != _stateList.end(); ++s)
 		for (NodeList::iterator n = (*s)->rootNodes.begin(); n != (*s)->rootNodes.end(); ++n)
 			(*n)->orderChildren();
 
+	indexStates();
+
 	needRebuild();
 }
 
+void Model::collectStreamingTextures() {
+	_streamingTextures.clear();
+
+	// Only world objects move far enough away to make the texture detail matter
+	if (_type != kModelTypeObject)
+		return;
+
+	for (StateList::iterator s = _stateList.begin(); s != _stateList.end(); ++s) {
+		for (NodeArray::iterator n = (*s)->nodes.begin(); n != (*s)->nodes.end(); ++n) {
+			const std::vector<TextureHandle> &textures = (*n)->_textures;
+
+			for (std::vector<TextureHandle>::const_iterator t = textures.begin(); t != textures.end(); ++t) {
+				if (t->empty())
+					continue;
+
+				Texture &texture = t->getTexture();
+				if (std::find(_streamingTextures.begin(), _streamingTextures.end(), &texture) != _streamingTextures.end())
+					continue;
+
+				texture.allowStreaming();
+				_streamingTextures.push_back(&texture);
+			}
+		}
+	}
+}
+
+void Model::requestTextureDetail(float distance) {
+	if (_streamingTextures.empty())
+		return;
+
+	// Assume each texture stretches over the whole model
+	const uint32 pixels = (uint32) getScreenSize(distance);
+
+	for (std::vector<Texture *>::iterator t = _streamingTextures.begin(); t != _streamingTextures.end(); ++t)
+		(*t)->requestSize(pixels);
+}
+
 void Model::needRebuild() {
-	for (int i = 0; i < kRenderPassAll; i++)
-		_needBuild[i] = true;
+	for (uint i = 0; i < kLODCount; i++)
+		for (int j = 0; j < kRenderPassAll; j++)
+			_needBuild[i][j] = true;
 }
 
 void Model::createStateNamesList() {
@@ -488,14 +1194,20 @@ void Model::createBound() {
 	if (!_currentState)
 		return;
 
-	for (NodeList::iterator n = _currentState->rootNodes.begin();
-	     n != _currentState->rootNodes.end(); ++n) {
+	updateTransforms();
 
-		Common::BoundingBox position;
+	const NodeArray &nodes = _currentState->nodes;
+	const std::vector<uint32> &parents = _currentState->parents;
 
-		(*n)->createAbsoluteBound(position);
+	for (NodeArray::const_iterator n = nodes.begin(); n != nodes.end(); ++n)
+		(*n)->createAbsoluteBound();
 
-		_boundBox.add((*n)->getAbsoluteBound());
+	// Children come after their parents, so going backwards collects whole subtrees
+	for (uint32 i = nodes.size(); i-- > 0; ) {
+		if (parents[i] != NodeIndex::kNoNode)
+			nodes[parents[i]]->_absoluteBoundBox.add(nodes[i]->_absoluteBoundBox);
+		else
+			_boundBox.add(nodes[i]->_absoluteBoundBox);
 	}
 
 	float minX, minY, minZ, maxX, maxY, maxZ;
@@ -512,12 +1224,34 @@ void Model::createBound() {
 	_absoluteBoundBox.absolutize();
 }
 
-void Model::readValue(Common::SeekableReadStream &stream, uint32 &value) {
-	value = stream.readUint32LE();
+void Model::createLODs() {
+	_lodCount = 1;
+
+	// Only world objects can be far enough away to need simpler versions
+	if (_type != kModelTypeObject)
+		return;
+
+	const float size = MAX(MAX(_boundBox.getWidth(), _boundBox.getHeight()), _boundBox.getDepth());
+	if (size <= 0.0)
+		return;
+
+	for (StateList::iterator s = _stateList.begin(); s != _stateList.end(); ++s) {
+		for (NodeArray::iterator n = (*s)->nodes.begin(); n != (*s)->nodes.end(); ++n) {
+			(*n)->clearLODs();
+
+			for (uint lod = 1; lod < kLODCount; lod++)
+				if ((*n)->createLOD(lod, size / kLODResolution[lod]))
+					_lodCount = MAX(_lodCount, lod + 1);
+		}
+	}
+}
+
+void Model::readValues(Common::SeekableReadStream &stream, uint32 *values, uint32 count) {
+	stream.readUint32LE(values, count);
 }
 
-void Model::readValue(Common::SeekableReadStream &stream, float &value) {
-	value = stream.readIEEEFloatLE();
+void Model::readValues(Common::SeekableReadStream &stream, float *values, uint32 count) {
+	stream.readIEEEFloatLE(values, count);
 }
 
 void Model::readArrayDef(Common::SeekableReadStream &stream,
@@ -542,8 +1276,8 @@ void Model::readArray(Common::SeekableReadStream &stream,
 	uint32 pos = stream.seekTo(offset);
 
 	values.resize(count);
-	for (uint32 i = 0; i < count; i++)
-		readValue(stream, values[i]);
+	if (count > 0)
+		readValues(stream, &values[0], count);
 
 	stream.seekTo(pos);
 }
@@ -555,6 +1289,50 @@ template
 void Model::readArray<float>(Common::SeekableReadStream &stream,
                              uint32 offset, uint32 count, std::vector<float> &values);
 
+
+ModelMemoryUsage::ModelMemoryUsage(const Common::UString &name) : _total(name) {
+}
+
+void ModelMemoryUsage::add(const Model &model) {
+	ModelMap::iterator m = _models.find(model.getName());
+	if (m == _models.end())
+		m = _models.insert(std::make_pair(model.getName(), ModelMemory(model.getName()))).first;
+
+	ModelMemory memory;
+	model.getMemoryUsage(memory);
+
+	m->second.add(memory);
+	_total.add(memory);
+}
+
+void ModelMemoryUsage::addVisible() {
+	static const QueueType kQueues[] = { kQueueVisibleWorldObject, kQueueVisibleGUIFrontObject };
+
+	for (int i = 0; i < ARRAYSIZE(kQueues); i++) {
+		QueueMan.lockQueue(kQueues[i]);
+
+		const std::list<Queueable *> &objects = QueueMan.getQueue(kQueues[i]);
+		for (std::list<Queueable *>::const_iterator o = objects.begin(); o != objects.end(); ++o) {
+			const Model *model = dynamic_cast<const Model *>(*o);
+			if (model)
+				add(*model);
+		}
+
+		QueueMan.unlockQueue(kQueues[i]);
+	}
+}
+
+const ModelMemory &ModelMemoryUsage::getTotal() const {
+	return _total;
+}
+
+void ModelMemoryUsage::getModels(std::list<ModelMemory> &models) const {
+	for (ModelMap::const_iterator m = _models.begin(); m != _models.end(); ++m)
+		models.push_back(m->second);
+
+	models.sort();
+}
+
 } // End of namespace Aurora
 
 } // End of namespace Graphics
@@ -43,6 +43,8 @@
 #include "graphics/renderable.h"
 
 #include "graphics/aurora/types.h"
+#include "graphics/aurora/animation.h"
+#include "graphics/aurora/nodeindex.h"
 
 namespace Common {
 	class SeekableReadStream;
@@ -53,6 +55,32 @@ namespace Graphics {
 namespace Aurora {
 
 class ModelNode;
+class Texture;
+
+/** The geometry one model, or a group of models, holds in memory. */
+struct ModelMemory {
+	Common::UString name; ///< The name of the model, or of the group of models.
+
+	uint32 models;    ///< Number of models.
+	uint32 nodes;     ///< Number of nodes, in all states.
+	uint32 faces;     ///< Number of faces, in all detail levels.
+	uint32 vertices;  ///< Number of face vertices, in all detail levels.
+	uint32 texCoords; ///< Number of texture coordinates, in all detail levels.
+
+	uint32 geometrySize; ///< Bytes of vertex, face and skin data.
+	uint32 listSize;     ///< Bytes of vertex data compiled into OpenGL display lists.
+
+	ModelMemory(const Common::UString &n = "");
+
+	/** Return the number of bytes held, in total. */
+	uint32 getSize() const;
+
+	/** Add the counts of another model, or group of models. */
+	void add(const ModelMemory &memory);
+
+	/** Sort larger first. */
+	bool operator<(const ModelMemory &right) const;
+};
 
 class Model : public GLContainer, public Renderable {
 public:
@@ -113,6 +141,19 @@ public:
 	const Common::UString &getState() const;
 
 
+	// Animations
+
+	/** Return a list of all animation names. */
+	const std::list<Common::UString> &getAnimations() const;
+
+	/** Play this animation, blending over from the one currently playing. */
+	bool playAnimation(const Common::UString &name, bool loop = true);
+	/** Stop the animation, returning all nodes to their resting places. */
+	void stopAnimation();
+	/** Is an animation currently playing? */
+	bool isAnimating() const;
+
+
 	// Nodes
 
 	/** Does the specified node exist in the current state? */
@@ -123,22 +164,33 @@ public:
 	/** Get the specified node, from the current state. */
 	const ModelNode *getNode(const Common::UString &node) const;
 
+	/** Get the node with this interned name ID, from the current state. */
+	ModelNode *getNode(uint32 nameID);
+
+
+	/** Add the geometry this model holds to the counts. */
+	void getMemoryUsage(ModelMemory &memory) const;
+
 
 	// Renderable
 	void calculateDistance();
 	void render(RenderPass pass);
+	void advanceAnimation(float elapsed);
 
 
 protected:
 	typedef std::list<ModelNode *> NodeList;
-	typedef std::map<Common::UString, ModelNode *, Common::UString::iless> NodeMap;
+	typedef std::vector<ModelNode *> NodeArray;
 
 	/** A model state. */
 	struct State {
 		Common::UString name; ///< The state's name.
 
-		NodeList nodeList; ///< The nodes within the state.
-		NodeMap  nodeMap;  ///< The nodes within the state, indexed by name.
+		NodeArray nodes;     ///< The nodes within the state, in hierarchy order.
+		NodeIndex nodeIndex; ///< The nodes' indices, by name ID.
+
+		/** The index of each node's parent, or NodeIndex::kNoNode. Always lower than the node's. */
+		std::vector<uint32> parents;
 
 		NodeList rootNodes; ///< The nodes in the state without a parent.
 	};
@@ -146,6 +198,9 @@ protected:
 	typedef std::list<State *> StateList;
 	typedef std::map<Common::UString, State *> StateMap;
 
+	typedef std::list<Animation *> AnimationList;
+	typedef std::map<Common::UString, Animation *, Common::UString::iless> AnimationMap;
+
 
 	ModelType _type; ///< The model's type.
 
@@ -159,6 +214,11 @@ protected:
 
 	std::list<Common::UString> _stateNames; ///< All state names.
 
+	AnimationList _animationList; ///< All animations within this model.
+	AnimationMap  _animationMap;  ///< All animations within this model, indexed by name.
+
+	std::list<Common::UString> _animationNames; ///< All animation names.
+
 	float _modelScale[3]; ///< The model's scale.
 
 	float _position[3]; ///< Model's position.
@@ -173,6 +233,22 @@ protected:
 	Common::BoundingBox _absoluteBoundBox;
 
 
+	/** Add an animation to the model, taking over its ownership. */
+	void addAnimation(Animation *animation);
+
+	/** Order the nodes of a state parents first, and index them by name. */
+	void indexState(State &state);
+	/** Reorder and index the nodes of all states, after their children lists changed. */
+	void indexStates();
+	/** Move the nodes below this parent along with the new order of its children.
+	 *
+	 *  The nodes are rearranged in place, so that the node arrays never
+	 *  change their size or storage.
+	 */
+	void reorderChildren(const ModelNode &parent);
+	/** Return the index after the last node below this one in the state's hierarchy order. */
+	static uint32 getSubtreeEnd(const State &state, uint32 index);
+
 	/** Finalize the loading procedure. */
 	void finalize();
 	/** Signal that the nodes changed and the OpenGL list needs to be rebuild. */
@@ -185,17 +261,82 @@ protected:
 
 
 private:
-	bool _needBuild[kRenderPassAll];
+	/** Number of detail levels, including the full detail. */
+	static const uint kLODCount = 3;
+
+	bool _needBuild[kLODCount][kRenderPassAll];
 	bool _drawBound;
 
 	ListID _lists; ///< OpenGL display lists for the model
 
+	uint _lodCount; ///< Number of detail levels this model actually has.
+	uint _lod;      ///< The detail level to render.
+
+	/** The textures of all nodes, whose mip maps are streamed in as we come closer. */
+	std::vector<Texture *> _streamingTextures;
+
+	/** An animation playing on the model's nodes. */
+	struct AnimationChannel {
+		Animation *animation; ///< The animation, or 0 if nothing's playing.
+
+		float time; ///< The current time within the animation, in seconds.
+		bool  loop; ///< Restart the animation when it ends?
+
+		std::vector<ModelNode *> nodes; ///< The node each track moves, or 0.
+
+		std::vector<Animation::Pose> rest;  ///< The resting pose of each node.
+		std::vector<Animation::Pose> poses; ///< The sampled pose of each node.
+
+		AnimationChannel();
+
+		void swap(AnimationChannel &channel);
+	};
+
+	AnimationChannel _animation;     ///< The animation currently playing.
+	AnimationChannel _lastAnimation; ///< The animation we're blending out of.
+
+	float _blendTime;   ///< How far into blending over we are, in seconds.
+	float _blendLength; ///< How long blending over takes, in seconds.
+
+	uint32 _animationStep; ///< Counter to mark nodes touched by each step.
+
+	std::vector<ModelNode *> _skinNodes; ///< The skinned mesh nodes of the current state.
+
 
 	bool buildList(RenderPass pass);
+	/** Render the model directly, without going through the display lists. */
+	void renderImmediate(RenderPass pass, uint lod);
+
+	void bindAnimation(AnimationChannel &channel);   ///< Find the nodes the tracks move.
+	void unbindAnimation(AnimationChannel &channel); ///< Return the nodes to their resting places.
+
+	/** Apply the sampled poses of the playing animations to the nodes. */
+	void applyAnimations();
+
+	/** Find the bones of the current state's skins and their bind poses. */
+	void bindSkins();
+	/** Queue the skins to be deformed by the current pose of their bones. */
+	void deformSkins();
+	/** Return the skins to their bind pose. */
+	void resetSkins();
+	/** Wait for the skins to be deformed. */
+	void waitForSkins();
+
+	void createLODs(); ///< Create simplified versions of all nodes.
+	uint selectLOD(float distance) const;
+
+	/** Return the height in pixels the model is projected to at this distance. */
+	float getScreenSize(float distance) const;
+
+	void collectStreamingTextures(); ///< Let the textures of world objects be streamed in.
+	void requestTextureDetail(float distance);
 
 	void createStateNamesList(); ///< Create the list of all state names.
 	void createBound();          ///< Create the model's bounding box.
 
+	/** Recalculate the transformations of the current state's nodes that moved. */
+	void updateTransforms();
+
 	void createAbsolutePosition();
 
 	void doDrawBound();
@@ -204,8 +345,8 @@ private:
 public:
 	// General loading helpers
 
-	static void readValue(Common::SeekableReadStream &stream, uint32 &value);
-	static void readValue(Common::SeekableReadStream &stream, float  &value);
+	static void readValues(Common::SeekableReadStream &stream, uint32 *values, uint32 count);
+	static void readValues(Common::SeekableReadStream &stream, float  *values, uint32 count);
 
 	static void readArrayDef(Common::SeekableReadStream &stream,
 	                         uint32 &offset, uint32 &count);
@@ -217,6 +358,28 @@ public:
 	friend class ModelNode;
 };
 
+/** Sums up the geometry of models, by model name. */
+class ModelMemoryUsage {
+public:
+	ModelMemoryUsage(const Common::UString &name = "");
+
+	/** Add the geometry of this model. */
+	void add(const Model &model);
+	/** Add the geometry of all models currently shown. */
+	void addVisible();
+
+	/** Return the counts of all models added. */
+	const ModelMemory &getTotal() const;
+	/** List the counts of the models added, by model name, larger first. */
+	void getModels(std::list<ModelMemory> &models) const;
+
+private:
+	typedef std::map<Common::UString, ModelMemory, Common::UString::iless> ModelMap;
+
+	ModelMemory _total;
+	ModelMap    _models;
+};
+
 } // End of namespace Aurora
 
 } // End of namespace Graphics
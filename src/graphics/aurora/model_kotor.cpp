@@ -31,6 +31,7 @@
 #pragma GCC diagnostic ignored "-Wunused-variable"
 #pragma GCC diagnostic ignored "-Wunused-but-set-variable"
 
+#include "common/util.h"
 #include "common/error.h"
 #include "common/maths.h"
 #include "common/stream.h"
@@ -39,6 +40,7 @@
 #include "aurora/resman.h"
 
 #include "graphics/aurora/model_kotor.h"
+#include "graphics/aurora/skinning.h"
 
 static const int kNodeFlagHasHeader    = 0x0001;
 static const int kNodeFlagHasLight     = 0x0002;
@@ -100,13 +102,16 @@ static const uint32 kControllerTypeSizeMid_Y            = 488;
 static const uint32 kControllerTypeSelfIllumColor       = 100;
 static const uint32 kControllerTypeAlpha                = 128;
 
+/** Column count flag: each value is followed by two bezier tangents. */
+static const uint8 kControllerBezier = 0x10;
+
 namespace Graphics {
 
 namespace Aurora {
 
 Model_KotOR::ParserContext::ParserContext(const Common::UString &name,
                                           const Common::UString &t, bool k2) :
-	mdl(0), mdx(0), state(0), texture(t), kotor2(k2) {
+	mdl(0), mdx(0), state(0), animation(0), texture(t), kotor2(k2), mdxStride(0) {
 
 	try {
 
@@ -136,6 +141,32 @@ void Model_KotOR::ParserContext::clear() {
 
 	delete state;
 	state = 0;
+
+	delete animation;
+	animation = 0;
+}
+
+/** Unpack a quaternion compressed into 11, 11 and 10 bits for x, y and z. */
+static void decompressQuaternion(float value, float *q) {
+	const uint32 data = convertIEEEFloat(value);
+
+	q[0] = ( (data        & 0x7FF) / 1023.0) - 1.0;
+	q[1] = (((data >> 11) & 0x7FF) / 1023.0) - 1.0;
+	q[2] = ( (data >> 22)          /  511.0) - 1.0;
+
+	// The quaternion is a unit quaternion, so w follows from the rest
+	const float length = q[0] * q[0] + q[1] * q[1] + q[2] * q[2];
+	if (length < 1.0) {
+		q[3] = sqrtf(1.0 - length);
+		return;
+	}
+
+	const float norm = sqrtf(length);
+
+	q[0] /= norm;
+	q[1] /= norm;
+	q[2] /= norm;
+	q[3]  = 0.0;
 }
 
 
@@ -183,7 +214,8 @@ void Model_KotOR::load(ParserContext &ctx) {
 
 	ctx.mdl->skip(4); // Unknown
 
-	ctx.mdl->skip(12); // TODO: Animation Header Pointer Array
+	uint32 animOffset, animCount;
+	readArrayDef(*ctx.mdl, animOffset, animCount);
 
 	ctx.mdl->skip(4); // Parent model pointer
 
@@ -226,6 +258,144 @@ void Model_KotOR::load(ParserContext &ctx) {
 	rootNode->load(ctx);
 
 	addState(ctx);
+
+	std::vector<uint32> animOffsets;
+	readArray(*ctx.mdl, ctx.offModelData + animOffset, animCount, animOffsets);
+
+	for (std::vector<uint32>::const_iterator offset = animOffsets.begin(); offset != animOffsets.end(); ++offset)
+		readAnim(ctx, ctx.offModelData + *offset);
+}
+
+void Model_KotOR::readAnim(ParserContext &ctx, uint32 offset) {
+	ctx.mdl->seekTo(offset);
+
+	ctx.mdl->skip(8); // Function pointers
+
+	Common::UString name;
+	name.readFixedASCII(*ctx.mdl, 32);
+
+	uint32 nodeHeadPointer = ctx.mdl->readUint32LE();
+	uint32 nodeCount       = ctx.mdl->readUint32LE();
+
+	ctx.mdl->skip(24 + 4); // Unknown + Reference count
+
+	uint8 type = ctx.mdl->readByte();
+
+	ctx.mdl->skip(3); // Padding
+
+	float animLength = ctx.mdl->readIEEEFloatLE();
+	float transTime  = ctx.mdl->readIEEEFloatLE();
+
+	// TODO: Animation root and events
+
+	ctx.animation = new Animation(name, animLength, transTime);
+
+	readAnimNode(ctx, ctx.offModelData + nodeHeadPointer);
+
+	addAnimation(ctx.animation);
+	ctx.animation = 0;
+}
+
+void Model_KotOR::readAnimNode(ParserContext &ctx, uint32 offset) {
+	/* The animation's nodes only exist to carry controllers for the model's
+	 * nodes of the same name, so we don't need to create any for them. */
+
+	ctx.mdl->seekTo(offset);
+
+	ctx.mdl->skip(4); // Flags + super node
+
+	uint16 nodeNumber = ctx.mdl->readUint16LE();
+
+	ctx.mdl->skip(6 + 4); // Unknown + parent pointer
+	ctx.mdl->skip(7 * 4); // Position + orientation
+
+	uint32 childrenOffset, childrenCount;
+	readArrayDef(*ctx.mdl, childrenOffset, childrenCount);
+
+	uint32 controllerKeyOffset, controllerKeyCount;
+	readArrayDef(*ctx.mdl, controllerKeyOffset, controllerKeyCount);
+
+	uint32 controllerDataOffset, controllerDataCount;
+	readArrayDef(*ctx.mdl, controllerDataOffset, controllerDataCount);
+
+	std::vector<uint32> children;
+	readArray(*ctx.mdl, ctx.offModelData + childrenOffset, childrenCount, children);
+
+	if (nodeNumber < ctx.names.size()) {
+		std::vector<float> controllerData;
+		readArray(*ctx.mdl, ctx.offModelData + controllerDataOffset,
+		          controllerDataCount, controllerData);
+
+		readAnimControllers(ctx, ctx.names[nodeNumber], ctx.offModelData + controllerKeyOffset,
+		                    controllerKeyCount, controllerData);
+	}
+
+	for (std::vector<uint32>::const_iterator child = children.begin(); child != children.end(); ++child)
+		readAnimNode(ctx, ctx.offModelData + *child);
+}
+
+void Model_KotOR::readAnimControllers(ParserContext &ctx, const Common::UString &node,
+		uint32 offset, uint32 count, std::vector<float> &data) {
+
+	if (count == 0)
+		return;
+
+	/* Each controller key is 6 words: type (uint32), row count, time index,
+	 * data index (uint16 each), column count (uint8) and 1 byte padding. */
+	static const uint32 kKeySize = 6;
+
+	std::vector<uint16> keys(kKeySize * count);
+
+	ctx.mdl->seekTo(offset);
+	ctx.mdl->readUint16LE(&keys[0], keys.size());
+
+	for (uint32 i = 0; i < count; i++) {
+		const uint16 *key = &keys[kKeySize * i];
+
+		uint32 type        = key[0] | (((uint32) key[1]) << 16);
+		uint16 rowCount    = key[2];
+		uint16 timeIndex   = key[3];
+		uint16 dataIndex   = key[4];
+		uint8  columnCount = key[5] & 0xFF;
+
+		if ((rowCount == 0) || (rowCount == 0xFFFF))
+			continue;
+
+		// We only interpolate linearly, so we skip over the bezier tangents
+		const uint32 columns = columnCount & ~kControllerBezier;
+		const uint32 stride  = (columnCount & kControllerBezier) ? (3 * columns) : columns;
+
+		if ((((uint32) timeIndex + rowCount) > data.size()) ||
+		    (((uint32) dataIndex + (uint32) rowCount * stride) > data.size()))
+			throw Common::Exception("Controller keys out of range");
+
+		const float *times  = &data[timeIndex];
+		const float *values = &data[dataIndex];
+
+		if        (type == kControllerTypePosition) {
+			if (columns != 3)
+				throw Common::Exception("Position controller with %d values", columnCount);
+
+			ctx.animation->addPositionKeys(node, rowCount, times, values, stride);
+
+		} else if (type == kControllerTypeOrientation) {
+			if (columns == 4) {
+				ctx.animation->addOrientationKeys(node, rowCount, times, values, stride);
+				continue;
+			}
+
+			if (columns != 2)
+				throw Common::Exception("Orientation controller with %d values", columnCount);
+
+			// Compressed quaternions, packed into one value per key
+			std::vector<float> orientations(4 * rowCount);
+			for (uint32 j = 0; j < rowCount; j++)
+				decompressQuaternion(values[j * stride], &orientations[4 * j]);
+
+			ctx.animation->addOrientationKeys(node, rowCount, times, &orientations[0], 4);
+		}
+
+	}
 }
 
 void Model_KotOR::readStrings(Common::SeekableReadStream &mdl,
@@ -258,13 +428,14 @@ void Model_KotOR::addState(ParserContext &ctx) {
 	for (std::list<ModelNode_KotOR *>::iterator n = ctx.nodes.begin();
 	     n != ctx.nodes.end(); ++n) {
 
-		ctx.state->nodeList.push_back(*n);
-		ctx.state->nodeMap.insert(std::make_pair((*n)->getName(), *n));
+		ctx.state->nodes.push_back(*n);
 
 		if (!(*n)->getParent())
 			ctx.state->rootNodes.push_back(*n);
 	}
 
+	indexState(*ctx.state);
+
 	_stateList.push_back(ctx.state);
 	_stateMap.insert(std::make_pair(ctx.state->name, ctx.state));
 
@@ -291,6 +462,8 @@ void ModelNode_KotOR::load(Model_KotOR::ParserContext &ctx) {
 	if (nodeNumber < ctx.names.size())
 		_name = ctx.names[nodeNumber];
 
+	_nodeNumber = nodeNumber;
+
 	ctx.mdl->skip(6 + 4); // Unknown + parent pointer
 
 	_position   [0] = ctx.mdl->readIEEEFloatLE();
@@ -343,8 +516,7 @@ void ModelNode_KotOR::load(Model_KotOR::ParserContext &ctx) {
 	}
 
 	if (flags & kNodeFlagHasSkin) {
-		// TODO: Skin
-		ctx.mdl->skip(0x64);
+		readSkin(ctx);
 	}
 
 	if (flags & kNodeFlagHasAnim) {
@@ -401,13 +573,22 @@ void ModelNode_KotOR::readNodeControllers(Model_KotOR::ParserContext &ctx,
 			_position[2] = data[dataIndex + 2];
 
 		} else if (type == kControllerTypeOrientation) {
-			if (columnCount != 4)
+			float q[4];
+
+			if        (columnCount == 4) {
+				q[0] = data[dataIndex + 0];
+				q[1] = data[dataIndex + 1];
+				q[2] = data[dataIndex + 2];
+				q[3] = data[dataIndex + 3];
+			} else if (columnCount == 2) {
+				decompressQuaternion(data[dataIndex], q);
+			} else
 				throw Common::Exception("Orientation controller with %d values", columnCount);
 
-			_orientation[0] = data[dataIndex + 0];
-			_orientation[1] = data[dataIndex + 1];
-			_orientation[2] = data[dataIndex + 2];
-			_orientation[3] = data[dataIndex + 3];
+			_orientation[0] = q[0];
+			_orientation[1] = q[1];
+			_orientation[2] = q[2];
+			_orientation[3] = Common::rad2deg(acos(CLIP(q[3], -1.0f, 1.0f)) * 2.0);
 		}
 
 	}
@@ -416,6 +597,10 @@ void ModelNode_KotOR::readNodeControllers(Model_KotOR::ParserContext &ctx,
 }
 
 void ModelNode_KotOR::readMesh(Model_KotOR::ParserContext &ctx) {
+	ctx.mdxData.clear();
+	ctx.mdxStride = 0;
+	ctx.faceVertices.clear();
+
 	uint32 P = ctx.mdl->pos();
 
 	ctx.mdl->skip(8); // Function pointers
@@ -526,41 +711,38 @@ void ModelNode_KotOR::readMesh(Model_KotOR::ParserContext &ctx) {
 
 	// Read vertex coordinates
 
-	std::vector<float> vX, vY, vZ;
+	/* The MDX holds one structure of mdxStructSize bytes per vertex, which
+	 * only contains floats. We read them all in one go and pick out the
+	 * vertex and texture coordinates. */
+	if ((mdxStructSize % 4) != 0)
+		throw Common::Exception("Invalid MDX struct size %d", mdxStructSize);
 
-	vX.resize(vertexCount);
-	vY.resize(vertexCount);
-	vZ.resize(vertexCount);
+	const uint32 mdxStride = mdxStructSize / 4;
+	if (mdxStride < 3)
+		throw Common::Exception("Invalid MDX struct size %d", mdxStructSize);
 
-	std::vector< std::vector<float> > tX, tY;
+	uint32 uvOffset[2];
+	for (uint16 t = 0; t < textureCount; t++) {
+		uvOffset[t] = 0xFFFFFFFF;
+		if (offUV[t] == 0xFFFFFFFF)
+			continue;
 
-	tX.resize(textureCount);
-	tY.resize(textureCount);
+		if (((offUV[t] % 4) != 0) || ((offUV[t] / 4 + 2) > mdxStride))
+			throw Common::Exception("Invalid MDX texture coordinates offset %d", offUV[t]);
 
-	for (uint16 t = 0; t < textureCount; t++) {
-		tX[t].resize(vertexCount);
-		tY[t].resize(vertexCount);
+		uvOffset[t] = offUV[t] / 4;
 	}
 
-	for (int i = 0; i < vertexCount; i++) {
-		ctx.mdx->seekTo(offNodeData + i * mdxStructSize);
+	// Make sure the MDX actually holds all these structures before allocating them
+	const uint32 mdxSize = ctx.mdx->size();
+	if ((offNodeData > mdxSize) || (vertexCount > ((mdxSize - offNodeData) / mdxStructSize)))
+		throw Common::Exception("MDX vertex data out of range (%u vertices of %u bytes at %u, MDX size %u)",
+		                        vertexCount, mdxStructSize, offNodeData, mdxSize);
 
-		vX[i] = ctx.mdx->readIEEEFloatLE();
-		vY[i] = ctx.mdx->readIEEEFloatLE();
-		vZ[i] = ctx.mdx->readIEEEFloatLE();
+	std::vector<float> mdxData(mdxStride * vertexCount, 0.0);
 
-		for (uint16 t = 0; t < textureCount; t++) {
-			if (offUV[t] != 0xFFFFFFFF) {
-				ctx.mdx->seekTo(offNodeData + i * mdxStructSize + offUV[t]);
-
-				tX[t][i] = ctx.mdx->readIEEEFloatLE();
-				tY[t][i] = ctx.mdx->readIEEEFloatLE();
-			} else {
-				tX[t][i] = 0.0;
-				tY[t][i] = 0.0;
-			}
-		}
-	}
+	ctx.mdx->seekTo(offNodeData);
+	ctx.mdx->readIEEEFloatLE(&mdxData[0], mdxData.size());
 
 
 	// Read faces
@@ -573,49 +755,115 @@ void ModelNode_KotOR::readMesh(Model_KotOR::ParserContext &ctx) {
 	ctx.mdl->seekTo(ctx.offModelData + offOffVerts);
 	uint32 offVerts = ctx.mdl->readUint32LE();
 
-	ctx.mdl->seekTo(ctx.offModelData + offVerts);
+	std::vector<uint16> indices(3 * facesCount);
 
+	ctx.mdl->seekTo(ctx.offModelData + offVerts);
+	ctx.mdl->readUint16LE(&indices[0], indices.size());
 
 	for (uint32 i = 0; i < facesCount; i++) {
-		// Vertex indices
-		const uint16 v1 = ctx.mdl->readUint16LE();
-		const uint16 v2 = ctx.mdl->readUint16LE();
-		const uint16 v3 = ctx.mdl->readUint16LE();
-
-		// Vertex coordinates
-		_vX[3 * i + 0] = v1 < vX.size() ? vX[v1] : 0.0;
-		_vY[3 * i + 0] = v1 < vY.size() ? vY[v1] : 0.0;
-		_vZ[3 * i + 0] = v1 < vZ.size() ? vZ[v1] : 0.0;
-		_boundBox.add(_vX[3 * i + 0], _vY[3 * i + 0], _vZ[3 * i + 0]);
-
-		_vX[3 * i + 1] = v2 < vX.size() ? vX[v2] : 0.0;
-		_vY[3 * i + 1] = v2 < vY.size() ? vY[v2] : 0.0;
-		_vZ[3 * i + 1] = v2 < vZ.size() ? vZ[v2] : 0.0;
-		_boundBox.add(_vX[3 * i + 1], _vY[3 * i + 1], _vZ[3 * i + 1]);
-
-		_vX[3 * i + 2] = v3 < vX.size() ? vX[v3] : 0.0;
-		_vY[3 * i + 2] = v3 < vY.size() ? vY[v3] : 0.0;
-		_vZ[3 * i + 2] = v3 < vZ.size() ? vZ[v3] : 0.0;
-		_boundBox.add(_vX[3 * i + 2], _vY[3 * i + 2], _vZ[3 * i + 2]);
-
-		// Texture coordinates
-		for (uint16 t = 0 ; t < textureCount; t++) {
-			_tX[3 * textureCount * i + 3 * t + 0] = v1 < tX[t].size() ? tX[t][v1] : 0.0;
-			_tY[3 * textureCount * i + 3 * t + 0] = v1 < tY[t].size() ? tY[t][v1] : 0.0;
-
-			_tX[3 * textureCount * i + 3 * t + 1] = v2 < tX[t].size() ? tX[t][v2] : 0.0;
-			_tY[3 * textureCount * i + 3 * t + 1] = v2 < tY[t].size() ? tY[t][v2] : 0.0;
-
-			_tX[3 * textureCount * i + 3 * t + 2] = v3 < tX[t].size() ? tX[t][v3] : 0.0;
-			_tY[3 * textureCount * i + 3 * t + 2] = v3 < tY[t].size() ? tY[t][v3] : 0.0;
+		for (uint32 j = 0; j < 3; j++) {
+			const uint32 n = 3 * i + j;
+			const uint16 v = indices[n];
+
+			const float *vertex = (v < vertexCount) ? &mdxData[mdxStride * v] : 0;
+
+			// Vertex coordinates
+			_vX[n] = vertex ? vertex[0] : 0.0;
+			_vY[n] = vertex ? vertex[1] : 0.0;
+			_vZ[n] = vertex ? vertex[2] : 0.0;
+			_boundBox.add(_vX[n], _vY[n], _vZ[n]);
+
+			// Texture coordinates
+			for (uint16 t = 0 ; t < textureCount; t++) {
+				const bool hasCoord = vertex && (uvOffset[t] != 0xFFFFFFFF);
+
+				_tX[3 * textureCount * i + 3 * t + j] = hasCoord ? vertex[uvOffset[t] + 0] : 0.0;
+				_tY[3 * textureCount * i + 3 * t + j] = hasCoord ? vertex[uvOffset[t] + 1] : 0.0;
+			}
 		}
 	}
 
 	createCenter();
 
+	// Keep the MDX data around, in case the mesh is a skin
+	ctx.mdxData.swap(mdxData);
+	ctx.mdxStride = mdxStride;
+	ctx.faceVertices.swap(indices);
+
 	ctx.mdl->seekTo(endPos);
 }
 
+void ModelNode_KotOR::readSkin(Model_KotOR::ParserContext &ctx) {
+	ctx.mdl->skip(12); // Weights array, only filled at run time
+
+	uint32 offWeights     = ctx.mdl->readUint32LE();
+	uint32 offBoneIndices = ctx.mdl->readUint32LE();
+
+	uint32 boneMapOffset = ctx.mdl->readUint32LE();
+	uint32 boneMapCount  = ctx.mdl->readUint32LE();
+
+	// We calculate the bind pose out of the bones' nodes ourselves
+	ctx.mdl->skip(12); // Bone rotations, inverted
+	ctx.mdl->skip(12); // Bone translations, inverted
+	ctx.mdl->skip(12); // Unknown
+
+	ctx.mdl->skip(16 * 2); // Bone part numbers
+	ctx.mdl->skip(4);      // Unknown
+
+	const uint32 stride = ctx.mdxStride;
+	if ((stride == 0) || ctx.mdxData.empty() || (boneMapCount == 0) ||
+	    (offWeights == 0xFFFFFFFF) || (offBoneIndices == 0xFFFFFFFF))
+		return;
+
+	// Skin::kMaxInfluences weights and bone indices in each MDX vertex structure
+	if (((offWeights     % 4) != 0) || ((offWeights     / 4 + Skin::kMaxInfluences) > stride) ||
+	    ((offBoneIndices % 4) != 0) || ((offBoneIndices / 4 + Skin::kMaxInfluences) > stride))
+		throw Common::Exception("Invalid MDX skin offsets %d, %d", offWeights, offBoneIndices);
+
+	uint32 endPos = ctx.mdl->pos();
+
+	// The bone index of each node in the model, by node number, or -1
+	std::vector<float> boneMap;
+	Model::readArray(*ctx.mdl, ctx.offModelData + boneMapOffset, boneMapCount, boneMap);
+
+	ctx.mdl->seekTo(endPos);
+
+	std::vector<uint32> boneNumbers;
+	for (uint32 i = 0; i < boneMapCount; i++) {
+		if ((boneMap[i] < 0.0) || (boneMap[i] >= 0xFFFF))
+			continue;
+
+		const uint32 bone = (uint32) boneMap[i];
+		if (bone >= boneNumbers.size())
+			boneNumbers.resize(bone + 1, 0xFFFFFFFF);
+
+		boneNumbers[bone] = i;
+	}
+
+	const uint32 vertexCount = ctx.mdxData.size() / stride;
+
+	std::vector<float>  vertices(3 * vertexCount);
+	std::vector<float>  weights(Skin::kMaxInfluences * vertexCount);
+	std::vector<uint16> bones  (Skin::kMaxInfluences * vertexCount);
+
+	for (uint32 v = 0; v < vertexCount; v++) {
+		const float *vertex = &ctx.mdxData[stride * v];
+
+		vertices[3 * v + 0] = vertex[0];
+		vertices[3 * v + 1] = vertex[1];
+		vertices[3 * v + 2] = vertex[2];
+
+		for (uint32 i = 0; i < Skin::kMaxInfluences; i++) {
+			const float bone = vertex[offBoneIndices / 4 + i];
+
+			weights[Skin::kMaxInfluences * v + i] = vertex[offWeights / 4 + i];
+			bones  [Skin::kMaxInfluences * v + i] = ((bone < 0.0) || (bone >= 0xFFFF)) ? 0xFFFF : (uint16) bone;
+		}
+	}
+
+	createSkin(vertices, ctx.faceVertices, boneNumbers, bones, weights);
+}
+
 } // End of namespace Aurora
 
 } // End of namespace Graphics
@@ -58,6 +58,9 @@ private:
 
 		State *state;
 
+		/** The animation we're currently reading, if any. */
+		Animation *animation;
+
 		std::list<ModelNode_KotOR *> nodes;
 
 		Common::UString texture;
@@ -69,6 +72,13 @@ private:
 
 		std::vector<Common::UString> names;
 
+		/** The last mesh's MDX vertex structures, for reading its skin. */
+		std::vector<float>  mdxData;
+		/** The number of floats in each of the last mesh's MDX vertex structures. */
+		uint32              mdxStride;
+		/** The vertex at each corner of each face of the last mesh. */
+		std::vector<uint16> faceVertices;
+
 		ParserContext(const Common::UString &name, const Common::UString &t, bool k2);
 		~ParserContext();
 
@@ -81,6 +91,12 @@ private:
 
 	void load(ParserContext &ctx);
 
+	void readAnim(ParserContext &ctx, uint32 offset);
+	/** Walk the nodes of an animation, collecting their controller keys. */
+	void readAnimNode(ParserContext &ctx, uint32 offset);
+	void readAnimControllers(ParserContext &ctx, const Common::UString &node,
+	                         uint32 offset, uint32 count, std::vector<float> &data);
+
 	void readStrings(Common::SeekableReadStream &mdl,
 			const std::vector<uint32> &offsets, uint32 offset,
 			std::vector<Common::UString> &strings);
@@ -99,6 +115,7 @@ private:
 	void readNodeControllers(Model_KotOR::ParserContext &ctx, uint32 offset,
 	                         uint32 count, std::vector<float> &data);
 	void readMesh(Model_KotOR::ParserContext &ctx);
+	void readSkin(Model_KotOR::ParserContext &ctx);
 };
 
 } // End of namespace Aurora
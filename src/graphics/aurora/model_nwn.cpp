@@ -31,6 +31,9 @@
 #pragma GCC diagnostic ignored "-Wunused-variable"
 #pragma GCC diagnostic ignored "-Wunused-but-set-variable"
 
+#include <algorithm>
+#include <map>
+
 #include "common/error.h"
 #include "common/maths.h"
 #include "common/debug.h"
@@ -41,6 +44,8 @@
 #include "aurora/resman.h"
 
 #include "graphics/aurora/model_nwn.h"
+#include "graphics/aurora/modelcache.h"
+#include "graphics/aurora/skinning.h"
 
 using Common::kDebugGraphics;
 
@@ -104,13 +109,51 @@ static const uint16 kControllerTypeSizeMid_Y            = 488;
 static const uint16 kControllerTypeSelfIllumColor       = 100;
 static const uint16 kControllerTypeAlpha                = 128;
 
+/** ID and version of compiled ASCII models, as kept in the model cache. */
+static const uint32 kCompiledID      = MKID_BE('XMDL');
+static const uint32 kCompiledVersion = 2;
+
+static const uint32 kCompiledNoParent = 0xFFFFFFFF;
+
+static const byte kCompiledFlagRender           = 0x01;
+static const byte kCompiledFlagDangly           = 0x02;
+static const byte kCompiledFlagTransparencyHint = 0x04;
+static const byte kCompiledFlagSkin             = 0x08;
+
+/** Longest string and most textures per node we expect in a compiled model. */
+static const uint32 kCompiledMaxString   = 1024;
+static const uint32 kCompiledMaxTextures = 16;
+
 namespace Graphics {
 
 namespace Aurora {
 
+static void writeCompiledString(Common::WriteStream &compiled, const Common::UString &str) {
+	const uint32 length = strlen(str.c_str());
+
+	compiled.writeUint32LE(length);
+	compiled.write(str.c_str(), length);
+}
+
+static Common::UString readCompiledString(Common::SeekableReadStream &compiled) {
+	const uint32 length = compiled.readUint32LE();
+	if ((length > kCompiledMaxString) || (length > (uint32) (compiled.size() - compiled.pos())))
+		throw Common::Exception("Invalid string length %u", length);
+
+	char str[kCompiledMaxString];
+	compiled.read(str, length);
+
+	return Common::UString(str, length);
+}
+
+static void readCompiledFloats(Common::SeekableReadStream &compiled, float *floats, uint32 n) {
+	if (compiled.readIEEEFloatLE(floats, n) != n)
+		throw Common::Exception(Common::kReadError);
+}
+
 Model_NWN::ParserContext::ParserContext(const Common::UString &name,
                                         const Common::UString &t) :
-	mdl(0), state(0), texture(t) {
+	mdl(0), state(0), animation(0), texture(t) {
 
 	mdl = ResMan.getResource(name, ::Aurora::kFileTypeMDL);
 	if (!mdl)
@@ -137,12 +180,16 @@ Model_NWN::ParserContext::~ParserContext() {
 }
 
 void Model_NWN::ParserContext::clear() {
-	for (std::list<ModelNode *>::iterator n = nodes.begin(); n != nodes.end(); ++n)
+	for (std::vector<ModelNode *>::iterator n = nodes.begin(); n != nodes.end(); ++n)
 		delete *n;
 	nodes.clear();
+	nodeIndex.clear();
 
 	delete state;
 	state = 0;
+
+	delete animation;
+	animation = 0;
 }
 
 bool Model_NWN::ParserContext::findNode(const Common::UString &name,
@@ -153,16 +200,12 @@ bool Model_NWN::ParserContext::findNode(const Common::UString &name,
 	if (name.empty() || (name == "NULL"))
 		return true;
 
-	for (std::list<ModelNode *>::const_iterator n = nodes.begin();
-	     n != nodes.end(); ++n) {
+	const uint32 n = nodeIndex.find(NodeNames.find(name));
+	if (n == NodeIndex::kNoNode)
+		return false;
 
-		if ((*n)->getName() == name) {
-			node = *n;
-			return true;
-		}
-	}
-
-	return false;
+	node = nodes[n];
+	return true;
 }
 
 
@@ -180,9 +223,13 @@ Model_NWN::Model_NWN(const Common::UString &name, ModelType type,
 
 	ParserContext ctx(name, texture);
 
-	if (ctx.isASCII)
-		loadASCII(ctx);
-	else
+	if (ctx.isASCII) {
+		// Parsing ASCII models is slow, so we compile them once
+		if (!loadCompiled(ctx)) {
+			loadASCII(ctx);
+			compile();
+		}
+	} else
 		loadBinary(ctx);
 
 	finalize();
@@ -307,6 +354,7 @@ void Model_NWN::loadASCII(ParserContext &ctx) {
 
 			ModelNode_NWN_ASCII *newNode = new ModelNode_NWN_ASCII(*this);
 			ctx.nodes.push_back(newNode);
+			ctx.nodeIndex.add(NodeNames.intern(line[2]), ctx.nodes.size() - 1);
 
 			newNode->load(ctx, line[1], line[2]);
 
@@ -326,6 +374,122 @@ void Model_NWN::loadASCII(ParserContext &ctx) {
 		readAnimASCII(ctx);
 	}
 }
+bool Model_NWN::loadCompiled(ParserContext &ctx) {
+	if (!ModelCacheMan.isEnabled())
+		return false;
+
+	Common::SeekableReadStream *compiled = ModelCacheMan.get(_fileName, ::Aurora::kFileTypeMDL);
+	if (!compiled)
+		return false;
+
+	try {
+		readCompiled(ctx, *compiled);
+	} catch (Common::Exception &e) {
+		delete compiled;
+
+		e.add("Failed reading compiled model \"%s\"", _fileName.c_str());
+		Common::printException(e, "WARNING: ");
+
+		// Throw away what we've read so far, and parse the model anew
+		ctx.clear();
+		_name.clear();
+
+		ModelCacheMan.remove(_fileName, ::Aurora::kFileTypeMDL);
+		return false;
+	}
+
+	delete compiled;
+	return true;
+}
+
+void Model_NWN::readCompiled(ParserContext &ctx, Common::SeekableReadStream &compiled) {
+	const uint32 id      = compiled.readUint32BE();
+	const uint32 version = compiled.readUint32LE();
+
+	if ((id != kCompiledID) || (version != kCompiledVersion))
+		throw Common::Exception("Not a compiled model of version %u", kCompiledVersion);
+
+	_name = readCompiledString(compiled);
+
+	// Like loadASCII(), we only have the one state with the model geometry
+
+	newState(ctx);
+
+	ctx.state->name = readCompiledString(compiled);
+
+	const uint32 nodeCount = compiled.readUint32LE();
+	if (nodeCount > (uint32) (compiled.size() - compiled.pos()))
+		throw Common::Exception("Invalid node count %u", nodeCount);
+
+	std::vector<ModelNode *> nodes;
+	nodes.reserve(nodeCount);
+
+	for (uint32 i = 0; i < nodeCount; i++) {
+		// Parents always come before their children
+		const uint32 parent = compiled.readUint32LE();
+		if ((parent != kCompiledNoParent) && (parent >= i))
+			throw Common::Exception("Invalid parent node %u of node %u", parent, i);
+
+		ModelNode_NWN_ASCII *node = new ModelNode_NWN_ASCII(*this);
+		ctx.nodes.push_back(node);
+		nodes.push_back(node);
+
+		if (parent != kCompiledNoParent)
+			node->setParent(nodes[parent]);
+
+		node->readCompiled(ctx, compiled);
+	}
+
+	if (compiled.err())
+		throw Common::Exception(Common::kReadError);
+
+	addState(ctx);
+}
+
+void Model_NWN::compile() const {
+	if (!ModelCacheMan.isEnabled())
+		return;
+
+	Common::MemoryWriteStreamDynamic compiled(true);
+
+	writeCompiled(compiled);
+
+	ModelCacheMan.add(_fileName, ::Aurora::kFileTypeMDL, compiled.getData(), compiled.size());
+}
+
+void Model_NWN::writeCompiled(Common::WriteStream &compiled) const {
+	compiled.writeUint32BE(kCompiledID);
+	compiled.writeUint32LE(kCompiledVersion);
+
+	writeCompiledString(compiled, _name);
+
+	const State *state = _stateList.empty() ? 0 : _stateList.front();
+	if (!state) {
+		writeCompiledString(compiled, "");
+		compiled.writeUint32LE(0);
+		return;
+	}
+
+	writeCompiledString(compiled, state->name);
+	compiled.writeUint32LE(state->nodes.size());
+
+	std::map<const ModelNode *, uint32> indices;
+
+	// The state's nodes are already ordered parents first
+	for (NodeArray::const_iterator n = state->nodes.begin(); n != state->nodes.end(); ++n) {
+		const ModelNode *parent = (*n)->getParent();
+
+		std::map<const ModelNode *, uint32>::const_iterator p = indices.find(parent);
+		compiled.writeUint32LE((p != indices.end()) ? p->second : kCompiledNoParent);
+
+		const uint32 index = indices.size();
+		indices.insert(std::make_pair(*n, index));
+
+		// An ASCII model only ever has ASCII nodes
+		static_cast<const ModelNode_NWN_ASCII *>(*n)->writeCompiled(compiled);
+	}
+}
+
 void Model_NWN::newState(ParserContext &ctx) {
 	ctx.clear();
 
@@ -370,16 +534,17 @@ void Model_NWN::addState(ParserContext &ctx) {
 		return;
 	}
 
-	for (std::list<ModelNode *>::iterator n = ctx.nodes.begin();
+	for (std::vector<ModelNode *>::iterator n = ctx.nodes.begin();
 	     n != ctx.nodes.end(); ++n) {
 
-		ctx.state->nodeList.push_back(*n);
-		ctx.state->nodeMap.insert(std::make_pair((*n)->getName(), *n));
+		ctx.state->nodes.push_back(*n);
 
 		if (!(*n)->getParent())
 			ctx.state->rootNodes.push_back(*n);
 	}
 
+	indexState(*ctx.state);
+
 	_stateList.push_back(ctx.state);
 	_stateMap.insert(std::make_pair(ctx.state->name, ctx.state));
 
@@ -388,7 +553,9 @@ void Model_NWN::addState(ParserContext &ctx) {
 
 	ctx.state = 0;
 
+	// The node indices only refer into this state's nodes
 	ctx.nodes.clear();
+	ctx.nodeIndex.clear();
 }
 
 void Model_NWN::readAnimBinary(ParserContext &ctx, uint32 offset) {
@@ -425,11 +592,17 @@ void Model_NWN::readAnimBinary(ParserContext &ctx, uint32 offset) {
 		eventName.readFixedASCII(*ctx.mdl, 32);
 	}
 
+	// The nodes add their controller keys to this animation
+	ctx.animation = new Animation(ctx.state->name, animLength, transTime);
+
 	ModelNode_NWN_Binary *rootNode = new ModelNode_NWN_Binary(*this);
 	ctx.nodes.push_back(rootNode);
 
 	ctx.mdl->seek(ctx.offModelData + nodeHeadPointer);
 	rootNode->load(ctx);
+
+	addAnimation(ctx.animation);
+	ctx.animation = 0;
 }
 
 
@@ -449,6 +622,8 @@ void ModelNode_NWN_Binary::load(Model_NWN::ParserContext &ctx) {
 
 	_name.readFixedASCII(*ctx.mdl, 32);
 
+	_nodeNumber = partNumber;
+
 	debugC(5, kDebugGraphics, "Node \"%s\" in state \"%s\"", _name.c_str(),
 	       ctx.state->name.c_str());
 
@@ -495,8 +670,7 @@ void ModelNode_NWN_Binary::load(Model_NWN::ParserContext &ctx) {
 	}
 
 	if (flags & kNodeFlagHasSkin) {
-		// TODO: Skin
-		ctx.mdl->skip(0x64);
+		readSkin(ctx);
 	}
 
 	if (flags & kNodeFlagHasAnim) {
@@ -553,6 +727,9 @@ void ModelNode_NWN_Binary::load(Model_NWN::ParserContext &ctx) {
 }
 
 void ModelNode_NWN_Binary::readMesh(Model_NWN::ParserContext &ctx) {
+	ctx.vertices.clear();
+	ctx.faceVertices.clear();
+
 	ctx.mdl->skip(8); // Function pointers
 
 	uint32 facesOffset, facesCount;
@@ -660,36 +837,26 @@ void ModelNode_NWN_Binary::readMesh(Model_NWN::ParserContext &ctx) {
 	uint32 endPos = ctx.mdl->pos();
 
 	// Read vertex coordinates
-	std::vector<float> vX, vY, vZ;
+	std::vector<float> vertices;
 	if (vertexOffset != 0xFFFFFFFF) {
 		ctx.mdl->seekTo(ctx.offRawData + vertexOffset);
 
-		vX.resize(vertexCount);
-		vY.resize(vertexCount);
-		vZ.resize(vertexCount);
-
-		for (uint32 i = 0; i < vertexCount; i++) {
-			vX[i] = ctx.mdl->readIEEEFloatLE();
-			vY[i] = ctx.mdl->readIEEEFloatLE();
-			vZ[i] = ctx.mdl->readIEEEFloatLE();
-		}
+		vertices.resize(3 * vertexCount);
+		if (!vertices.empty())
+			ctx.mdl->readIEEEFloatLE(&vertices[0], vertices.size());
 	}
 
+	const uint32 vCount = vertices.size() / 3;
+
 	// Read texture coordinates
-	std::vector< std::vector<float> > tX, tY;
-	tX.resize(textureCount);
-	tY.resize(textureCount);
+	std::vector< std::vector<float> > tVertices;
+	tVertices.resize(textureCount);
 	for (uint16 t = 0; t < textureCount; t++) {
-		tX[t].resize(vertexCount);
-		tY[t].resize(vertexCount);
+		tVertices[t].resize(2 * vertexCount, 0.0);
 
-		bool hasTexture = textureVertexOffset[t] != 0xFFFFFFFF;
-		if (hasTexture)
+		if ((textureVertexOffset[t] != 0xFFFFFFFF) && !tVertices[t].empty()) {
 			ctx.mdl->seekTo(ctx.offRawData + textureVertexOffset[t]);
-
-		for (uint32 i = 0; i < vertexCount; i++) {
-			tX[t][i] = hasTexture ? ctx.mdl->readIEEEFloatLE() : 0.0;
-			tY[t][i] = hasTexture ? ctx.mdl->readIEEEFloatLE() : 0.0;
+			ctx.mdl->readIEEEFloatLE(&tVertices[t][0], tVertices[t].size());
 		}
 	}
 
@@ -700,51 +867,105 @@ void ModelNode_NWN_Binary::readMesh(Model_NWN::ParserContext &ctx) {
 		return;
 	}
 
+	/* Each face is 16 words: normal (3 floats), distance (float), ID (uint32),
+	 * 3 adjacent face numbers and the 3 vertex indices (uint16 each). */
+	static const uint32 kFaceSize          = 16;
+	static const uint32 kFaceVertexIndices = 13;
+
+	std::vector<uint16> faces(kFaceSize * facesCount);
+
 	ctx.mdl->seekTo(ctx.offModelData + facesOffset);
-	for (uint32 i = 0; i < facesCount; i++) {
-		ctx.mdl->skip(3 * 4); // Normal
-		ctx.mdl->skip(    4); // Distance
-		ctx.mdl->skip(    4); // ID
-		ctx.mdl->skip(3 * 2); // Adjacent face number
+	ctx.mdl->readUint16LE(&faces[0], faces.size());
 
-		// Vertex indices
-		const uint16 v1 = ctx.mdl->readUint16LE();
-		const uint16 v2 = ctx.mdl->readUint16LE();
-		const uint16 v3 = ctx.mdl->readUint16LE();
+	ctx.faceVertices.resize(3 * facesCount);
 
-		// Vertex coordinates
-		_vX[3 * i + 0] = v1 < vX.size() ? vX[v1] : 0.0;
-		_vY[3 * i + 0] = v1 < vY.size() ? vY[v1] : 0.0;
-		_vZ[3 * i + 0] = v1 < vZ.size() ? vZ[v1] : 0.0;
-		_boundBox.add(_vX[3 * i + 0], _vY[3 * i + 0], _vZ[3 * i + 0]);
+	for (uint32 i = 0; i < facesCount; i++) {
+		const uint16 *v = &faces[kFaceSize * i + kFaceVertexIndices];
 
-		_vX[3 * i + 1] = v2 < vX.size() ? vX[v2] : 0.0;
-		_vY[3 * i + 1] = v2 < vY.size() ? vY[v2] : 0.0;
-		_vZ[3 * i + 1] = v2 < vZ.size() ? vZ[v2] : 0.0;
-		_boundBox.add(_vX[3 * i + 1], _vY[3 * i + 1], _vZ[3 * i + 1]);
+		for (uint32 j = 0; j < 3; j++) {
+			const uint32 n = 3 * i + j;
 
-		_vX[3 * i + 2] = v3 < vX.size() ? vX[v3] : 0.0;
-		_vY[3 * i + 2] = v3 < vY.size() ? vY[v3] : 0.0;
-		_vZ[3 * i + 2] = v3 < vZ.size() ? vZ[v3] : 0.0;
-		_boundBox.add(_vX[3 * i + 2], _vY[3 * i + 2], _vZ[3 * i + 2]);
+			ctx.faceVertices[n] = v[j];
 
-		// Texture coordinates
-		for (uint32 t = 0; t < textureCount; t++) {
-			_tX[3 * textureCount * i + 3 * t + 0] = v1 < tX[t].size() ? tX[t][v1] : 0.0;
-			_tY[3 * textureCount * i + 3 * t + 0] = v1 < tY[t].size() ? tY[t][v1] : 0.0;
+			// Vertex coordinates
+			if (v[j] < vCount) {
+				_vX[n] = vertices[3 * v[j] + 0];
+				_vY[n] = vertices[3 * v[j] + 1];
+				_vZ[n] = vertices[3 * v[j] + 2];
+			} else
+				_vX[n] = _vY[n] = _vZ[n] = 0.0;
 
-			_tX[3 * textureCount * i + 3 * t + 1] = v2 < tX[t].size() ? tX[t][v2] : 0.0;
-			_tY[3 * textureCount * i + 3 * t + 1] = v2 < tY[t].size() ? tY[t][v2] : 0.0;
+			_boundBox.add(_vX[n], _vY[n], _vZ[n]);
 
-			_tX[3 * textureCount * i + 3 * t + 2] = v3 < tX[t].size() ? tX[t][v3] : 0.0;
-			_tY[3 * textureCount * i + 3 * t + 2] = v3 < tY[t].size() ? tY[t][v3] : 0.0;
-		}
+			// Texture coordinates
+			for (uint32 t = 0; t < textureCount; t++) {
+				const bool hasCoord = v[j] < vertexCount;
 
+				_tX[3 * textureCount * i + 3 * t + j] = hasCoord ? tVertices[t][2 * v[j] + 0] : 0.0;
+				_tY[3 * textureCount * i + 3 * t + j] = hasCoord ? tVertices[t][2 * v[j] + 1] : 0.0;
+			}
+		}
 	}
 
 	createCenter();
 
+	// Keep the vertices around, in case the mesh is a skin
+	ctx.vertices.swap(vertices);
+
+	ctx.mdl->seekTo(endPos);
+}
+
+void ModelNode_NWN_Binary::readSkin(Model_NWN::ParserContext &ctx) {
+	ctx.mdl->skip(12); // Weights array, only filled at run time
+
+	uint32 weightsOffset  = ctx.mdl->readUint32LE();
+	uint32 boneRefsOffset = ctx.mdl->readUint32LE();
+
+	uint32 boneMapOffset = ctx.mdl->readUint32LE();
+	uint32 boneMapCount  = ctx.mdl->readUint32LE();
+
+	// We calculate the bind pose out of the bones' nodes ourselves
+	ctx.mdl->skip(12); // Bone rotations, inverted
+	ctx.mdl->skip(12); // Bone translations, inverted
+	ctx.mdl->skip(12); // Bone constant indices
+
+	ctx.mdl->skip(17 * 2 + 2); // Bone part numbers + Padding
+
+	const uint32 vertexCount = ctx.vertices.size() / 3;
+	if ((vertexCount == 0) || (boneMapCount == 0) ||
+	    (weightsOffset == 0xFFFFFFFF) || (boneRefsOffset == 0xFFFFFFFF))
+		return;
+
+	uint32 endPos = ctx.mdl->pos();
+
+	// Skin::kMaxInfluences bone weights and bone indices per vertex
+	std::vector<float> weights(Skin::kMaxInfluences * vertexCount);
+	ctx.mdl->seekTo(ctx.offRawData + weightsOffset);
+	ctx.mdl->readIEEEFloatLE(&weights[0], weights.size());
+
+	std::vector<uint16> bones(Skin::kMaxInfluences * vertexCount);
+	ctx.mdl->seekTo(ctx.offRawData + boneRefsOffset);
+	ctx.mdl->readUint16LE(&bones[0], bones.size());
+
+	// The bone index of each node in the model, by part number, or -1
+	std::vector<uint16> boneMap(boneMapCount);
+	ctx.mdl->seekTo(ctx.offModelData + boneMapOffset);
+	ctx.mdl->readUint16LE(&boneMap[0], boneMap.size());
+
 	ctx.mdl->seekTo(endPos);
+
+	std::vector<uint32> boneNumbers;
+	for (uint32 i = 0; i < boneMapCount; i++) {
+		if (boneMap[i] == 0xFFFF)
+			continue;
+
+		if (boneMap[i] >= boneNumbers.size())
+			boneNumbers.resize(boneMap[i] + 1, 0xFFFFFFFF);
+
+		boneNumbers[boneMap[i]] = i;
+	}
+
+	createSkin(ctx.vertices, ctx.faceVertices, boneNumbers, bones, weights);
 }
 
 void ModelNode_NWN_Binary::readAnim(Model_NWN::ParserContext &ctx) {
@@ -769,26 +990,45 @@ void ModelNode_NWN_Binary::readAnim(Model_NWN::ParserContext &ctx) {
 void ModelNode_NWN_Binary::readNodeControllers(Model_NWN::ParserContext &ctx,
 	uint32 offset, uint32 count, std::vector<float> &data) {
 
+	if (count == 0)
+		return;
+
+	/* Each controller key is 6 words: type (uint32), row count, time index,
+	 * data index (uint16 each), column count (uint8) and 1 byte padding. */
+	static const uint32 kKeySize = 6;
+
+	std::vector<uint16> keys(kKeySize * count);
+
 	uint32 pos = ctx.mdl->seekTo(offset);
+	ctx.mdl->readUint16LE(&keys[0], keys.size());
+	ctx.mdl->seekTo(pos);
 
 	// TODO: readNodeControllers: Implement this properly :P
 
 	for (uint32 i = 0; i < count; i++) {
-		uint32 type        = ctx.mdl->readUint32LE();
-		uint16 rowCount    = ctx.mdl->readUint16LE();
-		uint16 timeIndex   = ctx.mdl->readUint16LE();
-		uint16 dataIndex   = ctx.mdl->readUint16LE();
-		uint8  columnCount = ctx.mdl->readByte();
-		ctx.mdl->skip(1);
+		const uint16 *key = &keys[kKeySize * i];
+
+		uint32 type        = key[0] | (((uint32) key[1]) << 16);
+		uint16 rowCount    = key[2];
+		uint16 timeIndex   = key[3];
+		uint16 dataIndex   = key[4];
+		uint8  columnCount = key[5] & 0xFF;
 
 		if (rowCount == 0xFFFF)
 			// TODO: Controller row count = 0xFFFF
 			continue;
 
+		if ((((uint32) timeIndex + rowCount) > data.size()) ||
+		    (((uint32) dataIndex + (uint32) rowCount * columnCount) > data.size()))
+			throw Common::Exception("Controller keys out of range");
+
 		if        (type == kControllerTypePosition) {
 			if (columnCount != 3)
 				throw Common::Exception("Position controller with %d values", columnCount);
 
+			if (ctx.animation && (rowCount > 0))
+				ctx.animation->addPositionKeys(_name, rowCount, &data[timeIndex], &data[dataIndex], 3);
+
 			// Starting position
 			if (data[timeIndex + 0] == 0.0) {
 				_position[0] = data[dataIndex + 0];
@@ -802,6 +1042,9 @@ void ModelNode_NWN_Binary::readNodeControllers(Model_NWN::ParserContext &ctx,
 			if (columnCount != 4)
 				throw Common::Exception("Orientation controller with %d values", columnCount);
 
+			if (ctx.animation && (rowCount > 0))
+				ctx.animation->addOrientationKeys(_name, rowCount, &data[timeIndex], &data[dataIndex], 4);
+
 			// Starting orientation
 			if (data[timeIndex + 0] == 0.0) {
 				_orientation[0] = data[dataIndex + 0];
@@ -824,16 +1067,16 @@ void ModelNode_NWN_Binary::readNodeControllers(Model_NWN::ParserContext &ctx,
 		}
 
 	}
-
-	ctx.mdl->seekTo(pos);
 }
 
 
-ModelNode_NWN_ASCII::Mesh::Mesh() : vCount(0), tCount(0), faceCount(0) {
+ModelNode_NWN_ASCII::Mesh::Mesh() : vCount(0), tCount(0), faceCount(0), weightCount(0) {
 }
 
 
-ModelNode_NWN_ASCII::ModelNode_NWN_ASCII(Model &model) : ModelNode(model) {
+ModelNode_NWN_ASCII::ModelNode_NWN_ASCII(Model &model) : ModelNode(model),
+	_renderFlag(false) {
+
 	_hasTransparencyHint = true;
 	_transparencyHint = false;
 }
@@ -849,6 +1092,9 @@ void ModelNode_NWN_ASCII::load(Model_NWN::ParserContext &ctx,
 
 	_name = name;
 
+	// ASCII nodes have no numbers. Skins refer to their bones by name instead
+	_nodeNumber = NodeNames.intern(_name);
+
 	debugC(5, kDebugGraphics, "Node \"%s\" in state \"%s\"", _name.c_str(),
 	       ctx.state->name.c_str());
 
@@ -912,10 +1158,9 @@ void ModelNode_NWN_ASCII::load(Model_NWN::ParserContext &ctx,
 			line[1].parse(n);
 			readConstraints(ctx, n);
 		} else if (line[0] == "weights") {
-			uint32 n;
+			line[1].parse(mesh.weightCount);
 
-			line[1].parse(n);
-			readWeights(ctx, n);
+			readWeights(ctx, mesh);
 		} else if (line[0] == "bitmap") {
 			mesh.textures.push_back(line[1]);
 		} else if (line[0] == "verts") {
@@ -940,12 +1185,141 @@ void ModelNode_NWN_ASCII::load(Model_NWN::ParserContext &ctx,
 	if (!end)
 		throw Common::Exception("ModelNode_NWN_ASCII::load(): node without endnode");
 
+	// Remember what the model file said, for compiling the model
+	_textureNames = mesh.textures;
+	_renderFlag   = _render;
+
 	if (!mesh.textures.empty() && !ctx.texture.empty())
 		mesh.textures[0] = ctx.texture;
 
 	processMesh(mesh);
 }
 
+void ModelNode_NWN_ASCII::readCompiled(Model_NWN::ParserContext &ctx,
+                                       Common::SeekableReadStream &compiled) {
+
+	_name = readCompiledString(compiled);
+
+	_nodeNumber = NodeNames.intern(_name);
+
+	const byte flags = compiled.readByte();
+
+	_renderFlag       = (flags & kCompiledFlagRender          ) != 0;
+	_dangly           = (flags & kCompiledFlagDangly          ) != 0;
+	_transparencyHint = (flags & kCompiledFlagTransparencyHint) != 0;
+
+	_render = _renderFlag;
+
+	readCompiledFloats(compiled, _position   , 3);
+	readCompiledFloats(compiled, _orientation, 4);
+
+	const uint32 textureCount = compiled.readUint32LE();
+	if (textureCount > kCompiledMaxTextures)
+		throw Common::Exception("Invalid texture count %u", textureCount);
+
+	_textureNames.resize(textureCount);
+	for (uint32 t = 0; t < textureCount; t++)
+		_textureNames[t] = readCompiledString(compiled);
+
+	const uint32 faceCount = compiled.readUint32LE();
+
+	const uint32 floatsPerFace = 3 * 3 + 2 * 3 * textureCount;
+	if (faceCount > ((uint32) (compiled.size() - compiled.pos()) / (floatsPerFace * sizeof(float))))
+		throw Common::Exception("Invalid face count %u", faceCount);
+
+	std::vector<Common::UString> textures = _textureNames;
+	if (!textures.empty() && !ctx.texture.empty())
+		textures[0] = ctx.texture;
+
+	loadTextures(textures);
+	if (!createFaces(faceCount))
+		return;
+
+	readCompiledFloats(compiled, _coords, floatsPerFace * faceCount);
+
+	createBound();
+
+	if (!(flags & kCompiledFlagSkin))
+		return;
+
+	const uint32 boneCount = compiled.readUint32LE();
+	if (boneCount >= 0xFF)
+		throw Common::Exception("Invalid bone count %u", boneCount);
+
+	std::vector<Common::UString> boneNames(boneCount);
+	for (uint32 b = 0; b < boneCount; b++)
+		boneNames[b] = readCompiledString(compiled);
+
+	// Coordinates, bone indices and weights of each vertex
+	const uint32 vertexCount = compiled.readUint32LE();
+	const uint32 vertexSize  = 3 * sizeof(float) + Skin::kMaxInfluences * (sizeof(uint16) + sizeof(float));
+	if ((vertexCount == 0) || (vertexCount > ((uint32) (compiled.size() - compiled.pos()) / vertexSize)))
+		throw Common::Exception("Invalid skin vertex count %u", vertexCount);
+
+	std::vector<float> vertices(3 * vertexCount);
+	readCompiledFloats(compiled, &vertices[0], vertices.size());
+
+	std::vector<uint16> bones(Skin::kMaxInfluences * vertexCount);
+	compiled.readUint16LE(&bones[0], bones.size());
+
+	std::vector<float> weights(Skin::kMaxInfluences * vertexCount);
+	readCompiledFloats(compiled, &weights[0], weights.size());
+
+	std::vector<uint16> faceVertices(3 * _faceCount);
+	compiled.readUint16LE(&faceVertices[0], faceVertices.size());
+
+	if (compiled.err())
+		throw Common::Exception(Common::kReadError);
+
+	createNamedSkin(vertices, faceVertices, boneNames, bones, weights);
+}
+
+void ModelNode_NWN_ASCII::writeCompiled(Common::WriteStream &compiled) const {
+	writeCompiledString(compiled, _name);
+
+	compiled.writeByte((_renderFlag       ? kCompiledFlagRender           : 0) |
+	                   (_dangly           ? kCompiledFlagDangly           : 0) |
+	                   (_transparencyHint ? kCompiledFlagTransparencyHint : 0) |
+	                   (_skin             ? kCompiledFlagSkin             : 0));
+
+	compiled.writeIEEEFloatLE(_position   , 3);
+	compiled.writeIEEEFloatLE(_orientation, 4);
+
+	compiled.writeUint32LE(_textureNames.size());
+	for (std::vector<Common::UString>::const_iterator t = _textureNames.begin(); t != _textureNames.end(); ++t)
+		writeCompiledString(compiled, *t);
+
+	compiled.writeUint32LE(_faceCount);
+
+	if (_coords)
+		compiled.writeIEEEFloatLE(_coords, (3 * 3 + 2 * 3 * _textureNames.size()) * _faceCount);
+
+	if (!_skin)
+		return;
+
+	compiled.writeUint32LE(_skinBones.size());
+	for (std::vector<Common::UString>::const_iterator b = _skinBones.begin(); b != _skinBones.end(); ++b)
+		writeCompiledString(compiled, *b);
+
+	const uint32 vertexCount = _skin->vertexCount;
+	compiled.writeUint32LE(vertexCount);
+
+	for (uint32 v = 0; v < vertexCount; v++) {
+		compiled.writeIEEEFloatLE(_skin->rest[0 * vertexCount + v]);
+		compiled.writeIEEEFloatLE(_skin->rest[1 * vertexCount + v]);
+		compiled.writeIEEEFloatLE(_skin->rest[2 * vertexCount + v]);
+	}
+
+	// Vertices not moved by any bone refer to the identity, one past the last bone
+	for (std::vector<uint8>::const_iterator b = _skin->bones.begin(); b != _skin->bones.end(); ++b)
+		compiled.writeUint16LE((*b < _skinBones.size()) ? *b : 0xFFFF);
+
+	compiled.writeIEEEFloatLE(&_skin->weights[0], _skin->weights.size());
+
+	for (std::vector<uint32>::const_iterator v = _skin->faceVertices.begin(); v != _skin->faceVertices.end(); ++v)
+		compiled.writeUint16LE(*v);
+}
+
 void ModelNode_NWN_ASCII::readConstraints(Model_NWN::ParserContext &ctx, uint32 n) {
 	for (uint32 i = 0; i < n; ) {
 		std::vector<Common::UString> line;
@@ -962,11 +1336,14 @@ void ModelNode_NWN_ASCII::readConstraints(Model_NWN::ParserContext &ctx, uint32
 	}
 }
 
-void ModelNode_NWN_ASCII::readWeights(Model_NWN::ParserContext &ctx, uint32 n) {
-	for (uint32 i = 0; i < n; ) {
+void ModelNode_NWN_ASCII::readWeights(Model_NWN::ParserContext &ctx, Mesh &mesh) {
+	mesh.bones.resize(Skin::kMaxInfluences * mesh.weightCount, 0xFFFF);
+	mesh.weights.resize(Skin::kMaxInfluences * mesh.weightCount, 0.0);
+
+	for (uint32 i = 0; i < mesh.weightCount; ) {
 		std::vector<Common::UString> line;
 
-		int count = ctx.tokenize->getTokens(*ctx.mdl, line, 1);
+		int count = ctx.tokenize->getTokens(*ctx.mdl, line, 2);
 
 		ctx.tokenize->nextChunk(*ctx.mdl);
 
@@ -974,6 +1351,19 @@ void ModelNode_NWN_ASCII::readWeights(Model_NWN::ParserContext &ctx, uint32 n) {
 		if ((count == 0) || line[0].empty() || (*line[0].begin() == '#'))
 			continue;
 
+		// Pairs of bone name and weight
+		for (uint32 j = 0; (j < Skin::kMaxInfluences) && ((2 * j + 1) < (uint32) count); j++) {
+			const uint32 n = Skin::kMaxInfluences * i + j;
+
+			std::vector<Common::UString>::iterator bone =
+				std::find(mesh.boneNames.begin(), mesh.boneNames.end(), line[2 * j]);
+			if (bone == mesh.boneNames.end())
+				bone = mesh.boneNames.insert(mesh.boneNames.end(), line[2 * j]);
+
+			mesh.bones[n] = bone - mesh.boneNames.begin();
+			line[2 * j + 1].parse(mesh.weights[n]);
+		}
+
 		i++;
 	}
 }
@@ -1122,6 +1512,61 @@ void ModelNode_NWN_ASCII::processMesh(Mesh &mesh) {
 	}
 
 	createCenter();
+
+	processSkin(mesh);
+}
+
+void ModelNode_NWN_ASCII::processSkin(Mesh &mesh) {
+	if (mesh.weightCount == 0)
+		return;
+
+	if (mesh.weightCount != mesh.vCount) {
+		warning("ModelNode_NWN_ASCII::processSkin(): %u weights for %u vertices in node \"%s\"",
+		        mesh.weightCount, mesh.vCount, _name.c_str());
+		return;
+	}
+
+	// Skins index their vertices with 16 bits
+	if (mesh.vCount > 0xFFFF) {
+		warning("ModelNode_NWN_ASCII::processSkin(): Too many vertices (%u) in node \"%s\"",
+		        mesh.vCount, _name.c_str());
+		return;
+	}
+
+	std::vector<float> vertices(3 * mesh.vCount);
+	for (uint32 v = 0; v < mesh.vCount; v++) {
+		vertices[3 * v + 0] = mesh.vX[v];
+		vertices[3 * v + 1] = mesh.vY[v];
+		vertices[3 * v + 2] = mesh.vZ[v];
+	}
+
+	// Out-of-range indices make createSkin() refuse the skin
+	std::vector<uint16> faceVertices(3 * _faceCount);
+	for (uint32 i = 0; i < _faceCount; i++) {
+		faceVertices[3 * i + 0] = MIN<uint32>(mesh.vIA[i], 0xFFFF);
+		faceVertices[3 * i + 1] = MIN<uint32>(mesh.vIB[i], 0xFFFF);
+		faceVertices[3 * i + 2] = MIN<uint32>(mesh.vIC[i], 0xFFFF);
+	}
+
+	createNamedSkin(vertices, faceVertices, mesh.boneNames, mesh.bones, mesh.weights);
+}
+
+void ModelNode_NWN_ASCII::createNamedSkin(const std::vector<float> &vertices,
+                                          const std::vector<uint16> &faceVertices,
+                                          const std::vector<Common::UString> &boneNames,
+                                          const std::vector<uint16> &bones,
+                                          const std::vector<float> &weights) {
+
+	// The ASCII nodes' numbers are their interned names
+	std::vector<uint32> boneNumbers(boneNames.size());
+	for (uint32 b = 0; b < boneNames.size(); b++)
+		boneNumbers[b] = NodeNames.intern(boneNames[b]);
+
+	createSkin(vertices, faceVertices, boneNumbers, bones, weights);
+
+	_skinBones.clear();
+	if (_skin)
+		_skinBones = boneNames;
 }
 
 } // End of namespace Aurora
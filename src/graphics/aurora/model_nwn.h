@@ -35,6 +35,7 @@
 
 namespace Common {
 	class SeekableReadStream;
+	class WriteStream;
 	class StreamTokenizer;
 }
 
@@ -58,9 +59,14 @@ private:
 
 		State *state;
 
+		/** The animation we're currently reading, if any. */
+		Animation *animation;
+
 		bool isASCII;
 
-		std::list<ModelNode *> nodes;
+		std::vector<ModelNode *> nodes;
+		/** The indices of the ASCII nodes read so far, by name ID, for findNode(). */
+		NodeIndex nodeIndex;
 
 		Common::UString texture;
 
@@ -70,6 +76,11 @@ private:
 		bool hasPosition;
 		bool hasOrientation;
 
+		/** The last mesh's unique vertex coordinates, for reading its skin. */
+		std::vector<float>  vertices;
+		/** The vertex at each corner of each face of the last mesh. */
+		std::vector<uint16> faceVertices;
+
 		Common::StreamTokenizer *tokenize;
 		std::vector<uint32> anims;
 
@@ -92,6 +103,14 @@ private:
 	void readAnimASCII(ParserContext &ctx);
 	void skipAnimASCII(ParserContext &ctx);
 
+	/** Load the model out of its compiled form in the model cache, if it's there. */
+	bool loadCompiled(ParserContext &ctx);
+	void readCompiled(ParserContext &ctx, Common::SeekableReadStream &compiled);
+
+	/** Compile the ASCII model we just parsed, and add it to the model cache. */
+	void compile() const;
+	void writeCompiled(Common::WriteStream &compiled) const;
+
 	friend class ModelNode_NWN_Binary;
 	friend class ModelNode_NWN_ASCII;
 };
@@ -105,6 +124,7 @@ public:
 
 private:
 	void readMesh(Model_NWN::ParserContext &ctx);
+	void readSkin(Model_NWN::ParserContext &ctx);
 	void readAnim(Model_NWN::ParserContext &ctx);
 
 	void readNodeControllers(Model_NWN::ParserContext &ctx, uint32 offset,
@@ -119,7 +139,20 @@ public:
 	void load(Model_NWN::ParserContext &ctx,
 	          const Common::UString &type, const Common::UString &name);
 
+	/** Read the node out of a compiled model. */
+	void readCompiled(Model_NWN::ParserContext &ctx, Common::SeekableReadStream &compiled);
+	/** Write the node into a compiled model. */
+	void writeCompiled(Common::WriteStream &compiled) const;
+
 private:
+	/** The node's textures, as named in the model file. */
+	std::vector<Common::UString> _textureNames;
+
+	bool _renderFlag; ///< Should the node be rendered, as specified in the model file?
+
+	/** The names of the skin's bones, as named in the model file. */
+	std::vector<Common::UString> _skinBones;
+
 	struct Mesh {
 		uint32 vCount;
 		uint32 tCount;
@@ -135,11 +168,18 @@ private:
 
 		std::vector<uint32> smooth, mat;
 
+		uint32 weightCount;
+
+		std::vector<Common::UString> boneNames; ///< The names of all bones the weights refer to.
+
+		std::vector<uint16> bones;   ///< Skin::kMaxInfluences indices into boneNames per vertex.
+		std::vector<float>  weights; ///< Skin::kMaxInfluences bone weights per vertex.
+
 		Mesh();
 	};
 
 	void readConstraints(Model_NWN::ParserContext &ctx, uint32 n);
-	void readWeights(Model_NWN::ParserContext &ctx, uint32 n);
+	void readWeights(Model_NWN::ParserContext &ctx, Mesh &mesh);
 
 	void readFloats(const std::vector<Common::UString> &strings,
 	                float *floats, uint32 n, uint32 start);
@@ -150,6 +190,13 @@ private:
 	void readFaces(Model_NWN::ParserContext &ctx, Mesh &mesh);
 
 	void processMesh(Mesh &mesh);
+	/** Make the node a skinned mesh, if the mesh has bone weights. */
+	void processSkin(Mesh &mesh);
+
+	/** Make the node a skinned mesh, with bones referred to by name. */
+	void createNamedSkin(const std::vector<float> &vertices, const std::vector<uint16> &faceVertices,
+	                     const std::vector<Common::UString> &boneNames, const std::vector<uint16> &bones,
+	                     const std::vector<float> &weights);
 };
 
 } // End of namespace Aurora
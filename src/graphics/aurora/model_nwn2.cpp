@@ -140,13 +140,14 @@ void Model_NWN2::addState(ParserContext &ctx) {
 	for (std::list<ModelNode_NWN2 *>::iterator n = ctx.nodes.begin();
 	     n != ctx.nodes.end(); ++n) {
 
-		ctx.state->nodeList.push_back(*n);
-		ctx.state->nodeMap.insert(std::make_pair((*n)->getName(), *n));
+		ctx.state->nodes.push_back(*n);
 
 		if (!(*n)->getParent())
 			ctx.state->rootNodes.push_back(*n);
 	}
 
+	indexState(*ctx.state);
+
 	_stateList.push_back(ctx.state);
 	_stateMap.insert(std::make_pair(ctx.state->name, ctx.state));
 
@@ -192,13 +192,14 @@ void Model_Witcher::addState(ParserContext &ctx) {
 	for (std::list<ModelNode_Witcher *>::iterator n = ctx.nodes.begin();
 	     n != ctx.nodes.end(); ++n) {
 
-		ctx.state->nodeList.push_back(*n);
-		ctx.state->nodeMap.insert(std::make_pair((*n)->getName(), *n));
+		ctx.state->nodes.push_back(*n);
 
 		if (!(*n)->getParent())
 			ctx.state->rootNodes.push_back(*n);
 	}
 
+	indexState(*ctx.state);
+
 	_stateList.push_back(ctx.state);
 	_stateMap.insert(std::make_pair(ctx.state->name, ctx.state));
 
@@ -402,85 +403,62 @@ void ModelNode_Witcher::readMesh(Model_Witcher::ParserContext &ctx) {
 	// Read vertex coordinates
 	ctx.mdb->seekTo(ctx.offRawData + verticesOffset);
 
-	std::vector<float> vX, vY, vZ;
-	vX.resize(verticesCount);
-	vY.resize(verticesCount);
-	vZ.resize(verticesCount);
+	std::vector<float> vertices;
+	vertices.resize(3 * verticesCount);
 
-	for (uint32 i = 0; i < verticesCount; i++) {
-		vX[i] = ctx.mdb->readIEEEFloatLE();
-		vY[i] = ctx.mdb->readIEEEFloatLE();
-		vZ[i] = ctx.mdb->readIEEEFloatLE();
-	}
+	if (!vertices.empty())
+		ctx.mdb->readIEEEFloatLE(&vertices[0], vertices.size());
 
 
 	// Read texture coordinates
 
 	ctx.mdb->seekTo(ctx.offRawData + tVerts0Offset);
 
-	std::vector<float> tX, tY;
-	tX.resize(tVerts0Count);
-	tY.resize(tVerts0Count);
+	std::vector<float> tVertices;
+	tVertices.resize(2 * tVerts0Count);
 
-	for (uint32 i = 0; i < tVerts0Count; i++) {
-		tX[i] = ctx.mdb->readIEEEFloatLE();
-		tY[i] = ctx.mdb->readIEEEFloatLE();
-	}
+	if (!tVertices.empty())
+		ctx.mdb->readIEEEFloatLE(&tVertices[0], tVertices.size());
 
 
 	// Read faces
 
-	ctx.mdb->seekTo(ctx.offRawData + facesOffset);
-
-	for (uint32 i = 0; i < facesCount; i++) {
-		ctx.mdb->skip(4 * 4 + 4);
+	/* Each face is a plane (4 floats) and a smoothing group (uint32), followed
+	 * by the 3 vertex indices. Version 133 adds 3 unknown values before the
+	 * indices and 1 after them. */
+	const uint32 faceSize          = (ctx.fileVersion == 133) ? 12 : 8;
+	const uint32 faceVertexIndices = (ctx.fileVersion == 133) ?  8 : 5;
 
-		if (ctx.fileVersion == 133)
-			ctx.mdb->skip(3 * 4);
+	std::vector<uint32> faces(faceSize * facesCount);
 
-		// Vertex indices
-		const uint32 v1 = ctx.mdb->readUint32LE();
-		const uint32 v2 = ctx.mdb->readUint32LE();
-		const uint32 v3 = ctx.mdb->readUint32LE();
-
-		// Vertex coordinates
-		_vX[3 * i + 0] = v1 < vX.size() ? vX[v1] : 0.0;
-		_vY[3 * i + 0] = v1 < vY.size() ? vY[v1] : 0.0;
-		_vZ[3 * i + 0] = v1 < vZ.size() ? vZ[v1] : 0.0;
-		_boundBox.add(_vX[3 * i + 0], _vY[3 * i + 0], _vZ[3 * i + 0]);
-
-		_vX[3 * i + 1] = v2 < vX.size() ? vX[v2] : 0.0;
-		_vY[3 * i + 1] = v2 < vY.size() ? vY[v2] : 0.0;
-		_vZ[3 * i + 1] = v2 < vZ.size() ? vZ[v2] : 0.0;
-		_boundBox.add(_vX[3 * i + 1], _vY[3 * i + 1], _vZ[3 * i + 1]);
-
-		_vX[3 * i + 2] = v3 < vX.size() ? vX[v3] : 0.0;
-		_vY[3 * i + 2] = v3 < vY.size() ? vY[v3] : 0.0;
-		_vZ[3 * i + 2] = v3 < vZ.size() ? vZ[v3] : 0.0;
-		_boundBox.add(_vX[3 * i + 2], _vY[3 * i + 2], _vZ[3 * i + 2]);
+	ctx.mdb->seekTo(ctx.offRawData + facesOffset);
+	ctx.mdb->readUint32LE(&faces[0], faces.size());
 
-		const float tX1 = v1 < tX.size() ? tX[v1] : 0.0;
-		const float tY1 = v1 < tY.size() ? tY[v1] : 0.0;
+	for (uint32 i = 0; i < facesCount; i++) {
+		const uint32 *v = &faces[faceSize * i + faceVertexIndices];
 
-		const float tX2 = v2 < tX.size() ? tX[v2] : 0.0;
-		const float tY2 = v2 < tY.size() ? tY[v2] : 0.0;
+		for (uint32 j = 0; j < 3; j++) {
+			const uint32 n = 3 * i + j;
 
-		const float tX3 = v3 < tX.size() ? tX[v3] : 0.0;
-		const float tY3 = v3 < tY.size() ? tY[v3] : 0.0;
+			// Vertex coordinates
+			if (v[j] < verticesCount) {
+				_vX[n] = vertices[3 * v[j] + 0];
+				_vY[n] = vertices[3 * v[j] + 1];
+				_vZ[n] = vertices[3 * v[j] + 2];
+			} else
+				_vX[n] = _vY[n] = _vZ[n] = 0.0;
 
-		for (uint32 t = 0; t < textureCount; t++) {
-			_tX[3 * textureCount * i + 3 * t + 0] = tX1;
-			_tY[3 * textureCount * i + 3 * t + 0] = tY1;
+			_boundBox.add(_vX[n], _vY[n], _vZ[n]);
 
-			_tX[3 * textureCount * i + 3 * t + 1] = tX2;
-			_tY[3 * textureCount * i + 3 * t + 1] = tY2;
+			// Texture coordinates
+			const float tX = v[j] < tVerts0Count ? tVertices[2 * v[j] + 0] : 0.0;
+			const float tY = v[j] < tVerts0Count ? tVertices[2 * v[j] + 1] : 0.0;
 
-			_tX[3 * textureCount * i + 3 * t + 2] = tX3;
-			_tY[3 * textureCount * i + 3 * t + 2] = tY3;
+			for (uint32 t = 0; t < textureCount; t++) {
+				_tX[3 * textureCount * i + 3 * t + j] = tX;
+				_tY[3 * textureCount * i + 3 * t + j] = tY;
+			}
 		}
-
-		if (ctx.fileVersion == 133)
-			ctx.mdb->skip(4);
 	}
 
 	createCenter();
@@ -544,17 +522,29 @@ void ModelNode_Witcher::readTextures(Model_Witcher::ParserContext &ctx,
 void ModelNode_Witcher::readNodeControllers(Model_Witcher::ParserContext &ctx,
 		uint32 offset, uint32 count, std::vector<float> &data) {
 
+	if (count == 0)
+		return;
+
+	/* Each controller key is 6 words: type (uint32), row count, time index,
+	 * data index (uint16 each), column count (uint8) and 1 byte padding. */
+	static const uint32 kKeySize = 6;
+
+	std::vector<uint16> keys(kKeySize * count);
+
 	uint32 pos = ctx.mdb->seekTo(offset);
+	ctx.mdb->readUint16LE(&keys[0], keys.size());
+	ctx.mdb->seekTo(pos);
 
 	// TODO: readNodeControllers: Implement this properly :P
 
 	for (uint32 i = 0; i < count; i++) {
-		uint32 type        = ctx.mdb->readUint32LE();
-		uint16 rowCount    = ctx.mdb->readUint16LE();
-		uint16 timeIndex   = ctx.mdb->readUint16LE();
-		uint16 dataIndex   = ctx.mdb->readUint16LE();
-		uint8  columnCount = ctx.mdb->readByte();
-		ctx.mdb->skip(1);
+		const uint16 *key = &keys[kKeySize * i];
+
+		uint32 type        = key[0] | (((uint32) key[1]) << 16);
+		uint16 rowCount    = key[2];
+		uint16 timeIndex   = key[3];
+		uint16 dataIndex   = key[4];
+		uint8  columnCount = key[5] & 0xFF;
 
 		if (rowCount == 0xFFFF)
 			// TODO: Controller row count = 0xFFFF
@@ -579,8 +569,6 @@ void ModelNode_Witcher::readNodeControllers(Model_Witcher::ParserContext &ctx,
 		}
 
 	}
-
-	ctx.mdb->seekTo(pos);
 }
 
 } // End of namespace Aurora
@@ -0,0 +1,250 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey and Eclipse engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/aurora/modelcache.cpp
+ *  A cache of compiled models.
+ */
+
+#include <cstdio>
+#include <cstring>
+
+#include "common/util.h"
+#include "common/error.h"
+#include "common/stream.h"
+#include "common/filepath.h"
+#include "common/configman.h"
+
+#include "aurora/resman.h"
+
+#include "graphics/aurora/modelcache.h"
+#include "graphics/aurora/cachefile.h"
+
+/** Default number of megabytes of compiled models held in memory. */
+static const int kModelCacheSize = 32;
+
+DECLARE_SINGLETON(Graphics::Aurora::ModelCache)
+
+namespace Graphics {
+
+namespace Aurora {
+
+ModelCache::ModelCache() : _memorySize(0), _memoryBudget(0), _hits(0), _misses(0) {
+	setMemoryBudget(MAX(ConfigMan.getInt("modelcache", kModelCacheSize), 0) * 1024 * 1024);
+
+	setDirectory(ConfigMan.getString("modelcachedir"));
+}
+
+ModelCache::~ModelCache() {
+	for (EntryMap::iterator e = _entries.begin(); e != _entries.end(); ++e)
+		delete[] e->second.data;
+}
+
+void ModelCache::setDirectory(const Common::UString &directory) {
+	Common::StackLock lock(_mutex);
+
+	_directory.clear();
+	if (directory.empty())
+		return;
+
+	if (!Common::FilePath::createDirectories(directory)) {
+		warning("Can't create model cache directory \"%s\"", directory.c_str());
+		return;
+	}
+
+	_directory = Common::FilePath::normalize(directory);
+}
+
+void ModelCache::setMemoryBudget(uint32 budget) {
+	Common::StackLock lock(_mutex);
+
+	_memoryBudget = budget;
+
+	enforceBudget();
+}
+
+bool ModelCache::isEnabled() const {
+	return (_memoryBudget > 0) || !_directory.empty();
+}
+
+Common::UString ModelCache::getID(const Common::UString &name, ::Aurora::FileType type) {
+	Common::UString id = Common::UString::sprintf("%s.%d", name.c_str(), (int) type);
+	id.tolower();
+
+	return id;
+}
+
+Common::SeekableReadStream *ModelCache::get(const Common::UString &name, ::Aurora::FileType type) {
+	const Common::UString id = getID(name, type);
+	const uint32 serial = ResMan.getResourceSerial(name, type);
+
+	_mutex.lock();
+
+	EntryMap::iterator entry = _entries.find(id);
+	if (entry != _entries.end()) {
+		if (entry->second.serial == serial) {
+			// Hand out a copy, so the entry can go away while the model is still reading
+
+			byte *data = new byte[entry->second.size];
+			std::memcpy(data, entry->second.data, entry->second.size);
+
+			// Move it to the end of the age list
+			_ages.splice(_ages.end(), _ages, entry->second.age);
+
+			_hits++;
+			_mutex.unlock();
+
+			return new Common::MemoryReadStream(data, entry->second.size, true);
+		}
+
+		// The resource changed
+		removeEntry(entry);
+	}
+
+	_mutex.unlock();
+
+	Common::MemoryReadStream *stream = readFile(name, type);
+
+	Common::StackLock lock(_mutex);
+
+	if (!stream) {
+		_misses++;
+		return 0;
+	}
+
+	// Keep what we read from disk in memory too
+	const uint32 size = stream->size() - stream->pos();
+	addEntry(id, serial, stream->readInPlace(size), size);
+	stream->seek(-((int32) size), SEEK_CUR);
+
+	_hits++;
+	return stream;
+}
+
+void ModelCache::add(const Common::UString &name, ::Aurora::FileType type, const byte *data, uint32 size) {
+	// Look up the resource before locking, so we never hold our lock while waiting on ResMan's
+	const Common::UString id = getID(name, type);
+	const uint32 serial = ResMan.getResourceSerial(name, type);
+
+	_mutex.lock();
+	addEntry(id, serial, data, size);
+	_mutex.unlock();
+
+	writeFile(name, type, data, size);
+}
+
+void ModelCache::remove(const Common::UString &name, ::Aurora::FileType type) {
+	Common::UString file, key;
+	if (getFile(name, type, file, key))
+		std::remove(file.c_str());
+
+	Common::StackLock lock(_mutex);
+
+	EntryMap::iterator entry = _entries.find(getID(name, type));
+	if (entry != _entries.end())
+		removeEntry(entry);
+}
+
+void ModelCache::addEntry(const Common::UString &id, uint32 serial, const byte *data, uint32 size) {
+	if (!data || (size > _memoryBudget))
+		return;
+
+	EntryMap::iterator entry = _entries.find(id);
+	if (entry != _entries.end())
+		removeEntry(entry);
+
+	Entry &newEntry = _entries[id];
+
+	newEntry.serial = serial;
+	newEntry.size   = size;
+	newEntry.data   = new byte[size];
+	newEntry.age    = _ages.insert(_ages.end(), id);
+
+	std::memcpy(newEntry.data, data, size);
+
+	_memorySize += size;
+
+	enforceBudget();
+}
+
+void ModelCache::removeEntry(EntryMap::iterator entry) {
+	_memorySize -= entry->second.size;
+
+	delete[] entry->second.data;
+
+	_ages.erase(entry->second.age);
+	_entries.erase(entry);
+}
+
+void ModelCache::enforceBudget() {
+	while ((_memorySize > _memoryBudget) && !_ages.empty())
+		removeEntry(_entries.find(_ages.front()));
+}
+
+bool ModelCache::getFile(const Common::UString &name, ::Aurora::FileType type,
+                         Common::UString &file, Common::UString &key) const {
+
+	if (_directory.empty())
+		return false;
+
+	::Aurora::ResourceManager::ResourceOrigin origin;
+	if (!ResMan.getResourceOrigin(name, type, origin))
+		return false;
+
+	return getCacheFile(_directory, getID(name, type), "xmc", origin, file, key);
+}
+
+Common::MemoryReadStream *ModelCache::readFile(const Common::UString &name, ::Aurora::FileType type) {
+	Common::UString file, key;
+	if (!getFile(name, type, file, key))
+		return 0;
+
+	return readCacheFile(file, key);
+}
+
+void ModelCache::writeFile(const Common::UString &name, ::Aurora::FileType type, const byte *data, uint32 size) {
+	Common::UString file, key;
+	if (!getFile(name, type, file, key))
+		return;
+
+	writeCacheFile(file, key, data, size);
+}
+
+void ModelCache::resetStats() {
+	Common::StackLock lock(_mutex);
+
+	_hits   = 0;
+	_misses = 0;
+}
+
+void ModelCache::getStats(uint32 &hits, uint32 &misses) {
+	Common::StackLock lock(_mutex);
+
+	hits   = _hits;
+	misses = _misses;
+}
+
+} // End of namespace Aurora
+
+} // End of namespace Graphics
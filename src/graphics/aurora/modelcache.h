@@ -0,0 +1,141 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey and Eclipse engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/aurora/modelcache.h
+ *  A cache of compiled models.
+ */
+
+#ifndef GRAPHICS_AURORA_MODELCACHE_H
+#define GRAPHICS_AURORA_MODELCACHE_H
+
+#include <map>
+#include <list>
+
+#include "common/types.h"
+#include "common/ustring.h"
+#include "common/singleton.h"
+#include "common/mutex.h"
+
+#include "aurora/types.h"
+
+namespace Common {
+	class SeekableReadStream;
+	class MemoryReadStream;
+}
+
+namespace Graphics {
+
+namespace Aurora {
+
+/** A cache of compiled models.
+ *
+ *  Parsing models out of text formats, like NWN's ASCII MDL, is slow. A
+ *  model class can instead compile the parsed model into a binary blob,
+ *  which loads a lot faster, and hand it to this cache.
+ *
+ *  The blobs are kept in memory for the rest of the session, within a
+ *  memory budget. If a cache directory is set, they are also written
+ *  into it, to be kept across runs.
+ *
+ *  A blob in memory is identified by the model resource's name, type and
+ *  serial. A blob on disk is identified by the file the resource is read
+ *  from, the resource's place and size within that file, and the file's
+ *  modification time. If any of these changes, the blob is ignored.
+ */
+class ModelCache : public Common::Singleton<ModelCache> {
+public:
+	ModelCache();
+	~ModelCache();
+
+	/** Set the directory holding the cache files. An empty path disables them. */
+	void setDirectory(const Common::UString &directory);
+	/** Set the number of bytes of compiled models to keep in memory. */
+	void setMemoryBudget(uint32 budget);
+
+	/** Is the cache enabled, in memory or on disk? */
+	bool isEnabled() const;
+
+	/** Return the compiled model of this model resource, or 0 if there is none. */
+	Common::SeekableReadStream *get(const Common::UString &name, ::Aurora::FileType type);
+
+	/** Add the compiled model of this model resource. */
+	void add(const Common::UString &name, ::Aurora::FileType type, const byte *data, uint32 size);
+	/** Remove the compiled model of this model resource, because it turned out to be broken. */
+	void remove(const Common::UString &name, ::Aurora::FileType type);
+
+	/** Reset the counts of cache hits and misses. */
+	void resetStats();
+	/** Get the counts of cache hits and misses since the last reset. */
+	void getStats(uint32 &hits, uint32 &misses);
+
+private:
+	/** A compiled model held in memory. */
+	struct Entry {
+		uint32 serial; ///< The serial of the resource the model was compiled from.
+
+		byte  *data;
+		uint32 size;
+
+		std::list<Common::UString>::iterator age; ///< The entry's place in the age list.
+	};
+
+	typedef std::map<Common::UString, Entry> EntryMap;
+
+	Common::UString _directory;
+
+	EntryMap _entries;
+	std::list<Common::UString> _ages; ///< Names of all entries, oldest first.
+
+	uint32 _memorySize;   ///< Bytes of compiled models held in memory.
+	uint32 _memoryBudget; ///< Bytes of compiled models we may hold in memory.
+
+	uint32 _hits;   ///< Models found in the cache since the last reset.
+	uint32 _misses; ///< Models not found in the cache since the last reset.
+
+	Common::Mutex _mutex;
+
+	/** Find the cache file for this model resource. */
+	bool getFile(const Common::UString &name, ::Aurora::FileType type,
+	             Common::UString &file, Common::UString &key) const;
+
+	Common::MemoryReadStream *readFile(const Common::UString &name, ::Aurora::FileType type);
+	void writeFile(const Common::UString &name, ::Aurora::FileType type, const byte *data, uint32 size);
+
+	void addEntry(const Common::UString &id, uint32 serial, const byte *data, uint32 size);
+	void removeEntry(EntryMap::iterator entry);
+	/** Drop the oldest entries until we're within the memory budget again. */
+	void enforceBudget();
+
+	static Common::UString getID(const Common::UString &name, ::Aurora::FileType type);
+};
+
+} // End of namespace Aurora
+
+} // End of namespace Graphics
+
+/** Shortcut for accessing the model cache. */
+#define ModelCacheMan Graphics::Aurora::ModelCache::instance()
+
+#endif // GRAPHICS_AURORA_MODELCACHE_H
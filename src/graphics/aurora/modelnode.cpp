@@ -27,7 +27,10 @@
  *  A node within a 3D model.
  */
 
+#include <algorithm>
+
 #include "common/util.h"
+#include "common/error.h"
 #include "common/maths.h"
 
 #include "graphics/graphics.h"
@@ -38,6 +41,7 @@
 #include "graphics/aurora/modelnode.h"
 #include "graphics/aurora/model.h"
 #include "graphics/aurora/texture.h"
+#include "graphics/aurora/skinning.h"
 
 namespace Graphics {
 
@@ -47,11 +51,25 @@ static bool nodeComp(ModelNode *a, ModelNode *b) {
 	return a->isInFrontOf(*b);
 }
 
+/** Nodes with fewer faces aren't worth simplifying. */
+static const uint32 kLODMinFaces = 32;
+
+/** Number of cells along one axis of the vertex cluster grid. */
+static const uint32 kLODGridBits = 21;
+static const uint32 kLODGridMax  = (1 << kLODGridBits) - 1;
+
+static uint32 getLODCell(float v, float min, float cellSize) {
+	const float cell = (v - min) / cellSize;
+
+	return (cell > 0.0) ? MIN<uint32>((uint32) cell, kLODGridMax) : 0;
+}
+
 
 ModelNode::ModelNode(Model &model) :
-	_model(&model), _parent(0), _level(0),
-	_faceCount(0), _coords(0), _smoothGroups(0), _material(0), _isTransparent(false),
-	_render(false), _hasTransparencyHint(false) {
+	_model(&model), _parent(0), _level(0), _nameID(NodeNameManager::kInvalidID), _nodeNumber(0xFFFFFFFF),
+	_faceCount(0), _coords(0), _smoothGroups(0), _material(0), _skin(0), _animated(false), _animStamp(0),
+	_transformDirty(true), _transformMoved(false),
+	_isTransparent(false), _render(false), _hasTransparencyHint(false) {
 
 	_position[0] = 0.0; _position[1] = 0.0; _position[2] = 0.0;
 	_rotation[0] = 0.0; _rotation[1] = 0.0; _rotation[2] = 0.0;
@@ -60,9 +78,20 @@ ModelNode::ModelNode(Model &model) :
 	_orientation[1] = 0.0;
 	_orientation[2] = 0.0;
 	_orientation[3] = 0.0;
+
+	_animPosition[0] = 0.0; _animPosition[1] = 0.0; _animPosition[2] = 0.0;
+
+	_animOrientation[0] = 0.0;
+	_animOrientation[1] = 0.0;
+	_animOrientation[2] = 0.0;
+	_animOrientation[3] = 1.0;
 }
 
 ModelNode::~ModelNode() {
+	clearLODs();
+
+	delete _skin;
+
 	delete[] _material;
 	delete[] _smoothGroups;
 	delete[] _coords;
@@ -129,6 +158,53 @@ void ModelNode::getOrientation(float &x, float &y, float &z, float &a) const {
 	a = _orientation[3];
 }
 
+void ModelNode::getOrientationQuaternion(float *q) const {
+	const float length = sqrtf(_orientation[0] * _orientation[0] +
+	                           _orientation[1] * _orientation[1] +
+	                           _orientation[2] * _orientation[2]);
+
+	if ((length <= 0.0) || (_orientation[3] == 0.0)) {
+		q[0] = q[1] = q[2] = 0.0;
+		q[3] = 1.0;
+		return;
+	}
+
+	const float angle = Common::deg2rad(_orientation[3]) / 2.0;
+	const float s     = sinf(angle) / length;
+
+	q[0] = _orientation[0] * s;
+	q[1] = _orientation[1] * s;
+	q[2] = _orientation[2] * s;
+	q[3] = cosf(angle);
+}
+
+void ModelNode::getModelTransform(Common::TransformationMatrix &transform, bool animated) const {
+	if (_parent)
+		_parent->getModelTransform(transform, animated);
+	else
+		transform.loadIdentity();
+
+	applyTransform(transform, animated);
+}
+
+void ModelNode::applyTransform(Common::TransformationMatrix &transform, bool animated) const {
+	if (animated && _animated) {
+		const float *q = _animOrientation;
+
+		transform.translate(_animPosition[0], _animPosition[1], _animPosition[2]);
+		if ((q[0] != 0.0) || (q[1] != 0.0) || (q[2] != 0.0))
+			transform.rotate(Common::rad2deg(acosf(CLIP(q[3], -1.0f, 1.0f)) * 2.0), q[0], q[1], q[2]);
+
+	} else {
+		transform.translate(_position[0], _position[1], _position[2]);
+		transform.rotate(_orientation[3], _orientation[0], _orientation[1], _orientation[2]);
+	}
+
+	transform.rotate(_rotation[0], 1.0, 0.0, 0.0);
+	transform.rotate(_rotation[1], 0.0, 1.0, 0.0);
+	transform.rotate(_rotation[2], 0.0, 0.0, 1.0);
+}
+
 void ModelNode::getAbsolutePosition(float &x, float &y, float &z) const {
 	x = _absolutePosition.getX() * _model->_modelScale[0];
 	y = _absolutePosition.getY() * _model->_modelScale[1];
@@ -142,8 +218,15 @@ void ModelNode::setPosition(float x, float y, float z) {
 	_position[1] = y / _model->_modelScale[1];
 	_position[2] = z / _model->_modelScale[2];
 
-	if (_parent)
-		_parent->orderChildren();
+	_transformDirty = true;
+
+	if (_parent) {
+		// Our place among our siblings might have changed
+		_parent->_children.sort(nodeComp);
+
+		// The model renders its nodes in hierarchy order
+		_model->reorderChildren(*_parent);
+	}
 
 	_model->needRebuild();
 
@@ -157,6 +240,8 @@ void ModelNode::setRotation(float x, float y, float z) {
 	_rotation[1] = y;
 	_rotation[2] = z;
 
+	_transformDirty = true;
+
 	_model->needRebuild();
 
 	GfxMan.unlockFrame();
@@ -192,6 +277,9 @@ void ModelNode::inheritGeometry(ModelNode &node) const {
 	node._render        = _render;
 	node._isTransparent = _isTransparent;
 
+	node._hasTransparencyHint = _hasTransparencyHint;
+	node._transparencyHint    = _transparencyHint;
+
 	if (!node.createFaces(_faceCount))
 		return;
 
@@ -208,8 +296,9 @@ void ModelNode::reparent(ModelNode &parent) {
 	_model = parent._model;
 	_level = parent._level + 1;
 
-	_model->_currentState->nodeList.push_back(this);
-	_model->_currentState->nodeMap.insert(std::make_pair(_name, this));
+	_transformDirty = true;
+
+	_model->_currentState->nodes.push_back(this);
 
 	for (std::list<ModelNode *>::iterator c = _children.begin(); c != _children.end(); ++c)
 		(*c)->reparent(parent);
@@ -242,8 +331,8 @@ void ModelNode::addChild(Model *model) {
 	     s != model->_stateList.end(); ++s) {
 
 		if (*s == model->_currentState) {
-			(*s)->nodeList.clear();
-			(*s)->nodeMap.clear();
+			(*s)->nodes.clear();
+			(*s)->nodeIndex.clear();
 			(*s)->rootNodes.clear();
 		}
 	}
@@ -252,12 +341,14 @@ void ModelNode::addChild(Model *model) {
 	     s != model->_stateMap.end(); ++s) {
 
 		if (s->second == model->_currentState) {
-			s->second->nodeList.clear();
-			s->second->nodeMap.clear();
+			s->second->nodes.clear();
+			s->second->nodeIndex.clear();
 			s->second->rootNodes.clear();
 		}
 	}
 
+	_model->indexState(*_model->_currentState);
+
 	// Delete the model
 	delete model;
 
@@ -278,8 +369,8 @@ void ModelNode::loadTextures(const std::vector<Common::UString> &textures) {
 
 	_textures.resize(textures.size());
 
-	bool hasAlpha = true;
-	bool isDecal  = true;
+	// The textures are decoded in the background. We only look at
+	// them in checkTransparency(), once the whole model is loaded.
 
 	for (uint t = 0; t != textures.size(); t++) {
 
@@ -288,14 +379,6 @@ void ModelNode::loadTextures(const std::vector<Common::UString> &textures) {
 			if (!textures[t].empty() && (textures[t] != "NULL")) {
 				_textures[t] = TextureMan.get(textures[t]);
 				hasTexture = true;
-
-				if (!_textures[t].getTexture().hasAlpha())
-					hasAlpha = false;
-				if (_textures[t].getTexture().getTXI().getFeatures().alphaMean == 1.0)
-					hasAlpha = false;
-
-				if (!_textures[t].getTexture().getTXI().getFeatures().decal)
-					isDecal = false;
 			}
 
 		} catch (...) {
@@ -304,6 +387,31 @@ void ModelNode::loadTextures(const std::vector<Common::UString> &textures) {
 
 	}
 
+	// If the node has no actual texture, we just assume
+	// that the geometry shouldn't be rendered.
+	if (!hasTexture)
+		_render = false;
+}
+
+void ModelNode::checkTransparency() {
+	bool hasAlpha = true;
+	bool isDecal  = true;
+
+	for (std::vector<TextureHandle>::const_iterator t = _textures.begin(); t != _textures.end(); ++t) {
+		if (t->empty())
+			continue;
+
+		const Texture &texture = t->getTexture();
+
+		if (!texture.hasAlpha())
+			hasAlpha = false;
+		if (texture.getTXI().getFeatures().alphaMean == 1.0)
+			hasAlpha = false;
+
+		if (!texture.getTXI().getFeatures().decal)
+			isDecal = false;
+	}
+
 	if (_hasTransparencyHint) {
 		_isTransparent = _transparencyHint;
 		if (isDecal)
@@ -311,11 +419,6 @@ void ModelNode::loadTextures(const std::vector<Common::UString> &textures) {
 	} else {
 		_isTransparent = hasAlpha;
 	}
-
-	// If the node has no actual texture, we just assume
-	// that the geometry shouldn't be rendered.
-	if (!hasTexture)
-		_render = false;
 }
 
 bool ModelNode::createFaces(uint32 count) {
@@ -362,36 +465,225 @@ void ModelNode::createCenter() {
 	_center[2] = minZ + ((maxZ - minZ) / 2.0);
 }
 
-const Common::BoundingBox &ModelNode::getAbsoluteBound() const {
-	return _absoluteBoundBox;
+void ModelNode::createSkin(const std::vector<float> &vertices, const std::vector<uint16> &faceVertices,
+                           const std::vector<uint32> &boneNumbers, const std::vector<uint16> &bones,
+                           const std::vector<float> &weights) {
+
+	delete _skin;
+	_skin = 0;
+
+	const uint32 vertexCount = vertices.size() / 3;
+	const uint32 boneCount   = boneNumbers.size();
+
+	if ((vertexCount == 0) || (boneCount == 0) || (faceVertices.size() != (3 * _faceCount)))
+		return;
+
+	// Bone indices are bytes, and the last one is reserved for the identity
+	if (boneCount >= 0xFF) {
+		warning("ModelNode::createSkin(): Too many bones (%d) in node \"%s\"", boneCount, _name.c_str());
+		return;
+	}
+
+	if ((bones.size() < (Skin::kMaxInfluences * vertexCount)) ||
+	    (weights.size() < (Skin::kMaxInfluences * vertexCount)))
+		throw Common::Exception("Skin weights for %d vertices missing", vertexCount);
+
+	for (std::vector<uint16>::const_iterator v = faceVertices.begin(); v != faceVertices.end(); ++v) {
+		if (*v >= vertexCount) {
+			warning("ModelNode::createSkin(): Face vertex out of range (%d, %d) in node \"%s\"",
+			        *v, vertexCount, _name.c_str());
+			return;
+		}
+	}
+
+	Skin *skin = new Skin;
+
+	skin->vertexCount = vertexCount;
+
+	skin->rest.resize(3 * vertexCount);
+	skin->skinned.resize(3 * vertexCount);
+
+	for (uint32 v = 0; v < vertexCount; v++) {
+		skin->rest[0 * vertexCount + v] = vertices[3 * v + 0];
+		skin->rest[1 * vertexCount + v] = vertices[3 * v + 1];
+		skin->rest[2 * vertexCount + v] = vertices[3 * v + 2];
+	}
+
+	skin->bones.resize(Skin::kMaxInfluences * vertexCount, 0);
+	skin->weights.resize(Skin::kMaxInfluences * vertexCount, 0.0);
+
+	for (uint32 v = 0; v < vertexCount; v++) {
+		const uint32 n = Skin::kMaxInfluences * v;
+
+		float sum = 0.0;
+		for (uint32 i = 0; i < Skin::kMaxInfluences; i++) {
+			if ((bones[n + i] >= boneCount) || (weights[n + i] <= 0.0))
+				continue;
+
+			skin->bones  [n + i] = bones  [n + i];
+			skin->weights[n + i] = weights[n + i];
+
+			sum += weights[n + i];
+		}
+
+		if (sum <= 0.0) {
+			// Not moved by any bone: keep it in place
+			skin->bones  [n] = boneCount;
+			skin->weights[n] = 1.0;
+			continue;
+		}
+
+		for (uint32 i = 0; i < Skin::kMaxInfluences; i++)
+			skin->weights[n + i] /= sum;
+	}
+
+	skin->faceVertices.assign(faceVertices.begin(), faceVertices.end());
+
+	skin->boneNumbers = boneNumbers;
+
+	skin->boneNodes.resize(boneCount, 0);
+	skin->bindPose.resize(boneCount);
+	skin->matrices.resize(boneCount + 1);
+
+	_skin = skin;
 }
 
-void ModelNode::createAbsoluteBound(Common::BoundingBox parentPosition) {
-	// Transform by our position/orientation/rotation
-	parentPosition.translate(_position[0], _position[1], _position[2]);
-	parentPosition.rotate(_orientation[3], _orientation[0], _orientation[1], _orientation[2]);
+bool ModelNode::createLOD(uint level, float cellSize) {
+	if (!_render || (_faceCount < kLODMinFaces) || (cellSize <= 0.0))
+		return false;
+
+	// Simplifying would tear the faces away from the skin's vertices
+	if (_skin)
+		return false;
 
-	parentPosition.rotate(_rotation[0], 1.0, 0.0, 0.0);
-	parentPosition.rotate(_rotation[1], 0.0, 1.0, 0.0);
-	parentPosition.rotate(_rotation[2], 0.0, 0.0, 1.0);
+	const uint32 vertexCount  = 3 * _faceCount;
+	const uint32 textureCount = _textures.size();
 
+	float minX, minY, minZ;
+	_boundBox.getMin(minX, minY, minZ);
 
-	// That's our absolute position
-	_absolutePosition = parentPosition.getOrigin();
+	/* Vertex clustering: All vertices within the same grid cell are merged
+	 * into their average. Faces that lose a corner that way are dropped,
+	 * the others keep their texture coordinates.
+	 */
 
+	// Sort the vertices by grid cell
+	std::vector< std::pair<uint64, uint32> > cells;
+	cells.resize(vertexCount);
 
-	// Add our bounding box, creating the absolute bounding box
-	_absoluteBoundBox = parentPosition;
-	_absoluteBoundBox.add(_boundBox);
-	_absoluteBoundBox.absolutize();
+	for (uint32 v = 0; v < vertexCount; v++) {
+		const uint64 x = getLODCell(_vX[v], minX, cellSize);
+		const uint64 y = getLODCell(_vY[v], minY, cellSize);
+		const uint64 z = getLODCell(_vZ[v], minZ, cellSize);
 
+		cells[v].first  = x | (y << kLODGridBits) | (z << (2 * kLODGridBits));
+		cells[v].second = v;
+	}
 
-	// Recurse into the children
-	for (std::list<ModelNode *>::iterator c = _children.begin(); c != _children.end(); ++c) {
-		(*c)->createAbsoluteBound(parentPosition);
+	std::sort(cells.begin(), cells.end());
 
-		_absoluteBoundBox.add((*c)->getAbsoluteBound());
+	// Find the clusters and their average position
+	std::vector<uint32> cluster;
+	std::vector<float>  clusterPos;
+
+	cluster.resize(vertexCount);
+	clusterPos.reserve(3 * vertexCount);
+
+	for (uint32 i = 0; i < vertexCount; ) {
+		const uint32 id = clusterPos.size() / 3;
+
+		float x = 0.0, y = 0.0, z = 0.0;
+
+		uint32 j = i;
+		for (; (j < vertexCount) && (cells[j].first == cells[i].first); j++) {
+			const uint32 v = cells[j].second;
+
+			x += _vX[v];
+			y += _vY[v];
+			z += _vZ[v];
+
+			cluster[v] = id;
+		}
+
+		const float n = j - i;
+
+		clusterPos.push_back(x / n);
+		clusterPos.push_back(y / n);
+		clusterPos.push_back(z / n);
+
+		i = j;
 	}
+
+	// Find the faces that survive
+	std::vector<uint32> faces;
+	faces.reserve(_faceCount);
+
+	for (uint32 f = 0; f < _faceCount; f++) {
+		const uint32 a = cluster[3 * f + 0];
+		const uint32 b = cluster[3 * f + 1];
+		const uint32 c = cluster[3 * f + 2];
+
+		if ((a != b) && (b != c) && (a != c))
+			faces.push_back(f);
+	}
+
+	// Not worth it if it isn't notably simpler than the last version
+	const uint32 lastCount = _lods.empty() ? _faceCount : _lods.back().faceCount;
+	if (faces.empty() || ((4 * faces.size()) > (3 * lastCount)))
+		return false;
+
+	LOD lod;
+
+	lod.level     = level;
+	lod.faceCount = faces.size();
+	lod.coords    = new float[3 * 3 * lod.faceCount + 2 * 3 * lod.faceCount * textureCount];
+
+	float *vX = lod.coords + 0 * 3 * lod.faceCount;
+	float *vY = lod.coords + 1 * 3 * lod.faceCount;
+	float *vZ = lod.coords + 2 * 3 * lod.faceCount;
+
+	float *tX = lod.coords + 3 * 3 * lod.faceCount + 0 * 3 * lod.faceCount * textureCount;
+	float *tY = lod.coords + 3 * 3 * lod.faceCount + 1 * 3 * lod.faceCount * textureCount;
+
+	for (uint32 i = 0; i < lod.faceCount; i++) {
+		const uint32 f = faces[i];
+
+		for (uint32 v = 0; v < 3; v++) {
+			const float *pos = &clusterPos[3 * cluster[3 * f + v]];
+
+			vX[3 * i + v] = pos[0];
+			vY[3 * i + v] = pos[1];
+			vZ[3 * i + v] = pos[2];
+		}
+
+		memcpy(tX + 3 * textureCount * i, _tX + 3 * textureCount * f, 3 * textureCount * sizeof(float));
+		memcpy(tY + 3 * textureCount * i, _tY + 3 * textureCount * f, 3 * textureCount * sizeof(float));
+	}
+
+	_lods.push_back(lod);
+	return true;
+}
+
+void ModelNode::clearLODs() {
+	for (std::vector<LOD>::iterator l = _lods.begin(); l != _lods.end(); ++l)
+		delete[] l->coords;
+
+	_lods.clear();
+}
+
+const Common::BoundingBox &ModelNode::getAbsoluteBound() const {
+	return _absoluteBoundBox;
+}
+
+void ModelNode::createAbsoluteBound() {
+	// That's our absolute position
+	_absolutePosition = _modelTransform;
+
+	// Move our bounding box there
+	_absoluteBoundBox = Common::BoundingBox();
+	_absoluteBoundBox.transform(_modelTransform);
+	_absoluteBoundBox.add(_boundBox);
+	_absoluteBoundBox.absolutize();
 }
 
 void ModelNode::orderChildren() {
@@ -402,7 +694,7 @@ void ModelNode::orderChildren() {
 		(*c)->orderChildren();
 }
 
-void ModelNode::renderGeometry() {
+void ModelNode::renderGeometry(uint lod) {
 	// Enable all needed texture units
 	for (uint32 t = 0; t < _textures.size(); t++) {
 		TextureMan.activeTexture(t);
@@ -412,17 +704,46 @@ void ModelNode::renderGeometry() {
 	}
 
 
-	// Render the node's faces
+	// Find the simplest version made for this detail level
 
 	const uint32 textureCount = _textures.size();
+
+	uint32 faceCount = _faceCount;
 	const float *vX = _vX;
 	const float *vY = _vY;
 	const float *vZ = _vZ;
 	const float *tX = _tX;
 	const float *tY = _tY;
 
+	for (std::vector<LOD>::const_iterator l = _lods.begin(); l != _lods.end(); ++l) {
+		if (l->level > lod)
+			break;
+
+		faceCount = l->faceCount;
+
+		vX = l->coords + 0 * 3 * faceCount;
+		vY = l->coords + 1 * 3 * faceCount;
+		vZ = l->coords + 2 * 3 * faceCount;
+		tX = l->coords + 3 * 3 * faceCount + 0 * 3 * faceCount * textureCount;
+		tY = l->coords + 3 * 3 * faceCount + 1 * 3 * faceCount * textureCount;
+	}
+
+
+	// A deformed skin has its own vertex coordinates, which the faces index into
+
+	const Skin *skin = (_skin && _skin->deformed) ? _skin : 0;
+
+	const uint32 *faceVertices = skin ? &skin->faceVertices[0] : 0;
+
+	const float *sX = skin ? &skin->skinned[0] : 0;
+	const float *sY = skin ? (sX + skin->vertexCount) : 0;
+	const float *sZ = skin ? (sY + skin->vertexCount) : 0;
+
+
+	// Render the node's faces
+
 	glBegin(GL_TRIANGLES);
-	for (uint32 f = 0; f < _faceCount; f++, vX += 3, vY += 3, vZ += 3,
+	for (uint32 f = 0; f < faceCount; f++, vX += 3, vY += 3, vZ += 3,
 	                                   tX += 3 * textureCount, tY += 3 * textureCount) {
 
 		// Texture vertex A
@@ -430,7 +751,11 @@ void ModelNode::renderGeometry() {
 			TextureMan.textureCoord2f(t, tX[3 * t + 0], tY[3 * t + 0]);
 
 		// Geometry vertex A
-		glVertex3f(vX[0], vY[0], vZ[0]);
+		if (skin) {
+			const uint32 v = faceVertices[3 * f + 0];
+			glVertex3f(sX[v], sY[v], sZ[v]);
+		} else
+			glVertex3f(vX[0], vY[0], vZ[0]);
 
 
 		// Texture vertex B
@@ -438,7 +763,11 @@ void ModelNode::renderGeometry() {
 			TextureMan.textureCoord2f(t, tX[3 * t + 1], tY[3 * t + 1]);
 
 		// Geometry vertex B
-		glVertex3f(vX[1], vY[1], vZ[1]);
+		if (skin) {
+			const uint32 v = faceVertices[3 * f + 1];
+			glVertex3f(sX[v], sY[v], sZ[v]);
+		} else
+			glVertex3f(vX[1], vY[1], vZ[1]);
 
 
 		// Texture vertex C
@@ -446,7 +775,11 @@ void ModelNode::renderGeometry() {
 			TextureMan.textureCoord2f(t, tX[3 * t + 2], tY[3 * t + 2]);
 
 		// Geometry vertex C
-		glVertex3f(vX[2], vY[2], vZ[2]);
+		if (skin) {
+			const uint32 v = faceVertices[3 * f + 2];
+			glVertex3f(sX[v], sY[v], sZ[v]);
+		} else
+			glVertex3f(vX[2], vY[2], vZ[2]);
 	}
 	glEnd();
 
@@ -458,34 +791,75 @@ void ModelNode::renderGeometry() {
 	}
 }
 
-void ModelNode::render(RenderPass pass) {
-	// Apply the node's transformation
+void ModelNode::render(RenderPass pass, uint lod) {
+	bool shouldRender = _render && (_faceCount > 0);
+	if (((pass == kRenderPassOpaque)      &&  _isTransparent) ||
+			((pass == kRenderPassTransparent) && !_isTransparent))
+		shouldRender = false;
 
-	glTranslatef(_position[0], _position[1], _position[2]);
-	glRotatef(_orientation[3], _orientation[0], _orientation[1], _orientation[2]);
+	if (!shouldRender)
+		return;
 
-	glRotatef(_rotation[0], 1.0, 0.0, 0.0);
-	glRotatef(_rotation[1], 0.0, 1.0, 0.0);
-	glRotatef(_rotation[2], 0.0, 0.0, 1.0);
+	glPushMatrix();
+	glMultMatrixf(_modelTransform.get());
 
+	renderGeometry(lod);
 
-	// Render the node's geometry
+	glPopMatrix();
+}
+
+void ModelNode::getMemoryUsage(ModelMemory &memory) const {
+	const uint32 textureCount = _textures.size();
+
+	memory.nodes++;
+
+	// The full detail faces, with their smooth groups and materials
+	memory.faces     += _faceCount;
+	memory.vertices  += 3 * _faceCount;
+	memory.texCoords += 3 * _faceCount * textureCount;
+
+	memory.geometrySize += (3 * 3 * _faceCount + 2 * 3 * _faceCount * textureCount) * sizeof(float);
+	memory.geometrySize += 2 * _faceCount * sizeof(uint32);
+
+	// The simplified versions
+	for (std::vector<LOD>::const_iterator l = _lods.begin(); l != _lods.end(); ++l) {
+		memory.faces     += l->faceCount;
+		memory.vertices  += 3 * l->faceCount;
+		memory.texCoords += 3 * l->faceCount * textureCount;
+
+		memory.geometrySize += (3 * 3 * l->faceCount + 2 * 3 * l->faceCount * textureCount) * sizeof(float);
+	}
+
+	// The bone weights and deformed vertices
+	if (_skin) {
+		memory.geometrySize += (_skin->rest.capacity() + _skin->skinned.capacity() +
+		                        _skin->weights.capacity()) * sizeof(float);
+		memory.geometrySize += _skin->bones.capacity() * sizeof(uint8);
+		memory.geometrySize += (_skin->faceVertices.capacity() + _skin->boneNumbers.capacity()) * sizeof(uint32);
+		memory.geometrySize += _skin->boneNodes.capacity() * sizeof(ModelNode *);
+		memory.geometrySize += (_skin->bindPose.capacity() + _skin->matrices.capacity()) *
+		                       sizeof(Common::Matrix4x4);
+	}
+}
+
+uint32 ModelNode::getRenderSize(RenderPass pass, uint lod) const {
+	if (!_render || (_faceCount == 0))
+		return 0;
 
-	bool shouldRender = _render && (_faceCount > 0);
 	if (((pass == kRenderPassOpaque)      &&  _isTransparent) ||
 			((pass == kRenderPassTransparent) && !_isTransparent))
-		shouldRender = false;
+		return 0;
 
-	if (shouldRender)
-		renderGeometry();
+	uint32 faceCount = _faceCount;
+	for (std::vector<LOD>::const_iterator l = _lods.begin(); l != _lods.end(); ++l) {
+		if (l->level > lod)
+			break;
 
-
-	// Render the node's children
-	for (std::list<ModelNode *>::iterator c = _children.begin(); c != _children.end(); ++c) {
-		glPushMatrix();
-		(*c)->render(pass);
-		glPopMatrix();
+		faceCount = l->faceCount;
 	}
+
+	// Every face vertex sends its coordinates and one pair of texture coordinates per texture
+	return 3 * faceCount * (3 + 2 * _textures.size()) * sizeof(float);
 }
 
 } // End of namespace Aurora
@@ -47,6 +47,8 @@ namespace Graphics {
 namespace Aurora {
 
 class Model;
+struct Skin;
+struct ModelMemory;
 
 class ModelNode {
 public:
@@ -97,7 +99,10 @@ protected:
 
 	uint32 _level;
 
-	Common::UString _name; ///< The node's name.
+	Common::UString _name;   ///< The node's name.
+	uint32          _nameID; ///< The node's interned name ID, once it's been indexed.
+
+	uint32 _nodeNumber; ///< The node's number within the model, which skins refer to their bones by.
 
 	uint32 _faceCount; ///< Number of faces
 
@@ -115,14 +120,28 @@ protected:
 	uint32 *_smoothGroups; ///< Face smooth groups.
 	uint32 *_material;     ///< Face materials.
 
+	Skin *_skin; ///< The bone weights, if the node is a skinned mesh.
+
 	float _center     [3]; ///< The node's center.
 	float _position   [3]; ///< Position of the node.
 	float _rotation   [3]; ///< Node rotation.
 	float _orientation[4]; ///< Orientation of the node.
 
+	float _animPosition   [3]; ///< Position of the node, as set by the playing animation.
+	float _animOrientation[4]; ///< Orientation of the node, as set by the playing animation (quaternion).
+
+	bool   _animated;  ///< Is the node currently moved by an animation?
+	uint32 _animStamp; ///< The animation step that last set the animated position/orientation.
+
 	/** Position of the node after translate/rotate. */
 	Common::TransformationMatrix _absolutePosition;
 
+	Common::TransformationMatrix _localTransform; ///< The node's transformation relative to its parent.
+	Common::TransformationMatrix _modelTransform; ///< The node's transformation relative to the model.
+
+	bool _transformDirty; ///< Does the local transformation need to be recalculated?
+	bool _transformMoved; ///< Did the model transformation change in the last update?
+
 	float _wirecolor[3]; ///< Color of the wireframe.
 	float _ambient  [3]; ///< Ambient color.
 	float _diffuse  [3]; ///< Diffuse color.
@@ -164,23 +183,66 @@ protected:
 	Common::BoundingBox _boundBox;
 	Common::BoundingBox _absoluteBoundBox;
 
+	/** A simplified version of the node's faces. */
+	struct LOD {
+		uint level;       ///< The model detail level this version is made for.
+		uint32 faceCount; ///< Number of faces.
+		float *coords;    ///< Vertex and texture coordinates, laid out like _coords.
+	};
+
+	std::vector<LOD> _lods; ///< Simplified versions, from finest to coarsest.
+
 
 	// Loading helpers
 	void loadTextures(const std::vector<Common::UString> &textures);
+	/** Find out whether the node is transparent, from its textures and transparency hint. */
+	void checkTransparency();
 	bool createFaces(uint32 count);
 	void createBound();
 	void createCenter();
 
-	void render(RenderPass pass);
+	/** Make the node a skinned mesh.
+	 *
+	 *  @param vertices The mesh's unique vertex coordinates, 3 floats each.
+	 *  @param faceVertices The vertex at each corner of each face.
+	 *  @param boneNumbers The node number of each bone.
+	 *  @param bones Skin::kMaxInfluences bone indices per vertex, 0xFFFF for none.
+	 *  @param weights Skin::kMaxInfluences bone weights per vertex.
+	 */
+	void createSkin(const std::vector<float> &vertices, const std::vector<uint16> &faceVertices,
+	                const std::vector<uint32> &boneNumbers, const std::vector<uint16> &bones,
+	                const std::vector<float> &weights);
+
+	/** Create a simplified version by clustering all vertices within cubes of this size. */
+	bool createLOD(uint level, float cellSize);
+	void clearLODs();
+
+	/** Render the node's geometry, by its model transformation. The children render themselves. */
+	void render(RenderPass pass, uint lod);
+
+	/** Add the geometry this node holds to the counts. */
+	void getMemoryUsage(ModelMemory &memory) const;
+	/** Return the bytes of vertex data rendering the node in this pass and detail level sends. */
+	uint32 getRenderSize(RenderPass pass, uint lod) const;
+
+	/** Return the node's orientation as a quaternion (x, y, z, w). */
+	void getOrientationQuaternion(float *q) const;
+
+	/** Get the node's transformation relative to the model, animated or at rest. */
+	void getModelTransform(Common::TransformationMatrix &transform, bool animated) const;
 
 
 private:
 	const Common::BoundingBox &getAbsoluteBound() const;
-	void createAbsoluteBound(Common::BoundingBox parentPosition);
+	/** Create the absolute bounding box out of the model transformation, without the children. */
+	void createAbsoluteBound();
+
+	/** Apply the node's own transformation, animated or at rest, onto this matrix. */
+	void applyTransform(Common::TransformationMatrix &transform, bool animated) const;
 
 	void orderChildren();
 
-	void renderGeometry();
+	void renderGeometry(uint lod);
 
 
 public:
@@ -0,0 +1,156 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey and Eclipse engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/aurora/nodeindex.cpp
+ *  Looking up model nodes by name.
+ */
+
+#include "common/util.h"
+
+#include "graphics/aurora/nodeindex.h"
+
+DECLARE_SINGLETON(Graphics::Aurora::NodeNameManager)
+
+namespace Graphics {
+
+namespace Aurora {
+
+/** Smallest size of a node index table. */
+static const uint32 kMinSlots = 16;
+
+uint32 NodeNameManager::intern(const Common::UString &name) {
+	Common::StackLock lock(_mutex);
+
+	std::pair<IDMap::iterator, bool> id = _ids.insert(std::make_pair(name, (uint32) _ids.size()));
+
+	return id.first->second;
+}
+
+uint32 NodeNameManager::find(const Common::UString &name) {
+	Common::StackLock lock(_mutex);
+
+	IDMap::const_iterator id = _ids.find(name);
+	if (id == _ids.end())
+		return kInvalidID;
+
+	return id->second;
+}
+
+
+NodeIndex::NodeIndex() : _count(0), _shift(32) {
+}
+
+NodeIndex::~NodeIndex() {
+}
+
+void NodeIndex::clear() {
+	_slots.clear();
+	_count = 0;
+	_shift = 32;
+}
+
+void NodeIndex::build(const std::vector<uint32> &ids) {
+	clear();
+
+	// Keep the table at most half full
+	uint32 size = kMinSlots;
+	while (size < (2 * ids.size()))
+		size *= 2;
+
+	resize(size);
+
+	for (uint32 i = 0; i < ids.size(); i++)
+		add(ids[i], i);
+}
+
+void NodeIndex::add(uint32 id, uint32 index) {
+	if (id == NodeNameManager::kInvalidID)
+		return;
+
+	if ((2 * (_count + 1)) > _slots.size())
+		resize(MAX<uint32>(kMinSlots, 2 * _slots.size()));
+
+	Slot &slot = _slots[findSlot(id)];
+	if (slot.id == id)
+		return;
+
+	slot.id    = id;
+	slot.index = index;
+
+	_count++;
+}
+
+void NodeIndex::set(uint32 id, uint32 index) {
+	if (_slots.empty() || (id == NodeNameManager::kInvalidID))
+		return;
+
+	Slot &slot = _slots[findSlot(id)];
+	if (slot.id == id)
+		slot.index = index;
+}
+
+uint32 NodeIndex::find(uint32 id) const {
+	if (_slots.empty() || (id == NodeNameManager::kInvalidID))
+		return kNoNode;
+
+	const Slot &slot = _slots[findSlot(id)];
+	if (slot.id != id)
+		return kNoNode;
+
+	return slot.index;
+}
+
+void NodeIndex::resize(uint32 size) {
+	std::vector<Slot> slots(size);
+	for (std::vector<Slot>::iterator s = slots.begin(); s != slots.end(); ++s)
+		s->id = NodeNameManager::kInvalidID;
+
+	_slots.swap(slots);
+
+	_shift = 32;
+	for (uint32 n = size; n > 1; n >>= 1)
+		_shift--;
+
+	for (std::vector<Slot>::const_iterator s = slots.begin(); s != slots.end(); ++s)
+		if (s->id != NodeNameManager::kInvalidID)
+			_slots[findSlot(s->id)] = *s;
+}
+
+uint32 NodeIndex::findSlot(uint32 id) const {
+	const uint32 mask = _slots.size() - 1;
+
+	// Fibonacci hashing: the top bits of the product depend on all bits of the ID
+	uint32 slot = (uint32) (id * 2654435769U) >> _shift;
+
+	// Linear probing, until we find the ID or an empty slot
+	while ((_slots[slot].id != id) && (_slots[slot].id != NodeNameManager::kInvalidID))
+		slot = (slot + 1) & mask;
+
+	return slot;
+}
+
+} // End of namespace Aurora
+
+} // End of namespace Graphics
@@ -0,0 +1,116 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey and Eclipse engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/aurora/nodeindex.h
+ *  Looking up model nodes by name.
+ */
+
+#ifndef GRAPHICS_AURORA_NODEINDEX_H
+#define GRAPHICS_AURORA_NODEINDEX_H
+
+#include <vector>
+
+#include "boost/unordered/unordered_map.hpp"
+
+#include "common/types.h"
+#include "common/ustring.h"
+#include "common/singleton.h"
+#include "common/mutex.h"
+
+namespace Graphics {
+
+namespace Aurora {
+
+/** Interns the names of model nodes.
+ *
+ *  Every distinct node name, compared case-insensitively, gets a unique
+ *  numerical ID. The same name has the same ID in every model, so nodes
+ *  can be matched by comparing integers instead of strings.
+ */
+class NodeNameManager : public Common::Singleton<NodeNameManager> {
+public:
+	static const uint32 kInvalidID = 0xFFFFFFFF;
+
+	/** Return the ID of this node name, giving it a new one if necessary. */
+	uint32 intern(const Common::UString &name);
+	/** Return the ID of this node name, or kInvalidID if no node ever had it. */
+	uint32 find(const Common::UString &name);
+
+private:
+	typedef boost::unordered_map<Common::UString, uint32,
+	                             Common::hashUStringCaseInsensitive, Common::UString::iequal> IDMap;
+
+	IDMap _ids;
+
+	Common::Mutex _mutex;
+};
+
+/** An open addressing hash table from node name IDs to node indices. */
+class NodeIndex {
+public:
+	static const uint32 kNoNode = 0xFFFFFFFF;
+
+	NodeIndex();
+	~NodeIndex();
+
+	void clear();
+
+	/** Index nodes by their name IDs. Of several nodes with the same name, the first one wins. */
+	void build(const std::vector<uint32> &ids);
+
+	/** Add a node index under this name ID, unless the ID is already taken. */
+	void add(uint32 id, uint32 index);
+
+	/** Change the node index of a name ID already in the table. */
+	void set(uint32 id, uint32 index);
+
+	/** Return the index of the node with this name ID, or kNoNode. */
+	uint32 find(uint32 id) const;
+
+private:
+	struct Slot {
+		uint32 id;    ///< The name ID, or NodeNameManager::kInvalidID for an empty slot.
+		uint32 index; ///< The node index.
+	};
+
+	std::vector<Slot> _slots; ///< The table, always a power of two in size.
+
+	uint32 _count; ///< Number of used slots.
+	uint32 _shift; ///< 32 minus the binary logarithm of the table size.
+
+	void resize(uint32 size);
+
+	/** Return the slot this ID should go into. */
+	uint32 findSlot(uint32 id) const;
+};
+
+} // End of namespace Aurora
+
+} // End of namespace Graphics
+
+/** Shortcut for accessing the node name manager. */
+#define NodeNames Graphics::Aurora::NodeNameManager::instance()
+
+#endif // GRAPHICS_AURORA_NODEINDEX_H
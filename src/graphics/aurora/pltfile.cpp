@@ -27,6 +27,8 @@
  *  BioWare's Packed Layered Texture.
  */
 
+#include <cstring>
+
 #include "common/error.h"
 #include "common/stream.h"
 
@@ -57,8 +59,7 @@ static const char *kPalettes[PLTFile::kLayerMAX] = {
 	"pal_tattoo01"
 };
 
-PLTFile::PLTFile(const Common::UString &fileName) : _name(fileName),
-	_dataImage(0), _dataLayers(0) {
+PLTFile::PLTFile(const Common::UString &fileName) : _name(fileName), _data(0) {
 
 	assert(!_name.empty());
 
@@ -69,16 +70,13 @@ PLTFile::PLTFile(const Common::UString &fileName) : _name(fileName),
 }
 
 PLTFile::~PLTFile() {
-	delete[] _dataImage;
-	delete[] _dataLayers;
+	delete[] _data;
 }
 
 bool PLTFile::reload() {
-	delete _dataImage;
-	delete _dataLayers;
+	delete[] _data;
 
-	_dataImage  = 0;
-	_dataLayers = 0;
+	_data = 0;
 
 	load();
 	rebuild();
@@ -134,17 +132,22 @@ void PLTFile::readHeader(Common::SeekableReadStream &plt) {
 }
 
 void PLTFile::readData(Common::SeekableReadStream &plt) {
-	uint32 size = _width * _height;
-
-	_dataImage  = new uint8[size];
-	_dataLayers = new uint8[size];
+	const uint32 size = _width * _height;
 
-	uint8 *image = _dataImage;
-	uint8 *layer = _dataLayers;
-	while (size-- > 0) {
-		*image++ = plt.readByte();
-		*layer++ = MIN<uint8>(plt.readByte(), kLayerMAX - 1);
+	// Pairs of color index and layer
+	byte *pixels = new byte[2 * size];
+	if (plt.read(pixels, 2 * size) != (2 * size)) {
+		delete[] pixels;
+		throw Common::Exception(Common::kReadError);
 	}
+
+	_data = new uint16[size];
+
+	const byte *pixel = pixels;
+	for (uint32 i = 0; i < size; i++, pixel += 2)
+		_data[i] = (MIN<uint8>(pixel[1], kLayerMAX - 1) << 8) | pixel[0];
+
+	delete[] pixels;
 }
 
 void PLTFile::setLayerColor(Layer layer, uint8 color) {
@@ -189,49 +192,112 @@ void PLTImage::create(const PLTFile &parent) {
 	_mipMaps[0]->size   = _mipMaps[0]->width * _mipMaps[0]->height * 4;
 	_mipMaps[0]->data   = new byte[_mipMaps[0]->size];
 
-	byte rows[4 * 256 * PLTFile::kLayerMAX];
+	// One row of 256 colors for each layer, indexed directly by the pixels' layer and color index
+	uint32 rows[256 * PLTFile::kLayerMAX];
 	getColorRows(parent, rows);
 
 	uint32 pixels = parent._width * parent._height;
-	const byte *image = parent._dataImage;
-	const byte *layer = parent._dataLayers;
-	      byte *dst   = _mipMaps[0]->data;
+	const uint16 *data = parent._data;
+	      uint32 *dst  = (uint32 *) _mipMaps[0]->data;
+
+	for (; pixels >= 4; pixels -= 4, data += 4, dst += 4) {
+		dst[0] = rows[data[0]];
+		dst[1] = rows[data[1]];
+		dst[2] = rows[data[2]];
+		dst[3] = rows[data[3]];
+	}
+
+	while (pixels-- > 0)
+		*dst++ = rows[*data++];
+}
 
-	for (uint32 i = 0; i < pixels; i++, image++, layer++, dst += 4)
-		memcpy(dst, rows + (*layer * 4 * 256) + (*image * 4), 4);
+void PLTImage::getColorRows(const PLTFile &parent, uint32 *rows) {
+	PLTPalettes &palettes = TextureMan.getPLTPalettes();
+
+	for (uint i = 0; i < PLTFile::kLayerMAX; i++, rows += 256)
+		palettes.getRow((PLTFile::Layer) i, parent._colors[i], rows);
+}
+
+
+PLTPalettes::PLTPalettes() {
+	for (uint i = 0; i < PLTFile::kLayerMAX; i++) {
+		_palettes[i].loaded = false;
+		_palettes[i].rows   = 0;
+		_palettes[i].data   = 0;
+	}
 }
 
-void PLTImage::getColorRows(const PLTFile &parent, byte *rows) {
-	for (uint i = 0; i < PLTFile::kLayerMAX; i++, rows += 4 * 256) {
-		Common::SeekableReadStream *tgaFile = 0;
+PLTPalettes::~PLTPalettes() {
+	clear();
+}
 
-		try {
-			tgaFile = ResMan.getResource(kPalettes[i], ::Aurora::kFileTypeTGA);
-			if (!tgaFile)
-				throw std::exception();
+void PLTPalettes::clear() {
+	Common::StackLock lock(_mutex);
 
-			TGA tga(*tgaFile);
-			if (tga.getFormat() != kPixelFormatBGRA)
-				throw std::exception();
+	for (uint i = 0; i < PLTFile::kLayerMAX; i++) {
+		delete[] _palettes[i].data;
 
-			const MipMap &mipMap = tga.getMipMap(0);
-			if (mipMap.width != 256)
-				throw std::exception();
+		_palettes[i].loaded = false;
+		_palettes[i].rows   = 0;
+		_palettes[i].data   = 0;
+	}
+}
 
-			uint8 row = parent._colors[i];
-			if (row >= mipMap.height)
-				throw std::exception();
+void PLTPalettes::getRow(PLTFile::Layer layer, uint8 row, uint32 *colors) {
+	assert((layer >= 0) && (layer < PLTFile::kLayerMAX));
 
-			row = mipMap.height - 1 - row;
+	Common::StackLock lock(_mutex);
 
-			memcpy(rows, mipMap.data + (row * 4 * 256), 4 * 256);
+	// Layers using the same palette share it
+	uint i = 0;
+	while (std::strcmp(kPalettes[i], kPalettes[layer]))
+		i++;
 
-		} catch (...) {
-			memset(rows, 0, 4 * 256);
-		}
+	Palette &palette = _palettes[i];
+	if (!palette.loaded)
+		load(palette, kPalettes[i]);
 
-		delete tgaFile;
+	if (row >= palette.rows) {
+		std::memset(colors, 0, 256 * sizeof(uint32));
+		return;
 	}
+
+	std::memcpy(colors, palette.data + row * 256, 256 * sizeof(uint32));
+}
+
+void PLTPalettes::load(Palette &palette, const char *name) {
+	palette.loaded = true;
+
+	Common::SeekableReadStream *tgaFile = 0;
+
+	try {
+		tgaFile = ResMan.getResource(name, ::Aurora::kFileTypeTGA);
+		if (!tgaFile)
+			throw std::exception();
+
+		TGA tga(*tgaFile);
+		if (tga.getFormat() != kPixelFormatBGRA)
+			throw std::exception();
+
+		const ImageDecoder::MipMap &mipMap = tga.getMipMap(0);
+		if (mipMap.width != 256)
+			throw std::exception();
+
+		palette.rows = MIN<uint32>(mipMap.height, 256);
+		palette.data = new uint32[palette.rows * 256];
+
+		// The image is stored bottom row first
+		for (uint32 i = 0; i < palette.rows; i++)
+			std::memcpy(palette.data + i * 256, mipMap.data + (mipMap.height - 1 - i) * 4 * 256, 4 * 256);
+
+	} catch (...) {
+		delete[] palette.data;
+
+		palette.rows = 0;
+		palette.data = 0;
+	}
+
+	delete tgaFile;
 }
 
 } // End of namespace Aurora
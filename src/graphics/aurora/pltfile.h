@@ -31,6 +31,7 @@
 #define GRAPHICS_AURORA_PLTFILE_H
 
 #include "common/ustring.h"
+#include "common/mutex.h"
 
 #include "aurora/aurorafile.h"
 
@@ -73,8 +74,8 @@ private:
 	uint32 _width;
 	uint32 _height;
 
-	uint8 *_dataImage;
-	uint8 *_dataLayers;
+	/** For each pixel, the layer in the high byte and the color index in the low byte. */
+	uint16 *_data;
 
 	uint8 _colors[kLayerMAX];
 
@@ -101,11 +102,44 @@ private:
 	PLTImage(const PLTFile &parent);
 
 	void create(const PLTFile &parent);
-	void getColorRows(const PLTFile &parent, byte *rows);
+	void getColorRows(const PLTFile &parent, uint32 *rows);
 
 	friend class PLTFile;
 };
 
+/** The color palettes of the PLT layers.
+ *
+ *  Each palette is read and decoded once, and then shared by all PLTs.
+ */
+class PLTPalettes {
+public:
+	PLTPalettes();
+	~PLTPalettes();
+
+	/** Forget all palettes, so they're read again when next needed. */
+	void clear();
+
+	/** Copy the 256 BGRA colors of this row of the layer's palette.
+	 *
+	 *  If the palette or the row doesn't exist, the colors are all 0.
+	 */
+	void getRow(PLTFile::Layer layer, uint8 row, uint32 *colors);
+
+private:
+	/** A decoded palette image. */
+	struct Palette {
+		bool loaded;  ///< Did we try to read this palette already?
+		uint32 rows;  ///< The number of rows in the palette.
+		uint32 *data; ///< The colors, in rows of 256, top row first.
+	};
+
+	Palette _palettes[PLTFile::kLayerMAX];
+
+	Common::Mutex _mutex;
+
+	void load(Palette &palette, const char *name);
+};
+
 } // End of namespace Aurora
 
 } // End of namespace Graphics
@@ -0,0 +1,309 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey and Eclipse engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/aurora/skinning.cpp
+ *  Deforming skinned meshes by their bones.
+ */
+
+#include "common/util.h"
+#include "common/debug.h"
+#include "common/configman.h"
+
+#include "events/events.h"
+
+#include "graphics/aurora/skinning.h"
+
+#ifdef XOREOS_SSE2
+	#include <emmintrin.h>
+#endif
+
+DECLARE_SINGLETON(Graphics::Aurora::SkinManager)
+
+using Common::kDebugGraphics;
+
+namespace Graphics {
+
+namespace Aurora {
+
+/** Default number of threads deforming skins, besides the main thread. */
+static const int kSkinningThreads = 2;
+
+/** Number of vertices in one job. */
+static const uint32 kJobSize = 512;
+
+/** Number of milliseconds between two reports of the deformation rate. */
+static const uint32 kReportInterval = 1000;
+
+Skin::Skin() : vertexCount(0), deformed(false), pendingJobs(0) {
+}
+
+
+void skinVerticesScalar(Skin &skin, uint32 start, uint32 end) {
+	const uint32 n = skin.vertexCount;
+
+	const float *restX = &skin.rest[0];
+	const float *restY = restX + n;
+	const float *restZ = restY + n;
+
+	float *x = &skin.skinned[0];
+	float *y = x + n;
+	float *z = y + n;
+
+	const uint8 *bones   = &skin.bones  [Skin::kMaxInfluences * start];
+	const float *weights = &skin.weights[Skin::kMaxInfluences * start];
+
+	for (uint32 v = start; v < end; v++, bones += Skin::kMaxInfluences, weights += Skin::kMaxInfluences) {
+		float sX = 0.0, sY = 0.0, sZ = 0.0;
+
+		for (uint32 i = 0; i < Skin::kMaxInfluences; i++) {
+			if (weights[i] == 0.0)
+				continue;
+
+			// Column-major
+			const float *m = skin.matrices[bones[i]].get();
+
+			sX += weights[i] * (m[0] * restX[v] + m[4] * restY[v] + m[ 8] * restZ[v] + m[12]);
+			sY += weights[i] * (m[1] * restX[v] + m[5] * restY[v] + m[ 9] * restZ[v] + m[13]);
+			sZ += weights[i] * (m[2] * restX[v] + m[6] * restY[v] + m[10] * restZ[v] + m[14]);
+		}
+
+		x[v] = sX;
+		y[v] = sY;
+		z[v] = sZ;
+	}
+}
+
+#ifdef XOREOS_SSE2
+
+void skinVertices(Skin &skin, uint32 start, uint32 end) {
+	const uint32 n = skin.vertexCount;
+
+	const float *restX = &skin.rest[0];
+	const float *restY = restX + n;
+	const float *restZ = restY + n;
+
+	float *x = &skin.skinned[0];
+	float *y = x + n;
+	float *z = y + n;
+
+	const uint8 *bones   = &skin.bones  [Skin::kMaxInfluences * start];
+	const float *weights = &skin.weights[Skin::kMaxInfluences * start];
+
+	ALIGNED_PRE(16) float result[4];
+
+	/* With the matrices in column-major order, transforming a point is a sum
+	 * of the columns scaled by the point's coordinates, one vector each. An
+	 * unused influence has a weight of 0.0, so we don't need to branch. */
+
+	for (uint32 v = start; v < end; v++, bones += Skin::kMaxInfluences, weights += Skin::kMaxInfluences) {
+		const __m128 pX = _mm_set1_ps(restX[v]);
+		const __m128 pY = _mm_set1_ps(restY[v]);
+		const __m128 pZ = _mm_set1_ps(restZ[v]);
+
+		__m128 sum = _mm_setzero_ps();
+
+		for (uint32 i = 0; i < Skin::kMaxInfluences; i++) {
+			const float *m = skin.matrices[bones[i]].get();
+
+			const __m128 p = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(m + 0), pX),
+			                                       _mm_mul_ps(_mm_loadu_ps(m + 4), pY)),
+			                            _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(m + 8), pZ),
+			                                       _mm_loadu_ps(m + 12)));
+
+			sum = _mm_add_ps(sum, _mm_mul_ps(p, _mm_set1_ps(weights[i])));
+		}
+
+		_mm_store_ps(result, sum);
+
+		x[v] = result[0];
+		y[v] = result[1];
+		z[v] = result[2];
+	}
+}
+
+#else
+
+void skinVertices(Skin &skin, uint32 start, uint32 end) {
+	skinVerticesScalar(skin, start, end);
+}
+
+#endif
+
+
+SkinManager::Worker::Worker(SkinManager &manager) : _manager(&manager) {
+}
+
+SkinManager::Worker::~Worker() {
+	destroyThread();
+}
+
+void SkinManager::Worker::threadMethod() {
+	while (!_killThread)
+		if (!_manager->runJob())
+			_manager->_newJobs.wait(10);
+}
+
+
+SkinManager::SkinManager() : _nextJob(0), _pendingJobs(0), _vertexCount(0), _reportTime(0) {
+	const int threadCount = MAX(ConfigMan.getInt("skinthreads", kSkinningThreads), 0);
+
+	for (int i = 0; i < threadCount; i++) {
+		Worker *worker = new Worker(*this);
+
+		if (!worker->createThread()) {
+			warning("Failed to create a skinning thread");
+			delete worker;
+			break;
+		}
+
+		_workers.push_back(worker);
+	}
+}
+
+SkinManager::~SkinManager() {
+	finish();
+
+	for (std::vector<Worker *>::iterator w = _workers.begin(); w != _workers.end(); ++w)
+		delete *w;
+}
+
+void SkinManager::add(Skin &skin) {
+	if (skin.vertexCount == 0)
+		return;
+
+	_mutex.lock();
+
+	for (uint32 start = 0; start < skin.vertexCount; start += kJobSize) {
+		Job job;
+
+		job.skin  = &skin;
+		job.start = start;
+		job.end   = MIN(start + kJobSize, skin.vertexCount);
+
+		_jobs.push_back(job);
+
+		skin.pendingJobs++;
+		_pendingJobs++;
+	}
+
+	_vertexCount += skin.vertexCount;
+
+	_mutex.unlock();
+
+	_newJobs.signal();
+
+	reportRate();
+}
+
+void SkinManager::wait(Skin &skin) {
+	_mutex.lock();
+
+	while (skin.pendingJobs > 0) {
+		_mutex.unlock();
+
+		// Help out with the batch, if there's anything left to take
+		if (!runJob())
+			_finishedJobs.wait(1);
+
+		_mutex.lock();
+	}
+
+	_mutex.unlock();
+}
+
+void SkinManager::finish() {
+	while (runJob())
+		;
+
+	_mutex.lock();
+
+	while (_pendingJobs > 0) {
+		_mutex.unlock();
+		_finishedJobs.wait(1);
+		_mutex.lock();
+	}
+
+	_mutex.unlock();
+}
+
+uint32 SkinManager::getThreadCount() const {
+	return _workers.size();
+}
+
+uint64 SkinManager::resetVertexCount() {
+	Common::StackLock lock(_mutex);
+
+	const uint64 count = _vertexCount;
+	_vertexCount = 0;
+
+	return count;
+}
+
+void SkinManager::reportRate() {
+	const uint32 now = EventMan.getTimestamp();
+	if ((now - _reportTime) < kReportInterval)
+		return;
+
+	const uint64 count = resetVertexCount();
+	if (_reportTime > 0)
+		debugC(3, kDebugGraphics, "Deformed %.0f skinned vertices per second",
+		       (count * 1000.0) / (now - _reportTime));
+
+	_reportTime = now;
+}
+
+bool SkinManager::runJob() {
+	_mutex.lock();
+
+	if (_nextJob >= _jobs.size()) {
+		_mutex.unlock();
+		return false;
+	}
+
+	const Job job = _jobs[_nextJob++];
+
+	_mutex.unlock();
+
+	skinVertices(*job.skin, job.start, job.end);
+
+	_mutex.lock();
+
+	job.skin->pendingJobs--;
+
+	// Once the whole batch is done, start the next one from scratch
+	if (--_pendingJobs == 0) {
+		_jobs.clear();
+		_nextJob = 0;
+	}
+
+	_mutex.unlock();
+
+	_finishedJobs.signal();
+	return true;
+}
+
+} // End of namespace Aurora
+
+} // End of namespace Graphics
@@ -0,0 +1,161 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey and Eclipse engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/aurora/skinning.h
+ *  Deforming skinned meshes by their bones.
+ */
+
+#ifndef GRAPHICS_AURORA_SKINNING_H
+#define GRAPHICS_AURORA_SKINNING_H
+
+#include <vector>
+
+#include "common/types.h"
+#include "common/singleton.h"
+#include "common/mutex.h"
+#include "common/thread.h"
+#include "common/matrix4x4.h"
+
+namespace Graphics {
+
+namespace Aurora {
+
+class ModelNode;
+
+/** The bone weights of a skinned mesh node.
+ *
+ *  The vertices are kept unique, as they are in the model file, and the
+ *  faces index into them. Each vertex is moved by up to kMaxInfluences
+ *  weighted bone matrices; unused influences have a weight of 0.0.
+ */
+struct Skin {
+	/** Maximum number of bones influencing one vertex. */
+	static const uint32 kMaxInfluences = 4;
+
+	uint32 vertexCount; ///< Number of unique vertices.
+
+	std::vector<float> rest;    ///< Vertex coordinates in the bind pose: all X, then all Y, then all Z.
+	std::vector<float> skinned; ///< The deformed vertex coordinates, laid out like rest.
+
+	std::vector<uint8> bones;   ///< kMaxInfluences bone indices per vertex.
+	std::vector<float> weights; ///< kMaxInfluences bone weights per vertex.
+
+	std::vector<uint32> faceVertices; ///< The vertex at each corner of each face.
+
+	std::vector<uint32> boneNumbers; ///< The number of each bone's node within the model.
+
+	std::vector<ModelNode *>       boneNodes; ///< Each bone's node, or 0 if it doesn't exist.
+	std::vector<Common::Matrix4x4> bindPose;  ///< Each bone's inverse bind pose, relative to the skin node.
+
+	/** The current bone matrices. One more than there are bones, the last is the identity. */
+	std::vector<Common::Matrix4x4> matrices;
+
+	bool deformed; ///< Do the skinned coordinates hold the current pose?
+
+	uint32 pendingJobs; ///< Number of deformation jobs not yet finished.
+
+	Skin();
+};
+
+/** Deform the vertices start to end - 1 of this skin, using SSE2 if available. */
+void skinVertices(Skin &skin, uint32 start, uint32 end);
+/** Deform the vertices start to end - 1 of this skin, without using SSE2. */
+void skinVerticesScalar(Skin &skin, uint32 start, uint32 end);
+
+/** Deforms skinned meshes on a pool of threads.
+ *
+ *  All skins queued during a frame form one batch, split into jobs of a
+ *  fixed number of vertices. The worker threads pick up these jobs as soon
+ *  as they're queued, and a thread waiting for a skin helps with the jobs
+ *  still left instead of sleeping.
+ */
+class SkinManager : public Common::Singleton<SkinManager> {
+public:
+	SkinManager();
+	~SkinManager();
+
+	/** Queue this skin to be deformed by its current bone matrices. */
+	void add(Skin &skin);
+	/** Wait until this skin is deformed. */
+	void wait(Skin &skin);
+	/** Wait until all queued skins are deformed. */
+	void finish();
+
+	/** Return the number of threads deforming skins, besides the waiting ones. */
+	uint32 getThreadCount() const;
+
+	/** Return the number of vertices deformed since the last call, and reset it. */
+	uint64 resetVertexCount();
+
+private:
+	/** A thread deforming skins. */
+	class Worker : public Common::Thread {
+	public:
+		Worker(SkinManager &manager);
+		~Worker();
+
+	private:
+		SkinManager *_manager;
+
+		void threadMethod();
+	};
+
+	/** A range of vertices to deform. */
+	struct Job {
+		Skin *skin;
+
+		uint32 start;
+		uint32 end;
+	};
+
+	std::vector<Worker *> _workers;
+
+	std::vector<Job> _jobs; ///< The jobs of the current batch.
+	uint32 _nextJob;        ///< Index of the next job to take.
+	uint32 _pendingJobs;    ///< Number of jobs not yet finished.
+
+	uint64 _vertexCount; ///< Number of vertices deformed.
+	uint32 _reportTime;  ///< The timestamp the deformation rate was last reported at.
+
+	Common::Mutex _mutex; ///< Protects the jobs and the skins' job counts.
+
+	Common::Condition _newJobs;      ///< Signals newly queued jobs.
+	Common::Condition _finishedJobs; ///< Signals a finished job.
+
+	/** Run the next job. Returns false if there was none. */
+	bool runJob();
+
+	/** Report the number of vertices deformed per second, about once a second. */
+	void reportRate();
+};
+
+} // End of namespace Aurora
+
+} // End of namespace Graphics
+
+/** Shortcut for accessing the skin manager. */
+#define SkinMan Graphics::Aurora::SkinManager::instance()
+
+#endif // GRAPHICS_AURORA_SKINNING_H
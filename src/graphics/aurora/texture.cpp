@@ -33,6 +33,7 @@
 #include "common/stream.h"
 
 #include "graphics/aurora/texture.h"
+#include "graphics/aurora/textureman.h"
 
 #include "graphics/graphics.h"
 #include "graphics/images/txi.h"
@@ -42,6 +43,7 @@
 #include "graphics/images/tpc.h"
 #include "graphics/images/txb.h"
 #include "graphics/images/sbm.h"
+#include "graphics/images/xtc.h"
 
 #include "events/requests.h"
 
@@ -53,8 +55,17 @@ namespace Graphics {
 
 namespace Aurora {
 
+/** A streamed texture starts with the first mip map level at most this large. */
+static const uint32 kStreamingBaseSize = 64;
+/** A streamed texture keeps its image, and its larger mip maps, until its wanted detail stays the same this many frames. */
+static const uint32 kStreamingStableFrames = 30;
+
 Texture::Texture(const Common::UString &name) : _textureID(0),
-	_type(::Aurora::kFileTypeNone), _image(0), _txi(0), _width(0), _height(0) {
+	_type(::Aurora::kFileTypeNone), _image(0), _txi(0), _width(0), _height(0),
+	_hasAlpha(false), _fromResource(false), _imageStream(0), _txiStream(0), _imageCached(false),
+	_decoded(false), _rereading(false), _uploaded(false), _uploadedSize(0),
+	_streamable(false), _wantedSize(0), _baseLevel(0), _wantedLevel(0), _stableFrames(0),
+	_released(false), _wantAtlas(false) {
 
 	_txi = new TXI();
 
@@ -65,7 +76,11 @@ Texture::Texture(const Common::UString &name) : _textureID(0),
 }
 
 Texture::Texture(ImageDecoder *image, const TXI *txi) : _textureID(0),
-	_type(::Aurora::kFileTypeNone), _image(0), _txi(0), _width(0), _height(0) {
+	_type(::Aurora::kFileTypeNone), _image(0), _txi(0), _width(0), _height(0),
+	_hasAlpha(false), _fromResource(false), _imageStream(0), _txiStream(0), _imageCached(false),
+	_decoded(false), _rereading(false), _uploaded(false), _uploadedSize(0),
+	_streamable(false), _wantedSize(0), _baseLevel(0), _wantedLevel(0), _stableFrames(0),
+	_released(false), _wantAtlas(false) {
 
 	if (txi)
 		_txi = new TXI(*txi);
@@ -79,68 +94,320 @@ Texture::Texture(ImageDecoder *image, const TXI *txi) : _textureID(0),
 }
 
 Texture::~Texture() {
+	TextureMan.stopDecoding(*this);
+	TextureMan.removeFromAtlas(*this);
+
+	removeFromQueue(kQueueStreamingTexture);
 	removeFromQueue(kQueueNewTexture);
 	removeFromQueue(kQueueTexture);
 
 	if (_textureID != 0)
 		GfxMan.abandon(&_textureID, 1);
 
+	delete _txiStream;
+	delete _imageStream;
+
 	delete _txi;
 	delete _image;
 }
 
-TextureID Texture::getID() const {
+TextureID Texture::getID() {
+	// Make sure display lists compiled before the upload refer to the right texture
+	if (_textureID == 0)
+		glGenTextures(1, &_textureID);
+
 	return _textureID;
 }
 
 const uint32 Texture::getWidth() const {
+	waitDecoded();
+
 	return _width;
 }
 
 const uint32 Texture::getHeight() const {
+	waitDecoded();
+
 	return _height;
 }
 
 bool Texture::hasAlpha() const {
-	if (!_image)
-		return false;
+	waitDecoded();
 
-	return _image->hasAlpha();
+	return _hasAlpha;
 }
 
 void Texture::load(const Common::UString &name) {
-	Common::SeekableReadStream *img = ResMan.getResource(::Aurora::kResourceImage, name, &_type);
-	if (!img)
-		throw Common::Exception("No such image resource \"%s\"", name.c_str());
+	// If there's a current decoded copy in the texture cache, use that instead
+	TextureFileCache &cache = TextureMan.getFileCache();
+
+	_cacheKey = TextureCacheKey();
+
+	Common::SeekableReadStream *img = 0;
+	if (cache.getKey(name, _cacheKey))
+		img = cache.read(_cacheKey);
+
+	_imageCached = img != 0;
+
+	if (_imageCached) {
+		_type = _cacheKey.type;
+	} else {
+		img = ResMan.getResource(::Aurora::kResourceImage, name, &_type);
+		if (!img)
+			throw Common::Exception("No such image resource \"%s\"", name.c_str());
+	}
 
 	_name = name;
 
+	if ((_type != ::Aurora::kFileTypeTGA) && (_type != ::Aurora::kFileTypeDDS) &&
+	    (_type != ::Aurora::kFileTypeTPC) && (_type != ::Aurora::kFileTypeTXB) &&
+	    (_type != ::Aurora::kFileTypeSBM)) {
+
+		delete img;
+		throw Common::Exception("Unsupported image resource type %d", (int) _type);
+	}
+
+	_imageStream = img;
+	_txiStream   = ResMan.getResource(name, ::Aurora::kFileTypeTXI);
+
+	_decoded      = false;
+	_fromResource = true;
+
+	// Decode the image in the background, if possible
+	if (!TextureMan.startDecoding(*this))
+		decode();
+}
+
+void Texture::load(ImageDecoder *image) {
+	_image   = image;
+	_decoded = true;
+
+	// We can't get this image back once it's gone
+	_fromResource = false;
+
+	_cacheKey    = TextureCacheKey();
+	_imageCached = false;
+
+	loadImage();
+}
+
+void Texture::decode() {
+	/* Only hold the lock while decoding. Queueing locks the texture queue, and the
+	 * main thread holds that one while rebuilding textures, which locks us again. */
+	{
+		Common::StackLock lock(_decodeMutex);
+
+		if (_decoded)
+			return;
+
+		try {
+			_image = createImage(*_imageStream, _imageCached);
+
+			Common::SeekableReadStream *txi = _txiStream;
+			_txiStream = 0;
+
+			loadTXI(txi);
+			loadImage();
+
+			// Keep the decoded image for the next time
+			if (!_imageCached && !_cacheKey.file.empty())
+				TextureMan.getFileCache().write(_cacheKey, *_image);
+
+		} catch (Common::Exception &e) {
+			delete _image;
+			_image = 0;
+
+			// Don't trip over a broken cache file again
+			if (_imageCached)
+				TextureMan.getFileCache().remove(_cacheKey);
+
+			_width    = 0;
+			_height   = 0;
+			_hasAlpha = false;
+
+			e.add("Failed decoding texture \"%s\"", _name.c_str());
+			Common::printException(e, "WARNING: ");
+		}
+
+		delete _imageStream;
+		delete _txiStream;
+
+		_imageStream = 0;
+		_txiStream   = 0;
+
+		_decoded = true;
+	}
+
+	memoryChanged();
+
+	// Now we can upload the real image
+	addToQueue(kQueueNewTexture);
+}
+
+ImageDecoder *Texture::createImage(Common::SeekableReadStream &stream, bool cached) const {
+	// Images out of the texture cache are already decoded
+	if (cached)
+		return new XTC(stream);
+
 	// Loading the different image formats
 	if      (_type == ::Aurora::kFileTypeTGA)
-		_image = new TGA(*img);
+		return new TGA(stream);
 	else if (_type == ::Aurora::kFileTypeDDS)
-		_image = new DDS(*img);
+		return new DDS(stream);
 	else if (_type == ::Aurora::kFileTypeTPC)
-		_image = new TPC(*img);
+		return new TPC(stream);
 	else if (_type == ::Aurora::kFileTypeTXB)
-		_image = new TXB(*img);
+		return new TXB(stream);
 	else if (_type == ::Aurora::kFileTypeSBM)
-		_image = new SBM(*img);
-	else {
-		delete img;
-		throw Common::Exception("Unsupported image resource type %d", (int) _type);
+		return new SBM(stream);
+
+	throw Common::Exception("Unsupported image resource type %d", (int) _type);
+}
+
+ImageDecoder *Texture::readImage() const {
+	if (!_fromResource)
+		return 0;
+
+	// Rereading the image out of the texture cache saves decoding it again
+	Common::SeekableReadStream *img = 0;
+	if (!_cacheKey.file.empty())
+		img = TextureMan.getFileCache().read(_cacheKey);
+
+	const bool cached = img != 0;
+
+	if (!cached)
+		img = ResMan.getResource(_name, _type);
+
+	if (!img) {
+		warning("Failed rereading image resource \"%s\"", _name.c_str());
+		return 0;
+	}
+
+	ImageDecoder *image = 0;
+	try {
+		image = createImage(*img, cached);
+
+		if (GfxMan.needManualDeS3TC())
+			image->decompress();
+
+		image->buildMipMaps();
+
+	} catch (Common::Exception &e) {
+		delete image;
+		image = 0;
+
+		e.add("Failed rereading image resource \"%s\"", _name.c_str());
+		Common::printException(e, "WARNING: ");
 	}
 
 	delete img;
+	return image;
+}
 
-	loadTXI(ResMan.getResource(name, ::Aurora::kFileTypeTXI));
-	loadImage();
+void Texture::memoryChanged() {
+	// Only the textures kept for reuse count against the texture manager's budget
+	if (_released)
+		TextureMan.releasedTextureChanged();
 }
 
-void Texture::load(ImageDecoder *image) {
-	_image = image;
+void Texture::dropImage() {
+	{
+		Common::StackLock lock(_decodeMutex);
 
-	loadImage();
+		if (!_fromResource || !_image)
+			return;
+
+		delete _image;
+		_image = 0;
+	}
+
+	memoryChanged();
+}
+
+bool Texture::restoreImage() {
+	{
+		Common::StackLock lock(_decodeMutex);
+
+		if (_image)
+			return true;
+	}
+
+	// Reading and decoding takes a while, so only lock again to swap in the result
+	ImageDecoder *image = readImage();
+
+	Common::StackLock lock(_decodeMutex);
+
+	// Someone else might have been faster
+	if (!_image) {
+		_image = image;
+		image  = 0;
+
+		memoryChanged();
+	}
+
+	delete image;
+
+	return _image != 0;
+}
+
+bool Texture::startReread() {
+	Common::StackLock lock(_decodeMutex);
+
+	if (_image || !_fromResource)
+		return false;
+
+	if (_rereading)
+		return true;
+
+	_rereading = true;
+	if (TextureMan.startDecoding(*this))
+		return true;
+
+	_rereading = false;
+	return false;
+}
+
+void Texture::reread() {
+	const bool restored = restoreImage();
+
+	bool upload;
+
+	{
+		Common::StackLock lock(_decodeMutex);
+
+		// We can't get this image back, so don't try again with every rebuild
+		if (!restored)
+			_fromResource = false;
+
+		_rereading = false;
+
+		// A texture streaming in larger mip maps picks the image up by itself
+		upload = !_uploaded || _wantAtlas;
+	}
+
+	// Now we can upload the real image again
+	if (upload)
+		addToQueue(kQueueNewTexture);
+}
+
+void Texture::requestAtlas() {
+	if (_wantAtlas)
+		return;
+
+	_wantAtlas = true;
+
+	// The first upload is still to come, and it takes care of it
+	if (!_uploaded)
+		return;
+
+	// If we dropped the image, read it in the background first, so we don't show a placeholder meanwhile
+	if (!startReread())
+		addToQueue(kQueueNewTexture);
+}
+
+void Texture::waitDecoded() const {
+	// If the texture is still waiting to be decoded, we just do it ourselves
+	const_cast<Texture *>(this)->decode();
 }
 
 void Texture::loadTXI(Common::SeekableReadStream *stream) {
@@ -163,8 +430,9 @@ void Texture::loadTXI(Common::SeekableReadStream *stream) {
 
 void Texture::loadImage() {
 	if (!_image) {
-		_width  = 0;
-		_height = 0;
+		_width    = 0;
+		_height   = 0;
+		_hasAlpha = false;
 		return;
 	}
 
@@ -175,10 +443,18 @@ void Texture::loadImage() {
 	if (GfxMan.needManualDeS3TC())
 		_image->decompress();
 
+	/* Generate missing mip maps here, while we're still in the background.
+	 * Images given to us directly might still change, though, so for them
+	 * we create the mip maps anew with every upload. */
+	if (_fromResource)
+		_image->buildMipMaps();
+
 	// Set dimensions
 	_width  = _image->getMipMap(0).width;
 	_height = _image->getMipMap(0).height;
 
+	_hasAlpha = _image->hasAlpha();
+
 	// If we've still got no TXI, look if the image provides TXI data
 	loadTXI(_image->getTXI());
 }
@@ -187,13 +463,62 @@ void Texture::doDestroy() {
 	if (_textureID == 0)
 		return;
 
+	removeFromQueue(kQueueStreamingTexture);
+
 	glDeleteTextures(1, &_textureID);
 
-	_textureID = 0;
+	_textureID    = 0;
+	_uploaded     = false;
+	_uploadedSize = 0;
+	_baseLevel    = 0;
+
+	_levelSizes.clear();
+
+	memoryChanged();
+}
+
+void Texture::uploadPlaceholder() {
+	static const byte kPlaceholder[4] = { 0x80, 0x80, 0x80, 0xFF };
+
+	if (_textureID == 0)
+		glGenTextures(1, &_textureID);
+
+	glBindTexture(GL_TEXTURE_2D, _textureID);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_FALSE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, kPlaceholder);
 }
 
 void Texture::doRebuild() {
-	if (!_image)
+	// Whatever the atlas holds of us is outdated now
+	TextureMan.removeFromAtlas(*this);
+	removeFromQueue(kQueueStreamingTexture);
+	_uploaded     = false;
+	_uploadedSize = 0;
+	_baseLevel    = 0;
+
+	_levelSizes.clear();
+
+	if (!_decoded) {
+		// Still being decoded, show a plain grey placeholder until then
+		uploadPlaceholder();
+		return;
+	}
+
+	/* If we dropped the image after the last upload, we need to read it again.
+	 * That's left to the decoding threads, if possible, with a placeholder until then. */
+	if (startReread()) {
+		uploadPlaceholder();
+		return;
+	}
+
+	if (!restoreImage())
 		// No image
 		return;
 
@@ -218,55 +543,273 @@ void Texture::doRebuild() {
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	}
 
-	if (_image->getMipMapCount() == 1) {
-		// Texture doesn't specify any mip maps, generate our own
+	if ((_image->getMipMapCount() == 1) && _image->canBuildMipMaps()) {
+		// Texture doesn't specify any mip maps, we generate them during the upload
+
+		glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_FALSE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, getMipMapLevels(_width, _height) - 1);
+	} else if (_image->getMipMapCount() == 1) {
+		// Texture doesn't specify any mip maps and we can't generate them, let OpenGL do it
 
 		glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_TRUE);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 9);
 	} else {
-		// Texture does specify mip maps, use these
+		// Texture does specify mip maps, use these. If we may, only the smaller ones for now
+
+		if (_streamable && _fromResource && (GfxMan.getTextureStreamingBudget() > 0)) {
+			_levelSizes.resize(_image->getMipMapCount());
+			for (uint32 i = 0; i < _levelSizes.size(); i++)
+				_levelSizes[i] = _image->getMipMap(i).size;
+
+			_baseLevel    = getStreamingLevel(_levelSizes.size());
+			_wantedLevel  = _baseLevel;
+			_stableFrames = 0;
+		}
 
 		glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_FALSE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, _baseLevel);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, _image->getMipMapCount() - 1);
 	}
 
 	// Texture image data
+	for (uint32 i = _baseLevel; i < _image->getMipMapCount(); i++)
+		_uploadedSize += uploadMipMap(i);
+
+	_uploaded = true;
+
+	if (_image->getMipMapCount() == 1) {
+		if (_image->canBuildMipMaps())
+			_uploadedSize += uploadMipMaps();
+		else
+			// Mip maps OpenGL generates add about a third
+			_uploadedSize += _uploadedSize / 3;
+	}
+
+	memoryChanged();
+
+	// Copy the image into the atlas, now that we have it
+	if (_wantAtlas) {
+		_wantAtlas = false;
+
+		TextureMan.addToAtlas(*this, *_image);
+	}
+
+	// Larger mip maps are streamed in later. The image stays until the wanted detail settles
+	if (!_levelSizes.empty()) {
+		addToQueue(kQueueStreamingTexture);
+		return;
+	}
+
+	// OpenGL has its own copy now. If we can read the image again when needed, drop ours
+	dropImage();
+}
+
+uint32 Texture::uploadMipMap(uint32 level) {
+	const ImageDecoder::MipMap &mipMap = _image->getMipMap(level);
+
 	if (_image->isCompressed()) {
 		// Compressed texture data
 
-		for (uint32 i = 0; i < _image->getMipMapCount(); i++) {
-			const ImageDecoder::MipMap &mipMap = _image->getMipMap(i);
-
-			glCompressedTexImage2D(GL_TEXTURE_2D, i, _image->getFormatRaw(),
-			                       mipMap.width, mipMap.height, 0,
-			                       mipMap.size, mipMap.data);
-		}
+		glCompressedTexImage2D(GL_TEXTURE_2D, level, _image->getFormatRaw(),
+		                       mipMap.width, mipMap.height, 0,
+		                       mipMap.size, mipMap.data);
 
 	} else {
 		// Uncompressed texture data
 
-		for (uint32 i = 0; i < _image->getMipMapCount(); i++) {
-			const ImageDecoder::MipMap &mipMap = _image->getMipMap(i);
+		glTexImage2D(GL_TEXTURE_2D, level, _image->getFormatRaw(),
+		             mipMap.width, mipMap.height, 0, _image->getFormat(),
+		             _image->getDataType(), mipMap.data);
+
+	}
+
+	return mipMap.size;
+}
+
+void Texture::allowStreaming() {
+	_streamable = true;
+}
+
+void Texture::requestSize(uint32 pixels) {
+	// Only the largest request counts. Should two requests race, the loser repeats it next frame anyway
+	if (pixels > _wantedSize)
+		_wantedSize = pixels;
+}
+
+uint32 Texture::getWantedLevel(uint32 levelCount) const {
+	const uint32 wanted = _wantedSize;
+
+	/* Go down to the smallest mip map that still has at least as many texels as requested
+	 * pixels. Each mip map halves the size, so this works without the image, too. */
+	uint32 level = 0;
+	while ((level + 1) < levelCount) {
+		const uint32 size = MAX<uint32>(MAX<uint32>(_width >> (level + 1), _height >> (level + 1)), 1);
+		if (size < wanted)
+			break;
+
+		level++;
+	}
+
+	return level;
+}
+
+uint32 Texture::getStreamingBaseLevel(uint32 levelCount) const {
+	uint32 level = 0;
+	while ((level + 1) < levelCount) {
+		const uint32 size = MAX<uint32>(_width >> level, _height >> level);
+		if (size <= kStreamingBaseSize)
+			break;
+
+		level++;
+	}
+
+	return level;
+}
+
+uint32 Texture::getStreamingLevel(uint32 levelCount) const {
+	// Don't bother with the small ones first if the larger ones are already wanted
+	return MIN(getStreamingBaseLevel(levelCount), getWantedLevel(levelCount));
+}
 
-			glTexImage2D(GL_TEXTURE_2D, i, _image->getFormatRaw(),
-			             mipMap.width, mipMap.height, 0, _image->getFormat(),
-			             _image->getDataType(), mipMap.data);
+void Texture::stream(uint32 &budget) {
+	if (!_uploaded || _levelSizes.empty()) {
+		removeFromQueue(kQueueStreamingTexture);
+		return;
+	}
+
+	const uint32 levelCount = _levelSizes.size();
+	const uint32 wanted     = getStreamingLevel(levelCount);
+
+	// Visible models request their texture detail anew every frame. Let the others fade out
+	_wantedSize = _wantedSize / 2;
+
+	if (wanted != _wantedLevel) {
+		_wantedLevel  = wanted;
+		_stableFrames = 0;
+	} else if (_stableFrames < kStreamingStableFrames)
+		_stableFrames++;
+
+	const bool stable = _stableFrames >= kStreamingStableFrames;
+
+	if (wanted < _baseLevel) {
+		if (budget == 0)
+			return;
+
+		// We dropped the image earlier. Wait until it's read again
+		if (startReread())
+			return;
+
+		if (!restoreImage()) {
+			_levelSizes.clear();
+			removeFromQueue(kQueueStreamingTexture);
+			return;
 		}
 
+		glBindTexture(GL_TEXTURE_2D, _textureID);
+
+		// Upload the next larger levels while the budget lasts. The last one may overdraw it
+		while ((_baseLevel > wanted) && (budget > 0)) {
+			const uint32 size = uploadMipMap(--_baseLevel);
+
+			_uploadedSize += size;
+			budget        -= MIN(budget, size);
+		}
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, _baseLevel);
+
+		memoryChanged();
+
+		// Out of budget, continue next frame
+		if (_baseLevel > wanted)
+			return;
+
+	} else if ((wanted > _baseLevel) && stable)
+		// Less detail has been enough for a while now, so free the larger levels
+		evictMipMaps(wanted);
+
+	/* Once the wanted detail settled, drop the image until it changes again.
+	 * Until then, keep it, so that going back and forth doesn't read it every time. */
+	if (stable && (_baseLevel == wanted))
+		dropImage();
+}
+
+void Texture::evictMipMaps(uint32 level) {
+	glBindTexture(GL_TEXTURE_2D, _textureID);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+
+	// Levels below the base level don't need to be complete. Making them empty frees their memory
+	for (; _baseLevel < level; _baseLevel++) {
+		glTexImage2D(GL_TEXTURE_2D, _baseLevel, GL_RGBA, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+
+		_uploadedSize -= MIN(_uploadedSize, _levelSizes[_baseLevel]);
 	}
 
+	memoryChanged();
+}
+
+uint32 Texture::getMipMapLevels(uint32 width, uint32 height) {
+	uint32 levels = 1;
+
+	while ((width > 1) || (height > 1)) {
+		width  = MAX<uint32>(width  / 2, 1);
+		height = MAX<uint32>(height / 2, 1);
+
+		levels++;
+	}
+
+	return levels;
+}
+
+uint32 Texture::uploadMipMaps() {
+	// Downsample each mip map from the one before, only keeping the last one around
+
+	ImageDecoder::MipMap mipMaps[2];
+
+	const ImageDecoder::MipMap *last = &_image->getMipMap(0);
+
+	uint32 size = 0;
+	for (uint32 i = 1; (last->width > 1) || (last->height > 1); i++) {
+		ImageDecoder::MipMap &mipMap = mipMaps[i & 1];
+
+		delete[] mipMap.data;
+		mipMap.data = 0;
+
+		ImageDecoder::downsample(mipMap, *last, _image->getFormat());
+
+		glTexImage2D(GL_TEXTURE_2D, i, _image->getFormatRaw(),
+		             mipMap.width, mipMap.height, 0, _image->getFormat(),
+		             _image->getDataType(), mipMap.data);
+
+		size += mipMap.size;
+		last  = &mipMap;
+	}
+
+	return size;
 }
 
 const TXI &Texture::getTXI() const {
+	waitDecoded();
+
 	return *_txi;
 }
 
 bool Texture::reload(ImageDecoder *image, const TXI *txi) {
+	TextureMan.stopDecoding(*this);
+	_rereading = false;
+
+	removeFromQueue(kQueueStreamingTexture);
 	removeFromQueue(kQueueNewTexture);
 	removeFromQueue(kQueueTexture);
 
+	// Drop what might still be waiting to be decoded
+	delete _txiStream;
+	delete _imageStream;
+
+	_txiStream   = 0;
+	_imageStream = 0;
+
 	if (txi) {
 		delete _txi;
 		_txi = new TXI(*txi);
@@ -290,13 +833,25 @@ bool Texture::reload(const Common::UString &name) {
 		// Yeah, we don't know the resource name, so we can't reload the texture
 		return false;
 
+	TextureMan.stopDecoding(*this);
+	_rereading = false;
+
+	removeFromQueue(kQueueStreamingTexture);
 	removeFromQueue(kQueueNewTexture);
 	removeFromQueue(kQueueTexture);
 
+	// Drop what might still be waiting to be decoded
+	delete _txiStream;
+	delete _imageStream;
+
+	_txiStream   = 0;
+	_imageStream = 0;
+
 	delete _txi;
 	delete _image;
 
-	_txi = new TXI();
+	_txi   = new TXI();
+	_image = 0;
 
 	load(_name);
 
@@ -307,10 +862,43 @@ bool Texture::reload(const Common::UString &name) {
 }
 
 bool Texture::dumpTGA(const Common::UString &fileName) const {
-	if (!_image)
+	waitDecoded();
+
+	Common::StackLock lock(_decodeMutex);
+
+	if (_image)
+		return _image->dumpTGA(fileName);
+
+	// The image was dropped after the upload, temporarily read it again
+	ImageDecoder *image = readImage();
+	if (!image)
 		return false;
 
-	return _image->dumpTGA(fileName);
+	bool success = image->dumpTGA(fileName);
+
+	delete image;
+	return success;
+}
+
+uint32 Texture::getUploadedSize() const {
+	return _uploadedSize;
+}
+
+uint32 Texture::getDataSize() const {
+	Common::StackLock lock(_decodeMutex);
+
+	uint32 size = 0;
+
+	if (_image)
+		size += _image->getDataSize();
+
+	// Data still waiting to be decoded
+	if (_imageStream)
+		size += _imageStream->size();
+	if (_txiStream)
+		size += _txiStream->size();
+
+	return size;
 }
 
 } // End of namespace Aurora
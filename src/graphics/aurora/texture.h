@@ -30,13 +30,18 @@
 #ifndef GRAPHICS_AURORA_TEXTURE_H
 #define GRAPHICS_AURORA_TEXTURE_H
 
+#include <vector>
+
 #include "common/ustring.h"
+#include "common/mutex.h"
 
 #include "graphics/types.h"
 #include "graphics/texture.h"
 
 #include "aurora/types.h"
 
+#include "graphics/aurora/texturefilecache.h"
+
 namespace Common {
 	class SeekableReadStream;
 }
@@ -73,6 +78,22 @@ public:
 	/** Dump the texture into a TGA. */
 	bool dumpTGA(const Common::UString &fileName) const;
 
+	/** Return the number of bytes of image data currently held in memory. */
+	uint32 getDataSize() const;
+	/** Return the number of bytes of image data uploaded to OpenGL. */
+	uint32 getUploadedSize() const;
+
+	/** Only upload the smaller mip maps at first, and stream the larger ones in and out as requested. */
+	void allowStreaming();
+	/** Request enough detail for the texture to cover that many pixels on the screen.
+	 *
+	 *  Requests fade out after a few frames, so they need to be repeated every frame.
+	 */
+	void requestSize(uint32 pixels);
+
+	// Graphics::Texture
+	void stream(uint32 &budget);
+
 protected:
 	// GLContainer
 	void doRebuild();
@@ -91,15 +112,104 @@ private:
 	uint32 _width;
 	uint32 _height;
 
+	bool _hasAlpha;
+
+	/** Can the image be read again from the resource, after we dropped it? */
+	bool _fromResource;
+
+	TextureCacheKey _cacheKey; ///< The texture's file in the texture cache, if it can be cached.
+
+	Common::SeekableReadStream *_imageStream; ///< The image data still to be decoded.
+	Common::SeekableReadStream *_txiStream;   ///< The TXI data still to be read.
+
+	bool _imageCached; ///< Is the image data to be decoded from the texture cache?
+
+	volatile bool _decoded;   ///< Have image and TXI been decoded?
+	volatile bool _rereading; ///< Is the dropped image being read again in the background?
+
+	bool _uploaded; ///< Has the image been uploaded to OpenGL, instead of a placeholder?
+
+	uint32 _uploadedSize; ///< The number of bytes uploaded to OpenGL, including mip maps.
+
+	volatile bool   _streamable; ///< May the larger mip maps be uploaded only once needed?
+	volatile uint32 _wantedSize; ///< The largest on-screen size in pixels requested recently.
+
+	uint32 _baseLevel; ///< The largest mip map level uploaded to OpenGL.
+
+	/** The size of each mip map level, while the texture is streamed. */
+	std::vector<uint32> _levelSizes;
+
+	uint32 _wantedLevel;  ///< The mip map level wanted during the last frames.
+	uint32 _stableFrames; ///< The number of frames the wanted level stayed the same.
+
+	/** Is the texture unreferenced, and only kept for reuse by the texture manager? */
+	volatile bool _released;
+
+	/** Should the next upload copy the image into the texture atlas? */
+	volatile bool _wantAtlas;
+
+	/** Protects decoding, dropping and restoring the image. */
+	mutable Common::Mutex _decodeMutex;
+
 	void load(const Common::UString &name);
 	void load(ImageDecoder *image);
 
 	void loadTXI(Common::SeekableReadStream *stream);
 	void loadImage();
 
-	TextureID getID() const;
+	/** Decode the image and TXI data, if that hasn't happened yet. */
+	void decode();
+	/** Make sure the texture is decoded before looking at its properties. */
+	void waitDecoded() const;
+
+	/** Create an image decoder for the image in this stream. */
+	ImageDecoder *createImage(Common::SeekableReadStream &stream, bool cached) const;
+	/** Read the image from the resource again. */
+	ImageDecoder *readImage() const;
+
+	/** Tell the texture manager that we now hold a different amount of memory, if it cares. */
+	void memoryChanged();
+
+	/** Drop the image data, if it can be restored later. */
+	void dropImage();
+	/** Restore the image data we dropped. The image is read without holding the decode lock. */
+	bool restoreImage();
+	/** Have the decoding threads read the image we dropped again.
+	 *
+	 *  @return true if that's happening, false if there's nothing to
+	 *          read or there are no decoding threads.
+	 */
+	bool startReread();
+	/** Restore the image data we dropped, then queue the texture for the upload if needed. */
+	void reread();
+
+	/** Upload the texture again, copying it into the texture atlas while we have the image. */
+	void requestAtlas();
+
+	void uploadPlaceholder();
+	/** Upload this mip map level of the image, returning its size. */
+	uint32 uploadMipMap(uint32 level);
+	/** Generate and upload the mip maps of a single-level image, returning their size. */
+	uint32 uploadMipMaps();
+
+	/** Return the smallest of these mip map levels that still fulfills the requested size. */
+	uint32 getWantedLevel(uint32 levelCount) const;
+	/** Return the largest mip map level that's at most as large as a streamed texture starts out. */
+	uint32 getStreamingBaseLevel(uint32 levelCount) const;
+	/** Return the mip map level to start a streamed upload with. */
+	uint32 getStreamingLevel(uint32 levelCount) const;
+
+	/** Free the mip map levels larger than this one. */
+	void evictMipMaps(uint32 level);
+
+	/** Return the number of mip map levels down to 1x1 for an image of that size. */
+	static uint32 getMipMapLevels(uint32 width, uint32 height);
+
+	TextureID getID();
 
 	friend class TextureManager;
+	friend class TextureLoader;
+	friend class TextureAtlas;
 };
 
 } // End of namespace Aurora
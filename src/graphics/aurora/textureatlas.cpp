@@ -0,0 +1,339 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey and Eclipse engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/aurora/textureatlas.cpp
+ *  Shared pages of small GUI textures.
+ */
+
+#include "common/util.h"
+
+#include "graphics/graphics.h"
+
+#include "graphics/images/txi.h"
+#include "graphics/images/decoder.h"
+
+#include "graphics/aurora/textureatlas.h"
+#include "graphics/aurora/texture.h"
+
+/** Width and height of an atlas page, if the GPU supports textures that big. */
+static const uint32 kPageSize = 1024;
+/** Maximum number of atlas pages. */
+static const uint32 kMaxPages = 4;
+
+namespace Graphics {
+
+namespace Aurora {
+
+void AtlasRegion::map(float &u, float &v) const {
+	u = x + u * width;
+	v = y + v * height;
+}
+
+
+TextureAtlas::TextureAtlas() : _maxTextureSize(0), _pageSize(0), _usedArea(0) {
+}
+
+TextureAtlas::~TextureAtlas() {
+	for (std::vector<Page>::iterator p = _pages.begin(); p != _pages.end(); ++p)
+		GfxMan.abandon(&p->id, 1);
+}
+
+void TextureAtlas::setMaxTextureSize(uint32 size) {
+	Common::StackLock lock(_mutex);
+
+	_maxTextureSize = size;
+
+	clear();
+}
+
+const AtlasRegion *TextureAtlas::get(const Texture &texture) {
+	Common::StackLock lock(_mutex);
+
+	EntryMap::const_iterator e = _entries.find(&texture);
+	if ((e == _entries.end()) || !e->second.placed)
+		return 0;
+
+	return &e->second.region;
+}
+
+bool TextureAtlas::has(const Texture &texture) {
+	Common::StackLock lock(_mutex);
+
+	// Nothing fits into a disabled atlas
+	if (_maxTextureSize == 0)
+		return true;
+
+	return _entries.find(&texture) != _entries.end();
+}
+
+void TextureAtlas::add(const Texture &texture, const ImageDecoder &image) {
+	Common::StackLock lock(_mutex);
+
+	if (_maxTextureSize == 0)
+		return;
+
+	const uint32 width  = texture._width  + 2;
+	const uint32 height = texture._height + 2;
+
+	uint32 page, x, y;
+	bool found = canPlace(texture, image) && allocate(width, height, page, x, y);
+
+	/* If the pages are full, but mostly of textures that are gone by now, start over.
+	 * The textures still drawn through the atlas then ask to be copied in again. */
+	if (!found && canPlace(texture, image) && (_pages.size() == kMaxPages) &&
+	    (_usedArea < ((kMaxPages * _pageSize * _pageSize) / 2))) {
+
+		clear();
+
+		found = allocate(width, height, page, x, y);
+	}
+
+	if (!found) {
+		// Remember that it doesn't fit, so it's not uploaded again for us
+		Entry &rejected = _entries[&texture];
+
+		rejected.placed = false;
+		rejected.area   = 0;
+
+		return;
+	}
+
+	copy(image, _pages[page], x, y);
+
+	Entry &placed = _entries[&texture];
+
+	placed.placed = true;
+	placed.area   = width * height;
+
+	placed.region.page   = _pages[page].id;
+	placed.region.x      = (x + 1.0f) / _pageSize;
+	placed.region.y      = (y + 1.0f) / _pageSize;
+	placed.region.width  = ((float) texture._width ) / _pageSize;
+	placed.region.height = ((float) texture._height) / _pageSize;
+
+	_usedArea += placed.area;
+}
+
+void TextureAtlas::remove(const Texture &texture) {
+	Common::StackLock lock(_mutex);
+
+	EntryMap::iterator e = _entries.find(&texture);
+	if (e == _entries.end())
+		return;
+
+	_usedArea -= e->second.area;
+
+	_entries.erase(e);
+}
+
+void TextureAtlas::getStats(uint32 &pages, uint32 &textures) {
+	Common::StackLock lock(_mutex);
+
+	pages    = _pages.size();
+	textures = 0;
+
+	for (EntryMap::const_iterator e = _entries.begin(); e != _entries.end(); ++e)
+		if (e->second.placed)
+			textures++;
+}
+
+bool TextureAtlas::canPlace(const Texture &texture, const ImageDecoder &image) const {
+	if ((texture._width == 0) || (texture._height == 0))
+		return false;
+
+	// Streamed textures change their detail all the time
+	if (!texture._levelSizes.empty())
+		return false;
+
+	// We'd need to decompress the texture first, making it bigger than it was
+	if (image.isCompressed() || (image.getDataType() != kPixelDataType8))
+		return false;
+
+	if ((image.getFormat() != kPixelFormatRGBA) && (image.getFormat() != kPixelFormatBGRA) &&
+	    (image.getFormat() != kPixelFormatRGB ) && (image.getFormat() != kPixelFormatBGR ))
+		return false;
+
+	const ImageDecoder::MipMap &mipMap = image.getMipMap(0);
+	if ((mipMap.width != (int) texture._width) || (mipMap.height != (int) texture._height))
+		return false;
+
+	if ((texture._width > _maxTextureSize) || (texture._height > _maxTextureSize))
+		return false;
+
+	// The pages are always filtered
+	if (!texture._txi->getFeatures().filter)
+		return false;
+
+	return true;
+}
+
+bool TextureAtlas::allocate(uint32 width, uint32 height, uint32 &page, uint32 &x, uint32 &y) {
+	for (page = 0; ; page++) {
+		if ((page == _pages.size()) && !addPage())
+			return false;
+
+		if ((width > _pageSize) || (height > _pageSize))
+			return false;
+
+		Page &p = _pages[page];
+
+		// Start a new shelf if the texture doesn't fit into the current one
+		if ((p.shelfX + width) > _pageSize) {
+			if ((p.shelfY + p.shelfHeight + height) > _pageSize)
+				continue;
+
+			p.shelfX      = 0;
+			p.shelfY     += p.shelfHeight;
+			p.shelfHeight = 0;
+		}
+
+		if ((p.shelfY + height) > _pageSize)
+			continue;
+
+		x = p.shelfX;
+		y = p.shelfY;
+
+		p.shelfX     += width;
+		p.shelfHeight = MAX(p.shelfHeight, height);
+
+		return true;
+	}
+
+	return false;
+}
+
+bool TextureAtlas::addPage() {
+	if (_pages.size() >= kMaxPages)
+		return false;
+
+	if (_pages.empty()) {
+		// Make sure we're told when the OpenGL context goes away
+		rebuild();
+
+		GLint maxSize;
+		glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+
+		_pageSize = MIN<uint32>(kPageSize, maxSize);
+	}
+
+	_pages.push_back(Page());
+
+	Page &page = _pages.back();
+
+	page.shelfX      = 0;
+	page.shelfY      = 0;
+	page.shelfHeight = 0;
+
+	glGenTextures(1, &page.id);
+	glBindTexture(GL_TEXTURE_2D, page.id);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_FALSE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, _pageSize, _pageSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+
+	return true;
+}
+
+void TextureAtlas::copy(const ImageDecoder &image, const Page &page, uint32 x, uint32 y) {
+	const ImageDecoder::MipMap &mipMap = image.getMipMap(0);
+
+	const uint32 width  = mipMap.width;
+	const uint32 height = mipMap.height;
+
+	const PixelFormat format = image.getFormat();
+
+	const uint32 bpp = ((format == kPixelFormatRGBA) || (format == kPixelFormatBGRA)) ? 4 : 3;
+	const bool   bgr = (format == kPixelFormatBGRA) || (format == kPixelFormatBGR);
+
+	// Convert the pixels to RGBA, surrounded with a border of the edge pixels
+
+	const uint32 borderWidth  = width  + 2;
+	const uint32 borderHeight = height + 2;
+
+	byte *bordered = new byte[borderWidth * borderHeight * 4];
+
+	for (uint32 i = 0; i < borderHeight; i++) {
+		const byte *src  = mipMap.data + CLIP<int32>(i - 1, 0, height - 1) * width * bpp;
+		byte       *dest = bordered + i * borderWidth * 4;
+
+		for (uint32 j = 0; j < borderWidth; j++, dest += 4) {
+			const byte *pixel = src + CLIP<int32>(j - 1, 0, width - 1) * bpp;
+
+			dest[0] = pixel[bgr ? 2 : 0];
+			dest[1] = pixel[1];
+			dest[2] = pixel[bgr ? 0 : 2];
+			dest[3] = (bpp == 4) ? pixel[3] : 0xFF;
+		}
+	}
+
+	glBindTexture(GL_TEXTURE_2D, page.id);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, borderWidth, borderHeight, GL_RGBA, GL_UNSIGNED_BYTE, bordered);
+
+	delete[] bordered;
+}
+
+void TextureAtlas::clear() {
+	_entries.clear();
+
+	_usedArea = 0;
+
+	for (std::vector<Page>::iterator p = _pages.begin(); p != _pages.end(); ++p) {
+		p->shelfX      = 0;
+		p->shelfY      = 0;
+		p->shelfHeight = 0;
+	}
+}
+
+void TextureAtlas::doRebuild() {
+	Common::StackLock lock(_mutex);
+
+	// Any pages we still know of went away with the old context
+	_pages.clear();
+
+	clear();
+}
+
+void TextureAtlas::doDestroy() {
+	Common::StackLock lock(_mutex);
+
+	for (std::vector<Page>::iterator p = _pages.begin(); p != _pages.end(); ++p)
+		glDeleteTextures(1, &p->id);
+
+	_pages.clear();
+
+	clear();
+}
+
+} // End of namespace Aurora
+
+} // End of namespace Graphics
@@ -0,0 +1,162 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey and Eclipse engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/aurora/textureatlas.h
+ *  Shared pages of small GUI textures.
+ */
+
+#ifndef GRAPHICS_AURORA_TEXTUREATLAS_H
+#define GRAPHICS_AURORA_TEXTUREATLAS_H
+
+#include <vector>
+#include <map>
+
+#include "common/types.h"
+#include "common/mutex.h"
+
+#include "graphics/types.h"
+#include "graphics/glcontainer.h"
+
+namespace Graphics {
+
+class ImageDecoder;
+
+namespace Aurora {
+
+class Texture;
+
+/** The place of a texture within an atlas page. */
+struct AtlasRegion {
+	TextureID page; ///< The OpenGL texture of the page.
+
+	float x;      ///< Texture coordinate of the texture's left edge within the page.
+	float y;      ///< Texture coordinate of the texture's bottom edge within the page.
+	float width;  ///< Width of the texture in page texture coordinates.
+	float height; ///< Height of the texture in page texture coordinates.
+
+	/** Map texture coordinates of the texture into coordinates within the page. */
+	void map(float &u, float &v) const;
+};
+
+/** Packs small GUI textures into a few big pages.
+ *
+ *  A GUI screen consists of lots of small quads and glyphs, each with
+ *  its own texture. Copying these textures into shared pages lets
+ *  consecutive quads use the same texture binding.
+ *
+ *  A texture drawn through the atlas is copied into it with its next
+ *  upload, out of its decoded image. Compressed textures are never
+ *  placed into the atlas. Each texture gets a border of its replicated
+ *  edge pixels, so that filtering doesn't bleed in pixels of its
+ *  neighbours.
+ *
+ *  The pages are packed in shelves and space is never reused. When all
+ *  pages are full and most of their space is taken up by textures that
+ *  were since deleted or changed, the whole atlas is cleared and filled
+ *  anew.
+ */
+class TextureAtlas : public GLContainer {
+public:
+	TextureAtlas();
+	~TextureAtlas();
+
+	/** Set the maximum width and height of textures to place into the atlas. 0 disables the atlas. */
+	void setMaxTextureSize(uint32 size);
+
+	/** Return the region of this texture, or 0 if it's not in the atlas. */
+	const AtlasRegion *get(const Texture &texture);
+	/** Was this texture already placed into the atlas, or found not to fit?
+	 *
+	 *  Always true while the atlas is disabled.
+	 */
+	bool has(const Texture &texture);
+
+	/** Copy this decoded image of the texture into the atlas, if it fits.
+	 *
+	 *  May only be called from the main thread.
+	 */
+	void add(const Texture &texture, const ImageDecoder &image);
+
+	/** Forget this texture, because it changed or will be deleted. */
+	void remove(const Texture &texture);
+
+	/** Return the number of pages and the number of textures in them. */
+	void getStats(uint32 &pages, uint32 &textures);
+
+protected:
+	// GLContainer
+	void doRebuild();
+	void doDestroy();
+
+private:
+	/** A page of the atlas. */
+	struct Page {
+		TextureID id;
+
+		uint32 shelfX;      ///< Where the next texture in the current shelf goes.
+		uint32 shelfY;      ///< The bottom of the current shelf.
+		uint32 shelfHeight; ///< The height of the current shelf.
+	};
+
+	/** A texture known to the atlas. */
+	struct Entry {
+		bool placed; ///< Did the texture get a place? If not, we don't try again.
+		uint32 area; ///< The number of pixels the texture takes up, including the border.
+
+		AtlasRegion region;
+	};
+
+	typedef std::map<const Texture *, Entry> EntryMap;
+
+	uint32 _maxTextureSize;
+	uint32 _pageSize;
+
+	std::vector<Page> _pages;
+
+	EntryMap _entries;
+
+	uint32 _usedArea; ///< The number of page pixels taken up by the textures still in the atlas.
+
+	Common::Mutex _mutex;
+
+	/** Can this image of the texture be placed into the atlas at all? */
+	bool canPlace(const Texture &texture, const ImageDecoder &image) const;
+
+	/** Find room for a rectangle of that size. */
+	bool allocate(uint32 width, uint32 height, uint32 &page, uint32 &x, uint32 &y);
+	/** Add a new, empty page. */
+	bool addPage();
+
+	/** Copy the image's pixels into this place of a page. */
+	void copy(const ImageDecoder &image, const Page &page, uint32 x, uint32 y);
+
+	void clear();
+};
+
+} // End of namespace Aurora
+
+} // End of namespace Graphics
+
+#endif // GRAPHICS_AURORA_TEXTUREATLAS_H
@@ -0,0 +1,145 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey and Eclipse engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/aurora/texturefilecache.cpp
+ *  A directory of decoded textures, kept across runs.
+ */
+
+#include <cstdio>
+
+#include "common/util.h"
+#include "common/error.h"
+#include "common/stream.h"
+#include "common/filepath.h"
+
+#include "aurora/resman.h"
+
+#include "graphics/images/decoder.h"
+#include "graphics/images/xtc.h"
+
+#include "graphics/aurora/texturefilecache.h"
+#include "graphics/aurora/cachefile.h"
+
+namespace Graphics {
+
+namespace Aurora {
+
+TextureCacheKey::TextureCacheKey() : type(::Aurora::kFileTypeNone) {
+}
+
+
+TextureFileCache::TextureFileCache() : _hits(0), _misses(0) {
+}
+
+TextureFileCache::~TextureFileCache() {
+}
+
+void TextureFileCache::setDirectory(const Common::UString &directory) {
+	Common::StackLock lock(_mutex);
+
+	_directory.clear();
+	if (directory.empty())
+		return;
+
+	if (!Common::FilePath::createDirectories(directory)) {
+		warning("Can't create texture cache directory \"%s\"", directory.c_str());
+		return;
+	}
+
+	_directory = Common::FilePath::normalize(directory);
+}
+
+bool TextureFileCache::isEnabled() const {
+	return !_directory.empty();
+}
+
+bool TextureFileCache::getKey(const Common::UString &name, TextureCacheKey &key) {
+	if (!isEnabled())
+		return false;
+
+	::Aurora::ResourceManager::ResourceOrigin origin;
+	if (!ResMan.getResourceOrigin(::Aurora::kResourceImage, name, origin))
+		return false;
+
+	Common::UString lowerName = name;
+	lowerName.tolower();
+
+	if (!getCacheFile(_directory, lowerName, "xtc", origin, key.file, key.key))
+		return false;
+
+	// A cache file written in a different XTC version doesn't match the key, and is replaced
+	key.key  = Common::UString::sprintf("XTC%u|", XTC::getVersion()) + key.key;
+	key.type = origin.type;
+	return true;
+}
+
+Common::SeekableReadStream *TextureFileCache::read(const TextureCacheKey &key) {
+	Common::SeekableReadStream *stream = readCacheFile(key.file, key.key);
+
+	Common::StackLock lock(_mutex);
+
+	if (stream)
+		_hits++;
+	else
+		_misses++;
+
+	return stream;
+}
+
+void TextureFileCache::write(const TextureCacheKey &key, const ImageDecoder &image) {
+	Common::MemoryWriteStreamDynamic xtc(true);
+
+	try {
+		XTC::write(xtc, image);
+	} catch (Common::Exception &e) {
+		e.add("Failed writing texture cache file \"%s\"", key.file.c_str());
+		Common::printException(e, "WARNING: ");
+		return;
+	}
+
+	writeCacheFile(key.file, key.key, xtc.getData(), xtc.size());
+}
+
+void TextureFileCache::remove(const TextureCacheKey &key) {
+	std::remove(key.file.c_str());
+}
+
+void TextureFileCache::resetStats() {
+	Common::StackLock lock(_mutex);
+
+	_hits   = 0;
+	_misses = 0;
+}
+
+void TextureFileCache::getStats(uint32 &hits, uint32 &misses) {
+	Common::StackLock lock(_mutex);
+
+	hits   = _hits;
+	misses = _misses;
+}
+
+} // End of namespace Aurora
+
+} // End of namespace Graphics
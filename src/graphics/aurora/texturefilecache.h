@@ -0,0 +1,121 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey and Eclipse engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/aurora/texturefilecache.h
+ *  A directory of decoded textures, kept across runs.
+ */
+
+#ifndef GRAPHICS_AURORA_TEXTUREFILECACHE_H
+#define GRAPHICS_AURORA_TEXTUREFILECACHE_H
+
+#include "common/types.h"
+#include "common/ustring.h"
+#include "common/mutex.h"
+
+#include "aurora/types.h"
+
+namespace Common {
+	class SeekableReadStream;
+}
+
+namespace Graphics {
+
+class ImageDecoder;
+
+namespace Aurora {
+
+/** The cache file of an image resource. */
+struct TextureCacheKey {
+	Common::UString file; ///< The path of the cache file.
+	Common::UString key;  ///< Identifies the resource data the cache file was created from.
+
+	::Aurora::FileType type; ///< The type of the image resource.
+
+	TextureCacheKey();
+};
+
+/** A directory of decoded textures, kept across runs.
+ *
+ *  Decoding a texture can take a lot of work: parsing the image format,
+ *  deswizzling, decompressing S3TC data when the driver can't, and
+ *  generating mip maps. The result is written into a cache file, in the
+ *  XTC format, that can be uploaded to OpenGL as it is.
+ *
+ *  A cache file is identified by the file the resource is read from, the
+ *  resource's place and size within that file, and the file's modification
+ *  time, as well as the version of the XTC format. If any of these changes,
+ *  the cache file is ignored and replaced once the texture has been
+ *  decoded anew.
+ *
+ *  The cache is disabled until a directory has been set.
+ */
+class TextureFileCache {
+public:
+	TextureFileCache();
+	~TextureFileCache();
+
+	/** Set the directory holding the cache files. An empty path disables the cache. */
+	void setDirectory(const Common::UString &directory);
+
+	/** Is the cache enabled? */
+	bool isEnabled() const;
+
+	/** Find the cache file for the image resource with that name.
+	 *
+	 *  Returns false if the cache is disabled, or if the resource can't be
+	 *  cached, because its data isn't read directly from a file.
+	 */
+	bool getKey(const Common::UString &name, TextureCacheKey &key);
+
+	/** Read a cache file with one single read, if it exists and is still current.
+	 *
+	 *  The returned stream is positioned at the start of the XTC data.
+	 */
+	Common::SeekableReadStream *read(const TextureCacheKey &key);
+
+	/** Write a decoded image into its cache file. */
+	void write(const TextureCacheKey &key, const ImageDecoder &image);
+	/** Remove a cache file, because it turned out to be broken. */
+	void remove(const TextureCacheKey &key);
+
+	/** Reset the counts of cache hits and misses. */
+	void resetStats();
+	/** Get the counts of cache hits and misses since the last reset. */
+	void getStats(uint32 &hits, uint32 &misses);
+
+private:
+	Common::UString _directory;
+
+	uint32 _hits;   ///< Textures read out of the cache since the last reset.
+	uint32 _misses; ///< Textures not found in the cache since the last reset.
+
+	Common::Mutex _mutex;
+};
+
+} // End of namespace Aurora
+
+} // End of namespace Graphics
+
+#endif // GRAPHICS_AURORA_TEXTUREFILECACHE_H
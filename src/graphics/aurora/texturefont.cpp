@@ -89,13 +89,17 @@ void TextureFont::draw(uint32 c) const {
 		return;
 	}
 
-	TextureMan.set(_texture);
+	const AtlasRegion *region = TextureMan.setAtlased(_texture);
 
 	const Char &cC = _chars[c];
 
 	glBegin(GL_QUADS);
 	for (int i = 0; i < 4; i++) {
-		glTexCoord2f(cC.tX[i], cC.tY[i]);
+		float tX = cC.tX[i], tY = cC.tY[i];
+		if (region)
+			region->map(tX, tY);
+
+		glTexCoord2f(tX, tY);
 		glVertex2f  (cC.vX[i], cC.vY[i]);
 	}
 	glEnd();
@@ -0,0 +1,173 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey and Eclipse engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/aurora/textureloader.cpp
+ *  Decoding textures in the background.
+ */
+
+#include <algorithm>
+
+#include "common/util.h"
+
+#include "graphics/aurora/textureloader.h"
+#include "graphics/aurora/texture.h"
+
+namespace Graphics {
+
+namespace Aurora {
+
+TextureLoader::Worker::Worker(TextureLoader &loader) : _loader(&loader) {
+}
+
+TextureLoader::Worker::~Worker() {
+	destroyThread();
+}
+
+void TextureLoader::Worker::threadMethod() {
+	while (!_killThread) {
+		Texture *texture = _loader->take();
+		if (!texture) {
+			_loader->wait();
+			continue;
+		}
+
+		// A decoded texture is only queued again to read the image it dropped
+		if (texture->_decoded)
+			texture->reread();
+		else
+			texture->decode();
+
+		_loader->finish(*texture);
+	}
+}
+
+
+TextureLoader::TextureLoader() {
+}
+
+TextureLoader::~TextureLoader() {
+	stop();
+}
+
+void TextureLoader::start(uint threadCount) {
+	stop();
+
+	for (uint i = 0; i < threadCount; i++) {
+		Worker *worker = new Worker(*this);
+
+		if (!worker->createThread()) {
+			warning("Failed to create a texture decoding thread");
+			delete worker;
+			break;
+		}
+
+		_workers.push_back(worker);
+	}
+}
+
+void TextureLoader::stop() {
+	for (std::vector<Worker *>::iterator w = _workers.begin(); w != _workers.end(); ++w)
+		delete *w;
+
+	_workers.clear();
+
+	/* Nobody decodes the textures left in the queue now. They're decoded on demand instead.
+	 * Those waiting for their image to be read again, do that in their next rebuild. */
+	Common::StackLock lock(_mutex);
+
+	for (std::list<Texture *>::iterator t = _queue.begin(); t != _queue.end(); ++t) {
+		if ((*t)->_decoded) {
+			(*t)->_rereading = false;
+			(*t)->addToQueue(kQueueNewTexture);
+		}
+	}
+
+	_queue.clear();
+}
+
+bool TextureLoader::isRunning() const {
+	return !_workers.empty();
+}
+
+void TextureLoader::add(Texture &texture) {
+	_mutex.lock();
+
+	// Rebuilding all textures might queue one still waiting again
+	if (std::find(_queue.begin(), _queue.end(), &texture) == _queue.end())
+		_queue.push_back(&texture);
+
+	_mutex.unlock();
+
+	_newTexture.signal();
+}
+
+void TextureLoader::remove(Texture &texture) {
+	_mutex.lock();
+
+	_queue.remove(&texture);
+
+	// If a thread is currently decoding the texture, wait until it's done
+	while (isDecoding(texture)) {
+		_mutex.unlock();
+		_decoded.wait(1);
+		_mutex.lock();
+	}
+
+	_mutex.unlock();
+}
+
+Texture *TextureLoader::take() {
+	Common::StackLock lock(_mutex);
+
+	if (_queue.empty())
+		return 0;
+
+	Texture *texture = _queue.front();
+
+	_queue.pop_front();
+	_decoding.push_back(texture);
+
+	return texture;
+}
+
+void TextureLoader::finish(Texture &texture) {
+	_mutex.lock();
+	_decoding.remove(&texture);
+	_mutex.unlock();
+
+	_decoded.signal();
+}
+
+void TextureLoader::wait() {
+	_newTexture.wait(10);
+}
+
+bool TextureLoader::isDecoding(Texture &texture) const {
+	return std::find(_decoding.begin(), _decoding.end(), &texture) != _decoding.end();
+}
+
+} // End of namespace Aurora
+
+} // End of namespace Graphics
@@ -0,0 +1,116 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey and Eclipse engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/aurora/textureloader.h
+ *  Decoding textures in the background.
+ */
+
+#ifndef GRAPHICS_AURORA_TEXTURELOADER_H
+#define GRAPHICS_AURORA_TEXTURELOADER_H
+
+#include <vector>
+#include <list>
+
+#include "common/types.h"
+#include "common/mutex.h"
+#include "common/thread.h"
+
+namespace Graphics {
+
+namespace Aurora {
+
+class Texture;
+
+/** A pool of threads decoding textures in the background.
+ *
+ *  Decoding a texture includes parsing the image, decompressing S3TC
+ *  data if necessary and reading the TXI. The decoded texture then
+ *  queues itself for the upload to OpenGL, which happens in the main
+ *  thread.
+ *
+ *  A texture that dropped its image after the upload is queued here
+ *  again when it needs to be reuploaded, to read the image back in
+ *  without stalling the main thread.
+ *
+ *  A thread needing a texture's properties before it was decoded
+ *  decodes the texture on the spot, so nobody ever waits for a texture
+ *  still sitting in the queue.
+ */
+class TextureLoader {
+public:
+	TextureLoader();
+	~TextureLoader();
+
+	/** Start that many decoding threads. */
+	void start(uint threadCount);
+	/** Stop all decoding threads. */
+	void stop();
+
+	/** Are there threads running to decode textures? */
+	bool isRunning() const;
+
+	/** Queue this texture for decoding. */
+	void add(Texture &texture);
+	/** Remove this texture, waiting for it if it's currently being decoded. */
+	void remove(Texture &texture);
+
+private:
+	/** A thread decoding textures. */
+	class Worker : public Common::Thread {
+	public:
+		Worker(TextureLoader &loader);
+		~Worker();
+
+	private:
+		TextureLoader *_loader;
+
+		void threadMethod();
+	};
+
+	std::vector<Worker *> _workers;
+
+	std::list<Texture *> _queue;    ///< Textures waiting to be decoded.
+	std::list<Texture *> _decoding; ///< Textures currently being decoded.
+
+	Common::Mutex _mutex; ///< Protects the texture lists.
+
+	Common::Condition _newTexture; ///< Signals a newly queued texture.
+	Common::Condition _decoded;    ///< Signals a finished texture.
+
+	/** Take the next texture out of the queue. */
+	Texture *take();
+	/** Signal that this texture has been decoded. */
+	void finish(Texture &texture);
+	/** Wait for new textures to be queued. */
+	void wait();
+
+	bool isDecoding(Texture &texture) const;
+};
+
+} // End of namespace Aurora
+
+} // End of namespace Graphics
+
+#endif // GRAPHICS_AURORA_TEXTURELOADER_H
@@ -27,9 +27,12 @@
  *  The Aurora texture manager.
  */
 
+#include <SDL_thread.h>
+
 #include "common/util.h"
 #include "common/error.h"
 #include "common/uuid.h"
+#include "common/configman.h"
 
 #include "aurora/resman.h"
 
@@ -47,12 +50,25 @@ namespace Graphics {
 
 namespace Aurora {
 
-ManagedTexture::ManagedTexture(const Common::UString &name) : reloadable(false) {
+/** Number of threads decoding textures in the background. */
+static const uint kDecodingThreads = 2;
+/** Default maximum width and height of textures to place into the atlas. */
+static const int kAtlasTextureSize = 256;
+/** Default number of megabytes unreferenced textures may hold while kept for reuse. */
+static const int kTextureCacheSize = 64;
+
+ManagedTexture::ManagedTexture(const Common::UString &name) : reloadable(false),
+	imageSerial(0), txiSerial(0), released(false), releasedSize(0) {
+
 	referenceCount = 0;
+
+	updateSerials(name);
 	texture = new Texture(name);
 }
 
-ManagedTexture::ManagedTexture(const Common::UString &name, Texture *t) : reloadable(false) {
+ManagedTexture::ManagedTexture(const Common::UString &name, Texture *t) : reloadable(false),
+	imageSerial(0), txiSerial(0), released(false), releasedSize(0) {
+
 	referenceCount = 0;
 	texture = t;
 }
@@ -61,6 +77,16 @@ ManagedTexture::~ManagedTexture() {
 	delete texture;
 }
 
+void ManagedTexture::updateSerials(const Common::UString &name) {
+	imageSerial = ResMan.getResourceSerial(::Aurora::kResourceImage, name);
+	txiSerial   = ResMan.getResourceSerial(name, ::Aurora::kFileTypeTXI);
+}
+
+bool ManagedTexture::isCurrent(const Common::UString &name) const {
+	return (imageSerial == ResMan.getResourceSerial(::Aurora::kResourceImage, name)) &&
+	       (txiSerial   == ResMan.getResourceSerial(name, ::Aurora::kFileTypeTXI));
+}
+
 
 ManagedPLT::ManagedPLT(const Common::UString &name) {
 	referenceCount = 0;
@@ -72,6 +98,15 @@ ManagedPLT::~ManagedPLT() {
 }
 
 
+TextureMemory::TextureMemory(const Common::UString &n, uint32 s) : name(n), size(s) {
+}
+
+bool TextureMemory::operator<(const TextureMemory &right) const {
+	// Largest first
+	return size > right.size;
+}
+
+
 TextureHandle::TextureHandle() : _empty(true) {
 }
 
@@ -154,11 +189,26 @@ PLTFile &PLTHandle::getPLT() const {
 }
 
 
-TextureManager::TextureManager() {
+TextureManager::TextureManager() : _releasedSize(0), _cacheBudget(0), _releasedChanged(false),
+	_cacheHits(0), _cacheMisses(0), _boundID(0), _boundFrame(0), _bindCount(0), _lastBindCount(0), _bindFrame(0) {
+
+	setCacheBudget(MAX(ConfigMan.getInt("texturecache", kTextureCacheSize), 0) * 1024 * 1024);
+
+	_pltPalettes = new PLTPalettes;
+
+	_atlas.setMaxTextureSize(MAX(ConfigMan.getInt("atlastexturesize", kAtlasTextureSize), 0));
+
+	_fileCache.setDirectory(ConfigMan.getString("texturecachedir"));
+
+	_loader.start(kDecodingThreads);
 }
 
 TextureManager::~TextureManager() {
+	_loader.stop();
+
 	clear();
+
+	delete _pltPalettes;
 }
 
 void TextureManager::clear() {
@@ -166,10 +216,15 @@ void TextureManager::clear() {
 
 	_newPLTs.clear();
 
+	_pltPalettes->clear();
+
 	for (PLTList::iterator p = _plts.begin(); p != _plts.end(); ++p)
 		delete *p;
 	_plts.clear();
 
+	_released.clear();
+	_releasedSize = 0;
+
 	for (TextureMap::iterator t = _textures.begin(); t != _textures.end(); ++t)
 		delete t->second;
 	_textures.clear();
@@ -186,6 +241,12 @@ TextureHandle TextureManager::add(Texture *texture, Common::UString name) {
 	}
 
 	TextureMap::iterator text = _textures.find(name);
+	if ((text != _textures.end()) && text->second->released) {
+		// Only kept for reuse, make room for the new one
+		evict(text);
+		text = _textures.end();
+	}
+
 	if (text != _textures.end())
 		throw Common::Exception("Texture \"%s\" already exists", name.c_str());
 
@@ -205,16 +266,34 @@ TextureHandle TextureManager::add(Texture *texture, Common::UString name) {
 TextureHandle TextureManager::get(const Common::UString &name) {
 	Common::StackLock lock(_mutex);
 
+	recountReleased();
+
 	if (ResMan.hasResource(name, ::Aurora::kFileTypePLT)) {
 		_plts.push_back(new ManagedPLT(name));
 
-		_newPLTs.push_back(PLTHandle(--_plts.end()));
+		std::list<PLTHandle> &newPLTs = _newPLTs[SDL_ThreadID()];
 
-		return _newPLTs.back().getPLT().getTexture();
+		newPLTs.push_back(PLTHandle(--_plts.end()));
+
+		return newPLTs.back().getPLT().getTexture();
 	}
 
 	TextureMap::iterator texture = _textures.find(name);
+	if ((texture != _textures.end()) && texture->second->released) {
+		if (texture->second->isCurrent(name)) {
+			// Reuse the texture we kept
+			unrelease(texture);
+			_cacheHits++;
+		} else {
+			// The resources changed, so the texture is outdated
+			evict(texture);
+			texture = _textures.end();
+		}
+	}
+
 	if (texture == _textures.end()) {
+		_cacheMisses++;
+
 		std::pair<TextureMap::iterator, bool> result;
 
 		ManagedTexture *t = new ManagedTexture(name);
@@ -254,8 +333,12 @@ void TextureManager::release(TextureHandle &texture) {
 
 	if (!texture._empty && (texture._it != _textures.end())) {
 		if (--texture._it->second->referenceCount == 0) {
-			delete texture._it->second;
-			_textures.erase(texture._it);
+			if (texture._it->second->reloadable && (_cacheBudget > 0)) {
+				keep(texture._it);
+			} else {
+				delete texture._it->second;
+				_textures.erase(texture._it);
+			}
 		}
 	}
 
@@ -282,12 +365,22 @@ void TextureManager::reloadAll() {
 
 	GfxMan.lockFrame();
 
+	// The palettes might have changed as well
+	_pltPalettes->clear();
+
+	// No need to reload textures nobody uses
+	trimReleased(0);
+
 	TextureMap::iterator texture;
 	try {
 
-		for (texture = _textures.begin(); texture != _textures.end(); ++texture)
-			if (texture->second->reloadable)
-				texture->second->texture->reload(texture->first);
+		for (texture = _textures.begin(); texture != _textures.end(); ++texture) {
+			if (!texture->second->reloadable)
+				continue;
+
+			texture->second->updateSerials(texture->first);
+			texture->second->texture->reload(texture->first);
+		}
 
 	} catch (Common::Exception &e) {
 		e.add("Failed reloading texture \"%s\"", texture->first.c_str());
@@ -298,24 +391,167 @@ void TextureManager::reloadAll() {
 	GfxMan.unlockFrame();
 }
 
+void TextureManager::keep(TextureMap::iterator &i) {
+	ManagedTexture &texture = *i->second;
+
+	texture.released     = true;
+	texture.releasedSize = texture.texture->getUploadedSize() + texture.texture->getDataSize();
+	texture.lruPos       = _released.insert(_released.end(), i);
+
+	texture.texture->_released = true;
+
+	_releasedSize += texture.releasedSize;
+
+	recountReleased();
+	trimReleased(_cacheBudget);
+}
+
+void TextureManager::unrelease(TextureMap::iterator &i) {
+	ManagedTexture &texture = *i->second;
+
+	_released.erase(texture.lruPos);
+	_releasedSize -= texture.releasedSize;
+
+	texture.released     = false;
+	texture.releasedSize = 0;
+
+	texture.texture->_released = false;
+}
+
+void TextureManager::evict(TextureMap::iterator &i) {
+	unrelease(i);
+
+	delete i->second;
+	_textures.erase(i);
+}
+
+void TextureManager::trimReleased(uint32 budget) {
+	// With no budget at all, even textures that hold no memory yet have to go
+	while (!_released.empty() && ((_releasedSize > budget) || (budget == 0))) {
+		TextureMap::iterator oldest = _released.front();
+		evict(oldest);
+	}
+}
+
+void TextureManager::recountReleased() {
+	if (!_releasedChanged)
+		return;
+
+	/* Released textures might still be uploaded, read again or streamed, changing
+	 * the memory they hold. Clear the flag first, so we don't miss a change while
+	 * we count. */
+	_releasedChanged = false;
+
+	_releasedSize = 0;
+	for (ReleasedList::iterator r = _released.begin(); r != _released.end(); ++r) {
+		ManagedTexture &texture = *(*r)->second;
+
+		texture.releasedSize = texture.texture->getUploadedSize() + texture.texture->getDataSize();
+		_releasedSize += texture.releasedSize;
+	}
+
+	trimReleased(_cacheBudget);
+}
+
+void TextureManager::releasedTextureChanged() {
+	_releasedChanged = true;
+}
+
+void TextureManager::setCacheBudget(uint32 bytes) {
+	Common::StackLock lock(_mutex);
+
+	_cacheBudget = bytes;
+
+	trimReleased(_cacheBudget);
+}
+
+void TextureManager::resetCacheStats() {
+	Common::StackLock lock(_mutex);
+
+	_cacheHits   = 0;
+	_cacheMisses = 0;
+}
+
+void TextureManager::getCacheStats(uint32 &hits, uint32 &misses) {
+	Common::StackLock lock(_mutex);
+
+	hits   = _cacheHits;
+	misses = _cacheMisses;
+}
+
+void TextureManager::getCacheUsage(uint32 &count, uint32 &size) {
+	Common::StackLock lock(_mutex);
+
+	recountReleased();
+
+	count = _released.size();
+	size  = _releasedSize;
+}
+
+bool TextureManager::startDecoding(Texture &texture) {
+	if (!_loader.isRunning())
+		return false;
+
+	_loader.add(texture);
+	return true;
+}
+
+void TextureManager::stopDecoding(Texture &texture) {
+	_loader.remove(texture);
+}
+
+uint32 TextureManager::getMemoryUsage(std::list<TextureMemory> &textures) {
+	Common::StackLock lock(_mutex);
+
+	uint32 total = 0;
+	for (TextureMap::const_iterator t = _textures.begin(); t != _textures.end(); ++t) {
+		uint32 size = t->second->texture->getDataSize();
+		if (size == 0)
+			continue;
+
+		textures.push_back(TextureMemory(t->first, size));
+		total += size;
+	}
+
+	textures.sort();
+	return total;
+}
+
+PLTPalettes &TextureManager::getPLTPalettes() {
+	return *_pltPalettes;
+}
+
+TextureFileCache &TextureManager::getFileCache() {
+	return _fileCache;
+}
+
 void TextureManager::getNewPLTs(std::list<PLTHandle> &plts) {
-	for (std::list<PLTHandle>::const_iterator p = _newPLTs.begin(); p != _newPLTs.end(); ++p)
+	Common::StackLock lock(_mutex);
+
+	std::map<uint32, std::list<PLTHandle> >::iterator newPLTs = _newPLTs.find(SDL_ThreadID());
+	if (newPLTs == _newPLTs.end())
+		return;
+
+	for (std::list<PLTHandle>::const_iterator p = newPLTs->second.begin(); p != newPLTs->second.end(); ++p)
 		plts.push_back(*p);
-	_newPLTs.clear();
+
+	_newPLTs.erase(newPLTs);
 }
 
 void TextureManager::clearNewPLTs() {
-	_newPLTs.clear();
+	Common::StackLock lock(_mutex);
+
+	_newPLTs.erase(SDL_ThreadID());
 }
 
 void TextureManager::reset() {
 	activeTexture(0);
 	glEnable(GL_TEXTURE_2D);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	bind(0);
 }
 
 void TextureManager::set() {
-	glBindTexture(GL_TEXTURE_2D, 0);
+	bind(0);
 }
 
 void TextureManager::set(const TextureHandle &handle) {
@@ -324,11 +560,71 @@ void TextureManager::set(const TextureHandle &handle) {
 		return;
 	}
 
-	TextureID id = handle._it->second->texture->getID();
-	if (id == 0)
-		warning("Empty texture ID for texture \"%s\"", handle._it->first.c_str());
+	bind(handle._it->second->texture->getID());
+}
+
+const AtlasRegion *TextureManager::setAtlased(const TextureHandle &handle) {
+	if (handle.empty()) {
+		set();
+		return 0;
+	}
+
+	Texture &texture = *handle._it->second->texture;
+
+	const AtlasRegion *region = _atlas.get(texture);
+
+	// Not tried yet. Have the texture's next upload copy it into the atlas
+	if (!region && !_atlas.has(texture))
+		texture.requestAtlas();
+
+	const TextureID id    = region ? region->page : texture.getID();
+	const uint32    frame = GfxMan.getFrameCount();
+
+	// Consecutive quads of the same atlas page only need one bind
+	if ((id != _boundID) || (frame != _boundFrame))
+		bind(id);
+
+	_boundID    = id;
+	_boundFrame = frame;
+
+	return region;
+}
 
+void TextureManager::addToAtlas(const Texture &texture, const ImageDecoder &image) {
+	_atlas.add(texture, image);
+}
+
+void TextureManager::removeFromAtlas(const Texture &texture) {
+	_atlas.remove(texture);
+}
+
+void TextureManager::getAtlasStats(uint32 &pages, uint32 &textures) {
+	_atlas.getStats(pages, textures);
+}
+
+uint32 TextureManager::getBindCount() const {
+	return _lastBindCount;
+}
+
+void TextureManager::bind(TextureID id) {
 	glBindTexture(GL_TEXTURE_2D, id);
+
+	// Whatever setAtlased() bound last might not be bound anymore
+	_boundID = 0;
+
+	countBind();
+}
+
+void TextureManager::countBind() {
+	const uint32 frame = GfxMan.getFrameCount();
+	if (frame != _bindFrame) {
+		_lastBindCount = (frame == (_bindFrame + 1)) ? _bindCount : 0;
+
+		_bindCount = 0;
+		_bindFrame = frame;
+	}
+
+	_bindCount++;
 }
 
 static GLenum texture[32] = {
@@ -372,6 +668,8 @@ void TextureManager::activeTexture(uint32 n) {
 
 	if (GfxMan.supportMultipleTextures())
 		glActiveTextureARB(texture[n]);
+
+	_boundID = 0;
 }
 
 void TextureManager::textureCoord2f(uint32 n, float u, float v) {
@@ -40,12 +40,42 @@
 #include "common/mutex.h"
 #include "common/ustring.h"
 
+#include "graphics/aurora/textureloader.h"
+#include "graphics/aurora/textureatlas.h"
+#include "graphics/aurora/texturefilecache.h"
+
 namespace Graphics {
 
 namespace Aurora {
 
 class Texture;
 class PLTFile;
+class PLTPalettes;
+
+
+/** A managed PLT, storing how often it's referenced. */
+struct ManagedPLT {
+	PLTFile *plt;
+	uint32 referenceCount;
+
+	ManagedPLT(const Common::UString &name);
+	~ManagedPLT();
+};
+
+/** The image data a texture holds in memory. */
+struct TextureMemory {
+	Common::UString name;
+	uint32 size;
+
+	TextureMemory(const Common::UString &n = "", uint32 s = 0);
+
+	bool operator<(const TextureMemory &right) const;
+};
+
+struct ManagedTexture;
+
+typedef std::map<Common::UString, ManagedTexture *> TextureMap;
+typedef std::list<TextureMap::iterator> ReleasedList;
 
 /** A managed texture, storing how often it's referenced. */
 struct ManagedTexture {
@@ -54,21 +84,22 @@ struct ManagedTexture {
 
 	bool reloadable;
 
+	uint32 imageSerial; ///< The serial of the image resource the texture was loaded from.
+	uint32 txiSerial;   ///< The serial of the TXI resource the texture was loaded with.
+
+	bool released;                 ///< Is the texture unreferenced, but kept for reuse?
+	ReleasedList::iterator lruPos; ///< The texture's place in the released list.
+	uint32 releasedSize;           ///< The memory the texture held when it was released.
+
 	ManagedTexture(const Common::UString &name);
 	ManagedTexture(const Common::UString &name, Texture *t);
 	~ManagedTexture();
-};
 
-/** A managed PLT, storing how often it's referenced. */
-struct ManagedPLT {
-	PLTFile *plt;
-	uint32 referenceCount;
-
-	ManagedPLT(const Common::UString &name);
-	~ManagedPLT();
+	/** Remember which resources the texture was loaded from. */
+	void updateSerials(const Common::UString &name);
+	/** Do the texture's resources still exist unchanged? */
+	bool isCurrent(const Common::UString &name) const;
 };
-
-typedef std::map<Common::UString, ManagedTexture *> TextureMap;
 typedef std::list<ManagedPLT *> PLTList;;
 
 /** A handle to a texture. */
@@ -134,7 +165,40 @@ public:
 	void reloadAll();
 
 
+	/** Queue this texture for decoding, or for rereading its dropped image, in the background.
+	 *  Returns false if that's not possible. */
+	bool startDecoding(Texture &texture);
+	/** Remove this texture from the background decoding. */
+	void stopDecoding(Texture &texture);
+
+
+	/** Set the number of bytes unreferenced textures may hold while kept for reuse. 0 disables keeping them. */
+	void setCacheBudget(uint32 bytes);
+
+	/** Reset the counts of reused and newly loaded textures. */
+	void resetCacheStats();
+	/** Get the counts of reused and newly loaded textures since the last reset. */
+	void getCacheStats(uint32 &hits, uint32 &misses);
+	/** Get the number of unreferenced textures kept for reuse, and the bytes they hold. */
+	void getCacheUsage(uint32 &count, uint32 &size);
+
+	/** Note that an unreferenced texture kept for reuse now holds a different amount of memory. */
+	void releasedTextureChanged();
+
+
+	/** Return the number of bytes of image data all textures hold, and list the textures holding any. */
+	uint32 getMemoryUsage(std::list<TextureMemory> &textures);
+
+
+	/** Return the color palettes shared by all PLTs. */
+	PLTPalettes &getPLTPalettes();
+
+	/** Return the directory of decoded textures kept across runs. */
+	TextureFileCache &getFileCache();
+
+	/** Take the PLTs the calling thread created since the last clearNewPLTs(). */
 	void getNewPLTs(std::list<PLTHandle> &plts);
+	/** Forget the PLTs the calling thread created. */
 	void clearNewPLTs();
 
 
@@ -143,6 +207,27 @@ public:
 	void set(const TextureHandle &handle);
 
 
+	/** Bind the atlas page holding this texture, or the texture itself if it's not in the atlas.
+	 *
+	 *  Only meant for drawing GUI elements outside of display lists. If a region
+	 *  is returned, the texture coordinates need to be mapped into it. Coordinates
+	 *  outside of [0, 1] won't wrap around within the atlas, so textures drawn
+	 *  with those need to be bound with set() instead.
+	 */
+	const AtlasRegion *setAtlased(const TextureHandle &handle);
+
+	/** Copy this decoded image of the texture into the atlas, if it fits. */
+	void addToAtlas(const Texture &texture, const ImageDecoder &image);
+	/** Forget the place of this texture in the atlas. */
+	void removeFromAtlas(const Texture &texture);
+
+	/** Return the number of atlas pages and the number of textures in them. */
+	void getAtlasStats(uint32 &pages, uint32 &textures);
+
+	/** Return the number of textures bound during the last frame. */
+	uint32 getBindCount() const;
+
+
 	void activeTexture(uint32 n);
 	void textureCoord2f(uint32 n, float u, float v);
 
@@ -151,13 +236,55 @@ private:
 	TextureMap _textures;
 	PLTList    _plts;
 
-	std::list<PLTHandle> _newPLTs;
+	/** Unreferenced textures kept for reuse, least recently released first. */
+	ReleasedList _released;
+
+	uint32 _releasedSize; ///< The bytes held by the released textures.
+	uint32 _cacheBudget;  ///< The bytes the released textures may hold.
+
+	/** Did the memory a released texture holds change since we last counted? */
+	volatile bool _releasedChanged;
+
+	uint32 _cacheHits;   ///< Textures reused since the last reset.
+	uint32 _cacheMisses; ///< Textures newly loaded since the last reset.
+
+	/** Newly created PLTs, by the ID of the creating thread.
+	 *  Models are also loaded in the background, so each thread only sees its own. */
+	std::map<uint32, std::list<PLTHandle> > _newPLTs;
+
+	PLTPalettes *_pltPalettes;
+
+	TextureFileCache _fileCache; ///< Decoded textures kept across runs.
+
+	TextureLoader _loader; ///< Decodes textures in the background.
+	TextureAtlas  _atlas;  ///< Shares texture bindings between small GUI textures.
+
+	TextureID _boundID;    ///< The texture setAtlased() bound, if nothing else was bound since.
+	uint32    _boundFrame; ///< The frame in which setAtlased() bound that texture.
+
+	uint32 _bindCount;     ///< Textures bound during the current frame.
+	uint32 _lastBindCount; ///< Textures bound during the last frame.
+	uint32 _bindFrame;     ///< The frame _bindCount belongs to.
 
 	Common::Mutex _mutex;
 
+	void bind(TextureID id);
+	void countBind();
+
 	void release(TextureMap::iterator &i);
 	void release(PLTList::iterator &i);
 
+	/** Keep this unreferenced texture around for reuse. */
+	void keep(TextureMap::iterator &i);
+	/** Take this texture out of the released list, because it's referenced again. */
+	void unrelease(TextureMap::iterator &i);
+	/** Delete this released texture. */
+	void evict(TextureMap::iterator &i);
+	/** Delete released textures until they fit into the budget. */
+	void trimReleased(uint32 budget);
+	/** Count the memory the released textures hold again, if it changed, and enforce the budget. */
+	void recountReleased();
+
 	void assign(TextureHandle &texture, const TextureHandle &from);
 	void assign(PLTHandle &plt, const PLTHandle &from);
 	void release(TextureHandle &texture);
@@ -44,6 +44,7 @@ enum ModelType {
 
 class Model;
 class ModelNode;
+class ModelMemoryUsage;
 class Text;
 class GUIQuad;
 
@@ -46,8 +46,10 @@
 #include "graphics/fpscounter.h"
 #include "graphics/queueman.h"
 #include "graphics/glcontainer.h"
+#include "graphics/texture.h"
 #include "graphics/renderable.h"
 #include "graphics/camera.h"
+#include "graphics/scenebuilder.h"
 
 #include "graphics/images/decoder.h"
 #include "graphics/images/screenshot.h"
@@ -56,7 +58,10 @@ DECLARE_SINGLETON(Graphics::GraphicsManager)
 
 namespace Graphics {
 
-GraphicsManager::GraphicsManager() : _projection(4, 4), _projectionInv(4, 4) {
+/** Time in milliseconds per frame we may spend uploading new textures. */
+static const uint32 kTextureUploadBudget = 5;
+
+GraphicsManager::GraphicsManager() {
 	_ready = false;
 
 	_needManualDeS3TC        = false;
@@ -69,12 +74,21 @@ GraphicsManager::GraphicsManager() : _projection(4, 4), _projectionInv(4, 4) {
 
 	_gamma = 1.0;
 
+	_lodBias = 1.0;
+
+	_streamingBudget = 0;
+
 	_screen = 0;
 
 	_fpsCounter = new FPSCounter(3);
+	_frameCount = 0;
+
+	_sceneBuilder = new SceneBuilder;
 
 	_frameLock = 0;
 
+	_lastAnimationTime = 0;
+
 	_cursor = 0;
 	_cursorState = kCursorStateStay;
 
@@ -88,6 +102,7 @@ GraphicsManager::GraphicsManager() : _projection(4, 4), _projectionInv(4, 4) {
 GraphicsManager::~GraphicsManager() {
 	deinit();
 
+	delete _sceneBuilder;
 	delete _fpsCounter;
 }
 
@@ -125,9 +140,19 @@ void GraphicsManager::init() {
 	if (ConfigMan.hasKey("gamma"))
 		setGamma(ConfigMan.getDouble("gamma", 1.0));
 
+	// Set the level-of-detail bias to what the config specifies
+	setLODBias(ConfigMan.getDouble("lodbias", 1.0));
+
+	// Set how many KB of texture mip maps to stream in per frame
+	setTextureStreamingBudget(MAX(ConfigMan.getInt("texturestreaming", 1024), 0) * 1024);
+
 	// Set the window title to our name
 	setWindowTitle(PACKAGE_STRING);
 
+	// Prepare the draw lists in the background
+	if (!_sceneBuilder->start())
+		warning("Failed to start the scene builder thread, building the scene synchronously");
+
 	_ready = true;
 }
 
@@ -137,6 +162,8 @@ void GraphicsManager::deinit() {
 	if (!_ready)
 		return;
 
+	_sceneBuilder->stop();
+
 	QueueMan.clearAllQueues();
 
 	SDL_Quit();
@@ -171,6 +198,10 @@ uint32 GraphicsManager::getFPS() const {
 	return _fpsCounter->getFPS();
 }
 
+uint32 GraphicsManager::getFrameCount() const {
+	return _frameCount;
+}
+
 void GraphicsManager::initSize(int width, int height, bool fullscreen) {
 	int bpp = SDL_GetVideoInfo()->vfmt->BitsPerPixel;
 	if ((bpp != 24) && (bpp != 32))
@@ -340,6 +371,29 @@ void GraphicsManager::setGamma(float gamma) {
 	SDL_SetGamma(gamma, gamma, gamma);
 }
 
+float GraphicsManager::getLODBias() const {
+	return _lodBias;
+}
+
+void GraphicsManager::setLODBias(float bias) {
+	_lodBias = MAX(bias, 0.0f);
+}
+
+uint32 GraphicsManager::getTextureStreamingBudget() const {
+	return _streamingBudget;
+}
+
+void GraphicsManager::setTextureStreamingBudget(uint32 budget) {
+	_streamingBudget = budget;
+}
+
+float GraphicsManager::getProjectedSize(float size, float distance) const {
+	// Nothing is nearer than the near clipping plane
+	distance = MAX(distance, 1.0f);
+
+	return (size * _projection(1, 1) * getScreenHeight()) / (2.0 * distance);
+}
+
 void GraphicsManager::setupScene() {
 	if (!_screen)
 		throw Common::Exception("No screen initialized");
@@ -401,10 +455,6 @@ void GraphicsManager::perspective(float fovy, float aspect, float zNear, float z
 }
 
 bool GraphicsManager::project(float x, float y, float z, float &sX, float &sY, float &sZ) {
-	// This is our projection matrix
-	Common::Matrix proj = _projection;
-
-
 	// Generate the model matrix
 
 	Common::TransformationMatrix model;
@@ -426,28 +476,21 @@ bool GraphicsManager::project(float x, float y, float z, float &sX, float &sY, f
 	model.translate(-cPos[0], -cPos[1], cPos[2]);
 
 
-	// Generate a matrix for the coordinates
+	// Multiply the coordinates with our projection and the model matrix
 
-	Common::Matrix coords(4, 1);
+	float v[4] = { x, y, z, 1.0 };
 
-	coords(0, 0) = x;
-	coords(1, 0) = y;
-	coords(2, 0) = z;
-	coords(3, 0) = 1.0;
-
-
-	// Multiply them
-	Common::Matrix v(proj * model * coords);
+	(_projection * model).multiply(v, v);
 
 
 	// Projection divide
 
-	if (v(3, 0) == 0.0)
+	if (v[3] == 0.0)
 		return false;
 
-	v(0, 0) /= v(3, 0);
-	v(1, 0) /= v(3, 0);
-	v(2, 0) /= v(3, 0);
+	v[0] /= v[3];
+	v[1] /= v[3];
+	v[2] /= v[3];
 
 	// Viewport coordinates
 
@@ -459,9 +502,9 @@ bool GraphicsManager::project(float x, float y, float z, float &sX, float &sY, f
 	view[3] = _screen->h;
 
 
-	sX = view[0] + view[2] * (v(0, 0) + 1.0) / 2.0;
-	sY = view[1] + view[3] * (v(1, 0) + 1.0) / 2.0;
-	sZ =                     (v(2, 0) + 1.0) / 2.0;
+	sX = view[0] + view[2] * (v[0] + 1.0) / 2.0;
+	sY = view[1] + view[3] * (v[1] + 1.0) / 2.0;
+	sZ =                     (v[2] + 1.0) / 2.0;
 
 	sX -= view[2] / 2.0;
 	sY -= view[3] / 2.0;
@@ -511,47 +554,46 @@ bool GraphicsManager::unproject(float x, float y,
 		float zFar  = 1.0;
 
 
-		// Generate a matrix for the coordinates at the near plane
-
-		Common::Matrix coordsNear(4, 1);
+		// The coordinates at the near plane
 
-		coordsNear(0, 0) = ((2 * (x - view[0])) / (view[2])) - 1.0;
-		coordsNear(1, 0) = ((2 * (y - view[1])) / (view[3])) - 1.0;
-		coordsNear(2, 0) = (2 * zNear) - 1.0;
-		coordsNear(3, 0) = 1.0;
+		float oNear[4];
 
+		oNear[0] = ((2 * (x - view[0])) / (view[2])) - 1.0;
+		oNear[1] = ((2 * (y - view[1])) / (view[3])) - 1.0;
+		oNear[2] = (2 * zNear) - 1.0;
+		oNear[3] = 1.0;
 
 
-		// Generate a matrix for the coordinates at the far plane
+		// The coordinates at the far plane
 
-		Common::Matrix coordsFar(4, 1);
+		float oFar[4];
 
-		coordsFar(0, 0) = ((2 * (x - view[0])) / (view[2])) - 1.0;
-		coordsFar(1, 0) = ((2 * (y - view[1])) / (view[3])) - 1.0;
-		coordsFar(2, 0) = (2 * zFar) - 1.0;
-		coordsFar(3, 0) = 1.0;
+		oFar[0] = ((2 * (x - view[0])) / (view[2])) - 1.0;
+		oFar[1] = ((2 * (y - view[1])) / (view[3])) - 1.0;
+		oFar[2] = (2 * zFar) - 1.0;
+		oFar[3] = 1.0;
 
 
 		// Unproject
-		Common::Matrix oNear(model * coordsNear);
-		Common::Matrix oFar (model * coordsFar );
-		if ((oNear(3, 0) == 0.0) || (oNear(3, 0) == 0.0))
+		model.multiply(oNear, oNear);
+		model.multiply(oFar , oFar );
+		if ((oNear[3] == 0.0) || (oFar[3] == 0.0))
 			return false;
 
 
 		// And return the values
 
-		oNear(3, 0) = 1.0 / oNear(3, 0);
+		oNear[3] = 1.0 / oNear[3];
 
-		x1 = oNear(0, 0) * oNear(3, 0);
-		y1 = oNear(1, 0) * oNear(3, 0);
-		z1 = oNear(2, 0) * oNear(3, 0);
+		x1 = oNear[0] * oNear[3];
+		y1 = oNear[1] * oNear[3];
+		z1 = oNear[2] * oNear[3];
 
-		oFar(3, 0) = 1.0 / oFar(3, 0);
+		oFar[3] = 1.0 / oFar[3];
 
-		x2 = oFar(0, 0) * oFar(3, 0);
-		y2 = oFar(1, 0) * oFar(3, 0);
-		z2 = oFar(2, 0) * oFar(3, 0);
+		x2 = oFar[0] * oFar[3];
+		y2 = oFar[1] * oFar[3];
+		z2 = oFar[2] * oFar[3];
 
 	} catch (Common::Exception &e) {
 		Common::printException(e, "WARNING: ");
@@ -578,25 +620,16 @@ void GraphicsManager::unlockFrame() {
 }
 
 void GraphicsManager::recalculateObjectDistances() {
-	// World objects
-	QueueMan.lockQueue(kQueueVisibleWorldObject);
-
-	const std::list<Queueable *> &objects = QueueMan.getQueue(kQueueVisibleWorldObject);
-	for (std::list<Queueable *>::const_iterator o = objects.begin(); o != objects.end(); ++o)
-		static_cast<Renderable *>(*o)->calculateDistance();
-
-	QueueMan.sortQueue(kQueueVisibleWorldObject);
-	QueueMan.unlockQueue(kQueueVisibleWorldObject);
-
-	// GUI front objects
-	QueueMan.lockQueue(kQueueVisibleGUIFrontObject);
+	// The scene builder recalculates the distances and resorts the objects for the next frame
+	_sceneBuilder->invalidate();
+}
 
-	const std::list<Queueable *> &gui = QueueMan.getQueue(kQueueVisibleGUIFrontObject);
-	for (std::list<Queueable *>::const_iterator g = gui.begin(); g != gui.end(); ++g)
-		static_cast<Renderable *>(*g)->calculateDistance();
+void GraphicsManager::addToScene(Renderable &renderable, QueueType queue) {
+	_sceneBuilder->add(renderable, queue);
+}
 
-	QueueMan.sortQueue(kQueueVisibleGUIFrontObject);
-	QueueMan.unlockQueue(kQueueVisibleGUIFrontObject);
+void GraphicsManager::removeFromScene(Renderable &renderable) {
+	_sceneBuilder->remove(renderable);
 }
 
 uint32 GraphicsManager::createRenderableID() {
@@ -656,12 +689,14 @@ Renderable *GraphicsManager::getGUIObjectAt(float x, float y) const {
 
 	Renderable *object = 0;
 
-	QueueMan.lockQueue(kQueueVisibleGUIFrontObject);
-	const std::list<Queueable *> &gui = QueueMan.getQueue(kQueueVisibleGUIFrontObject);
+	DrawList &list = _sceneBuilder->lockCurrent();
 
 	// Go through the GUI elements, from nearest to furthest
-	for (std::list<Queueable *>::const_iterator g = gui.begin(); g != gui.end(); ++g) {
-		Renderable &r = static_cast<Renderable &>(**g);
+	for (std::vector<Renderable *>::const_iterator g = list.gui.begin(); g != list.gui.end(); ++g) {
+		if (!*g)
+			continue;
+
+		Renderable &r = **g;
 
 		if (!r.isClickable())
 			// Object isn't clickable, don't check
@@ -674,7 +709,7 @@ Renderable *GraphicsManager::getGUIObjectAt(float x, float y) const {
 		}
 	}
 
-	QueueMan.unlockQueue(kQueueVisibleGUIFrontObject);
+	_sceneBuilder->unlock(list);
 	return object;
 }
 
@@ -691,11 +726,14 @@ Renderable *GraphicsManager::getWorldObjectAt(float x, float y) const {
 
 	Renderable *object = 0;
 
-	QueueMan.lockQueue(kQueueVisibleWorldObject);
-	const std::list<Queueable *> &objects = QueueMan.getQueue(kQueueVisibleWorldObject);
+	DrawList &list = _sceneBuilder->lockCurrent();
 
-	for (std::list<Queueable *>::const_iterator o = objects.begin(); o != objects.end(); ++o) {
-		Renderable &r = static_cast<Renderable &>(**o);
+	// Go through the world objects, from nearest to furthest
+	for (std::vector<Renderable *>::const_iterator o = list.world.begin(); o != list.world.end(); ++o) {
+		if (!*o)
+			continue;
+
+		Renderable &r = **o;
 
 		if (!r.isClickable())
 			// Object isn't clickable, don't check
@@ -708,7 +746,7 @@ Renderable *GraphicsManager::getWorldObjectAt(float x, float y) const {
 		}
 	}
 
-	QueueMan.unlockQueue(kQueueVisibleWorldObject);
+	_sceneBuilder->unlock(list);
 	return object;
 }
 
@@ -726,19 +764,68 @@ Renderable *GraphicsManager::getObjectAt(float x, float y) {
 
 void GraphicsManager::buildNewTextures() {
 	QueueMan.lockQueue(kQueueNewTexture);
-	const std::list<Queueable *> &text = QueueMan.getQueue(kQueueNewTexture);
-	if (text.empty()) {
+	if (QueueMan.isQueueEmpty(kQueueNewTexture)) {
 		QueueMan.unlockQueue(kQueueNewTexture);
 		return;
 	}
 
-	for (std::list<Queueable *>::const_iterator t = text.begin(); t != text.end(); ++t)
-		static_cast<GLContainer *>(*t)->rebuild();
+	// Upload as many textures as fit into our time budget. The rest has to wait for the next frame
+	const uint32 start = EventMan.getTimestamp();
+
+	Queueable *texture;
+	while ((texture = QueueMan.popQueue(kQueueNewTexture))) {
+		static_cast<GLContainer *>(texture)->rebuild();
+
+		if ((EventMan.getTimestamp() - start) >= kTextureUploadBudget)
+			break;
+	}
 
-	QueueMan.clearQueue(kQueueNewTexture);
 	QueueMan.unlockQueue(kQueueNewTexture);
 }
 
+void GraphicsManager::streamTextures() {
+	QueueMan.lockQueue(kQueueStreamingTexture);
+
+	/* Upload the mip map levels the textures want until we've used up our budget.
+	 * Textures past that still need to look at their requests, to free the levels
+	 * they don't need anymore. A texture that's no longer streamed removes itself
+	 * from the queue, so we need to step past it first. */
+	uint32 budget = _streamingBudget;
+	if (budget == 0)
+		// Streaming has been disabled, so finish what's left at once
+		budget = 0xFFFFFFFF;
+
+	const std::list<Queueable *> &textures = QueueMan.getQueue(kQueueStreamingTexture);
+	for (std::list<Queueable *>::const_iterator t = textures.begin(); t != textures.end(); ) {
+		Texture *texture = static_cast<Texture *>(*t++);
+
+		texture->stream(budget);
+	}
+
+	QueueMan.unlockQueue(kQueueStreamingTexture);
+}
+
+void GraphicsManager::animateObjects() {
+	const uint32 now = EventMan.getTimestamp();
+
+	const float elapsed = (_lastAnimationTime > 0) ? ((now - _lastAnimationTime) / 1000.0) : 0.0;
+	_lastAnimationTime = now;
+
+	/* Advance all animations in one go, so that they're all sampled at the
+	 * same time. An object whose animation ends removes itself from the
+	 * queue, so we need to step past it first. */
+	QueueMan.lockQueue(kQueueAnimatedObject);
+
+	const std::list<Queueable *> &objects = QueueMan.getQueue(kQueueAnimatedObject);
+	for (std::list<Queueable *>::const_iterator o = objects.begin(); o != objects.end(); ) {
+		Renderable *object = static_cast<Renderable *>(*o++);
+
+		object->advanceAnimation(elapsed);
+	}
+
+	QueueMan.unlockQueue(kQueueAnimatedObject);
+}
+
 void GraphicsManager::beginScene() {
 	// Switch cursor on/off
 	if (_cursorState != kCursorStateStay)
@@ -777,8 +864,8 @@ bool GraphicsManager::playVideo() {
 	return true;
 }
 
-bool GraphicsManager::renderWorld() {
-	if (QueueMan.isQueueEmpty(kQueueVisibleWorldObject))
+bool GraphicsManager::renderWorld(const DrawList &list) {
+	if (list.world.empty())
 		return false;
 
 	float cPos[3];
@@ -805,35 +892,35 @@ bool GraphicsManager::renderWorld() {
 	// Apply camera position
 	glTranslatef(-cPos[0], -cPos[1], cPos[2]);
 
-	QueueMan.lockQueue(kQueueVisibleWorldObject);
-	const std::list<Queueable *> &objects = QueueMan.getQueue(kQueueVisibleWorldObject);
-
-	buildNewTextures();
-
 	// Draw opaque objects
-	for (std::list<Queueable *>::const_reverse_iterator o = objects.rbegin();
-	     o != objects.rend(); ++o) {
+	for (std::vector<Renderable *>::const_reverse_iterator o = list.world.rbegin();
+	     o != list.world.rend(); ++o) {
+
+		if (!*o)
+			continue;
 
 		glPushMatrix();
-		static_cast<Renderable *>(*o)->render(kRenderPassOpaque);
+		(*o)->render(kRenderPassOpaque);
 		glPopMatrix();
 	}
 
 	// Draw transparent objects
-	for (std::list<Queueable *>::const_reverse_iterator o = objects.rbegin();
-	     o != objects.rend(); ++o) {
+	for (std::vector<Renderable *>::const_reverse_iterator o = list.world.rbegin();
+	     o != list.world.rend(); ++o) {
+
+		if (!*o)
+			continue;
 
 		glPushMatrix();
-		static_cast<Renderable *>(*o)->render(kRenderPassTransparent);
+		(*o)->render(kRenderPassTransparent);
 		glPopMatrix();
 	}
 
-	QueueMan.unlockQueue(kQueueVisibleWorldObject);
 	return true;
 }
 
-bool GraphicsManager::renderGUIFront() {
-	if (QueueMan.isQueueEmpty(kQueueVisibleGUIFrontObject))
+bool GraphicsManager::renderGUIFront(const DrawList &list) {
+	if (list.gui.empty())
 		return false;
 
 	glDisable(GL_DEPTH_TEST);
@@ -845,21 +932,17 @@ bool GraphicsManager::renderGUIFront() {
 	glMatrixMode(GL_MODELVIEW);
 	glLoadIdentity();
 
-	QueueMan.lockQueue(kQueueVisibleGUIFrontObject);
-	const std::list<Queueable *> &gui = QueueMan.getQueue(kQueueVisibleGUIFrontObject);
+	for (std::vector<Renderable *>::const_reverse_iterator g = list.gui.rbegin();
+	     g != list.gui.rend(); ++g) {
 
-	buildNewTextures();
-
-	for (std::list<Queueable *>::const_reverse_iterator g = gui.rbegin();
-	     g != gui.rend(); ++g) {
+		if (!*g)
+			continue;
 
 		glPushMatrix();
-		static_cast<Renderable *>(*g)->render(kRenderPassAll);
+		(*g)->render(kRenderPassAll);
 		glPopMatrix();
 	}
 
-	QueueMan.unlockQueue(kQueueVisibleGUIFrontObject);
-
 	glEnable(GL_DEPTH_TEST);
 	return true;
 }
@@ -868,8 +951,6 @@ bool GraphicsManager::renderCursor() {
 	if (!_cursor)
 		return false;
 
-	buildNewTextures();
-
 	glDisable(GL_DEPTH_TEST);
 	glMatrixMode(GL_PROJECTION);
 	glLoadIdentity();
@@ -893,6 +974,7 @@ void GraphicsManager::endScene() {
 	}
 
 	_fpsCounter->finishedFrame();
+	_frameCount++;
 
 	if (_fsaa > 0)
 		glDisable(GL_MULTISAMPLE_ARB);
@@ -913,8 +995,26 @@ void GraphicsManager::renderScene() {
 		return;
 	}
 
-	renderWorld();
-	renderGUIFront();
+	buildNewTextures();
+	streamTextures();
+	animateObjects();
+
+	/* Measure the object distances while holding the frame lock mutex. As long as
+	 * we hold it, no object can start moving, and with a frame lock count of 0,
+	 * no object is in the middle of moving either. */
+	_frameLockMutex.lock();
+	if (_frameLock == 0)
+		_sceneBuilder->updateDistances();
+	_frameLockMutex.unlock();
+
+	// Draw the lists the scene builder prepared for us
+	DrawList &list = _sceneBuilder->lockFront();
+
+	renderWorld(list);
+	renderGUIFront(list);
+
+	_sceneBuilder->unlock(list);
+
 	renderCursor();
 
 	endScene();
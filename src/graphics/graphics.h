@@ -38,7 +38,7 @@
 #include "common/types.h"
 #include "common/singleton.h"
 #include "common/mutex.h"
-#include "common/matrix.h"
+#include "common/matrix4x4.h"
 
 namespace Common {
 	class UString;
@@ -47,6 +47,8 @@ namespace Common {
 namespace Graphics {
 
 class FPSCounter;
+class SceneBuilder;
+struct DrawList;
 class Cursor;
 class Renderable;
 
@@ -103,6 +105,8 @@ public:
 
 	/** How many frames per second to we render at the moments? */
 	uint32 getFPS() const;
+	/** Return the number of frames rendered so far. */
+	uint32 getFrameCount() const;
 
 	/** That the window's title. */
 	void setWindowTitle(const Common::UString &title);
@@ -112,6 +116,19 @@ public:
 	/** Set the overall gamma correction. */
 	void setGamma(float gamma);
 
+	/** Get the level-of-detail bias. */
+	float getLODBias() const;
+	/** Set the level-of-detail bias. Higher values switch to simpler models sooner, 0 disables. */
+	void setLODBias(float bias);
+
+	/** Get the number of bytes of texture mip maps streamed in per frame. */
+	uint32 getTextureStreamingBudget() const;
+	/** Set the number of bytes of texture mip maps streamed in per frame, 0 disables streaming. */
+	void setTextureStreamingBudget(uint32 budget);
+
+	/** Return the height in pixels an object of this size at this distance is projected to. */
+	float getProjectedSize(float size, float distance) const;
+
 	/** Show/Hide the cursor. */
 	void showCursor(bool show);
 	/** Set the current cursor. */
@@ -133,6 +150,10 @@ public:
 
 	/** Recalculate all object distances to the camera and resort the objebts. */
 	void recalculateObjectDistances();
+	/** Add this renderable to the objects sorted into the draw lists. */
+	void addToScene(Renderable &renderable, QueueType queue);
+	/** Remove this renderable from the prepared draw lists. */
+	void removeFromScene(Renderable &renderable);
 
 	/** Lock the frame mutex. */
 	void lockFrame();
@@ -175,15 +196,24 @@ private:
 
 	float _gamma; ///< The current gamma correction value.
 
+	float _lodBias; ///< The current level-of-detail bias.
+
+	uint32 _streamingBudget; ///< Bytes of texture mip maps we may stream in per frame.
+
 	SDL_Surface *_screen; ///< The OpenGL hardware surface.
 
 	FPSCounter *_fpsCounter; ///< Counts the current frames per seconds value.
+	uint32      _frameCount; ///< The number of frames rendered so far.
+
+	SceneBuilder *_sceneBuilder; ///< Prepares the draw lists of the next frame.
 
-	Common::Matrix _projection;    ///< Our projection matrix.
-	Common::Matrix _projectionInv; ///< The inverse of our projection matrix.
+	Common::Matrix4x4 _projection;    ///< Our projection matrix.
+	Common::Matrix4x4 _projectionInv; ///< The inverse of our projection matrix.
 
 	uint32 _frameLock;
 
+	uint32 _lastAnimationTime; ///< The timestamp our animations were last advanced at.
+
 	Common::Mutex _frameLockMutex; ///< A soft mutex locked for each frame.
 	Common::Mutex _cursorMutex;    ///< A mutex locked for the cursor.
 
@@ -227,11 +257,13 @@ private:
 	Renderable *getWorldObjectAt(float x, float y) const;
 
 	void buildNewTextures();
+	void streamTextures();
+	void animateObjects();
 
 	void beginScene();
 	bool playVideo();
-	bool renderWorld();
-	bool renderGUIFront();
+	bool renderWorld(const DrawList &list);
+	bool renderGUIFront(const DrawList &list);
 	bool renderCursor();
 	void endScene();
 };
@@ -27,6 +27,9 @@
  *  Generic image decoder interface.
  */
 
+#include <cstring>
+
+#include "common/system.h"
 #include "common/util.h"
 #include "common/error.h"
 #include "common/stream.h"
@@ -37,8 +40,46 @@
 #include "graphics/images/s3tc.h"
 #include "graphics/images/dumptga.h"
 
+#ifdef XOREOS_SSE2
+	#include <emmintrin.h>
+#endif
+
 namespace Graphics {
 
+/** Return the number of bytes per pixel of uncompressed 8-bit pixel data. */
+static uint32 getBytesPerPixel(PixelFormat format) {
+	if ((format == kPixelFormatRGB) || (format == kPixelFormatBGR))
+		return 3;
+
+	return 4;
+}
+
+#ifdef XOREOS_SSE2
+/** Add the even pixels to the odd pixels of 4 pixels, into 2 pixels of 16-bit channels. */
+static FORCEINLINE __m128i addPixelPairs(__m128i pixels) {
+	const __m128i zero = _mm_setzero_si128();
+
+	pixels = _mm_shuffle_epi32(pixels, _MM_SHUFFLE(3, 1, 2, 0));
+
+	return _mm_add_epi16(_mm_unpacklo_epi8(pixels, zero), _mm_unpackhi_epi8(pixels, zero));
+}
+
+/** Box filter 4 pixels out of 8 pixels each of two lines of 4-byte pixels. */
+static FORCEINLINE void downsample8(byte *dest, const byte *line0, const byte *line1) {
+	const __m128i two = _mm_set1_epi16(2);
+
+	__m128i sum0 = _mm_add_epi16(addPixelPairs(_mm_loadu_si128((const __m128i *)  line0      )),
+	                             addPixelPairs(_mm_loadu_si128((const __m128i *)  line1      )));
+	__m128i sum1 = _mm_add_epi16(addPixelPairs(_mm_loadu_si128((const __m128i *) (line0 + 16))),
+	                             addPixelPairs(_mm_loadu_si128((const __m128i *) (line1 + 16))));
+
+	sum0 = _mm_srli_epi16(_mm_add_epi16(sum0, two), 2);
+	sum1 = _mm_srli_epi16(_mm_add_epi16(sum1, two), 2);
+
+	_mm_storeu_si128((__m128i *) dest, _mm_packus_epi16(sum0, sum1));
+}
+#endif
+
 ImageDecoder::MipMap::MipMap() : width(0), height(0), size(0), data(0) {
 }
 
@@ -98,6 +139,14 @@ const ImageDecoder::MipMap &ImageDecoder::getMipMap(uint32 mipMap) const {
 	return *_mipMaps[mipMap];
 }
 
+uint32 ImageDecoder::getDataSize() const {
+	uint32 size = 0;
+	for (std::vector<MipMap *>::const_iterator m = _mipMaps.begin(); m != _mipMaps.end(); ++m)
+		size += (*m)->size;
+
+	return size;
+}
+
 void ImageDecoder::decompress(MipMap &out, const MipMap &in, PixelFormatRaw format) {
 	if ((format != kPixelFormatDXT1) &&
 	    (format != kPixelFormatDXT3) &&
@@ -109,16 +158,29 @@ void ImageDecoder::decompress(MipMap &out, const MipMap &in, PixelFormatRaw form
 	out.size   = out.width * out.height * 4;
 	out.data   = new byte[out.size];
 
-	Common::MemoryReadStream *stream = new Common::MemoryReadStream(in.data, in.size);
+	const uint32 blockSize = (format == kPixelFormatDXT1) ? 8 : 16;
+	const uint32 dataSize  = getCompressedSize(in.width, in.height, blockSize);
+
+	// Pad truncated data with zeroes, so the decompressor never reads past the end
+	const byte *data = in.data;
+	byte *padded = 0;
+	if (in.size < dataSize) {
+		padded = new byte[dataSize];
+
+		std::memcpy(padded, in.data, in.size);
+		std::memset(padded + in.size, 0, dataSize - in.size);
+
+		data = padded;
+	}
 
 	if      (format == kPixelFormatDXT1)
-		decompressDXT1(out.data, *stream, out.width, out.height, out.width * 4);
+		decompressDXT1(out.data, data, out.width, out.height, out.width * 4);
 	else if (format == kPixelFormatDXT3)
-		decompressDXT3(out.data, *stream, out.width, out.height, out.width * 4);
+		decompressDXT3(out.data, data, out.width, out.height, out.width * 4);
 	else if (format == kPixelFormatDXT5)
-		decompressDXT5(out.data, *stream, out.width, out.height, out.width * 4);
+		decompressDXT5(out.data, data, out.width, out.height, out.width * 4);
 
-	delete stream;
+	delete[] padded;
 }
 
 void ImageDecoder::decompress() {
@@ -139,6 +201,79 @@ void ImageDecoder::decompress() {
 	_compressed = false;
 }
 
+bool ImageDecoder::canBuildMipMaps() const {
+	if (_compressed || (_dataType != kPixelDataType8) || _mipMaps.empty())
+		return false;
+
+	return (_format == kPixelFormatRGB) || (_format == kPixelFormatBGR) ||
+	       (_format == kPixelFormatRGBA) || (_format == kPixelFormatBGRA);
+}
+
+void ImageDecoder::buildMipMaps() {
+	if ((_mipMaps.size() != 1) || !canBuildMipMaps())
+		return;
+
+	while ((_mipMaps.back()->width > 1) || (_mipMaps.back()->height > 1)) {
+		MipMap *mipMap = new MipMap;
+
+		try {
+			downsample(*mipMap, *_mipMaps.back(), _format);
+		} catch (...) {
+			delete mipMap;
+			throw;
+		}
+
+		_mipMaps.push_back(mipMap);
+	}
+}
+
+/** Downsample a mip map to half its size, optionally filtering 4-byte pixels with SSE2. */
+static void downsampleMipMap(ImageDecoder::MipMap &out, const ImageDecoder::MipMap &in,
+                             PixelFormat format, bool simd) {
+
+	const uint32 bpp = getBytesPerPixel(format);
+
+	out.width  = MAX(in.width  / 2, 1);
+	out.height = MAX(in.height / 2, 1);
+	out.size   = out.width * out.height * bpp;
+	out.data   = new byte[out.size];
+
+	// Odd dimensions drop the last line or column. A dimension of 1 stays, using its pixels twice
+	const uint32 inPitch  = in.width * bpp;
+	const uint32 outPitch = out.width * bpp;
+	const uint32 nextLine = (in.height > 1) ? inPitch : 0;
+	const uint32 nextCol  = (in.width  > 1) ? bpp     : 0;
+
+	for (int y = 0; y < out.height; y++) {
+		const byte *line0 = in.data + (nextLine * 2) * y;
+		const byte *line1 = line0 + nextLine;
+		byte       *dest  = out.data + outPitch * y;
+
+		int x = 0;
+
+#ifdef XOREOS_SSE2
+		if (simd && (bpp == 4) && nextCol) {
+			for (; (x + 4) <= out.width; x += 4, dest += 16, line0 += 32, line1 += 32)
+				downsample8(dest, line0, line1);
+		}
+#else
+		(void) simd;
+#endif
+
+		for (; x < out.width; x++, line0 += 2 * nextCol, line1 += 2 * nextCol)
+			for (uint32 c = 0; c < bpp; c++)
+				*dest++ = (line0[c] + line0[c + nextCol] + line1[c] + line1[c + nextCol] + 2) >> 2;
+	}
+}
+
+void ImageDecoder::downsample(MipMap &out, const MipMap &in, PixelFormat format) {
+	downsampleMipMap(out, in, format, true);
+}
+
+void ImageDecoder::downsampleScalar(MipMap &out, const MipMap &in, PixelFormat format) {
+	downsampleMipMap(out, in, format, false);
+}
+
 bool ImageDecoder::dumpTGA(const Common::UString &fileName) const {
 	if (_mipMaps.size() < 1)
 		return false;
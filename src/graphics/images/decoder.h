@@ -81,9 +81,26 @@ public:
 	/** Return a mip map. */
 	const MipMap &getMipMap(uint32 mipMap) const;
 
+	/** Return the size of all mip maps' image data, in bytes. */
+	uint32 getDataSize() const;
+
 	/** Manually decompress the texture image data. */
 	void decompress();
 
+	/** Can mip maps for this image be generated out of its first mip map? */
+	bool canBuildMipMaps() const;
+
+	/** Generate a full chain of mip maps down to 1x1, if the image only has one.
+	 *
+	 *  Each mip map is downsampled from the one before with a 2x2 box filter.
+	 */
+	void buildMipMaps();
+
+	/** Downsample a mip map of uncompressed 8-bit pixel data to half its size, using SSE2 if available. */
+	static void downsample(MipMap &out, const MipMap &in, PixelFormat format);
+	/** Downsample a mip map of uncompressed 8-bit pixel data to half its size, without using SSE2. */
+	static void downsampleScalar(MipMap &out, const MipMap &in, PixelFormat format);
+
 	/** Return TXI data, if embedded in the image. */
 	virtual Common::SeekableReadStream *getTXI() const;
 
@@ -27,177 +27,379 @@
  *  Manual S3TC DXTn decompression methods.
  */
 
+#include <cstring>
+
 #include "common/util.h"
-#include "common/stream.h"
+#include "common/endianness.h"
+#include "common/mutex.h"
+#include "common/thread.h"
+#include "common/threads.h"
 
 #include "graphics/images/s3tc.h"
 
+#ifdef XOREOS_SSE2
+	#include <emmintrin.h>
+#endif
+
+/** Images with at least that many blocks are decompressed by several threads. */
+static const uint32 kThreadMinBlocks = 16384;
+/** The number of threads decompressing a big image, including the calling one. */
+static const uint32 kThreadCount     = 4;
+/** Milliseconds an idle helper thread waits before looking whether it should stop. */
+static const uint32 kHelperTimeout   = 100;
+
 namespace Graphics {
 
-static uint32 convert565To8888(uint16 color) {
-	return ((color & 0x1F) << 11) | ((color & 0x7E0) << 13) | ((color & 0xF800) << 16) | 0xFF;
+/** A pixel with the color channels in RGBA byte order, as it lies in memory. */
+static FORCEINLINE uint32 makePixel(uint32 r, uint32 g, uint32 b, uint32 a) {
+	return TO_BE_32((r << 24) | (g << 16) | (b << 8) | a);
 }
 
-static uint32 interpolate32(double weight, uint32 color_0, uint32 color_1) {
-	byte r[3], g[3], b[3], a[3];
-	r[0] = color_0 >> 24;
-	r[1] = color_1 >> 24;
-	r[2] = (byte)((1.0f - weight) * (double)r[0] + weight * (double)r[1]);
-	g[0] = (color_0 >> 16) & 0xFF;
-	g[1] = (color_1 >> 16) & 0xFF;
-	g[2] = (byte)((1.0f - weight) * (double)g[0] + weight * (double)g[1]);
-	b[0] = (color_0 >> 8) & 0xFF;
-	b[1] = (color_1 >> 8) & 0xFF;
-	b[2] = (byte)((1.0f - weight) * (double)b[0] + weight * (double)b[1]);
-	a[0] = color_0 & 0xFF;
-	a[1] = color_1 & 0xFF;
-	a[2] = (byte)((1.0f - weight) * (double)a[0] + weight * (double)a[1]);
-	return r[2] << 24 | g[2] << 16 | b[2] << 8 | a[2];
+/** Read the two endpoint colors of a block and interpolate the other two.
+ *
+ *  With DXT1, a block whose first color is not greater than its second
+ *  color only has one interpolated color, and the fourth one is transparent.
+ *  DXT3 and DXT5 always interpolate two colors.
+ */
+static FORCEINLINE void readColors(const byte *src, uint32 *colors, uint32 alpha, bool dxt1) {
+	const uint16 color0 = READ_LE_UINT16(src    );
+	const uint16 color1 = READ_LE_UINT16(src + 2);
+
+	uint32 r[4], g[4], b[4];
+
+	r[0] = (color0 >> 11) & 0x1F; g[0] = (color0 >> 5) & 0x3F; b[0] = color0 & 0x1F;
+	r[1] = (color1 >> 11) & 0x1F; g[1] = (color1 >> 5) & 0x3F; b[1] = color1 & 0x1F;
+
+	for (int i = 0; i < 2; i++) {
+		r[i] = (r[i] << 3) | (r[i] >> 2);
+		g[i] = (g[i] << 2) | (g[i] >> 4);
+		b[i] = (b[i] << 3) | (b[i] >> 2);
+	}
+
+	colors[0] = makePixel(r[0], g[0], b[0], alpha);
+	colors[1] = makePixel(r[1], g[1], b[1], alpha);
+
+	if (!dxt1 || (color0 > color1)) {
+		colors[2] = makePixel((2 * r[0] + r[1]) / 3, (2 * g[0] + g[1]) / 3, (2 * b[0] + b[1]) / 3, alpha);
+		colors[3] = makePixel((r[0] + 2 * r[1]) / 3, (g[0] + 2 * g[1]) / 3, (b[0] + 2 * b[1]) / 3, alpha);
+	} else {
+		colors[2] = makePixel((r[0] + r[1]) / 2, (g[0] + g[1]) / 2, (b[0] + b[1]) / 2, alpha);
+		colors[3] = 0;
+	}
 }
 
-struct DXT1Texel {
-	uint16 color_0;
-	uint16 color_1;
-	uint32 pixels;
-};
+/** Write a full 4x4 block of pixels.
+ *
+ *  @param dest    The top-left pixel of the block.
+ *  @param pitch   The number of bytes in an image line.
+ *  @param colors  The four block colors.
+ *  @param indices The four bytes of 2-bit color indices, one byte per line.
+ *  @param alpha   The alpha value of each of the 16 pixels, to be or'd
+ *                 into the colors. 0 if the colors already hold the alpha.
+ */
+static FORCEINLINE void writeBlock(byte *dest, uint32 pitch, const uint32 *colors,
+                                   const byte *indices, const uint32 *alpha) {
 
-#define READ_DXT1_TEXEL(x) \
-	x.color_0 = src.readUint16LE(); \
-	x.color_1 = src.readUint16LE(); \
-	x.pixels = src.readUint32BE()
-
-void decompressDXT1(byte *dest, Common::SeekableReadStream &src, uint32 width, uint32 height, uint32 pitch) {
-	for (int32 ty = height; ty > 0; ty -= 4) {
-		for (uint32 tx = 0; tx < width; tx += 4) {
-			DXT1Texel tex;
-			READ_DXT1_TEXEL(tex);
-			uint32 blended[4];
-
-			blended[0] = convert565To8888(tex.color_0);
-			blended[1] = convert565To8888(tex.color_1);
-
-			if (tex.color_0 > tex.color_1) {
-				blended[2] = interpolate32(0.333333f, blended[0], blended[1]);
-				blended[3] = interpolate32(0.666666f, blended[0], blended[1]);
-			} else {
-				blended[2] = interpolate32(0.5f, blended[0], blended[1]);
-				blended[3] = 0;
-			}
+#ifdef XOREOS_SSE2
+	/* Expand the indices of two lines at once into 16-bit lanes. Multiplying
+	 * by a power of two shifts each lane by a different amount, so that the
+	 * 2-bit index of the lane's pixel ends up in the same position in all lanes.
+	 * Each pixel's color is then picked with a mask comparing its index. */
 
-			uint32 cpx = tex.pixels;
-			uint32 blockWidth = MIN<uint32>(width, 4);
-			uint32 blockHeight = MIN<uint32>(height, 4);
+	const __m128i shifts = _mm_set_epi16(1, 4, 16, 64, 1, 4, 16, 64);
+	const __m128i three  = _mm_set1_epi16(3);
 
-			for (byte y = 0; y < blockHeight; ++y) {
-				for (byte x = 0; x < blockWidth; ++x) {
-					WRITE_BE_UINT32(dest + (height - 1 - (ty - blockHeight + y)) * pitch + (tx + x) * 4, blended[cpx & 3]);
-					cpx >>= 2;
-				}
-			}
+	const __m128i color0 = _mm_set1_epi32(colors[0]);
+	const __m128i color1 = _mm_set1_epi32(colors[1]);
+	const __m128i color2 = _mm_set1_epi32(colors[2]);
+	const __m128i color3 = _mm_set1_epi32(colors[3]);
+
+	const __m128i index1 = _mm_set1_epi32(0x00010001);
+	const __m128i index2 = _mm_set1_epi32(0x00020002);
+	const __m128i index3 = _mm_set1_epi32(0x00030003);
+
+	for (int y = 0; y < 4; y += 2) {
+		__m128i lines = _mm_set_epi16(indices[y + 1], indices[y + 1], indices[y + 1], indices[y + 1],
+		                              indices[y    ], indices[y    ], indices[y    ], indices[y    ]);
+
+		lines = _mm_and_si128(_mm_srli_epi16(_mm_mullo_epi16(lines, shifts), 6), three);
+
+		const __m128i lineIndices[2] = { _mm_unpacklo_epi16(lines, lines), _mm_unpackhi_epi16(lines, lines) };
+
+		for (int i = 0; i < 2; i++) {
+			const __m128i mask1 = _mm_cmpeq_epi32(lineIndices[i], index1);
+			const __m128i mask2 = _mm_cmpeq_epi32(lineIndices[i], index2);
+			const __m128i mask3 = _mm_cmpeq_epi32(lineIndices[i], index3);
+			const __m128i mask0 = _mm_cmpeq_epi32(lineIndices[i], _mm_setzero_si128());
+
+			__m128i line = _mm_or_si128(_mm_or_si128(_mm_and_si128(mask0, color0), _mm_and_si128(mask1, color1)),
+			                            _mm_or_si128(_mm_and_si128(mask2, color2), _mm_and_si128(mask3, color3)));
+
+			if (alpha)
+				line = _mm_or_si128(line, _mm_loadu_si128((const __m128i *) (alpha + (y + i) * 4)));
+
+			_mm_storeu_si128((__m128i *) (dest + (y + i) * pitch), line);
 		}
 	}
+
+#else
+
+	for (int y = 0; y < 4; y++, dest += pitch) {
+		uint32 line = indices[y];
+
+		uint32 pixels[4];
+		for (int x = 0; x < 4; x++, line >>= 2)
+			pixels[x] = colors[line & 3] | (alpha ? alpha[y * 4 + x] : 0);
+
+		std::memcpy(dest, pixels, sizeof(pixels));
+	}
+
+#endif
+}
+
+/** Decompress a DXT1 block: 8 bytes of colors and color indices. */
+static void decompressBlockDXT1(byte *dest, uint32 pitch, const byte *src) {
+	uint32 colors[4];
+	readColors(src, colors, 0xFF, true);
+
+	writeBlock(dest, pitch, colors, src + 4, 0);
+}
+
+/** Decompress a DXT3 block: 8 bytes of explicit 4-bit alpha, followed by a DXT1 block. */
+static void decompressBlockDXT3(byte *dest, uint32 pitch, const byte *src) {
+	uint32 alpha[16];
+	for (int i = 0; i < 8; i++) {
+		const uint32 alpha0 = src[i] & 0x0F;
+		const uint32 alpha1 = src[i] >> 4;
+
+		alpha[i * 2    ] = makePixel(0, 0, 0, alpha0 | (alpha0 << 4));
+		alpha[i * 2 + 1] = makePixel(0, 0, 0, alpha1 | (alpha1 << 4));
+	}
+
+	uint32 colors[4];
+	readColors(src + 8, colors, 0, false);
+
+	writeBlock(dest, pitch, colors, src + 12, alpha);
 }
 
-struct DXT23Texel : public DXT1Texel {
-	uint16 alpha[4];
+/** Decompress a DXT5 block: 2 alpha endpoints, 6 bytes of 3-bit alpha
+ *  indices, followed by a DXT1 block. */
+static void decompressBlockDXT5(byte *dest, uint32 pitch, const byte *src) {
+	const uint32 alpha0 = src[0];
+	const uint32 alpha1 = src[1];
+
+	uint32 alphas[8];
+	alphas[0] = alpha0;
+	alphas[1] = alpha1;
+
+	if (alpha0 > alpha1) {
+		for (uint32 i = 1; i < 7; i++)
+			alphas[i + 1] = ((7 - i) * alpha0 + i * alpha1 + 3) / 7;
+	} else {
+		for (uint32 i = 1; i < 5; i++)
+			alphas[i + 1] = ((5 - i) * alpha0 + i * alpha1 + 2) / 5;
+
+		alphas[6] = 0;
+		alphas[7] = 255;
+	}
+
+	for (int i = 0; i < 8; i++)
+		alphas[i] = makePixel(0, 0, 0, alphas[i]);
+
+	uint64 indices = READ_LE_UINT32(src + 2) | (((uint64) READ_LE_UINT16(src + 6)) << 32);
+
+	uint32 alpha[16];
+	for (int i = 0; i < 16; i++, indices >>= 3)
+		alpha[i] = alphas[indices & 7];
+
+	uint32 colors[4];
+	readColors(src + 8, colors, 0, false);
+
+	writeBlock(dest, pitch, colors, src + 12, alpha);
+}
+
+typedef void (*DecompressBlockFunc)(byte *dest, uint32 pitch, const byte *src);
+
+/** A range of block lines to decompress. */
+struct DecompressJob {
+	byte *dest;
+	const byte *src;
+
+	uint32 width;
+	uint32 height;
+	uint32 pitch;
+
+	uint32 blockSize;
+	DecompressBlockFunc decompressBlock;
+
+	uint32 lineStart; ///< The first block line to decompress.
+	uint32 lineEnd;   ///< One past the last block line to decompress.
 };
 
-#define READ_DXT3_TEXEL(x) \
-	x.alpha[0] = src.readUint16LE(); \
-	x.alpha[1] = src.readUint16LE(); \
-	x.alpha[2] = src.readUint16LE(); \
-	x.alpha[3] = src.readUint16LE(); \
-	READ_DXT1_TEXEL(x)
-
-void decompressDXT3(byte *dest, Common::SeekableReadStream &src, uint32 width, uint32 height, uint32 pitch) {
-	for (int32 ty = height; ty > 0; ty -= 4) {
-		for (uint32 tx = 0; tx < width; tx += 4) {
-			DXT23Texel tex;
-			uint32 blended[4];
-			READ_DXT3_TEXEL(tex);
-
-			blended[0] = convert565To8888(tex.color_0) & 0xFFFFFF00;
-			blended[1] = convert565To8888(tex.color_1) & 0xFFFFFF00;
-			blended[2] = interpolate32(0.333333f, blended[0], blended[1]);
-			blended[3] = interpolate32(0.666666f, blended[0], blended[1]);
-
-			uint32 cpx = tex.pixels;
-			uint32 blockWidth = MIN<uint32>(width, 4);
-			uint32 blockHeight = MIN<uint32>(height, 4);
-
-			for (byte y = 0; y < blockHeight; ++y) {
-				for (byte x = 0; x < blockWidth; ++x) {
-					uint32 alpha = (tex.alpha[y] >> (x * 4)) & 0xF;
-					WRITE_BE_UINT32(dest + (height - 1 - (ty - blockHeight + y)) * pitch + (tx + x) * 4, blended[cpx & 3] | alpha << 4);
-					cpx >>= 2;
-				}
+static void decompressLines(const DecompressJob &job) {
+	const uint32 blocksX = (job.width + 3) / 4;
+
+	const byte *src = job.src + job.lineStart * blocksX * job.blockSize;
+
+	for (uint32 by = job.lineStart; by < job.lineEnd; by++) {
+		const uint32 y = by * 4;
+
+		for (uint32 x = 0; x < job.width; x += 4, src += job.blockSize) {
+			byte *dest = job.dest + y * job.pitch + x * 4;
+
+			if (((x + 4) <= job.width) && ((y + 4) <= job.height)) {
+				job.decompressBlock(dest, job.pitch, src);
+				continue;
 			}
+
+			// A block sticking out of the image, only copy the pixels inside
+
+			byte block[4 * 4 * 4];
+			job.decompressBlock(block, 4 * 4, src);
+
+			const uint32 blockWidth  = MIN<uint32>(job.width  - x, 4);
+			const uint32 blockHeight = MIN<uint32>(job.height - y, 4);
+
+			for (uint32 i = 0; i < blockHeight; i++)
+				std::memcpy(dest + i * job.pitch, block + i * 4 * 4, blockWidth * 4);
 		}
 	}
 }
 
-struct DXT45Texel : public DXT1Texel {
-	byte alpha_0;
-	byte alpha_1;
-	uint64 alphabl;
-};
+/** A thread helping the main thread decompress big images. */
+class DecompressHelper : public Common::Thread {
+public:
+	DecompressHelper() : _started(false), _job(0), _newJob(_mutex), _jobDone(_mutex) {
+	}
 
-static uint64 readUint48LE(Common::SeekableReadStream &src) {
-	uint64 output = src.readUint32LE();
-	return output | ((uint64)src.readUint16LE() << 32);
-}
+	~DecompressHelper() {
+		destroyThread();
+	}
 
-#define READ_DXT5_TEXEL(x) \
-	x.alpha_0 = src.readByte(); \
-	x.alpha_1 = src.readByte(); \
-	x.alphabl = readUint48LE(src); \
-	READ_DXT1_TEXEL(x)
-
-void decompressDXT5(byte *dest, Common::SeekableReadStream &src, uint32 width, uint32 height, uint32 pitch) {
-	for (int32 ty = height; ty > 0; ty -= 4) {
-		for (uint32 tx = 0; tx < width; tx += 4) {
-			uint32 blended[4];
-			byte alphab[8];
-			DXT45Texel tex;
-			READ_DXT5_TEXEL(tex);
-
-			alphab[0] = tex.alpha_0;
-			alphab[1] = tex.alpha_1;
-
-			if (tex.alpha_0 > tex.alpha_1) {
-				alphab[2] = (byte)((6.0f * (double)alphab[0] + 1.0f * (double)alphab[1] + 3.0f) / 7.0f);
-				alphab[3] = (byte)((5.0f * (double)alphab[0] + 2.0f * (double)alphab[1] + 3.0f) / 7.0f);
-				alphab[4] = (byte)((4.0f * (double)alphab[0] + 3.0f * (double)alphab[1] + 3.0f) / 7.0f);
-				alphab[5] = (byte)((3.0f * (double)alphab[0] + 4.0f * (double)alphab[1] + 3.0f) / 7.0f);
-				alphab[6] = (byte)((2.0f * (double)alphab[0] + 5.0f * (double)alphab[1] + 3.0f) / 7.0f);
-				alphab[7] = (byte)((1.0f * (double)alphab[0] + 6.0f * (double)alphab[1] + 3.0f) / 7.0f);
-			} else {
-				alphab[2] = (byte)((4.0f * (double)alphab[0] + 1.0f * (double)alphab[1] + 2.0f) / 5.0f);
-				alphab[3] = (byte)((3.0f * (double)alphab[0] + 2.0f * (double)alphab[1] + 2.0f) / 5.0f);
-				alphab[4] = (byte)((2.0f * (double)alphab[0] + 3.0f * (double)alphab[1] + 2.0f) / 5.0f);
-				alphab[5] = (byte)((1.0f * (double)alphab[0] + 4.0f * (double)alphab[1] + 2.0f) / 5.0f);
-				alphab[6] = 0;
-				alphab[7] = 255;
-			}
+	/** Decompress this job in the background. Returns false if there's no thread to do it. */
+	bool start(const DecompressJob &job) {
+		if (!_started && !(_started = createThread()))
+			return false;
+
+		_mutex.lock();
+		_job = &job;
+		_mutex.unlock();
 
-			blended[0] = convert565To8888(tex.color_0) & 0xFFFFFF00;
-			blended[1] = convert565To8888(tex.color_1) & 0xFFFFFF00;
-			blended[2] = interpolate32(0.333333f, blended[0], blended[1]);
-			blended[3] = interpolate32(0.666666f, blended[0], blended[1]);
-
-			uint32 cpx = tex.pixels;
-			uint32 blockWidth = MIN<uint32>(width, 4);
-			uint32 blockHeight = MIN<uint32>(height, 4);
-
-			for (byte y = 0; y < blockHeight; ++y) {
-				for (byte x = 0; x < blockWidth; ++x) {
-					uint32 alpha = alphab[(tex.alphabl >> (3 * (4 * (3 - y) + x))) & 7];
-					WRITE_BE_UINT32(dest + (height - 1 - (ty - blockHeight + y)) * pitch + (tx + x) * 4, blended[cpx & 3] | alpha);
-					cpx >>= 2;
-				}
+		_newJob.signal();
+		return true;
+	}
+
+	/** Wait until the job is done. */
+	void finish() {
+		_mutex.lock();
+
+		while (_job)
+			_jobDone.wait(kHelperTimeout);
+
+		_mutex.unlock();
+	}
+
+private:
+	bool _started;
+
+	const DecompressJob *_job;
+
+	Common::Mutex _mutex;
+
+	Common::Condition _newJob;  ///< Signals a new job.
+	Common::Condition _jobDone; ///< Signals a finished job.
+
+	void threadMethod() {
+		_mutex.lock();
+
+		while (!_killThread) {
+			if (!_job) {
+				_newJob.wait(kHelperTimeout);
+				continue;
 			}
+
+			const DecompressJob *job = _job;
+
+			_mutex.unlock();
+			decompressLines(*job);
+			_mutex.lock();
+
+			_job = 0;
+			_jobDone.signal();
 		}
+
+		_mutex.unlock();
+	}
+};
+
+/** Should an image of that many blocks be split across the helper threads?
+ *
+ *  Only the main thread waits for images to be decompressed, holding up
+ *  everything else. Other threads, like the texture decoding threads, are
+ *  already running in parallel to each other, so splitting their images
+ *  as well would only oversubscribe the CPU.
+ */
+static bool useHelpers(uint32 blocks) {
+	return (blocks >= kThreadMinBlocks) && Common::initedThreads() && Common::isMainThread();
+}
+
+static void decompress(byte *dest, const byte *src, uint32 width, uint32 height, uint32 pitch,
+                       uint32 blockSize, DecompressBlockFunc decompressBlock) {
+
+	const uint32 blocksX = (width  + 3) / 4;
+	const uint32 blocksY = (height + 3) / 4;
+
+	DecompressJob jobs[kThreadCount];
+
+	uint32 jobCount = 1;
+	if (useHelpers(blocksX * blocksY))
+		jobCount = MIN(kThreadCount, blocksY);
+
+	for (uint32 i = 0; i < jobCount; i++) {
+		jobs[i].dest   = dest;
+		jobs[i].src    = src;
+		jobs[i].width  = width;
+		jobs[i].height = height;
+		jobs[i].pitch  = pitch;
+
+		jobs[i].blockSize       = blockSize;
+		jobs[i].decompressBlock = decompressBlock;
+
+		jobs[i].lineStart = ( i      * blocksY) / jobCount;
+		jobs[i].lineEnd   = ((i + 1) * blocksY) / jobCount;
 	}
+
+	/* Hand all but the first range to the helper threads, and decompress that one ourselves.
+	 * Only the main thread uses the helpers, so they're created once and never shared. */
+
+	static DecompressHelper helpers[kThreadCount - 1];
+
+	bool started[kThreadCount];
+	for (uint32 i = 1; i < jobCount; i++)
+		if (!(started[i] = helpers[i - 1].start(jobs[i])))
+			decompressLines(jobs[i]);
+
+	decompressLines(jobs[0]);
+
+	for (uint32 i = 1; i < jobCount; i++)
+		if (started[i])
+			helpers[i - 1].finish();
+}
+
+uint32 getCompressedSize(uint32 width, uint32 height, uint32 blockSize) {
+	return ((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+}
+
+void decompressDXT1(byte *dest, const byte *src, uint32 width, uint32 height, uint32 pitch) {
+	decompress(dest, src, width, height, pitch, 8, decompressBlockDXT1);
+}
+
+void decompressDXT3(byte *dest, const byte *src, uint32 width, uint32 height, uint32 pitch) {
+	decompress(dest, src, width, height, pitch, 16, decompressBlockDXT3);
+}
+
+void decompressDXT5(byte *dest, const byte *src, uint32 width, uint32 height, uint32 pitch) {
+	decompress(dest, src, width, height, pitch, 16, decompressBlockDXT5);
 }
 
 } // End of namespace Graphics
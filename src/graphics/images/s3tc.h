@@ -32,15 +32,24 @@
 
 #include "common/types.h"
 
-namespace Common {
-	class SeekableReadStream;
-}
-
 namespace Graphics {
 
-void decompressDXT1(byte *dest, Common::SeekableReadStream &src, uint32 width, uint32 height, uint32 pitch);
-void decompressDXT3(byte *dest, Common::SeekableReadStream &src, uint32 width, uint32 height, uint32 pitch);
-void decompressDXT5(byte *dest, Common::SeekableReadStream &src, uint32 width, uint32 height, uint32 pitch);
+/** Return the number of bytes of S3TC data for an image of these dimensions.
+ *
+ *  @param blockSize The size of a 4x4 block: 8 for DXT1, 16 for DXT3 and DXT5.
+ */
+uint32 getCompressedSize(uint32 width, uint32 height, uint32 blockSize);
+
+/** Decompress S3TC DXT1 data into RGBA pixels.
+ *
+ *  src needs to hold getCompressedSize(width, height, 8) bytes. Big images
+ *  decompressed on the main thread are split across a few helper threads.
+ */
+void decompressDXT1(byte *dest, const byte *src, uint32 width, uint32 height, uint32 pitch);
+/** Decompress S3TC DXT3 data into RGBA pixels. See decompressDXT1(). */
+void decompressDXT3(byte *dest, const byte *src, uint32 width, uint32 height, uint32 pitch);
+/** Decompress S3TC DXT5 data into RGBA pixels. See decompressDXT1(). */
+void decompressDXT5(byte *dest, const byte *src, uint32 width, uint32 height, uint32 pitch);
 
 } // End of namespace Graphics
 
@@ -81,34 +81,50 @@ void SBM::readData(Common::SeekableReadStream &sbm) {
 	// coordinates but different planes.
 	// We'll unpack them and draw them next to each other instead.
 
-	int masks [4] = { 0x03, 0x0C, 0x30, 0xC0 };
-	int shifts[4] = {    0,    2,    4,    6 };
+	// All pixels are white, with one of four alpha values
+	byte pixels[4][4];
+	for (int i = 0; i < 4; i++) {
+		pixels[i][0] = 0xFF;     // B
+		pixels[i][1] = 0xFF;     // G
+		pixels[i][2] = 0xFF;     // R
+		pixels[i][3] = i * 0x55; // A
+	}
 
-	byte *data = _mipMaps[0]->data;
-	byte buffer[1024];
-	for (uint32 c = 0; c < rowCount; c++) {
+	// Read all characters at once, or use them directly out of a memory stream
+	const uint32 dataSize = rowCount * 1024;
+
+	Common::MemoryReadStream *memStream = dynamic_cast<Common::MemoryReadStream *>(&sbm);
+
+	const byte *src = memStream ? memStream->readInPlace(dataSize) : 0;
+
+	byte *buffer = 0;
+	if (!src) {
+		buffer = new byte[dataSize];
 
-		if (sbm.read(buffer, 1024) != 1024)
+		if (sbm.read(buffer, dataSize) != dataSize) {
+			delete[] buffer;
 			throw Common::Exception(Common::kReadError);
+		}
 
-		for (int y = 0; y < 32; y++) {
-			byte *src = buffer + y * 32;
+		src = buffer;
+	}
 
+	byte *data = _mipMaps[0]->data;
+	for (uint32 c = 0; c < rowCount; c++) {
+		for (int y = 0; y < 32; y++, src += 32) {
 			for (int plane = 0; plane < 4; plane++) {
-				for (int x = 0; x < 32; x++) {
-					byte a = ((src[x] & masks[plane]) >> shifts[plane]) * 0x55;
-
-					*data++ = 0xFF; // B
-					*data++ = 0xFF; // G
-					*data++ = 0xFF; // R
-					*data++ = a;    // A
-				}
+				const int shift = plane * 2;
+
+				for (int x = 0; x < 32; x++, data += 4)
+					memcpy(data, pixels[(src[x] >> shift) & 0x03], 4);
 			}
 		}
 	}
 
+	delete[] buffer;
+
 	byte *dataEnd = _mipMaps[0]->data + _mipMaps[0]->size;
-	memset(data, dataEnd - data, 0);
+	memset(data, 0, dataEnd - data);
 }
 
 } // End of namespace Graphics
@@ -193,44 +193,50 @@ void TPC::readHeader(Common::SeekableReadStream &tpc, bool &needDeSwizzle) {
 
 }
 
-void TPC::deSwizzle(byte *dst, const byte *src, uint32 width, uint32 height) {
-	for (uint32 y = 0; y < height; y++) {
-		for (uint32 x = 0; x < width; x++) {
-			const uint32 offset = deSwizzleOffset(x, y, width, height) * 4;
-
-			*dst++ = src[offset + 0];
-			*dst++ = src[offset + 1];
-			*dst++ = src[offset + 2];
-			*dst++ = src[offset + 3];
-		}
-	}
-}
-
 void TPC::readData(Common::SeekableReadStream &tpc, bool needDeSwizzle) {
-	for (std::vector<MipMap *>::iterator mipMap = _mipMaps.begin(); mipMap != _mipMaps.end(); ++mipMap) {
+	// Swizzled data we can deswizzle straight out of the memory of a memory stream
+	Common::MemoryReadStream *memStream = dynamic_cast<Common::MemoryReadStream *>(&tpc);
+
+	// Otherwise, we need a buffer big enough for the first and biggest mip map
+	byte *buffer = 0;
 
-		// If the texture width is a power of two, the texture memory layout is "swizzled"
-		const bool widthPOT = ((*mipMap)->width & ((*mipMap)->width - 1)) == 0;
-		const bool swizzled = needDeSwizzle && widthPOT;
+	try {
+
+		for (std::vector<MipMap *>::iterator mipMap = _mipMaps.begin(); mipMap != _mipMaps.end(); ++mipMap) {
+
+			// If the texture width is a power of two, the texture memory layout is "swizzled"
+			const bool widthPOT = ((*mipMap)->width & ((*mipMap)->width - 1)) == 0;
+			const bool swizzled = needDeSwizzle && widthPOT;
 
-		(*mipMap)->data = new byte[(*mipMap)->size];
+			(*mipMap)->data = new byte[(*mipMap)->size];
 
-		if (swizzled) {
-			byte *tmp = new byte[(*mipMap)->size];
+			if (!swizzled) {
+				if (tpc.read((*mipMap)->data, (*mipMap)->size) != (*mipMap)->size)
+					throw Common::Exception(Common::kReadError);
 
-			if (tpc.read(tmp, (*mipMap)->size) != (*mipMap)->size)
-				throw Common::Exception(Common::kReadError);
+				continue;
+			}
 
-			deSwizzle((*mipMap)->data, tmp, (*mipMap)->width, (*mipMap)->height);
+			const byte *src = memStream ? memStream->readInPlace((*mipMap)->size) : 0;
+			if (!src) {
+				if (!buffer)
+					buffer = new byte[(*mipMap)->size];
 
-			delete[] tmp;
+				if (tpc.read(buffer, (*mipMap)->size) != (*mipMap)->size)
+					throw Common::Exception(Common::kReadError);
 
-		} else {
-			if (tpc.read((*mipMap)->data, (*mipMap)->size) != (*mipMap)->size)
-				throw Common::Exception(Common::kReadError);
+				src = buffer;
+			}
+
+			deSwizzle((*mipMap)->data, src, (*mipMap)->width, (*mipMap)->height);
 		}
 
+	} catch (...) {
+		delete[] buffer;
+		throw;
 	}
+
+	delete[] buffer;
 }
 
 void TPC::readTXIData(Common::SeekableReadStream &tpc) {
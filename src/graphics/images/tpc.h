@@ -58,8 +58,6 @@ private:
 	void readHeader(Common::SeekableReadStream &tpc, bool &needDeSwizzle);
 	void readData(Common::SeekableReadStream &tpc, bool needDeSwizzle);
 	void readTXIData(Common::SeekableReadStream &tpc);
-
-	static void deSwizzle(byte *dst, const byte *src, uint32 width, uint32 height);
 };
 
 } // End of namespace Graphics
@@ -0,0 +1,194 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey and Eclipse engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/images/xtc.cpp
+ *  XTC (xoreos' own texture cache format) loading and writing.
+ */
+
+#include "common/util.h"
+#include "common/error.h"
+#include "common/stream.h"
+
+#include "graphics/images/xtc.h"
+
+static const uint32 kXTCID      = MKID_BE('XTC ');
+static const uint32 kXTCVersion = 1;
+
+static const uint32 kFlagCompressed = 0x01;
+static const uint32 kFlagHasAlpha   = 0x02;
+
+/** Refuse mip maps bigger than that, they can't be ours. */
+static const uint32 kMaxDimension = 16384;
+
+namespace Graphics {
+
+XTC::XTC(Common::SeekableReadStream &xtc) : _txiData(0), _txiDataSize(0) {
+	load(xtc);
+}
+
+XTC::~XTC() {
+	delete[] _txiData;
+}
+
+void XTC::load(Common::SeekableReadStream &xtc) {
+	try {
+
+		readHeader (xtc);
+		readData   (xtc);
+		readTXIData(xtc);
+
+		if (xtc.err())
+			throw Common::Exception(Common::kReadError);
+
+	} catch (Common::Exception &e) {
+		e.add("Failed reading XTC file");
+		throw e;
+	}
+}
+
+Common::SeekableReadStream *XTC::getTXI() const {
+	if (!_txiData || (_txiDataSize == 0))
+		return 0;
+
+	return new Common::MemoryReadStream(_txiData, _txiDataSize);
+}
+
+void XTC::readHeader(Common::SeekableReadStream &xtc) {
+	const uint32 id      = xtc.readUint32BE();
+	const uint32 version = xtc.readUint32LE();
+
+	if ((id != kXTCID) || (version != kXTCVersion))
+		throw Common::Exception("Not a version %d XTC file", kXTCVersion);
+
+	const uint32 flags = xtc.readUint32LE();
+
+	_compressed = (flags & kFlagCompressed) != 0;
+	_hasAlpha   = (flags & kFlagHasAlpha  ) != 0;
+
+	_format    = (PixelFormat   ) xtc.readUint32LE();
+	_formatRaw = (PixelFormatRaw) xtc.readUint32LE();
+	_dataType  = (PixelDataType ) xtc.readUint32LE();
+
+	const uint32 mipMapCount = xtc.readUint32LE();
+	if ((mipMapCount == 0) || (mipMapCount > 32))
+		throw Common::Exception("Invalid XTC mip map count %d", mipMapCount);
+
+	_mipMaps.reserve(mipMapCount);
+	for (uint32 i = 0; i < mipMapCount; i++) {
+		MipMap *mipMap = new MipMap;
+
+		_mipMaps.push_back(mipMap);
+
+		mipMap->width  = xtc.readUint32LE();
+		mipMap->height = xtc.readUint32LE();
+		mipMap->size   = xtc.readUint32LE();
+
+		if ((mipMap->width  == 0) || (((uint32) mipMap->width ) > kMaxDimension) ||
+		    (mipMap->height == 0) || (((uint32) mipMap->height) > kMaxDimension))
+			throw Common::Exception("Invalid XTC mip map dimensions %dx%d", mipMap->width, mipMap->height);
+
+		// No format we use needs more than 4 bytes per pixel, or 16 bytes per S3TC block
+		if (mipMap->size > MAX<uint32>(mipMap->width * mipMap->height * 4, 16))
+			throw Common::Exception("Invalid XTC mip map size %d", mipMap->size);
+	}
+}
+
+void XTC::readData(Common::SeekableReadStream &xtc) {
+	for (std::vector<MipMap *>::iterator mipMap = _mipMaps.begin(); mipMap != _mipMaps.end(); ++mipMap) {
+		(*mipMap)->data = new byte[(*mipMap)->size];
+
+		if (xtc.read((*mipMap)->data, (*mipMap)->size) != (*mipMap)->size)
+			throw Common::Exception(Common::kReadError);
+	}
+}
+
+void XTC::readTXIData(Common::SeekableReadStream &xtc) {
+	_txiDataSize = xtc.readUint32LE();
+	if (_txiDataSize == 0)
+		return;
+
+	if (_txiDataSize > ((uint32) (xtc.size() - xtc.pos())))
+		throw Common::Exception(Common::kReadError);
+
+	_txiData = new byte[_txiDataSize];
+
+	if (xtc.read(_txiData, _txiDataSize) != _txiDataSize)
+		throw Common::Exception(Common::kReadError);
+}
+
+uint32 XTC::getVersion() {
+	return kXTCVersion;
+}
+
+void XTC::write(Common::WriteStream &xtc, const ImageDecoder &image) {
+	const uint32 flags = (image.isCompressed() ? kFlagCompressed : 0) |
+	                     (image.hasAlpha()     ? kFlagHasAlpha   : 0);
+
+	xtc.writeUint32BE(kXTCID);
+	xtc.writeUint32LE(kXTCVersion);
+
+	xtc.writeUint32LE(flags);
+
+	xtc.writeUint32LE((uint32) image.getFormat());
+	xtc.writeUint32LE((uint32) image.getFormatRaw());
+	xtc.writeUint32LE((uint32) image.getDataType());
+
+	xtc.writeUint32LE(image.getMipMapCount());
+	for (uint32 i = 0; i < image.getMipMapCount(); i++) {
+		const MipMap &mipMap = image.getMipMap(i);
+
+		xtc.writeUint32LE(mipMap.width);
+		xtc.writeUint32LE(mipMap.height);
+		xtc.writeUint32LE(mipMap.size);
+	}
+
+	for (uint32 i = 0; i < image.getMipMapCount(); i++) {
+		const MipMap &mipMap = image.getMipMap(i);
+
+		if (xtc.write(mipMap.data, mipMap.size) != mipMap.size)
+			throw Common::Exception(Common::kWriteError);
+	}
+
+	Common::SeekableReadStream *txi = image.getTXI();
+	if (!txi) {
+		xtc.writeUint32LE(0);
+		return;
+	}
+
+	try {
+		const uint32 txiSize = txi->size();
+
+		xtc.writeUint32LE(txiSize);
+		xtc.writeStream(*txi);
+
+	} catch (...) {
+		delete txi;
+		throw;
+	}
+
+	delete txi;
+}
+
+} // End of namespace Graphics
@@ -0,0 +1,78 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey and Eclipse engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/images/xtc.h
+ *  XTC (xoreos' own texture cache format) loading and writing.
+ */
+
+#ifndef GRAPHICS_IMAGES_XTC_H
+#define GRAPHICS_IMAGES_XTC_H
+
+#include "graphics/images/decoder.h"
+
+namespace Common {
+	class SeekableReadStream;
+	class WriteStream;
+}
+
+namespace Graphics {
+
+/** xoreos' own texture cache format, XTC.
+ *
+ *  An XTC holds a decoded image exactly as it's uploaded to OpenGL: the
+ *  pixel format, all mip maps and the TXI data the image had embedded.
+ *  Reading one back needs no further decoding at all.
+ *
+ *  The format is only meant for the texture cache of this very version
+ *  of xoreos. A cache file written by a different version is rejected.
+ */
+class XTC : public ImageDecoder {
+public:
+	XTC(Common::SeekableReadStream &xtc);
+	~XTC();
+
+	/** Return the enclosed TXI data. */
+	Common::SeekableReadStream *getTXI() const;
+
+	/** Write an image into an XTC. */
+	static void write(Common::WriteStream &xtc, const ImageDecoder &image);
+
+	/** Return the version of the XTC format written and read by this version of xoreos. */
+	static uint32 getVersion();
+
+private:
+	byte  *_txiData;
+	uint32 _txiDataSize;
+
+	// Loading helpers
+	void load(Common::SeekableReadStream &xtc);
+	void readHeader(Common::SeekableReadStream &xtc);
+	void readData(Common::SeekableReadStream &xtc);
+	void readTXIData(Common::SeekableReadStream &xtc);
+};
+
+} // End of namespace Graphics
+
+#endif // GRAPHICS_IMAGES_XTC_H
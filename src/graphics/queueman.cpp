@@ -105,6 +105,20 @@ void QueueManager::clearQueue(QueueType queue) {
 	unlockQueue(queue);
 }
 
+Queueable *QueueManager::popQueue(QueueType queue) {
+	Common::StackLock lock(_queueMutex[queue]);
+
+	if (_queue[queue].empty())
+		return 0;
+
+	Queueable *q = _queue[queue].front();
+
+	q->kickedOut(queue);
+	_queue[queue].pop_front();
+
+	return q;
+}
+
 void QueueManager::clearAllQueues() {
 	for (int i = 0; i < kQueueMAX; i++)
 		clearQueue((QueueType) i);
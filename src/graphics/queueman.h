@@ -58,6 +58,9 @@ public:
 	void sortQueue(QueueType queue);
 	void clearQueue(QueueType queue);
 
+	/** Remove the first element of the queue and return it. Returns 0 if the queue is empty. */
+	Queueable *popQueue(QueueType queue);
+
 	void clearAllQueues();
 
 private:
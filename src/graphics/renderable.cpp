@@ -35,7 +35,9 @@
 
 namespace Graphics {
 
-Renderable::Renderable(RenderableType type) : _clickable(false), _distance(0.0) {
+Renderable::Renderable(RenderableType type) : _clickable(false), _distance(0.0), _sceneSlot(0) {
+	_listSlot[0] = _listSlot[1] = 0;
+
 	if        (type == kRenderableTypeVideo) {
 		_queueExists  = kQueueVideo;
 		_queueVisible = kQueueVisibleVideo;
@@ -92,20 +94,30 @@ bool Renderable::isVisible() const {
 }
 
 void Renderable::resort() {
-	sortQueue(_queueVisible);
+	GfxMan.recalculateObjectDistances();
 }
 
 void Renderable::show() {
 	lockQueue(_queueVisible);
 
-	addToQueue(_queueVisible);
-	sortQueue(_queueVisible);
+	if (!isInQueue(_queueVisible)) {
+		addToQueue(_queueVisible);
+
+		GfxMan.addToScene(*this, _queueVisible);
+	}
 
 	unlockQueue(_queueVisible);
+
+	GfxMan.recalculateObjectDistances();
 }
 
 void Renderable::hide() {
 	removeFromQueue(_queueVisible);
+
+	GfxMan.removeFromScene(*this);
+}
+
+void Renderable::advanceAnimation(float elapsed) {
 }
 
 bool Renderable::isIn(float x, float y) const {
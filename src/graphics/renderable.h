@@ -79,6 +79,9 @@ public:
 	/** Does the line from x1.y1.z1 to x2.y2.z2 intersect with the object? */
 	virtual bool isIn(float x1, float y1, float z1, float x2, float y2, float z2) const;
 
+	/** Advance the object's animation by that many seconds. */
+	virtual void advanceAnimation(float elapsed);
+
 protected:
 	QueueType _queueExists;
 	QueueType _queueVisible;
@@ -91,6 +94,12 @@ protected:
 	double _distance; ///< The distance of the object from the viewer.
 
 	void resort();
+
+private:
+	uint32 _sceneSlot;   ///< Index of the object within the scene builder's array of visible objects.
+	uint32 _listSlot[2]; ///< Index of the object within each of the scene builder's draw lists.
+
+	friend class SceneBuilder;
 };
 
 } // End of namespace Graphics
@@ -0,0 +1,351 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey and Eclipse engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/scenebuilder.cpp
+ *  Preparing the draw lists of the next frame.
+ */
+
+#include <algorithm>
+
+#include "graphics/scenebuilder.h"
+#include "graphics/renderable.h"
+#include "graphics/camera.h"
+
+namespace Graphics {
+
+SceneBuilder::SceneEntry::SceneEntry(Renderable *r) : distance(0.0), renderable(r) {
+}
+
+bool SceneBuilder::SceneEntry::operator<(const SceneEntry &entry) const {
+	return distance < entry.distance;
+}
+
+
+SceneBuilder::SceneBuilder() : _changes(0), _front(0), _started(false), _needBuild(true), _backReady(false) {
+}
+
+SceneBuilder::~SceneBuilder() {
+	stop();
+}
+
+bool SceneBuilder::start() {
+	if (_started)
+		return true;
+
+	if (!createThread())
+		return false;
+
+	_started = true;
+	return true;
+}
+
+void SceneBuilder::stop() {
+	if (_started)
+		destroyThread();
+
+	_started = false;
+
+	_sceneMutex.lock();
+	_world.clear();
+	_gui.clear();
+	_changes++;
+	_sceneMutex.unlock();
+
+	for (int i = 0; i < 2; i++) {
+		Common::StackLock lock(_lists[i].mutex);
+
+		_lists[i].world.clear();
+		_lists[i].gui.clear();
+	}
+
+	Common::StackLock lock(_swapMutex);
+
+	_needBuild = true;
+	_backReady = false;
+}
+
+void SceneBuilder::invalidate() {
+	_needBuild = true;
+
+	_needWork.signal();
+}
+
+void SceneBuilder::updateDistances() {
+	_sceneMutex.lock();
+
+	// World objects are sorted by their distance to the camera
+	CameraMan.lock();
+	updateDistances(_world);
+	CameraMan.unlock();
+
+	updateDistances(_gui);
+
+	_sceneMutex.unlock();
+
+	invalidate();
+}
+
+DrawList &SceneBuilder::lockFront() {
+	_swapMutex.lock();
+
+	if (_backReady) {
+		// A new list is ready, swap it in and let the builder start on the next one
+		_front     = 1 - _front;
+		_backReady = false;
+
+		_needWork.signal();
+	}
+
+	DrawList &list = _lists[_front];
+
+	if (!_started && _needBuild) {
+		// No builder thread, we need to build the list ourselves
+		_needBuild = false;
+
+		_swapMutex.unlock();
+
+		if (!build(list))
+			_needBuild = true;
+	} else
+		_swapMutex.unlock();
+
+	list.mutex.lock();
+	return list;
+}
+
+DrawList &SceneBuilder::lockCurrent() {
+	_swapMutex.lock();
+	DrawList &list = _lists[_front];
+	_swapMutex.unlock();
+
+	list.mutex.lock();
+	return list;
+}
+
+void SceneBuilder::unlock(DrawList &list) {
+	list.mutex.unlock();
+}
+
+void SceneBuilder::add(Renderable &renderable, QueueType queue) {
+	_sceneMutex.lock();
+
+	std::vector<SceneEntry> *entries = 0;
+	if      (queue == kQueueVisibleWorldObject)
+		entries = &_world;
+	else if (queue == kQueueVisibleGUIFrontObject)
+		entries = &_gui;
+
+	// New objects are appended to the end, the next build sorts them into place
+	if (entries && !hasEntry(_world, &renderable) && !hasEntry(_gui, &renderable)) {
+		renderable._sceneSlot = entries->size();
+		entries->push_back(SceneEntry(&renderable));
+
+		_changes++;
+	}
+
+	_sceneMutex.unlock();
+
+	invalidate();
+}
+
+void SceneBuilder::remove(Renderable &renderable) {
+	_sceneMutex.lock();
+
+	if (removeEntry(_world, &renderable) || removeEntry(_gui, &renderable))
+		_changes++;
+
+	_sceneMutex.unlock();
+
+	// If the renderable is currently being drawn or searched, this waits until that's done
+	for (uint i = 0; i < 2; i++) {
+		Common::StackLock lock(_lists[i].mutex);
+
+		removeFromList(_lists[i].world, &renderable, i);
+		removeFromList(_lists[i].gui  , &renderable, i);
+	}
+}
+
+bool SceneBuilder::buildBack() {
+	_swapMutex.lock();
+
+	if (!_needBuild || _backReady) {
+		// Nothing changed, or the last list hasn't been picked up yet
+		_swapMutex.unlock();
+		return false;
+	}
+
+	_needBuild = false;
+
+	DrawList &list = _lists[1 - _front];
+
+	_swapMutex.unlock();
+
+	const bool built = build(list);
+
+	Common::StackLock lock(_swapMutex);
+
+	// If objects came or went while we sorted, we need to try again
+	if (!built) {
+		_needBuild = true;
+		return true;
+	}
+
+	_backReady = true;
+	return true;
+}
+
+bool SceneBuilder::build(DrawList &list) {
+	// Sort a copy, so that adding and removing objects doesn't need to wait for us
+	_sceneMutex.lock();
+
+	_sortWorld = _world;
+	_sortGUI   = _gui;
+
+	const uint32 changes = _changes;
+
+	_sceneMutex.unlock();
+
+	sortEntries(_sortWorld);
+	sortEntries(_sortGUI);
+
+	Common::StackLock sceneLock(_sceneMutex);
+
+	if (changes != _changes)
+		return false;
+
+	/* Keep the new order, so that the next sort starts out nearly sorted,
+	 * but with the distances the main thread measured in the meantime. */
+	for (size_t i = 0; i < _world.size(); i++)
+		_sortWorld[i].distance = _world[_sortWorld[i].renderable->_sceneSlot].distance;
+	for (size_t i = 0; i < _gui.size(); i++)
+		_sortGUI[i].distance = _gui[_sortGUI[i].renderable->_sceneSlot].distance;
+
+	_world.swap(_sortWorld);
+	_gui.swap(_sortGUI);
+
+	updateSlots(_world);
+	updateSlots(_gui);
+
+	Common::StackLock listLock(list.mutex);
+
+	const uint index = &list - _lists;
+
+	copyEntries(_world, list.world, index);
+	copyEntries(_gui  , list.gui  , index);
+
+	return true;
+}
+
+void SceneBuilder::updateDistances(std::vector<SceneEntry> &entries) {
+	for (std::vector<SceneEntry>::iterator e = entries.begin(); e != entries.end(); ++e) {
+		e->renderable->calculateDistance();
+
+		e->distance = e->renderable->getDistance();
+	}
+}
+
+void SceneBuilder::sortEntries(std::vector<SceneEntry> &entries) {
+	/* The order of the last build is usually nearly right, so an insertion sort
+	 * only needs to move a few entries a few places. After a camera jump or a lot
+	 * of new objects, that's not true anymore, so we then fall back to a full sort.
+	 * Both sorts are stable, keeping the order of objects with the same distance.
+	 */
+
+	const size_t count    = entries.size();
+	const size_t maxMoves = 8 * count;
+
+	size_t moves = 0;
+	for (size_t i = 1; i < count; i++) {
+		if (!(entries[i] < entries[i - 1]))
+			continue;
+
+		SceneEntry entry = entries[i];
+
+		size_t j = i;
+		for (; (j > 0) && (entry < entries[j - 1]); j--)
+			entries[j] = entries[j - 1];
+
+		entries[j] = entry;
+
+		moves += i - j;
+		if (moves > maxMoves) {
+			std::stable_sort(entries.begin(), entries.end());
+			return;
+		}
+	}
+}
+
+void SceneBuilder::updateSlots(std::vector<SceneEntry> &entries) {
+	for (size_t i = 0; i < entries.size(); i++)
+		entries[i].renderable->_sceneSlot = i;
+}
+
+void SceneBuilder::copyEntries(const std::vector<SceneEntry> &entries,
+                               std::vector<Renderable *> &list, uint index) {
+
+	list.resize(entries.size());
+
+	for (size_t i = 0; i < entries.size(); i++) {
+		list[i] = entries[i].renderable;
+
+		list[i]->_listSlot[index] = i;
+	}
+}
+
+bool SceneBuilder::hasEntry(const std::vector<SceneEntry> &entries, const Renderable *renderable) {
+	const uint32 slot = renderable->_sceneSlot;
+
+	return (slot < entries.size()) && (entries[slot].renderable == renderable);
+}
+
+bool SceneBuilder::removeEntry(std::vector<SceneEntry> &entries, Renderable *renderable) {
+	if (!hasEntry(entries, renderable))
+		return false;
+
+	// Move the last object into the hole. The next build sorts it back into place
+	const uint32 slot = renderable->_sceneSlot;
+
+	entries[slot] = entries.back();
+	entries[slot].renderable->_sceneSlot = slot;
+
+	entries.pop_back();
+	return true;
+}
+
+void SceneBuilder::removeFromList(std::vector<Renderable *> &list, Renderable *renderable, uint index) {
+	// Keep the order and the other objects' slots intact, the next build drops the hole
+	const uint32 slot = renderable->_listSlot[index];
+
+	if ((slot < list.size()) && (list[slot] == renderable))
+		list[slot] = 0;
+}
+
+void SceneBuilder::threadMethod() {
+	while (!_killThread)
+		if (!buildBack())
+			_needWork.wait(10);
+}
+
+} // End of namespace Graphics
@@ -0,0 +1,160 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey and Eclipse engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/scenebuilder.h
+ *  Preparing the draw lists of the next frame.
+ */
+
+#ifndef GRAPHICS_SCENEBUILDER_H
+#define GRAPHICS_SCENEBUILDER_H
+
+#include <vector>
+
+#include "common/types.h"
+#include "common/mutex.h"
+#include "common/thread.h"
+
+#include "graphics/types.h"
+
+namespace Graphics {
+
+class Renderable;
+
+/** The visible renderables of one frame, ordered from nearest to furthest.
+ *
+ *  Objects removed from the scene after the list was built are set to 0.
+ */
+struct DrawList {
+	std::vector<Renderable *> world; ///< Visible world objects.
+	std::vector<Renderable *> gui;   ///< Visible GUI front objects.
+
+	/** Held while the list is built, drawn or searched. */
+	Common::Mutex mutex;
+};
+
+/** Builds the draw lists of the next frame.
+ *
+ *  The builder works on two draw lists. While the main thread submits
+ *  the front list to OpenGL, the builder thread sorts the visible objects
+ *  by distance and copies them into the back list. The main thread then
+ *  swaps in the finished back list at the start of its next frame.
+ *
+ *  The distances themselves are calculated by the main thread, at the
+ *  start of each frame, since that also selects the objects' LODs and
+ *  texture detail. The builder only ever sorts its own copy of them.
+ *
+ *  The visible objects are kept in an array in the order of the last
+ *  sort, which is updated with an insertion sort. Between two frames, the
+ *  order rarely changes much, so this is usually close to linear. Each
+ *  object remembers its place in the array and in the draw lists, so
+ *  that removing it doesn't need to search for it.
+ *
+ *  Until the builder thread is started, lists are built synchronously
+ *  by the thread that asks for them.
+ */
+class SceneBuilder : public Common::Thread {
+public:
+	SceneBuilder();
+	~SceneBuilder();
+
+	/** Start the builder thread. */
+	bool start();
+	/** Stop the builder thread and drop all lists. */
+	void stop();
+
+	/** Signal that the visible objects or their distances changed. */
+	void invalidate();
+
+	/** Recalculate the distances of all visible objects.
+	 *
+	 *  Must be called by the main thread, while the frame isn't locked.
+	 */
+	void updateDistances();
+
+	/** Swap in the newest finished list and lock it for drawing. */
+	DrawList &lockFront();
+	/** Lock the current front list, without swapping. */
+	DrawList &lockCurrent();
+	/** Unlock a list returned by lockFront() or lockCurrent(). */
+	void unlock(DrawList &list);
+
+	/** Add this renderable to the scene. */
+	void add(Renderable &renderable, QueueType queue);
+	/** Remove this renderable from the scene and all lists. */
+	void remove(Renderable &renderable);
+
+private:
+	/** A visible object together with its last known distance. */
+	struct SceneEntry {
+		double distance;
+		Renderable *renderable;
+
+		SceneEntry(Renderable *r = 0);
+
+		bool operator<(const SceneEntry &entry) const;
+	};
+
+	std::vector<SceneEntry> _world; ///< All visible world objects, in the order of the last sort.
+	std::vector<SceneEntry> _gui;   ///< All visible GUI front objects, in the order of the last sort.
+
+	uint32 _changes; ///< Number of times objects were added to or removed from the scene.
+
+	Common::Mutex _sceneMutex; ///< Protects the scene arrays, their slots and the change count.
+
+	std::vector<SceneEntry> _sortWorld; ///< The builder's copy of the world objects.
+	std::vector<SceneEntry> _sortGUI;   ///< The builder's copy of the GUI front objects.
+
+	DrawList _lists[2];
+
+	uint _front; ///< Index of the list the main thread draws.
+
+	bool _started;
+	volatile bool _needBuild; ///< Has the scene changed since the last build?
+	volatile bool _backReady; ///< Is the back list finished and waiting to be swapped in?
+
+	Common::Mutex     _swapMutex; ///< Protects the list indices and flags.
+	Common::Condition _needWork;  ///< Signals the builder thread.
+
+	/** Build the back list, if necessary. Returns false if there was nothing to do. */
+	bool buildBack();
+
+	/** Build this list. Returns false if the scene changed while sorting. */
+	bool build(DrawList &list);
+
+	static void updateDistances(std::vector<SceneEntry> &entries);
+	static void sortEntries(std::vector<SceneEntry> &entries);
+	static void updateSlots(std::vector<SceneEntry> &entries);
+	static void copyEntries(const std::vector<SceneEntry> &entries, std::vector<Renderable *> &list, uint index);
+
+	static bool hasEntry(const std::vector<SceneEntry> &entries, const Renderable *renderable);
+	static bool removeEntry(std::vector<SceneEntry> &entries, Renderable *renderable);
+	static void removeFromList(std::vector<Renderable *> &list, Renderable *renderable, uint index);
+
+	void threadMethod();
+};
+
+} // End of namespace Graphics
+
+#endif // GRAPHICS_SCENEBUILDER_H
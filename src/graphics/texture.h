@@ -41,6 +41,13 @@ class Texture : public GLContainer {
 public:
 	Texture();
 	~Texture();
+
+	/** Upload more of the texture's mip map levels, taking their size off the budget.
+	 *
+	 *  Called every frame, even once the budget is used up, so that the texture
+	 *  can free the mip map levels it doesn't need anymore.
+	 */
+	virtual void stream(uint32 &budget) = 0;
 };
 
 } // End of namespace Graphics
@@ -69,8 +69,10 @@ enum PixelDataType {
 enum QueueType {
 	kQueueTexture               = 0, ///< A texture.
 	kQueueNewTexture               , ///< A newly created texture.
+	kQueueStreamingTexture         , ///< A texture with mip map levels still to upload.
 	kQueueWorldObject              , ///< An object in 3D space.
 	kQueueVisibleWorldObject       , ///< A visible object in 3D space.
+	kQueueAnimatedObject           , ///< An object playing an animation.
 	kQueueGUIFrontObject           , ///< A GUI object.
 	kQueueVisibleGUIFrontObject    , ///< A visible GUI object.
 	kQueueVideo                    , ///< A video.
@@ -30,6 +30,8 @@
 #ifndef GRAPHICS_UTIL_H
 #define GRAPHICS_UTIL_H
 
+#include <cstring>
+
 #include "common/types.h"
 #include "common/util.h"
 #include "common/maths.h"
@@ -115,6 +117,29 @@ static inline uint32 deSwizzleOffset(uint32 x, uint32 y, uint32 width, uint32 he
 	return offset;
 }
 
+/** De-"swizzle" a whole image of 4-byte pixels.
+ *
+ *  The x and y bits of a swizzled offset occupy separate bits, so the
+ *  offset of a pixel is the offset of its column or'd with the offset of
+ *  its line. Adding 1 to a value spread over the bits of a mask works by
+ *  filling the gaps with ones first: ((offset | ~mask) + 1) & mask, or
+ *  (offset - mask) & mask. This way, we step through the image line by
+ *  line without calculating each pixel's offset anew.
+ */
+static inline void deSwizzle(byte *dst, const byte *src, uint32 width, uint32 height) {
+	const uint32 xMask = deSwizzleOffset(0xFFFFFFFF, 0, width, height);
+	const uint32 yMask = deSwizzleOffset(0, 0xFFFFFFFF, width, height);
+
+	uint32 yOffset = 0;
+	for (uint32 y = 0; y < height; y++, yOffset = (yOffset - yMask) & yMask) {
+		const byte *line = src + yOffset * 4;
+
+		uint32 xOffset = 0;
+		for (uint32 x = 0; x < width; x++, xOffset = (xOffset - xMask) & xMask, dst += 4)
+			memcpy(dst, line + xOffset * 4, 4);
+	}
+}
+
 } // End of namespace Graphics
 
 #endif // GRAPHICS_UTIL_H
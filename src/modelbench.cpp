@@ -0,0 +1,1743 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey and Eclipse engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file modelbench.cpp
+ *  Benchmark loading the models and textures of a game, rebuilding PLTs,
+ *  animating, skinning, transforming matrices, decompressing S3TC data and
+ *  tokenizing, without opening a window.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <cstring>
+#include <list>
+#include <vector>
+#include <set>
+
+#include "boost/date_time/posix_time/posix_time.hpp"
+
+#include "singletons.h"
+#include "alloccount.h"
+
+#include "common/ustring.h"
+#include "common/util.h"
+#include "common/error.h"
+#include "common/stream.h"
+#include "common/filepath.h"
+#include "common/threads.h"
+#include "common/configman.h"
+#include "common/maths.h"
+#include "common/matrix.h"
+#include "common/transmatrix.h"
+#include "common/endianness.h"
+#include "common/streamtokenizer.h"
+
+#include "aurora/resman.h"
+
+#include "graphics/images/decoder.h"
+#include "graphics/images/tga.h"
+#include "graphics/images/dds.h"
+#include "graphics/images/tpc.h"
+#include "graphics/images/txb.h"
+#include "graphics/images/sbm.h"
+#include "graphics/images/s3tc.h"
+
+#include "graphics/aurora/pltfile.h"
+#include "graphics/aurora/animation.h"
+#include "graphics/aurora/skinning.h"
+
+#include "engines/enginemanager.h"
+#include "engines/aurora/model.h"
+
+/** What to benchmark. */
+enum Mode {
+	kModeModels,     ///< Loading the models of a game.
+	kModeTextures,   ///< Decoding the textures of a game and building their mip maps.
+	kModePLTs,       ///< Rebuilding the PLTs of a game with different colors.
+	kModeAnimations, ///< Sampling and blending animations of many model instances.
+	kModeSkinning,   ///< Deforming skinned meshes.
+	kModeMatrices,   ///< Transforming with matrices.
+	kModeS3TC,       ///< Decompressing S3TC data.
+	kModeTokenize    ///< Tokenizing text 2DAs and ASCII models.
+};
+
+/** The results of loading one model. */
+struct ModelResult {
+	Common::UString name;
+
+	bool loaded; ///< Was the model loaded successfully?
+
+	uint64 time;      ///< Microseconds spent loading the model.
+	uint32 size;      ///< Bytes of model data.
+	uint32 allocs;    ///< Number of allocations while loading.
+	uint64 allocSize; ///< Bytes allocated while loading.
+
+	ModelResult(const Common::UString &n = "") : name(n), loaded(false),
+		time(0), size(0), allocs(0), allocSize(0) {
+	}
+
+	/** Sort slower first. */
+	bool operator<(const ModelResult &right) const {
+		return time > right.time;
+	}
+};
+
+/** The results of decoding one texture. */
+struct TextureResult {
+	Common::UString name;
+
+	bool loaded;  ///< Was the texture decoded successfully?
+	bool mipMaps; ///< Did we build mip maps for the texture?
+	bool match;   ///< Did the SSE2 and the scalar code build the same mip maps?
+
+	uint32 width;  ///< Width of the texture.
+	uint32 height; ///< Height of the texture.
+	uint32 size;   ///< Bytes of image data.
+
+	uint64 decodeTime; ///< Microseconds spent decoding the image.
+	uint64 mipMapTime; ///< Microseconds spent building the mip maps, using SSE2 if available.
+	uint64 scalarTime; ///< Microseconds spent building the mip maps, without using SSE2.
+
+	TextureResult(const Common::UString &n = "") : name(n), loaded(false), mipMaps(false),
+		match(false), width(0), height(0), size(0), decodeTime(0), mipMapTime(0), scalarTime(0) {
+	}
+
+	/** Sort slower first. */
+	bool operator<(const TextureResult &right) const {
+		return (decodeTime + mipMapTime) > (right.decodeTime + right.mipMapTime);
+	}
+};
+
+typedef void (*DownsampleFunc)(Graphics::ImageDecoder::MipMap &out,
+                               const Graphics::ImageDecoder::MipMap &in, Graphics::PixelFormat format);
+
+static void displayUsage(const char *name);
+static bool parseMode(const char *arg, Mode &mode);
+
+static uint64 getMicroseconds();
+
+static void findResources(const std::vector<Aurora::FileType> &types, std::list<Common::UString> &names);
+
+static void findModels(std::list<Common::UString> &models);
+static uint32 getModelSize(const Common::UString &name);
+static void benchModels(const std::list<Common::UString> &models);
+static void benchModel(ModelResult &result);
+
+static void printResult(const ModelResult &result);
+static void printSummary(const std::list<ModelResult> &results);
+
+static void getTextureTypes(std::vector<Aurora::FileType> &types);
+static void findTextures(std::list<Common::UString> &textures);
+static Graphics::ImageDecoder *createImage(Common::SeekableReadStream &stream, Aurora::FileType type);
+static uint64 buildMipMaps(std::vector<Graphics::ImageDecoder::MipMap *> &mipMaps,
+                           const Graphics::ImageDecoder &image, DownsampleFunc downsample);
+static bool compareMipMaps(const std::vector<Graphics::ImageDecoder::MipMap *> &a,
+                           const std::vector<Graphics::ImageDecoder::MipMap *> &b);
+static void freeMipMaps(std::vector<Graphics::ImageDecoder::MipMap *> &mipMaps);
+static void benchTextures(const std::list<Common::UString> &textures);
+static void benchTexture(TextureResult &result);
+
+static void printResult(const TextureResult &result);
+static void printSummary(const std::list<TextureResult> &results);
+
+static void findPLTs(std::list<Common::UString> &plts);
+static void benchPLTs(const std::list<Common::UString> &plts);
+
+static Graphics::Aurora::Animation *createAnimation(const Common::UString &name, float length, float phase);
+static void benchAnimations();
+
+static void createSkin(Graphics::Aurora::Skin &skin);
+static void benchSkinning();
+
+static void benchMatrices();
+
+static void benchS3TC();
+
+static void checkTokenizer();
+static void benchTokenizer(const std::list<Common::UString> &models);
+
+static void deinit();
+
+int main(int argc, char **argv) {
+	if ((argc > 1) && !strcmp(argv[1], "--help")) {
+		displayUsage(argv[0]);
+		return 0;
+	}
+
+	int arg = 1;
+
+	Mode mode = kModeModels;
+	if ((argc > 1) && !strncmp(argv[1], "--", 2)) {
+		if (!parseMode(argv[1], mode)) {
+			displayUsage(argv[0]);
+			return 1;
+		}
+
+		arg++;
+	}
+
+	/* Models, textures and PLTs are loaded out of a game, the tokenizer can
+	 * additionally be benchmarked on one, the other modes make up their own data. */
+	const bool needGame = (mode == kModeModels) || (mode == kModeTextures) || (mode == kModePLTs);
+	const bool useGame  = arg < argc;
+	if ((needGame && !useGame) || (useGame && !needGame && (mode != kModeTokenize))) {
+		displayUsage(argv[0]);
+		return 1;
+	}
+
+	// No other threads exist yet, so they will all see the counter's mutex
+	initAllocationCounting();
+
+	atexit(deinit);
+
+	Common::UString baseDir;
+	if (useGame) {
+		baseDir = Common::FilePath::makeAbsolute(Common::UString(argv[arg++]));
+		if (!Common::FilePath::isDirectory(baseDir) && !Common::FilePath::isRegularFile(baseDir))
+			error("No such file or directory \"%s\"", baseDir.c_str());
+	}
+
+	// We want to measure parsing models, not fetching them out of the model cache
+	ConfigMan.setCommandlineKey("modelcache"   , "0");
+	ConfigMan.setCommandlineKey("modelcachedir", "");
+
+	Engines::GameInstance game(baseDir);
+
+	try {
+		Common::initThreads();
+
+		if        (mode == kModeAnimations) {
+			benchAnimations();
+			return 0;
+		} else if (mode == kModeSkinning) {
+			benchSkinning();
+			return 0;
+		} else if (mode == kModeMatrices) {
+			benchMatrices();
+			return 0;
+		} else if (mode == kModeS3TC) {
+			benchS3TC();
+			return 0;
+		} else if (mode == kModeTokenize) {
+			checkTokenizer();
+			if (!useGame)
+				return 0;
+		}
+
+		if (!EngineMan.probeGame(game))
+			throw Common::Exception("Unable to detect the game");
+
+		status("Detected game \"%s\"", EngineMan.getGameName(game, true).c_str());
+
+		// Index the resources the same way the engine does, but don't create a window
+		EngineMan.indexResources(game);
+
+		std::list<Common::UString> names;
+		for (int i = arg; i < argc; i++)
+			names.push_back(argv[i]);
+
+		if (mode == kModeTextures) {
+			if (names.empty())
+				findTextures(names);
+
+			benchTextures(names);
+		} else if (mode == kModePLTs) {
+			if (names.empty())
+				findPLTs(names);
+
+			benchPLTs(names);
+		} else if (mode == kModeTokenize) {
+			benchTokenizer(names);
+		} else {
+			if (names.empty())
+				findModels(names);
+
+			benchModels(names);
+		}
+
+		Engines::unregisterModelLoader();
+
+	} catch (Common::Exception &e) {
+		Engines::unregisterModelLoader();
+
+		Common::printException(e);
+		std::exit(1);
+	}
+
+	return 0;
+}
+
+static void displayUsage(const char *name) {
+	std::printf("Usage: %s [--models] <target> [<model> ...]\n", name);
+	std::printf("       %s --textures <target> [<texture> ...]\n", name);
+	std::printf("       %s --plts <target> [<plt> ...]\n", name);
+	std::printf("       %s --animations\n", name);
+	std::printf("       %s --skinning\n", name);
+	std::printf("       %s --matrix\n", name);
+	std::printf("       %s --s3tc\n", name);
+	std::printf("       %s --tokenize [<target> [<model> ...]]\n\n", name);
+	std::printf("  --models      Load all models of the game in <target>, or only the\n");
+	std::printf("                specified models, through the game's model loader and\n");
+	std::printf("                report how long each one took. The model cache is disabled.\n");
+	std::printf("  --textures    Decode all textures of the game in <target>, or only the\n");
+	std::printf("                specified textures, and build mip maps for the textures\n");
+	std::printf("                that only have one, with and without SSE2.\n");
+	std::printf("  --plts        Rebuild up to 500 PLTs of the game in <target>, or the\n");
+	std::printf("                specified PLTs, 500 times in total, with random layer colors.\n");
+	std::printf("  --animations  Sample one animation, and blend two animations, on 500\n");
+	std::printf("                model instances with 40 bones each.\n");
+	std::printf("  --skinning    Deform 200 skins of 1200 vertices each, with the scalar and\n");
+	std::printf("                the SSE2 code, and batched on the skinning threads.\n");
+	std::printf("  --matrix      Run 1000000 chains of translating, rotating, scaling and\n");
+	std::printf("                transforming a point, with the fixed-size 4x4 matrix and\n");
+	std::printf("                with the old TransformationMatrix built on the generic Matrix.\n");
+	std::printf("  --s3tc        Decompress random DXT1 and DXT5 images of several sizes,\n");
+	std::printf("                with the current and the old stream-based decompressor.\n");
+	std::printf("  --tokenize    Compare the tokenizer against the old one on 20000 random\n");
+	std::printf("                short inputs. With a <target>, also tokenize all text 2DAs\n");
+	std::printf("                and the largest, or the specified, ASCII models of the game\n");
+	std::printf("                10 times, with the current and the old tokenizer.\n\n");
+	std::printf("No window is opened.\n");
+}
+
+static bool parseMode(const char *arg, Mode &mode) {
+	if      (!strcmp(arg, "--models"))
+		mode = kModeModels;
+	else if (!strcmp(arg, "--textures"))
+		mode = kModeTextures;
+	else if (!strcmp(arg, "--plts"))
+		mode = kModePLTs;
+	else if (!strcmp(arg, "--animations"))
+		mode = kModeAnimations;
+	else if (!strcmp(arg, "--skinning"))
+		mode = kModeSkinning;
+	else if (!strcmp(arg, "--matrix"))
+		mode = kModeMatrices;
+	else if (!strcmp(arg, "--s3tc"))
+		mode = kModeS3TC;
+	else if (!strcmp(arg, "--tokenize"))
+		mode = kModeTokenize;
+	else
+		return false;
+
+	return true;
+}
+
+static uint64 getMicroseconds() {
+	static const boost::posix_time::ptime epoch(boost::gregorian::date(1970, 1, 1));
+
+	return (boost::posix_time::microsec_clock::universal_time() - epoch).total_microseconds();
+}
+
+/** Add the names of all resources of these types, sorted and without duplicates. */
+static void findResources(const std::vector<Aurora::FileType> &types, std::list<Common::UString> &names) {
+	std::list<Aurora::ResourceManager::ResourceID> resources;
+	ResMan.getAvailableResources(types, resources);
+
+	std::set<Common::UString> unique;
+	for (std::list<Aurora::ResourceManager::ResourceID>::const_iterator r = resources.begin();
+	     r != resources.end(); ++r)
+		unique.insert(r->name);
+
+	names.insert(names.end(), unique.begin(), unique.end());
+}
+
+static void findModels(std::list<Common::UString> &models) {
+	// NWN and KotOR models are MDL files, NWN2 and The Witcher ones are MDB files
+	std::vector<Aurora::FileType> types;
+	types.push_back(Aurora::kFileTypeMDL);
+	types.push_back(Aurora::kFileTypeMDB);
+
+	findResources(types, models);
+}
+
+static uint32 getModelSize(const Common::UString &name) {
+	// The files a model can be made of
+	static const Aurora::FileType kTypes[] = {
+		Aurora::kFileTypeMDL, Aurora::kFileTypeMDX, Aurora::kFileTypeMDB
+	};
+
+	uint32 size = 0;
+	for (int i = 0; i < ARRAYSIZE(kTypes); i++) {
+		Common::SeekableReadStream *stream = ResMan.getResource(name, kTypes[i]);
+		if (!stream)
+			continue;
+
+		size += stream->size();
+		delete stream;
+	}
+
+	return size;
+}
+
+static void benchModels(const std::list<Common::UString> &models) {
+	status("Loading %u models", (uint) models.size());
+
+	std::printf("   Time (ms) |  Size (KB) |  Allocs | Alloc (KB) | Model\n");
+	std::printf("-------------|------------|---------|------------|----------------\n");
+
+	std::list<ModelResult> results;
+	for (std::list<Common::UString>::const_iterator m = models.begin(); m != models.end(); ++m) {
+		results.push_back(ModelResult(*m));
+
+		benchModel(results.back());
+		printResult(results.back());
+	}
+
+	printSummary(results);
+}
+
+static void benchModel(ModelResult &result) {
+	result.size = getModelSize(result.name);
+
+	startAllocationCounting();
+
+	const uint64 start = getMicroseconds();
+
+	Graphics::Aurora::Model *model = 0;
+	try {
+		model = Engines::loadModelObject(result.name);
+	} catch (Common::Exception &e) {
+		stopAllocationCounting(result.allocs, result.allocSize);
+
+		Common::printException(e, "WARNING: ");
+	}
+
+	const uint64 end = getMicroseconds();
+
+	stopAllocationCounting(result.allocs, result.allocSize);
+
+	result.loaded = model != 0;
+	result.time   = end - start;
+
+	Engines::freeModel(model);
+}
+
+static void printResult(const ModelResult &result) {
+	std::printf("%12.3f | %10.1f | %7u | %10.1f | %s%s\n", result.time / 1000.0, result.size / 1024.0,
+	            result.allocs, result.allocSize / 1024.0, result.name.c_str(),
+	            result.loaded ? "" : " (failed)");
+}
+
+static void printSummary(const std::list<ModelResult> &results) {
+	uint32 loaded = 0, totalAllocs = 0;
+	uint64 totalTime = 0, totalSize = 0, totalAllocSize = 0;
+
+	std::list<ModelResult> slowest;
+	for (std::list<ModelResult>::const_iterator r = results.begin(); r != results.end(); ++r) {
+		if (!r->loaded)
+			continue;
+
+		loaded++;
+
+		totalTime      += r->time;
+		totalSize      += r->size;
+		totalAllocs    += r->allocs;
+		totalAllocSize += r->allocSize;
+
+		slowest.push_back(*r);
+	}
+
+	std::printf("\n");
+	std::printf("%u of %u models loaded in %.3f s\n", loaded, (uint) results.size(), totalTime / 1000000.0);
+
+	if (totalTime == 0)
+		return;
+
+	std::printf("%.1f models/s, %.2f MB/s of model data\n", (loaded * 1000000.0) / totalTime,
+	            (totalSize * 1000000.0) / (totalTime * 1024.0 * 1024.0));
+	std::printf("%u allocations, %.2f MB allocated, %.1f allocations per model\n",
+	            totalAllocs, totalAllocSize / (1024.0 * 1024.0), (double) totalAllocs / loaded);
+
+	slowest.sort();
+
+	std::printf("\nSlowest models:\n");
+
+	uint n = 0;
+	for (std::list<ModelResult>::const_iterator r = slowest.begin(); (r != slowest.end()) && (n < 10); ++r, ++n)
+		printResult(*r);
+}
+
+static void getTextureTypes(std::vector<Aurora::FileType> &types) {
+	types.push_back(Aurora::kFileTypeTGA);
+	types.push_back(Aurora::kFileTypeDDS);
+	types.push_back(Aurora::kFileTypeTPC);
+	types.push_back(Aurora::kFileTypeTXB);
+	types.push_back(Aurora::kFileTypeSBM);
+}
+
+static void findTextures(std::list<Common::UString> &textures) {
+	std::vector<Aurora::FileType> types;
+	getTextureTypes(types);
+
+	findResources(types, textures);
+}
+
+static Graphics::ImageDecoder *createImage(Common::SeekableReadStream &stream, Aurora::FileType type) {
+	if      (type == Aurora::kFileTypeTGA)
+		return new Graphics::TGA(stream);
+	else if (type == Aurora::kFileTypeDDS)
+		return new Graphics::DDS(stream);
+	else if (type == Aurora::kFileTypeTPC)
+		return new Graphics::TPC(stream);
+	else if (type == Aurora::kFileTypeTXB)
+		return new Graphics::TXB(stream);
+	else if (type == Aurora::kFileTypeSBM)
+		return new Graphics::SBM(stream);
+
+	throw Common::Exception("Unsupported image resource type %d", (int) type);
+}
+
+/** Build the chain of mip maps out of the image's first one, like ImageDecoder::buildMipMaps() does.
+ *
+ *  Returns the number of microseconds it took.
+ */
+static uint64 buildMipMaps(std::vector<Graphics::ImageDecoder::MipMap *> &mipMaps,
+                           const Graphics::ImageDecoder &image, DownsampleFunc downsample) {
+
+	const uint64 start = getMicroseconds();
+
+	const Graphics::ImageDecoder::MipMap *last = &image.getMipMap(0);
+	while ((last->width > 1) || (last->height > 1)) {
+		mipMaps.push_back(new Graphics::ImageDecoder::MipMap);
+
+		downsample(*mipMaps.back(), *last, image.getFormat());
+		last = mipMaps.back();
+	}
+
+	return getMicroseconds() - start;
+}
+
+static bool compareMipMaps(const std::vector<Graphics::ImageDecoder::MipMap *> &a,
+                           const std::vector<Graphics::ImageDecoder::MipMap *> &b) {
+
+	if (a.size() != b.size())
+		return false;
+
+	for (uint32 i = 0; i < a.size(); i++)
+		if ((a[i]->size != b[i]->size) || memcmp(a[i]->data, b[i]->data, a[i]->size))
+			return false;
+
+	return true;
+}
+
+static void freeMipMaps(std::vector<Graphics::ImageDecoder::MipMap *> &mipMaps) {
+	for (std::vector<Graphics::ImageDecoder::MipMap *>::iterator m = mipMaps.begin(); m != mipMaps.end(); ++m)
+		delete *m;
+
+	mipMaps.clear();
+}
+
+static void benchTextures(const std::list<Common::UString> &textures) {
+	status("Decoding %u textures", (uint) textures.size());
+
+	std::printf(" Decode (ms) |  Mips (ms) | Scalar (ms) |  Size (KB) |    Width x Height | Texture\n");
+	std::printf("-------------|------------|-------------|------------|-------------------|----------------\n");
+
+	std::list<TextureResult> results;
+	for (std::list<Common::UString>::const_iterator t = textures.begin(); t != textures.end(); ++t) {
+		results.push_back(TextureResult(*t));
+
+		benchTexture(results.back());
+		printResult(results.back());
+	}
+
+	printSummary(results);
+}
+
+static void benchTexture(TextureResult &result) {
+	std::vector<Aurora::FileType> types;
+	getTextureTypes(types);
+
+	Aurora::FileType type;
+	Common::SeekableReadStream *stream = ResMan.getResource(result.name, types, &type);
+	if (!stream) {
+		warning("No such texture \"%s\"", result.name.c_str());
+		return;
+	}
+
+	result.size = stream->size();
+
+	const uint64 start = getMicroseconds();
+
+	Graphics::ImageDecoder *image = 0;
+	try {
+		image = createImage(*stream, type);
+		if (image->getMipMapCount() < 1)
+			throw Common::Exception("Texture has no images");
+
+	} catch (Common::Exception &e) {
+		delete image;
+		image = 0;
+
+		e.add("Failed decoding texture \"%s\"", result.name.c_str());
+		Common::printException(e, "WARNING: ");
+	}
+
+	result.decodeTime = getMicroseconds() - start;
+
+	delete stream;
+
+	if (!image)
+		return;
+
+	result.loaded = true;
+	result.width  = image->getMipMap(0).width;
+	result.height = image->getMipMap(0).height;
+
+	// Like the textures, only build mip maps for images that have just the one
+	if ((image->getMipMapCount() == 1) && image->canBuildMipMaps()) {
+		std::vector<Graphics::ImageDecoder::MipMap *> mipMaps, scalarMipMaps;
+
+		result.mipMapTime = buildMipMaps(mipMaps      , *image, &Graphics::ImageDecoder::downsample);
+		result.scalarTime = buildMipMaps(scalarMipMaps, *image, &Graphics::ImageDecoder::downsampleScalar);
+
+		result.mipMaps = true;
+		result.match   = compareMipMaps(mipMaps, scalarMipMaps);
+
+		freeMipMaps(mipMaps);
+		freeMipMaps(scalarMipMaps);
+	}
+
+	delete image;
+}
+
+static void printResult(const TextureResult &result) {
+	if (!result.mipMaps) {
+		std::printf("%12.3f |          - |           - | %10.1f | %7u x %-7u | %s%s\n",
+		            result.decodeTime / 1000.0, result.size / 1024.0, result.width, result.height,
+		            result.name.c_str(), result.loaded ? "" : " (failed)");
+		return;
+	}
+
+	std::printf("%12.3f | %10.3f | %11.3f | %10.1f | %7u x %-7u | %s%s\n",
+	            result.decodeTime / 1000.0, result.mipMapTime / 1000.0, result.scalarTime / 1000.0,
+	            result.size / 1024.0, result.width, result.height, result.name.c_str(),
+	            result.match ? "" : " (mip maps differ)");
+}
+
+static void printSummary(const std::list<TextureResult> &results) {
+	uint32 loaded = 0, mipMapped = 0, mismatched = 0;
+	uint64 decodeTime = 0, mipMapTime = 0, scalarTime = 0, totalSize = 0;
+
+	std::list<TextureResult> slowest;
+	for (std::list<TextureResult>::const_iterator r = results.begin(); r != results.end(); ++r) {
+		if (!r->loaded)
+			continue;
+
+		loaded++;
+
+		decodeTime += r->decodeTime;
+		totalSize  += r->size;
+
+		if (r->mipMaps) {
+			mipMapped++;
+
+			mipMapTime += r->mipMapTime;
+			scalarTime += r->scalarTime;
+
+			if (!r->match)
+				mismatched++;
+		}
+
+		slowest.push_back(*r);
+	}
+
+	std::printf("\n");
+	std::printf("%u of %u textures decoded in %.3f s\n", loaded, (uint) results.size(), decodeTime / 1000000.0);
+
+	if (decodeTime > 0)
+		std::printf("%.1f textures/s, %.2f MB/s of image data\n", (loaded * 1000000.0) / decodeTime,
+		            (totalSize * 1000000.0) / (decodeTime * 1024.0 * 1024.0));
+
+	std::printf("Mip maps of %u textures built in %.3f s, %.3f s without SSE2\n",
+	            mipMapped, mipMapTime / 1000000.0, scalarTime / 1000000.0);
+
+	if (mismatched > 0)
+		std::printf("WARNING: The mip maps of %u textures differ between the SSE2 and the scalar code\n",
+		            mismatched);
+
+	slowest.sort();
+
+	std::printf("\nSlowest textures:\n");
+
+	uint n = 0;
+	for (std::list<TextureResult>::const_iterator r = slowest.begin(); (r != slowest.end()) && (n < 10); ++r, ++n)
+		printResult(*r);
+}
+
+/** Number of PLT rebuilds to benchmark. */
+static const uint32 kPLTRebuilds = 500;
+
+static void findPLTs(std::list<Common::UString> &plts) {
+	std::vector<Aurora::FileType> types;
+	types.push_back(Aurora::kFileTypePLT);
+
+	findResources(types, plts);
+}
+
+static void benchPLTs(const std::list<Common::UString> &plts) {
+	std::vector<Graphics::Aurora::PLTFile *> files;
+
+	std::list<Common::UString>::const_iterator p = plts.begin();
+	for (; (p != plts.end()) && (files.size() < kPLTRebuilds); ++p) {
+		try {
+			files.push_back(new Graphics::Aurora::PLTFile(*p));
+		} catch (Common::Exception &e) {
+			Common::printException(e, "WARNING: ");
+		}
+	}
+
+	if (files.empty())
+		throw Common::Exception("No PLTs to rebuild");
+
+	status("Rebuilding %u PLTs %u times", (uint) files.size(), kPLTRebuilds);
+
+	// The first rebuild reads the palettes, which a running game already has
+	uint64 start = getMicroseconds();
+
+	files[0]->rebuild();
+
+	const uint64 firstTime = getMicroseconds() - start;
+
+	start = getMicroseconds();
+
+	for (uint32 i = 0; i < kPLTRebuilds; i++) {
+		Graphics::Aurora::PLTFile &plt = *files[i % files.size()];
+
+		for (int l = 0; l < Graphics::Aurora::PLTFile::kLayerMAX; l++)
+			plt.setLayerColor((Graphics::Aurora::PLTFile::Layer) l, std::rand() % 256);
+
+		plt.rebuild();
+	}
+
+	const uint64 time = MAX<uint64>(getMicroseconds() - start, 1);
+
+	std::printf("First rebuild, reading the palettes: %8.3f ms\n", firstTime / 1000.0);
+	std::printf("%u rebuilds in %.3f ms, %.3f ms per rebuild, %.1f rebuilds/s\n", kPLTRebuilds,
+	            time / 1000.0, time / (1000.0 * kPLTRebuilds), (kPLTRebuilds * 1000000.0) / time);
+
+	for (std::vector<Graphics::Aurora::PLTFile *>::iterator f = files.begin(); f != files.end(); ++f)
+		delete *f;
+}
+
+/** Number of model instances to animate. */
+static const uint32 kAnimationInstances = 500;
+/** Number of bones each animated model has. */
+static const uint32 kAnimationBones     = 40;
+/** Number of keys in each track of an animation. */
+static const uint32 kAnimationKeys      = 30;
+/** Number of frames to animate. */
+static const uint32 kAnimationFrames    = 600;
+
+/** Create an animation that swings and bobs each bone. */
+static Graphics::Aurora::Animation *createAnimation(const Common::UString &name, float length, float phase) {
+	Graphics::Aurora::Animation *animation = new Graphics::Aurora::Animation(name, length, 0.25);
+
+	std::vector<float> times(kAnimationKeys), positions(kAnimationKeys * 3), orientations(kAnimationKeys * 4);
+
+	for (uint32 b = 0; b < kAnimationBones; b++) {
+		for (uint32 k = 0; k < kAnimationKeys; k++) {
+			const float angle = 0.3 * sinf(phase + k * 0.2 + b);
+
+			times[k] = (length * k) / (kAnimationKeys - 1);
+
+			positions[k * 3 + 0] = b * 0.1;
+			positions[k * 3 + 1] = sinf(k * 0.1 + b);
+			positions[k * 3 + 2] = 0.0;
+
+			orientations[k * 4 + 0] = sinf(angle / 2.0);
+			orientations[k * 4 + 1] = 0.0;
+			orientations[k * 4 + 2] = 0.0;
+			orientations[k * 4 + 3] = cosf(angle / 2.0);
+		}
+
+		const Common::UString bone = Common::UString::sprintf("bone%02u", b);
+
+		animation->addPositionKeys   (bone, kAnimationKeys, &times[0], &positions[0]);
+		animation->addOrientationKeys(bone, kAnimationKeys, &times[0], &orientations[0]);
+	}
+
+	return animation;
+}
+
+static void benchAnimations() {
+	Graphics::Aurora::Animation *walk = createAnimation("walk", 1.2, 0.0);
+	Graphics::Aurora::Animation *run  = createAnimation("run" , 0.8, 1.0);
+
+	std::vector<Graphics::Aurora::Animation::Pose> poses(kAnimationInstances * kAnimationBones);
+	std::vector<Graphics::Aurora::Animation::Pose> from(kAnimationBones);
+
+	std::printf("%u instances, %u bones, %u keys per track, %u frames\n",
+	            kAnimationInstances, kAnimationBones, kAnimationKeys, kAnimationFrames);
+
+	// First only play the walk animation, then blend over from running into walking
+	for (int blend = 0; blend < 2; blend++) {
+		const uint64 start = getMicroseconds();
+
+		for (uint32 f = 0; f < kAnimationFrames; f++) {
+			for (uint32 i = 0; i < kAnimationInstances; i++) {
+				// Don't have all instances in lockstep
+				const float time = fmodf(i * 0.013 + f / 60.0, walk->getLength());
+
+				Graphics::Aurora::Animation::Pose *pose = &poses[i * kAnimationBones];
+
+				walk->sample(time, pose);
+				if (!blend)
+					continue;
+
+				run->sample(fmodf(time, run->getLength()), &from[0]);
+				for (uint32 b = 0; b < kAnimationBones; b++)
+					Graphics::Aurora::Animation::interpolate(from[b], pose[b], 0.5, pose[b]);
+			}
+		}
+
+		const uint64 time = MAX<uint64>(getMicroseconds() - start, 1);
+
+		std::printf("%-16s %8.3f ms/frame, %6.1fM bones/s\n", blend ? "Blending two:" : "One animation:",
+		            time / (1000.0 * kAnimationFrames),
+		            ((double) kAnimationInstances * kAnimationBones * kAnimationFrames) / time);
+	}
+
+	delete walk;
+	delete run;
+}
+
+/** Number of skins to deform. */
+static const uint32 kSkins        = 200;
+/** Number of vertices in each skin. */
+static const uint32 kSkinVertices = 1200;
+/** Number of bones moving each skin. */
+static const uint32 kSkinBones    = 40;
+/** Number of frames to deform the skins for. */
+static const uint32 kSkinFrames   = 50;
+
+/** Create a skin of random vertices, each weighted to two to four random bones. */
+static void createSkin(Graphics::Aurora::Skin &skin) {
+	const uint32 influences = Graphics::Aurora::Skin::kMaxInfluences;
+
+	skin.vertexCount = kSkinVertices;
+
+	skin.rest.resize(3 * kSkinVertices);
+	skin.skinned.resize(3 * kSkinVertices);
+
+	skin.bones.resize(influences * kSkinVertices);
+	skin.weights.resize(influences * kSkinVertices);
+
+	for (uint32 i = 0; i < skin.rest.size(); i++)
+		skin.rest[i] = (std::rand() % 1000) / 100.0;
+
+	for (uint32 v = 0; v < kSkinVertices; v++) {
+		uint8 *bones   = &skin.bones  [influences * v];
+		float *weights = &skin.weights[influences * v];
+
+		float sum = 0.0;
+		for (uint32 i = 0; i < influences; i++) {
+			bones  [i] = std::rand() % kSkinBones;
+			weights[i] = ((i < 2) || (std::rand() % 2)) ? ((std::rand() % 100) + 1) : 0.0;
+
+			sum += weights[i];
+		}
+
+		for (uint32 i = 0; i < influences; i++)
+			weights[i] /= sum;
+	}
+
+	skin.matrices.resize(kSkinBones + 1);
+	for (uint32 b = 0; b < kSkinBones; b++) {
+		Common::TransformationMatrix matrix;
+
+		matrix.translate(b * 0.1, 1.0, b * -0.2);
+		matrix.rotate(b * 7.0, 0.3, 0.5, 0.8);
+
+		skin.matrices[b] = matrix;
+	}
+}
+
+static void benchSkinning() {
+	std::vector<Graphics::Aurora::Skin> skins(kSkins);
+	for (uint32 i = 0; i < kSkins; i++)
+		createSkin(skins[i]);
+
+	std::printf("%u skins, %u vertices, %u bones, %u frames\n", kSkins, kSkinVertices, kSkinBones, kSkinFrames);
+
+	const double vertices = (double) kSkins * kSkinVertices * kSkinFrames;
+
+	uint64 start = getMicroseconds();
+	for (uint32 f = 0; f < kSkinFrames; f++)
+		for (uint32 i = 0; i < kSkins; i++)
+			Graphics::Aurora::skinVerticesScalar(skins[i], 0, kSkinVertices);
+
+	const uint64 scalarTime = MAX<uint64>(getMicroseconds() - start, 1);
+
+	const std::vector<float> scalar = skins[0].skinned;
+
+	start = getMicroseconds();
+	for (uint32 f = 0; f < kSkinFrames; f++)
+		for (uint32 i = 0; i < kSkins; i++)
+			Graphics::Aurora::skinVertices(skins[i], 0, kSkinVertices);
+
+	const uint64 simdTime = MAX<uint64>(getMicroseconds() - start, 1);
+
+	float maxDiff = 0.0;
+	for (uint32 i = 0; i < scalar.size(); i++)
+		maxDiff = MAX(maxDiff, ABS(scalar[i] - skins[0].skinned[i]));
+
+	start = getMicroseconds();
+	for (uint32 f = 0; f < kSkinFrames; f++) {
+		for (uint32 i = 0; i < kSkins; i++)
+			SkinMan.add(skins[i]);
+
+		SkinMan.finish();
+	}
+
+	const uint64 batchTime = MAX<uint64>(getMicroseconds() - start, 1);
+
+	std::printf("Scalar:  %8.3f ms/frame, %6.1fM vertices/s\n",
+	            scalarTime / (1000.0 * kSkinFrames), vertices / scalarTime);
+	std::printf("SSE2:    %8.3f ms/frame, %6.1fM vertices/s, max difference %g\n",
+	            simdTime / (1000.0 * kSkinFrames), vertices / simdTime, maxDiff);
+	std::printf("Batched: %8.3f ms/frame, %6.1fM vertices/s, with %u skinning threads\n",
+	            batchTime / (1000.0 * kSkinFrames), vertices / batchTime, SkinMan.getThreadCount());
+}
+
+/** Number of different random transformation chains. */
+static const uint32 kMatrixChains     = 10000;
+/** Number of transformation chains to time. */
+static const uint32 kMatrixIterations = 1000000;
+
+static const float kMatrixIdentity[] = {
+	1.0, 0.0, 0.0, 0.0,
+	0.0, 1.0, 0.0, 0.0,
+	0.0, 0.0, 1.0, 0.0,
+	0.0, 0.0, 0.0, 1.0
+};
+
+/** The old TransformationMatrix, built on the generic Matrix, as a speed and precision reference. */
+class OldTransformationMatrix : public Common::Matrix {
+public:
+	OldTransformationMatrix() : Common::Matrix(4, 4) {
+		set(kMatrixIdentity);
+	}
+
+	void getPosition(float &x, float &y, float &z) const {
+		x = _elements[12];
+		y = _elements[13];
+		z = _elements[14];
+	}
+
+	void translate(float x, float y, float z) {
+		Common::Matrix tMatrix(4, 4);
+
+		tMatrix.set(kMatrixIdentity);
+
+		tMatrix(0, 3) = x;
+		tMatrix(1, 3) = y;
+		tMatrix(2, 3) = z;
+
+		(*this) *= tMatrix;
+	}
+
+	void scale(float x, float y, float z) {
+		Common::Matrix sMatrix(4, 4);
+
+		sMatrix.set(kMatrixIdentity);
+
+		sMatrix(0, 0) = x;
+		sMatrix(1, 1) = y;
+		sMatrix(2, 2) = z;
+
+		(*this) *= sMatrix;
+	}
+
+	void rotate(float angle, float x, float y, float z) {
+		float length = x * x + y * y + z * z;
+		if ((length != 1.0) && (length != 0.0)) {
+			length = sqrtf(length);
+
+			x /= length;
+			y /= length;
+			z /= length;
+		}
+
+		const float c = cosf(Common::deg2rad(angle));
+		const float s = sinf(Common::deg2rad(angle));
+
+		float e[16];
+
+		e[ 0] = (x * x) * (1.0 - c) +     c;
+		e[ 1] = (y * x) * (1.0 - c) + z * s;
+		e[ 2] = (z * x) * (1.0 - c) - y * s;
+		e[ 3] = 0.0;
+		e[ 4] = (x * y) * (1.0 - c) - z * s;
+		e[ 5] = (y * y) * (1.0 - c) +     c;
+		e[ 6] = (z * y) * (1.0 - c) + x * s;
+		e[ 7] = 0.0;
+		e[ 8] = (x * z) * (1.0 - c) + y * s;
+		e[ 9] = (y * z) * (1.0 - c) - x * s;
+		e[10] = (z * z) * (1.0 - c) +     c;
+		e[11] = 0.0;
+		e[12] = 0.0;
+		e[13] = 0.0;
+		e[14] = 0.0;
+		e[15] = 1.0;
+
+		Common::Matrix rMatrix(4, 4);
+
+		rMatrix.set(e);
+
+		(*this) *= rMatrix;
+	}
+};
+
+/** The parameters of one transformation chain. */
+struct MatrixChain {
+	float translate[3];
+	float angle;
+	float axis[3];
+	float scale[3];
+	float point[3];
+};
+
+static float randomFloat(float min, float max) {
+	return min + (std::rand() / (float) RAND_MAX) * (max - min);
+}
+
+static void createMatrixChain(MatrixChain &chain) {
+	for (int i = 0; i < 3; i++) {
+		chain.translate[i] = randomFloat(-100.0, 100.0);
+		chain.axis     [i] = randomFloat(  -1.0,   1.0);
+		chain.scale    [i] = randomFloat(   0.5,   2.0);
+		chain.point    [i] = randomFloat( -10.0,  10.0);
+	}
+
+	chain.angle = randomFloat(-180.0, 180.0);
+}
+
+/** Run a transformation chain on a copy of the parent, the way the old code transformed points. */
+static void runOldMatrixChain(const OldTransformationMatrix &parent, const MatrixChain &chain, float *point) {
+	OldTransformationMatrix matrix = parent;
+
+	matrix.translate(chain.translate[0], chain.translate[1], chain.translate[2]);
+	matrix.rotate(chain.angle, chain.axis[0], chain.axis[1], chain.axis[2]);
+	matrix.scale(chain.scale[0], chain.scale[1], chain.scale[2]);
+
+	matrix.translate(chain.point[0], chain.point[1], chain.point[2]);
+	matrix.getPosition(point[0], point[1], point[2]);
+}
+
+/** Run a transformation chain on a copy of the parent. */
+static void runMatrixChain(const Common::TransformationMatrix &parent, const MatrixChain &chain, float *point) {
+	Common::TransformationMatrix matrix = parent;
+
+	matrix.translate(chain.translate[0], chain.translate[1], chain.translate[2]);
+	matrix.rotate(chain.angle, chain.axis[0], chain.axis[1], chain.axis[2]);
+	matrix.scale(chain.scale[0], chain.scale[1], chain.scale[2]);
+
+	point[0] = chain.point[0];
+	point[1] = chain.point[1];
+	point[2] = chain.point[2];
+
+	matrix.transformPoint(point[0], point[1], point[2]);
+}
+
+static void benchMatrices() {
+	std::vector<MatrixChain> chains(kMatrixChains);
+	for (uint32 i = 0; i < kMatrixChains; i++)
+		createMatrixChain(chains[i]);
+
+	// A parent transformation, like a model's position in the world
+	OldTransformationMatrix      oldParent;
+	Common::TransformationMatrix parent;
+
+	oldParent.translate(12.0, -3.0, 40.0);
+	oldParent.rotate(30.0, 0.2, 0.9, 0.4);
+
+	parent.translate(12.0, -3.0, 40.0);
+	parent.rotate(30.0, 0.2, 0.9, 0.4);
+
+	float maxError = 0.0;
+	for (uint32 i = 0; i < kMatrixChains; i++) {
+		float oldPoint[3], point[3];
+
+		runOldMatrixChain(oldParent, chains[i], oldPoint);
+		runMatrixChain   (parent   , chains[i], point);
+
+		for (int j = 0; j < 3; j++)
+			maxError = MAX(maxError, ABS(oldPoint[j] - point[j]) / MAX(ABS(oldPoint[j]), 1.0f));
+	}
+
+	std::printf("%u transformation chains of translate, rotate, scale and transforming a point\n\n",
+	            kMatrixIterations);
+
+	// Sum up the results, so that the compiler can't throw the work away
+	float sum = 0.0;
+
+	uint64 start = getMicroseconds();
+	for (uint32 i = 0; i < kMatrixIterations; i++) {
+		float point[3];
+		runOldMatrixChain(oldParent, chains[i % kMatrixChains], point);
+
+		sum += point[0];
+	}
+
+	const uint64 oldTime = MAX<uint64>(getMicroseconds() - start, 1);
+
+	start = getMicroseconds();
+	for (uint32 i = 0; i < kMatrixIterations; i++) {
+		float point[3];
+		runMatrixChain(parent, chains[i % kMatrixChains], point);
+
+		sum += point[0];
+	}
+
+	const uint64 newTime = MAX<uint64>(getMicroseconds() - start, 1);
+
+#ifdef XOREOS_SSE2
+	static const char *kPath = "SSE2";
+#else
+	static const char *kPath = "scalar";
+#endif
+
+	std::printf("Old Matrix:  %8.1f ns/chain\n", (oldTime * 1000.0) / kMatrixIterations);
+	std::printf("Matrix4x4:   %8.1f ns/chain, %s, %.2fx\n", (newTime * 1000.0) / kMatrixIterations,
+	            kPath, (double) oldTime / newTime);
+	std::printf("Max relative error over %u chains: %g (checksum %g)\n", kMatrixChains, maxError, sum);
+}
+
+/** Number of bytes of decompressed pixels to produce for each S3TC image size. */
+static const uint32 kS3TCBytes = 256 * 1024 * 1024;
+
+/** Expand a 565 color to RGBA8888, the way the old decompressor did. */
+static uint32 oldConvert565To8888(uint16 color) {
+	return ((color & 0x1F) << 11) | ((color & 0x7E0) << 13) | ((color & 0xF800) << 16) | 0xFF;
+}
+
+/** Interpolate two colors with floating point math, the way the old decompressor did. */
+static uint32 oldInterpolate32(double weight, uint32 color0, uint32 color1) {
+	uint32 result = 0;
+	for (int shift = 24; shift >= 0; shift -= 8) {
+		const double c0 = (color0 >> shift) & 0xFF;
+		const double c1 = (color1 >> shift) & 0xFF;
+
+		result |= ((uint32) (byte) ((1.0f - weight) * c0 + weight * c1)) << shift;
+	}
+
+	return result;
+}
+
+/** Write the pixels of one block, the way the old decompressor did. */
+static void oldWriteBlock(byte *dest, uint32 width, uint32 height, uint32 pitch, uint32 tx, int32 ty,
+                          const uint32 *blended, uint32 pixels, const uint32 *alpha) {
+
+	const uint32 blockWidth  = MIN<uint32>(width , 4);
+	const uint32 blockHeight = MIN<uint32>(height, 4);
+
+	for (uint32 y = 0; y < blockHeight; ++y) {
+		for (uint32 x = 0; x < blockWidth; ++x, pixels >>= 2)
+			WRITE_BE_UINT32(dest + (height - 1 - (ty - blockHeight + y)) * pitch + (tx + x) * 4,
+			                blended[pixels & 3] | (alpha ? alpha[y * 4 + x] : 0));
+	}
+}
+
+/** The old stream-based DXT1 decompressor, as a speed reference. */
+static void oldDecompressDXT1(byte *dest, Common::SeekableReadStream &src, uint32 width, uint32 height, uint32 pitch) {
+	for (int32 ty = height; ty > 0; ty -= 4) {
+		for (uint32 tx = 0; tx < width; tx += 4) {
+			const uint16 color0 = src.readUint16LE();
+			const uint16 color1 = src.readUint16LE();
+			const uint32 pixels = src.readUint32BE();
+
+			uint32 blended[4];
+
+			blended[0] = oldConvert565To8888(color0);
+			blended[1] = oldConvert565To8888(color1);
+
+			if (color0 > color1) {
+				blended[2] = oldInterpolate32(0.333333f, blended[0], blended[1]);
+				blended[3] = oldInterpolate32(0.666666f, blended[0], blended[1]);
+			} else {
+				blended[2] = oldInterpolate32(0.5f, blended[0], blended[1]);
+				blended[3] = 0;
+			}
+
+			oldWriteBlock(dest, width, height, pitch, tx, ty, blended, pixels, 0);
+		}
+	}
+}
+
+/** The old stream-based DXT5 decompressor, as a speed reference. */
+static void oldDecompressDXT5(byte *dest, Common::SeekableReadStream &src, uint32 width, uint32 height, uint32 pitch) {
+	for (int32 ty = height; ty > 0; ty -= 4) {
+		for (uint32 tx = 0; tx < width; tx += 4) {
+			byte alphab[8];
+
+			alphab[0] = src.readByte();
+			alphab[1] = src.readByte();
+
+			uint64 alphabl = src.readUint32LE();
+			alphabl |= ((uint64) src.readUint16LE()) << 32;
+
+			const uint16 color0 = src.readUint16LE();
+			const uint16 color1 = src.readUint16LE();
+			const uint32 pixels = src.readUint32BE();
+
+			if (alphab[0] > alphab[1]) {
+				for (int i = 2; i < 8; i++)
+					alphab[i] = (byte) (((8.0f - i) * alphab[0] + (i - 1.0f) * alphab[1] + 3.0f) / 7.0f);
+			} else {
+				for (int i = 2; i < 6; i++)
+					alphab[i] = (byte) (((6.0f - i) * alphab[0] + (i - 1.0f) * alphab[1] + 2.0f) / 5.0f);
+
+				alphab[6] = 0;
+				alphab[7] = 255;
+			}
+
+			uint32 blended[4];
+
+			blended[0] = oldConvert565To8888(color0) & 0xFFFFFF00;
+			blended[1] = oldConvert565To8888(color1) & 0xFFFFFF00;
+			blended[2] = oldInterpolate32(0.333333f, blended[0], blended[1]);
+			blended[3] = oldInterpolate32(0.666666f, blended[0], blended[1]);
+
+			uint32 alpha[16];
+			for (uint32 y = 0; y < 4; y++)
+				for (uint32 x = 0; x < 4; x++)
+					alpha[y * 4 + x] = alphab[(alphabl >> (3 * (4 * (3 - y) + x))) & 7];
+
+			oldWriteBlock(dest, width, height, pitch, tx, ty, blended, pixels, alpha);
+		}
+	}
+}
+
+static void benchS3TC() {
+	static const uint32 kSizes[] = { 64, 256, 1024, 2048 };
+
+	std::printf("%u MB of pixels per image size, on the main thread\n\n", kS3TCBytes / (1024 * 1024));
+
+	std::printf("Format |   Width x Height |  Old (MB/s) |  New (MB/s) | Speedup\n");
+	std::printf("-------|------------------|-------------|-------------|--------\n");
+
+	for (int dxt5 = 0; dxt5 < 2; dxt5++) {
+		const uint32 blockSize = dxt5 ? 16 : 8;
+
+		for (int i = 0; i < ARRAYSIZE(kSizes); i++) {
+			const uint32 size       = kSizes[i];
+			const uint32 pixelSize  = size * size * 4;
+			const uint32 compressed = Graphics::getCompressedSize(size, size, blockSize);
+			const uint32 count      = MAX<uint32>(kS3TCBytes / pixelSize, 1);
+
+			std::vector<byte> src(compressed), dest(pixelSize);
+			for (uint32 j = 0; j < compressed; j++)
+				src[j] = std::rand() & 0xFF;
+
+			uint64 start = getMicroseconds();
+			for (uint32 j = 0; j < count; j++) {
+				Common::MemoryReadStream stream(&src[0], compressed);
+
+				if (dxt5)
+					oldDecompressDXT5(&dest[0], stream, size, size, size * 4);
+				else
+					oldDecompressDXT1(&dest[0], stream, size, size, size * 4);
+			}
+
+			const uint64 oldTime = MAX<uint64>(getMicroseconds() - start, 1);
+
+			start = getMicroseconds();
+			for (uint32 j = 0; j < count; j++) {
+				if (dxt5)
+					Graphics::decompressDXT5(&dest[0], &src[0], size, size, size * 4);
+				else
+					Graphics::decompressDXT1(&dest[0], &src[0], size, size, size * 4);
+			}
+
+			const uint64 newTime = MAX<uint64>(getMicroseconds() - start, 1);
+
+			const double bytes = (double) pixelSize * count;
+
+			std::printf("%-6s | %7u x %-7u | %11.1f | %11.1f | %6.2fx\n", dxt5 ? "DXT5" : "DXT1", size, size,
+			            bytes / (oldTime * 1.048576), bytes / (newTime * 1.048576), (double) oldTime / newTime);
+		}
+	}
+}
+
+/** Number of random short inputs to compare the tokenizer and the old one on. */
+static const uint32 kTokenizerChecks = 20000;
+/** Number of times to tokenize the game's files. */
+static const uint32 kTokenizeRuns    = 10;
+
+/** The old list-based tokenizer, reading byte by byte, as a speed and behaviour reference. */
+class OldStreamTokenizer {
+public:
+	OldStreamTokenizer(Common::StreamTokenizer::ConsecutiveSeparatorRule conSepRule) : _conSepRule(conSepRule) {
+	}
+
+	void addSeparator(uint32 c) { _separators.push_back(c); }
+	void addQuote    (uint32 c) { _quotes.push_back(c);     }
+	void addChunkEnd (uint32 c) { _chunkEnds.push_back(c);  }
+	void addIgnore   (uint32 c) { _ignores.push_back(c);    }
+
+	Common::UString getToken(Common::SeekableReadStream &stream);
+
+	int getTokens(Common::SeekableReadStream &stream, std::vector<Common::UString> &list,
+	              int min = 0, int max = -1, const Common::UString &def = "");
+
+	void skipChunk(Common::SeekableReadStream &stream);
+	void nextChunk(Common::SeekableReadStream &stream);
+
+private:
+	Common::StreamTokenizer::ConsecutiveSeparatorRule _conSepRule;
+
+	std::list<uint32> _separators;
+	std::list<uint32> _quotes;
+	std::list<uint32> _chunkEnds;
+	std::list<uint32> _ignores;
+
+	static bool isIn(uint32 c, const std::list<uint32> &list);
+
+	bool isChunkEnd(Common::SeekableReadStream &stream);
+};
+
+bool OldStreamTokenizer::isIn(uint32 c, const std::list<uint32> &list) {
+	for (std::list<uint32>::const_iterator it = list.begin(); it != list.end(); ++it)
+		if (*it == c)
+			return true;
+
+	return false;
+}
+
+Common::UString OldStreamTokenizer::getToken(Common::SeekableReadStream &stream) {
+	bool   chunkEnd     = false;
+	bool   inQuote      = false;
+	bool   hasSeparator = false;
+	uint32 separator    = 0;
+
+	Common::UString token;
+
+	while (!stream.eos()) {
+		char c = (char) stream.readByte();
+
+		if (isIn(c, _chunkEnds)) {
+			stream.seek(-1, SEEK_CUR);
+			chunkEnd = true;
+			break;
+		}
+
+		if (isIn(c, _quotes)) {
+			inQuote = !inQuote;
+			continue;
+		}
+
+		if (!inQuote && isIn(c, _separators)) {
+			if (!token.empty()) {
+				hasSeparator = true;
+				separator = c;
+				break;
+			}
+
+			if (_conSepRule == Common::StreamTokenizer::kRuleHeed) {
+				hasSeparator = true;
+				separator = c;
+				break;
+			}
+
+			if ((_conSepRule == Common::StreamTokenizer::kRuleIgnoreSame) && hasSeparator && (separator != ((byte) c))) {
+				hasSeparator = true;
+				separator = c;
+				break;
+			}
+
+			hasSeparator = true;
+			separator = c;
+			continue;
+		}
+
+		if (isIn(c, _ignores))
+			continue;
+
+		token += c;
+	}
+
+	if (!token.empty() && (*token.begin() == '\0'))
+		token.clear();
+
+	if (!chunkEnd && (_conSepRule != Common::StreamTokenizer::kRuleHeed)) {
+		while (!stream.eos()) {
+			uint32 c = stream.readByte();
+
+			if (((_conSepRule == Common::StreamTokenizer::kRuleIgnoreSame) && (c != separator)) ||
+			    ((_conSepRule == Common::StreamTokenizer::kRuleIgnoreAll ) && !isIn(c, _separators))) {
+
+				stream.seek(-1, SEEK_CUR);
+				break;
+			}
+		}
+	}
+
+	return token;
+}
+
+int OldStreamTokenizer::getTokens(Common::SeekableReadStream &stream, std::vector<Common::UString> &list,
+                                  int min, int max, const Common::UString &def) {
+
+	list.clear();
+	list.reserve(min);
+
+	int realTokenCount;
+	for (realTokenCount = 0; !isChunkEnd(stream) && ((max < 0) || (realTokenCount < max)); realTokenCount++) {
+		Common::UString token = getToken(stream);
+
+		if (!token.empty() || (_conSepRule != Common::StreamTokenizer::kRuleIgnoreAll))
+			list.push_back(token);
+	}
+
+	while (list.size() < ((uint32) min))
+		list.push_back(def);
+
+	return realTokenCount;
+}
+
+void OldStreamTokenizer::skipChunk(Common::SeekableReadStream &stream) {
+	while (!stream.eos() && !stream.err()) {
+		if (isIn(stream.readByte(), _chunkEnds)) {
+			stream.seek(-1, SEEK_CUR);
+			break;
+		}
+	}
+
+	if (stream.err())
+		throw Common::Exception(Common::kReadError);
+}
+
+void OldStreamTokenizer::nextChunk(Common::SeekableReadStream &stream) {
+	skipChunk(stream);
+
+	byte c = stream.readByte();
+
+	if (stream.eos() || stream.err())
+		return;
+
+	if (!isIn(c, _chunkEnds))
+		stream.seek(-1, SEEK_CUR);
+	else
+		if (stream.pos() == stream.size())
+			stream.readByte();
+}
+
+bool OldStreamTokenizer::isChunkEnd(Common::SeekableReadStream &stream) {
+	if (stream.eos())
+		return true;
+
+	bool chunkEnd = isIn(stream.readByte(), _chunkEnds);
+
+	stream.seek(-1, SEEK_CUR);
+
+	return chunkEnd;
+}
+
+/** Set up a tokenizer the way the text 2DA reader does. */
+template<class Tokenizer>
+static void setupTwoDATokenizer(Tokenizer &tokenizer) {
+	tokenizer.addSeparator(' ');
+	tokenizer.addSeparator('\t');
+	tokenizer.addQuote('"');
+	tokenizer.addChunkEnd('\n');
+	tokenizer.addIgnore('\r');
+}
+
+/** Set up a tokenizer the way the ASCII NWN model loader does. */
+template<class Tokenizer>
+static void setupMDLTokenizer(Tokenizer &tokenizer) {
+	tokenizer.addSeparator(' ');
+	tokenizer.addChunkEnd('\n');
+	tokenizer.addIgnore('\r');
+}
+
+/** Tokenize a whole stream line by line, the way the loaders do.
+ *
+ *  If a trace is given, every token, every line's token count and the
+ *  stream position after every line are recorded into it.
+ *
+ *  @return The number of tokens.
+ */
+template<class Tokenizer>
+static uint32 tokenizeLines(Tokenizer &tokenizer, Common::SeekableReadStream &stream,
+                            std::vector<Common::UString> *trace = 0) {
+
+	std::vector<Common::UString> line;
+
+	// Every line consumes at least one byte, but don't hang if a tokenizer doesn't
+	uint32 tokens = 0;
+	for (int32 lines = 0; !stream.eos() && (lines <= stream.size()); lines++) {
+		const int count = tokenizer.getTokens(stream, line);
+
+		tokenizer.nextChunk(stream);
+
+		tokens += line.size();
+
+		if (trace) {
+			trace->insert(trace->end(), line.begin(), line.end());
+			trace->push_back(Common::UString::sprintf("<%d %d %d>", count, stream.pos(), stream.eos()));
+		}
+	}
+
+	return tokens;
+}
+
+/** Tokenize data with the tokenizer and the old one, and return whether they agree. */
+static bool compareTokenizers(const std::vector<byte> &data, Common::StreamTokenizer::ConsecutiveSeparatorRule rule,
+                              bool mdl, bool memory) {
+
+	Common::StreamTokenizer newTokenizer(rule);
+	OldStreamTokenizer      oldTokenizer(rule);
+
+	if (mdl) {
+		setupMDLTokenizer(newTokenizer);
+		setupMDLTokenizer(oldTokenizer);
+	} else {
+		setupTwoDATokenizer(newTokenizer);
+		setupTwoDATokenizer(oldTokenizer);
+	}
+
+	const byte *dataPtr = data.empty() ? 0 : &data[0];
+
+	std::vector<Common::UString> newTrace, oldTrace;
+
+	Common::MemoryReadStream newStream(dataPtr, data.size());
+	Common::MemoryReadStream oldStream(dataPtr, data.size());
+
+	if (memory) {
+		tokenizeLines(newTokenizer, newStream, &newTrace);
+	} else {
+		// Hide the memory stream, so that the tokenizer has to copy the data out
+		Common::SeekableSubReadStream subStream(&newStream, 0, data.size());
+
+		tokenizeLines(newTokenizer, subStream, &newTrace);
+	}
+
+	tokenizeLines(oldTokenizer, oldStream, &oldTrace);
+
+	return newTrace == oldTrace;
+}
+
+/** Compare the tokenizer against the old one on random short inputs. */
+static void checkTokenizer() {
+	static const char kCharacters[] = "  \t\t\"\r\n\nab";
+
+	static const Common::StreamTokenizer::ConsecutiveSeparatorRule kRules[] = {
+		Common::StreamTokenizer::kRuleIgnoreSame,
+		Common::StreamTokenizer::kRuleIgnoreAll,
+		Common::StreamTokenizer::kRuleHeed
+	};
+
+	status("Comparing the tokenizer against the old one on %u random inputs", kTokenizerChecks);
+
+	uint32 mismatches = 0;
+	for (uint32 i = 0; i < kTokenizerChecks; i++) {
+		// Mostly short inputs, but some longer than what the tokenizer copies out of a stream at once
+		const uint32 length = ((i % 16) == 0) ? (std::rand() % 1024) : (std::rand() % 64);
+
+		std::vector<byte> data(length);
+		for (uint32 j = 0; j < length; j++)
+			data[j] = kCharacters[std::rand() % (sizeof(kCharacters) - 1)];
+
+		// Every line ends properly, like in the files the loaders read
+		data.push_back('\n');
+
+		bool agree = true;
+		for (int r = 0; r < ARRAYSIZE(kRules); r++)
+			for (int mdl = 0; mdl < 2; mdl++)
+				for (int memory = 0; memory < 2; memory++)
+					agree = compareTokenizers(data, kRules[r], mdl, memory) && agree;
+
+		if (!agree)
+			mismatches++;
+	}
+
+	std::printf("%u of %u random inputs tokenized differently\n", mismatches, kTokenizerChecks);
+
+	if (mismatches > 0)
+		throw Common::Exception("The tokenizer disagrees with the old one");
+}
+
+/** A file to tokenize. */
+struct TokenizeFile {
+	Common::UString name;
+	bool mdl;
+
+	std::vector<byte> data;
+};
+
+/** Read a resource completely, if it is a text 2DA or an ASCII MDL. */
+static bool readTokenizeFile(const Common::UString &name, Aurora::FileType type, TokenizeFile &file) {
+	Common::SeekableReadStream *stream = ResMan.getResource(name, type);
+	if (!stream)
+		return false;
+
+	file.name = name;
+	file.mdl  = type == Aurora::kFileTypeMDL;
+
+	file.data.resize(stream->size());
+	const uint32 size = file.data.empty() ? 0 : stream->read(&file.data[0], file.data.size());
+
+	delete stream;
+
+	if (size != file.data.size())
+		return false;
+
+	// Binary MDLs start with a 0, binary 2DAs have a different version
+	if (file.mdl)
+		return (size >= 4) && (READ_LE_UINT32(&file.data[0]) != 0);
+
+	return (size >= 8) && !std::memcmp(&file.data[0], "2DA V2.0", 8);
+}
+
+/** Find all text 2DAs, and the given ASCII MDLs or the largest one. */
+static void findTokenizeFiles(const std::list<Common::UString> &models, std::list<TokenizeFile> &files) {
+	std::list<Common::UString> mdls(models);
+	if (mdls.empty()) {
+		std::vector<Aurora::FileType> types;
+		types.push_back(Aurora::kFileTypeMDL);
+
+		findResources(types, mdls);
+	}
+
+	TokenizeFile largest;
+	for (std::list<Common::UString>::const_iterator m = mdls.begin(); m != mdls.end(); ++m) {
+		TokenizeFile file;
+		if (!readTokenizeFile(*m, Aurora::kFileTypeMDL, file)) {
+			if (!models.empty())
+				warning("No ASCII model \"%s\"", m->c_str());
+
+			continue;
+		}
+
+		if (!models.empty())
+			files.push_back(file);
+		else if (file.data.size() > largest.data.size())
+			largest = file;
+	}
+
+	if (!largest.data.empty())
+		files.push_back(largest);
+
+	std::list<Common::UString> twoDAs;
+
+	std::vector<Aurora::FileType> types;
+	types.push_back(Aurora::kFileType2DA);
+
+	findResources(types, twoDAs);
+
+	for (std::list<Common::UString>::const_iterator t = twoDAs.begin(); t != twoDAs.end(); ++t) {
+		TokenizeFile file;
+		if (readTokenizeFile(*t, Aurora::kFileType2DA, file))
+			files.push_back(file);
+	}
+}
+
+/** Tokenize all files once, and return the number of tokens. */
+template<class Tokenizer>
+static uint32 tokenizeFiles(const std::list<TokenizeFile> &files, bool mdl) {
+	uint32 tokens = 0;
+	for (std::list<TokenizeFile>::const_iterator f = files.begin(); f != files.end(); ++f) {
+		if (f->mdl != mdl)
+			continue;
+
+		Tokenizer tokenizer(Common::StreamTokenizer::kRuleIgnoreAll);
+		if (mdl)
+			setupMDLTokenizer(tokenizer);
+		else
+			setupTwoDATokenizer(tokenizer);
+
+		Common::MemoryReadStream stream(&f->data[0], f->data.size());
+
+		tokens += tokenizeLines(tokenizer, stream);
+	}
+
+	return tokens;
+}
+
+static void benchTokenizer(const std::list<Common::UString> &models) {
+	std::list<TokenizeFile> files;
+	findTokenizeFiles(models, files);
+
+	if (files.empty())
+		throw Common::Exception("No files to tokenize");
+
+	uint32 mismatches = 0;
+	for (std::list<TokenizeFile>::const_iterator f = files.begin(); f != files.end(); ++f) {
+		if (!compareTokenizers(f->data, Common::StreamTokenizer::kRuleIgnoreAll, f->mdl, true)) {
+			warning("\"%s\" tokenized differently", f->name.c_str());
+			mismatches++;
+		}
+	}
+
+	status("Tokenizing %u files %u times", (uint) files.size(), kTokenizeRuns);
+
+	std::printf("Format | Files |    Size (KB) |  Old (MB/s) |  New (MB/s) | Speedup\n");
+	std::printf("-------|-------|--------------|-------------|-------------|--------\n");
+
+	for (int mdl = 1; mdl >= 0; mdl--) {
+		uint32 count = 0;
+		uint64 size  = 0;
+		for (std::list<TokenizeFile>::const_iterator f = files.begin(); f != files.end(); ++f) {
+			if (f->mdl == (mdl != 0)) {
+				count++;
+				size += f->data.size();
+			}
+		}
+
+		if (count == 0)
+			continue;
+
+		uint64 start = getMicroseconds();
+		for (uint32 i = 0; i < kTokenizeRuns; i++)
+			tokenizeFiles<OldStreamTokenizer>(files, mdl);
+
+		const uint64 oldTime = MAX<uint64>(getMicroseconds() - start, 1);
+
+		start = getMicroseconds();
+		for (uint32 i = 0; i < kTokenizeRuns; i++)
+			tokenizeFiles<Common::StreamTokenizer>(files, mdl);
+
+		const uint64 newTime = MAX<uint64>(getMicroseconds() - start, 1);
+
+		const double bytes = (double) size * kTokenizeRuns;
+
+		std::printf("%-6s | %5u | %12.1f | %11.1f | %11.1f | %6.2fx\n", mdl ? "MDL" : "2DA", count, size / 1024.0,
+		            bytes / (oldTime * 1.048576), bytes / (newTime * 1.048576), (double) oldTime / newTime);
+	}
+
+	if (mismatches > 0)
+		throw Common::Exception("%u files tokenized differently", mismatches);
+}
+
+static void deinit() {
+	destroySingletons();
+
+	// The singletons' threads are gone, nothing can be allocating concurrently anymore
+	deinitAllocationCounting();
+}
@@ -0,0 +1,82 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey and Eclipse engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file singletons.cpp
+ *  Destroying the global singletons on shutdown.
+ */
+
+#include "singletons.h"
+
+#include "common/debugman.h"
+#include "common/configman.h"
+
+#include "aurora/resman.h"
+#include "aurora/2dareg.h"
+#include "aurora/talkman.h"
+
+#include "graphics/queueman.h"
+#include "graphics/graphics.h"
+
+#include "sound/sound.h"
+
+#include "events/requests.h"
+#include "events/events.h"
+#include "events/timerman.h"
+
+#include "engines/enginemanager.h"
+
+#include "graphics/aurora/textureman.h"
+#include "graphics/aurora/cursorman.h"
+#include "graphics/aurora/fontman.h"
+#include "graphics/aurora/modelcache.h"
+#include "graphics/aurora/skinning.h"
+#include "graphics/aurora/nodeindex.h"
+
+void destroySingletons() {
+	Graphics::Aurora::FontManager::destroy();
+	Graphics::Aurora::CursorManager::destroy();
+	Graphics::Aurora::ModelCache::destroy();
+	Graphics::Aurora::SkinManager::destroy();
+	Graphics::Aurora::NodeNameManager::destroy();
+	Graphics::Aurora::TextureManager::destroy();
+
+	Aurora::TalkManager::destroy();
+	Aurora::TwoDARegistry::destroy();
+	Aurora::ResourceManager::destroy();
+
+	Engines::EngineManager::destroy();
+
+	Events::EventsManager::destroy();
+	Events::RequestManager::destroy();
+	Events::TimerManager::destroy();
+
+	Sound::SoundManager::destroy();
+
+	Graphics::GraphicsManager::destroy();
+	Graphics::QueueManager::destroy();
+
+	Common::DebugManager::destroy();
+	Common::ConfigManager::destroy();
+}
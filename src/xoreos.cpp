@@ -30,6 +30,7 @@
 #include <cstdio>
 
 #include "cline.h"
+#include "singletons.h"
 
 #include "common/ustring.h"
 #include "common/util.h"
@@ -39,26 +40,14 @@
 #include "common/debugman.h"
 #include "common/configman.h"
 
-#include "aurora/resman.h"
-#include "aurora/2dareg.h"
-#include "aurora/talkman.h"
-
-#include "graphics/queueman.h"
 #include "graphics/graphics.h"
 
 #include "sound/sound.h"
 
-#include "events/requests.h"
 #include "events/events.h"
-#include "events/timerman.h"
 
-#include "engines/enginemanager.h"
 #include "engines/gamethread.h"
 
-#include "graphics/aurora/textureman.h"
-#include "graphics/aurora/cursorman.h"
-#include "graphics/aurora/fontman.h"
-
 void initConfig();
 
 void init();
@@ -188,6 +177,13 @@ void initConfig() {
 	ConfigMan.setBool  (Common::kConfigRealmDefault, "fullscreen", false);
 	ConfigMan.setInt   (Common::kConfigRealmDefault, "fsaa",       0);
 	ConfigMan.setDouble(Common::kConfigRealmDefault, "gamma",    1.0);
+	ConfigMan.setDouble(Common::kConfigRealmDefault, "lodbias",  1.0);
+	ConfigMan.setInt   (Common::kConfigRealmDefault, "atlastexturesize", 256);
+	ConfigMan.setInt   (Common::kConfigRealmDefault, "texturecache",      64);
+	ConfigMan.setInt   (Common::kConfigRealmDefault, "texturestreaming", 1024);
+	ConfigMan.setInt   (Common::kConfigRealmDefault, "modelcache",         32);
+	ConfigMan.setInt   (Common::kConfigRealmDefault, "modelthreads",        2);
+	ConfigMan.setInt   (Common::kConfigRealmDefault, "skinthreads",         2);
 
 	ConfigMan.setDouble(Common::kConfigRealmDefault, "volume"      , 1.0);
 	ConfigMan.setDouble(Common::kConfigRealmDefault, "volume_music", 1.0);
@@ -253,26 +249,5 @@ void deinit() {
 	} catch (...) {
 	}
 
-	// Destroy global singletons
-	Graphics::Aurora::FontManager::destroy();
-	Graphics::Aurora::CursorManager::destroy();
-	Graphics::Aurora::TextureManager::destroy();
-
-	Aurora::TalkManager::destroy();
-	Aurora::TwoDARegistry::destroy();
-	Aurora::ResourceManager::destroy();
-
-	Engines::EngineManager::destroy();
-
-	Events::EventsManager::destroy();
-	Events::RequestManager::destroy();
-	Events::TimerManager::destroy();
-
-	Sound::SoundManager::destroy();
-
-	Graphics::GraphicsManager::destroy();
-	Graphics::QueueManager::destroy();
-
-	Common::DebugManager::destroy();
-	Common::ConfigManager::destroy();
+	destroySingletons();
 }